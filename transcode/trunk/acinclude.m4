@@ -140,6 +140,28 @@ AC_DEFUN([TC_C_ATTRIBUTE_ALIGNED],
 
 dnl -----------------------------------------------------------------------
 
+dnl TC_C_GCC_SYNC_BUILTINS
+dnl See if the __sync_*() atomic builtins are available (and link, since
+dnl some targets lack the needed instructions and emit library calls).
+dnl
+AC_DEFUN([TC_C_GCC_SYNC_BUILTINS],
+    [AC_CACHE_CHECK([__sync_*() atomic builtins support],
+        [ac_cv_c_gcc_sync_builtins],
+        [AC_TRY_LINK([],
+            [unsigned long v = 0;
+             __sync_bool_compare_and_swap(&v, 0, 1);
+             __sync_fetch_and_add(&v, 1);
+             __sync_synchronize();
+             return (int)v;],
+            [ac_cv_c_gcc_sync_builtins=yes],
+            [ac_cv_c_gcc_sync_builtins=no])])
+    if test x"$ac_cv_c_gcc_sync_builtins" = x"yes"; then
+        AC_DEFINE([HAVE_SYNC_BUILTINS], 1,
+               [Compiler provides the __sync_*() atomic builtins])
+    fi])
+
+dnl -----------------------------------------------------------------------
+
 dnl TC_TRY_CFLAGS (CFLAGS, [ACTION-IF-WORKS], [ACTION-IF-FAILS])
 dnl Check if $CC supports a given set of CFLAGS.
 
@@ -33,6 +33,9 @@
 #define AC_SSE          0x0080  /* x86: SSE instructions */
 #define AC_SSE2         0x0100  /* x86: SSE2 instructions */
 #define AC_SSE3         0x0200  /* x86: SSE3 instructions */
+#define AC_AVX          0x0400  /* x86: AVX instructions */
+#define AC_AVX2         0x0800  /* x86: AVX2 instructions */
+#define AC_AVX512       0x1000  /* x86: AVX-512 (foundation) instructions */
 
 #define AC_NONE         0       /* No acceleration (vanilla C functions) */
 #define AC_ALL          (~0)    /* All available acceleration */
@@ -56,6 +59,11 @@ extern int ac_init(int accel);
 /* Returns the set of acceleration features supported by this CPU. */
 extern int ac_cpuinfo(void);
 
+/* Returns the set of acceleration features enabled by the last ac_init()
+ * call (already masked by ac_cpuinfo()), for code outside aclib which
+ * selects its own accelerated routines. */
+extern int ac_getaccel(void);
+
 /* Returns the endianness of this CPU (AC_BIG_ENDIAN or AC_LITTLE_ENDIAN). */
 extern int ac_endian(void);
 
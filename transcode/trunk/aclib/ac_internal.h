@@ -22,6 +22,17 @@
 /* Are _all_ of the given acceleration flags (`test') available? */
 #define HAS_ACCEL(accel,test) (((accel) & (test)) == (test))
 
+/* AVX2 routines are written with compiler intrinsics and compiled for
+ * AVX2 whatever the compiler flags; they are only selected at run time
+ * if the CPU (and OS) support it.  This needs a compiler which
+ * understands the target attribute with <immintrin.h>. */
+#if (defined(ARCH_X86) || defined(ARCH_X86_64)) \
+ && (defined(__clang__) || __GNUC__ > 4 \
+     || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define HAVE_AC_AVX2
+# define AC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 /* Initialization subfunctions */
 extern int ac_average_init(int accel);
 extern int ac_imgconvert_init(int accel);
@@ -19,6 +19,9 @@
 static int cpuinfo_x86(void);
 #endif
 
+/* Acceleration flags given to the last ac_init() call */
+static int ac_accel = AC_NONE;
+
 /*************************************************************************/
 
 /* Library initialization function.  Determines CPU features, then calls
@@ -29,6 +32,7 @@ static int cpuinfo_x86(void);
 int ac_init(int accel)
 {
     accel &= ac_cpuinfo();
+    ac_accel = accel;
     if (!ac_average_init(accel)
      || !ac_imgconvert_init(accel)
      || !ac_memcpy_init(accel)
@@ -54,6 +58,15 @@ int ac_cpuinfo(void)
 
 /*************************************************************************/
 
+/* Returns the set of acceleration features enabled by ac_init(). */
+
+int ac_getaccel(void)
+{
+    return ac_accel;
+}
+
+/*************************************************************************/
+
 /* Returns the endianness of this CPU (AC_BIG_ENDIAN or AC_LITTLE_ENDIAN). */
 
 int ac_endian(void)
@@ -78,7 +91,10 @@ const char *ac_flagstotext(int accel)
     static char retbuf[1000];
     if (!accel)
         return "none";
-    snprintf(retbuf, sizeof(retbuf), "%s%s%s%s%s%s%s%s%s",
+    snprintf(retbuf, sizeof(retbuf), "%s%s%s%s%s%s%s%s%s%s%s%s",
+             accel & AC_AVX512                ? " avx512"   : "",
+             accel & AC_AVX2                  ? " avx2"     : "",
+             accel & AC_AVX                   ? " avx"      : "",
              accel & AC_SSE3                  ? " sse3"     : "",
              accel & AC_SSE2                  ? " sse2"     : "",
              accel & AC_SSE                   ? " sse"      : "",
@@ -124,6 +140,19 @@ const char *ac_flagstotext(int accel)
         : "=a" (ret_a), "=S" (ret_b), "=c" (ret_c), "=d" (ret_d)        \
         : "a" (func))
 
+/* Same as CPUID(), for functions taking a subfunction number in ECX. */
+#define CPUID_COUNT(func,sub,ret_a,ret_b,ret_c,ret_d)                   \
+    asm("mov "EBX", "ESI"; cpuid; xchg "EBX", "ESI                      \
+        : "=a" (ret_a), "=S" (ret_b), "=c" (ret_c), "=d" (ret_d)        \
+        : "a" (func), "c" (sub))
+
+/* Macro to read extended control register `reg' (XGETBV instruction,
+ * written as bytes for older assemblers) into ret_a (low) and ret_d
+ * (high). */
+#define XGETBV(reg,ret_a,ret_d)                                         \
+    asm(".byte 0x0F, 0x01, 0xD0"                                        \
+        : "=a" (ret_a), "=d" (ret_d) : "c" (reg))
+
 /* Various CPUID flags.  The second word of the macro name indicates the
  * function (1: function 1, X1: function 0x80000001) and register (D: EDX)
  * to which the value belongs. */
@@ -132,6 +161,10 @@ const char *ac_flagstotext(int accel)
 #define CPUID_1D_SSE            (1UL<<25)
 #define CPUID_1D_SSE2           (1UL<<26)
 #define CPUID_1C_SSE3           (1UL<< 0)
+#define CPUID_1C_OSXSAVE        (1UL<<27)
+#define CPUID_1C_AVX            (1UL<<28)
+#define CPUID_7B_AVX2           (1UL<< 5)
+#define CPUID_7B_AVX512F        (1UL<<16)
 #define CPUID_X1D_AMD_MMXEXT    (1UL<<22)  /* AMD only */
 #define CPUID_X1D_AMD_3DNOW     (1UL<<31)  /* AMD only */
 #define CPUID_X1D_AMD_3DNOWEXT  (1UL<<30)  /* AMD only */
@@ -142,7 +175,8 @@ static int cpuinfo_x86(void)
     uint32_t eax, ebx, ecx, edx;
     uint32_t cpuid_max, cpuid_ext_max;  /* Maximum CPUID function numbers */
     char cpu_vendor[13];  /* 12-byte CPU vendor string + trailing null */
-    uint32_t cpuid_1D, cpuid_1C, cpuid_X1D;
+    uint32_t cpuid_1D, cpuid_1C, cpuid_7B, cpuid_X1D;
+    uint32_t xcr0 = 0;  /* Register states saved by the OS */
     int accel;
 
     /* First see if the CPUID instruction is even available.  We try to
@@ -172,9 +206,13 @@ static int cpuinfo_x86(void)
     CPUID(0x80000000, cpuid_ext_max, ebx, ecx, edx);
 
     /* Read available features */
-    cpuid_1D = cpuid_1C = cpuid_X1D = 0;
+    cpuid_1D = cpuid_1C = cpuid_7B = cpuid_X1D = 0;
     if (cpuid_max >= 1)
         CPUID(1, eax, ebx, cpuid_1C, cpuid_1D);
+    if (cpuid_max >= 7)
+        CPUID_COUNT(7, 0, eax, cpuid_7B, ecx, edx);
+    if (cpuid_1C & CPUID_1C_OSXSAVE)
+        XGETBV(0, xcr0, edx);
     if (cpuid_ext_max >= 0x80000001)
         CPUID(0x80000001, eax, ebx, ecx, cpuid_X1D);
 
@@ -194,6 +232,16 @@ static int cpuinfo_x86(void)
         accel |= AC_SSE2;
     if (cpuid_1C & CPUID_1C_SSE3)
         accel |= AC_SSE3;
+    /* AVX registers are only usable if the OS saves them on context
+     * switches: XCR0 bits 1-2 (XMM/YMM), plus 5-7 (opmask/ZMM) for
+     * AVX-512 */
+    if ((cpuid_1C & CPUID_1C_AVX) && (xcr0 & 0x06) == 0x06) {
+        accel |= AC_AVX;
+        if (cpuid_7B & CPUID_7B_AVX2)
+            accel |= AC_AVX2;
+        if ((cpuid_7B & CPUID_7B_AVX512F) && (xcr0 & 0xE0) == 0xE0)
+            accel |= AC_AVX512;
+    }
     if (strcmp(cpu_vendor, "AuthenticAMD") == 0) {
         if (cpuid_X1D & CPUID_X1D_AMD_MMXEXT)
             accel |= AC_MMXEXT;
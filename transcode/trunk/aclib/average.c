@@ -205,6 +205,40 @@ static void average_sse2(const uint8_t *src1, const uint8_t *src2,
 
 #endif  /* HAVE_ASM_SSE2 */
 
+/*************************************************************************/
+
+/* AVX2 version */
+
+#if defined(HAVE_AC_AVX2)
+
+#include <immintrin.h>
+
+static AC_TARGET_AVX2 void average_avx2(const uint8_t *src1,
+                                        const uint8_t *src2,
+                                        uint8_t *dest, int bytes)
+{
+    int i;
+
+    for (i = 0; i + 64 <= bytes; i += 64) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(src1 + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(src1 + i + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(src2 + i));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(src2 + i + 32));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_avg_epu8(a0, b0));
+        _mm256_storeu_si256((__m256i *)(dest + i + 32),
+                            _mm256_avg_epu8(a1, b1));
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src2 + i));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_avg_epu8(a, b));
+    }
+    if (UNLIKELY(i < bytes))
+        average(src1+i, src2+i, dest+i, bytes-i);
+}
+
+#endif  /* HAVE_AC_AVX2 */
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -226,6 +260,10 @@ int ac_average_init(int accel)
     if (HAS_ACCEL(accel, AC_SSE2))
         average_ptr = average_sse2;
 #endif
+#if defined(HAVE_AC_AVX2)
+    if (HAS_ACCEL(accel, AC_AVX2))
+        average_ptr = average_avx2;
+#endif
 
     return 1;
 }
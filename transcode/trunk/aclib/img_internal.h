@@ -11,10 +11,6 @@
 #ifndef ACLIB_IMG_INTERNAL_H
 #define ACLIB_IMG_INTERNAL_H
 
-/* Type of a conversion function */
-typedef int (*ConversionFunc)(uint8_t **src, uint8_t **dest,
-                              int width, int height);
-
 /* Function to register a conversion */
 extern int register_conversion(ImageFormat srcfmt, ImageFormat destfmt,
                                ConversionFunc function);
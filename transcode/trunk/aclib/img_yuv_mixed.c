@@ -9,6 +9,7 @@
  */
 
 #include "ac.h"
+#include "ac_internal.h"
 #include "imgconvert.h"
 #include "img_internal.h"
 
@@ -17,71 +18,8 @@
 
 /* Standard C implementations */
 
-/*************************************************************************/
-
-/* Wrappers for UYVY and YVYU */
-/* Note: we rely on YUY2<->{UYVY,YVYU} working for src==dest */
-/* FIXME: when converting from UYVY/YVYU, src is destroyed! */
-
-static int uyvy_yvyu_wrapper(uint8_t **src, ImageFormat srcfmt,
-                             uint8_t **dest, ImageFormat destfmt,
-                             int width, int height)
-{
-    if (srcfmt == IMG_UYVY || srcfmt == IMG_YVYU)
-        return ac_imgconvert(src, srcfmt, src, IMG_YUY2, width, height)
-            && ac_imgconvert(src, IMG_YUY2, dest, destfmt, width, height);
-    else
-        return ac_imgconvert(src, srcfmt, dest, IMG_YUY2, width, height)
-            && ac_imgconvert(dest, IMG_YUY2, dest, destfmt, width, height);
-}
-
-static int yuv420p_uyvy(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV420P, dest, IMG_UYVY, width, height); }
-
-static int yuv420p_yvyu(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV420P, dest, IMG_YVYU, width, height); }
-
-static int yuv411p_uyvy(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV411P, dest, IMG_UYVY, width, height); }
-
-static int yuv411p_yvyu(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV411P, dest, IMG_YVYU, width, height); }
-
-static int yuv422p_uyvy(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV422P, dest, IMG_UYVY, width, height); }
-
-static int yuv422p_yvyu(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV422P, dest, IMG_YVYU, width, height); }
-
-static int yuv444p_uyvy(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV444P, dest, IMG_UYVY, width, height); }
-
-static int yuv444p_yvyu(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YUV444P, dest, IMG_YVYU, width, height); }
-
-static int uyvy_yuv420p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_UYVY, dest, IMG_YUV420P, width, height); }
-
-static int yvyu_yuv420p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YVYU, dest, IMG_YUV420P, width, height); }
-
-static int uyvy_yuv411p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_UYVY, dest, IMG_YUV411P, width, height); }
-
-static int yvyu_yuv411p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YVYU, dest, IMG_YUV411P, width, height); }
-
-static int uyvy_yuv422p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_UYVY, dest, IMG_YUV422P, width, height); }
-
-static int yvyu_yuv422p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YVYU, dest, IMG_YUV422P, width, height); }
-
-static int uyvy_yuv444p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_UYVY, dest, IMG_YUV444P, width, height); }
-
-static int yvyu_yuv444p(uint8_t **src, uint8_t **dest, int width, int height)
-{ return uyvy_yvyu_wrapper(src, IMG_YVYU, dest, IMG_YUV444P, width, height); }
+/* There are no C conversions between UYVY/YVYU and the planar formats;
+ * ac_imgconvert() does these through YUY2 (see find_routes()). */
 
 /*************************************************************************/
 
@@ -903,6 +841,447 @@ static int uyvy_y8_sse2(uint8_t **src, uint8_t **dest, int width, int height)
 /*************************************************************************/
 /*************************************************************************/
 
+#if defined(HAVE_AC_AVX2)
+
+/* AVX2 routines.  All three packed formats are handled by the same code,
+ * parametrized by where Y and V sit in each 4-byte pixel pair:
+ *     YUY2: Y U Y V   (yodd=0, vfirst=0)
+ *     UYVY: U Y V Y   (yodd=1, vfirst=0)
+ *     YVYU: Y V Y U   (yodd=0, vfirst=1)
+ * so UYVY and YVYU get direct conversions here instead of going through
+ * uyvy_yvyu_wrapper() (which also means the source is left untouched). */
+
+#include <immintrin.h>
+
+#define AVX2_INLINE static inline AC_TARGET_AVX2
+
+/* Interleave 32 `first' and 32 `second' bytes into 64 bytes at `dest' */
+AVX2_INLINE void interleave_store_avx2(uint8_t *dest,
+                                       __m256i first, __m256i second)
+{
+    first  = _mm256_permute4x64_epi64(first,  0xD8);
+    second = _mm256_permute4x64_epi64(second, 0xD8);
+    _mm256_storeu_si256((__m256i *)dest,
+                        _mm256_unpacklo_epi8(first, second));
+    _mm256_storeu_si256((__m256i *)(dest+32),
+                        _mm256_unpackhi_epi8(first, second));
+}
+
+/* Store 32 Y bytes and 16 U/V words as 32 packed pixels */
+AVX2_INLINE void store_packed_avx2(uint8_t *dest, __m256i Y,
+                                   __m256i Uw, __m256i Vw,
+                                   int yodd, int vfirst)
+{
+    __m256i C = vfirst ? _mm256_or_si256(Vw, _mm256_slli_epi16(Uw, 8))
+                       : _mm256_or_si256(Uw, _mm256_slli_epi16(Vw, 8));
+    if (yodd)
+        interleave_store_avx2(dest, C, Y);
+    else
+        interleave_store_avx2(dest, Y, C);
+}
+
+/* Load 32 packed pixels as 32 Y bytes and 16 U/V words */
+AVX2_INLINE void load_packed_avx2(const uint8_t *src, __m256i *Y,
+                                  __m256i *Uw, __m256i *Vw,
+                                  int yodd, int vfirst)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    __m256i s0 = _mm256_loadu_si256((const __m256i *)src);
+    __m256i s1 = _mm256_loadu_si256((const __m256i *)(src+32));
+    __m256i y0, y1, c0, c1, C;
+
+    if (yodd) {
+        y0 = _mm256_srli_epi16(s0, 8);
+        y1 = _mm256_srli_epi16(s1, 8);
+        c0 = _mm256_and_si256(s0, mask);
+        c1 = _mm256_and_si256(s1, mask);
+    } else {
+        y0 = _mm256_and_si256(s0, mask);
+        y1 = _mm256_and_si256(s1, mask);
+        c0 = _mm256_srli_epi16(s0, 8);
+        c1 = _mm256_srli_epi16(s1, 8);
+    }
+    *Y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1), 0xD8);
+    C = _mm256_permute4x64_epi64(_mm256_packus_epi16(c0, c1), 0xD8);
+    if (vfirst) {
+        *Uw = _mm256_srli_epi16(C, 8);
+        *Vw = _mm256_and_si256(C, mask);
+    } else {
+        *Uw = _mm256_and_si256(C, mask);
+        *Vw = _mm256_srli_epi16(C, 8);
+    }
+}
+
+/*************************************************************************/
+
+/* One row (or a whole image, if rows need not be handled separately) of
+ * planar -> packed.  `hshift' gives the chroma subsampling of the source:
+ * 0 for 4:4:4, 1 for 4:2:x, 2 for 4:1:1 (unit: 2 pixels) */
+AVX2_INLINE void planar_packed_row_avx2(const uint8_t *srcY,
+                                        const uint8_t *srcU,
+                                        const uint8_t *srcV,
+                                        uint8_t *dest, int npix,
+                                        int hshift, int yodd, int vfirst)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int x;
+
+    for (x = 0; x + 32 <= npix; x += 32) {
+        __m256i Y = _mm256_loadu_si256((const __m256i *)(srcY+x));
+        __m256i Uw, Vw;
+        if (hshift == 0) {
+            __m256i u = _mm256_loadu_si256((const __m256i *)(srcU+x));
+            __m256i v = _mm256_loadu_si256((const __m256i *)(srcV+x));
+            Uw = _mm256_avg_epu16(_mm256_and_si256(u, mask),
+                                  _mm256_srli_epi16(u, 8));
+            Vw = _mm256_avg_epu16(_mm256_and_si256(v, mask),
+                                  _mm256_srli_epi16(v, 8));
+        } else if (hshift == 1) {
+            Uw = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(srcU+x/2)));
+            Vw = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(srcV+x/2)));
+        } else {
+            __m128i u = _mm_loadl_epi64((const __m128i *)(srcU+x/4));
+            __m128i v = _mm_loadl_epi64((const __m128i *)(srcV+x/4));
+            Uw = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u, u));
+            Vw = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v, v));
+        }
+        store_packed_avx2(dest+x*2, Y, Uw, Vw, yodd, vfirst);
+    }
+    for (; x + 1 < npix; x += 2) {
+        int U, V;
+        if (hshift == 0) {
+            U = (srcU[x] + srcU[x+1]) / 2;
+            V = (srcV[x] + srcV[x+1]) / 2;
+        } else {
+            U = srcU[x >> hshift];
+            V = srcV[x >> hshift];
+        }
+        dest[x*2 + yodd    ] = srcY[x];
+        dest[x*2 + yodd + 2] = srcY[x+1];
+        dest[x*2 + !yodd + (vfirst ? 2 : 0)] = U;
+        dest[x*2 + !yodd + (vfirst ? 0 : 2)] = V;
+    }
+}
+
+/* One row (or a whole image) of packed -> planar.  `hshift' gives the
+ * chroma subsampling of the destination, as above (unit: 2 pixels, 4 for
+ * 4:1:1).  If `src2' is not NULL, a second row is converted to `destY2'
+ * and the chroma of the two rows is averaged (4:2:0). */
+AVX2_INLINE void packed_planar_row_avx2(const uint8_t *src,
+                                        const uint8_t *src2,
+                                        uint8_t *destY, uint8_t *destY2,
+                                        uint8_t *destU, uint8_t *destV,
+                                        int npix, int hshift,
+                                        int yodd, int vfirst)
+{
+    const int uofs = !yodd + (vfirst ? 2 : 0);
+    const int vofs = !yodd + (vfirst ? 0 : 2);
+    int x;
+
+    for (x = 0; x + 32 <= npix; x += 32) {
+        __m256i Y, Uw, Vw;
+        load_packed_avx2(src+x*2, &Y, &Uw, &Vw, yodd, vfirst);
+        _mm256_storeu_si256((__m256i *)(destY+x), Y);
+        if (src2) {
+            __m256i Y2, Uw2, Vw2;
+            load_packed_avx2(src2+x*2, &Y2, &Uw2, &Vw2, yodd, vfirst);
+            _mm256_storeu_si256((__m256i *)(destY2+x), Y2);
+            Uw = _mm256_avg_epu16(Uw, Uw2);
+            Vw = _mm256_avg_epu16(Vw, Vw2);
+        }
+        if (hshift == 0) {
+            _mm256_storeu_si256((__m256i *)(destU+x),
+                                _mm256_or_si256(Uw, _mm256_slli_epi16(Uw, 8)));
+            _mm256_storeu_si256((__m256i *)(destV+x),
+                                _mm256_or_si256(Vw, _mm256_slli_epi16(Vw, 8)));
+        } else if (hshift == 1) {
+            __m256i uv = _mm256_permute4x64_epi64(
+                _mm256_packus_epi16(Uw, Vw), 0xD8);
+            _mm_storeu_si128((__m128i *)(destU+x/2),
+                             _mm256_castsi256_si128(uv));
+            _mm_storeu_si128((__m128i *)(destV+x/2),
+                             _mm256_extracti128_si256(uv, 1));
+        } else {
+            const __m256i mask = _mm256_set1_epi32(0xFFFF);
+            const __m256i order = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+            __m256i uv;
+            Uw = _mm256_avg_epu16(_mm256_and_si256(Uw, mask),
+                                  _mm256_srli_epi32(Uw, 16));
+            Vw = _mm256_avg_epu16(_mm256_and_si256(Vw, mask),
+                                  _mm256_srli_epi32(Vw, 16));
+            uv = _mm256_packus_epi32(Uw, Vw);
+            uv = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(uv, uv),
+                                             order);
+            _mm_storel_epi64((__m128i *)(destU+x/4),
+                             _mm256_castsi256_si128(uv));
+            _mm_storel_epi64((__m128i *)(destV+x/4),
+                             _mm_srli_si128(_mm256_castsi256_si128(uv), 8));
+        }
+    }
+    if (hshift == 2) {
+        for (; x + 3 < npix; x += 4) {
+            destY[x  ] = src[x*2 + yodd];
+            destY[x+1] = src[x*2 + yodd + 2];
+            destY[x+2] = src[x*2 + yodd + 4];
+            destY[x+3] = src[x*2 + yodd + 6];
+            destU[x/4] = (src[x*2+uofs] + src[x*2+uofs+4] + 1) / 2;
+            destV[x/4] = (src[x*2+vofs] + src[x*2+vofs+4] + 1) / 2;
+        }
+        return;
+    }
+    for (; x + 1 < npix; x += 2) {
+        destY[x  ] = src[x*2 + yodd];
+        destY[x+1] = src[x*2 + yodd + 2];
+        if (src2) {
+            destY2[x  ] = src2[x*2 + yodd];
+            destY2[x+1] = src2[x*2 + yodd + 2];
+            destU[x/2] = (src[x*2+uofs] + src2[x*2+uofs] + 1) / 2;
+            destV[x/2] = (src[x*2+vofs] + src2[x*2+vofs] + 1) / 2;
+        } else if (hshift == 0) {
+            destU[x] = destU[x+1] = src[x*2+uofs];
+            destV[x] = destV[x+1] = src[x*2+vofs];
+        } else {
+            destU[x/2] = src[x*2+uofs];
+            destV[x/2] = src[x*2+vofs];
+        }
+    }
+}
+
+/*************************************************************************/
+
+/* Planar -> packed drivers; `fmt' is the packed format, `yodd' and
+ * `vfirst' its layout as described above */
+
+#define DEFINE_PLANAR_PACKED_AVX2(fmt,yodd,vfirst) \
+static AC_TARGET_AVX2 int yuv420p_##fmt##_avx2(uint8_t **src, uint8_t **dest,\
+                                               int width, int height)   \
+{                                                                       \
+    int y;                                                              \
+    for (y = 0; y < (height & ~1); y++) {                               \
+        planar_packed_row_avx2(src[0]+y*width, src[1]+(y/2)*(width/2),  \
+                               src[2]+(y/2)*(width/2), dest[0]+y*width*2,\
+                               width & ~1, 1, yodd, vfirst);            \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int yuv411p_##fmt##_avx2(uint8_t **src, uint8_t **dest,\
+                                               int width, int height)   \
+{                                                                       \
+    if (!(width & 3)) {                                                 \
+        /* Fast version, no bytes at end of row to skip */              \
+        planar_packed_row_avx2(src[0], src[1], src[2], dest[0],         \
+                               width*height, 2, yodd, vfirst);          \
+    } else {                                                            \
+        /* Slow version, loop through each row */                       \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            planar_packed_row_avx2(src[0]+y*width, src[1]+y*(width/4),  \
+                                   src[2]+y*(width/4), dest[0]+y*width*2,\
+                                   width & ~1, 2, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int yuv422p_##fmt##_avx2(uint8_t **src, uint8_t **dest,\
+                                               int width, int height)   \
+{                                                                       \
+    if (!(width & 1)) {                                                 \
+        planar_packed_row_avx2(src[0], src[1], src[2], dest[0],         \
+                               width*height, 1, yodd, vfirst);          \
+    } else {                                                            \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            planar_packed_row_avx2(src[0]+y*width, src[1]+y*(width/2),  \
+                                   src[2]+y*(width/2), dest[0]+y*width*2,\
+                                   width & ~1, 1, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int yuv444p_##fmt##_avx2(uint8_t **src, uint8_t **dest,\
+                                               int width, int height)   \
+{                                                                       \
+    if (!(width & 1)) {                                                 \
+        planar_packed_row_avx2(src[0], src[1], src[2], dest[0],         \
+                               width*height, 0, yodd, vfirst);          \
+    } else {                                                            \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            planar_packed_row_avx2(src[0]+y*width, src[1]+y*width,      \
+                                   src[2]+y*width, dest[0]+y*width*2,   \
+                                   width & ~1, 0, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}
+
+/* Packed -> planar drivers */
+
+#define DEFINE_PACKED_PLANAR_AVX2(fmt,yodd,vfirst) \
+static AC_TARGET_AVX2 int fmt##_yuv420p_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    int y;                                                              \
+    for (y = 0; y < (height & ~1); y += 2) {                            \
+        packed_planar_row_avx2(src[0]+y*width*2, src[0]+(y+1)*width*2,  \
+                               dest[0]+y*width, dest[0]+(y+1)*width,    \
+                               dest[1]+(y/2)*(width/2),                 \
+                               dest[2]+(y/2)*(width/2),                 \
+                               width & ~1, 1, yodd, vfirst);            \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int fmt##_yuv411p_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    if (!(width & 3)) {                                                 \
+        packed_planar_row_avx2(src[0], NULL, dest[0], NULL, dest[1],    \
+                               dest[2], width*height, 2, yodd, vfirst); \
+    } else {                                                            \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            packed_planar_row_avx2(src[0]+y*width*2, NULL,              \
+                                   dest[0]+y*width, NULL,               \
+                                   dest[1]+y*(width/4),                 \
+                                   dest[2]+y*(width/4),                 \
+                                   width & ~3, 2, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int fmt##_yuv422p_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    if (!(width & 1)) {                                                 \
+        packed_planar_row_avx2(src[0], NULL, dest[0], NULL, dest[1],    \
+                               dest[2], width*height, 1, yodd, vfirst); \
+    } else {                                                            \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            packed_planar_row_avx2(src[0]+y*width*2, NULL,              \
+                                   dest[0]+y*width, NULL,               \
+                                   dest[1]+y*(width/2),                 \
+                                   dest[2]+y*(width/2),                 \
+                                   width & ~1, 1, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+static AC_TARGET_AVX2 int fmt##_yuv444p_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    if (!(width & 1)) {                                                 \
+        packed_planar_row_avx2(src[0], NULL, dest[0], NULL, dest[1],    \
+                               dest[2], width*height, 0, yodd, vfirst); \
+    } else {                                                            \
+        int y;                                                          \
+        for (y = 0; y < height; y++) {                                  \
+            packed_planar_row_avx2(src[0]+y*width*2, NULL,              \
+                                   dest[0]+y*width, NULL,               \
+                                   dest[1]+y*width, dest[2]+y*width,    \
+                                   width & ~1, 0, yodd, vfirst);        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}
+
+DEFINE_PLANAR_PACKED_AVX2(yuy2, 0, 0)
+DEFINE_PLANAR_PACKED_AVX2(uyvy, 1, 0)
+DEFINE_PLANAR_PACKED_AVX2(yvyu, 0, 1)
+DEFINE_PACKED_PLANAR_AVX2(yuy2, 0, 0)
+DEFINE_PACKED_PLANAR_AVX2(uyvy, 1, 0)
+DEFINE_PACKED_PLANAR_AVX2(yvyu, 0, 1)
+
+/*************************************************************************/
+
+/* Y8 <-> packed (YUY2 and YVYU are the same here, UYVY has `yodd' set) */
+
+AVX2_INLINE void y8_packed_avx2(const uint8_t *src, uint8_t *dest, int npix,
+                                int yodd)
+{
+    const __m256i gray = _mm256_set1_epi8(-128);
+    int i;
+
+    for (i = 0; i + 32 <= npix; i += 32) {
+        __m256i Y = _mm256_loadu_si256((const __m256i *)(src+i));
+        if (yodd)
+            interleave_store_avx2(dest+i*2, gray, Y);
+        else
+            interleave_store_avx2(dest+i*2, Y, gray);
+    }
+    for (; i < npix; i++) {
+        dest[i*2 +  yodd] = src[i];
+        dest[i*2 + !yodd] = 128;
+    }
+}
+
+AVX2_INLINE void packed_y8_avx2(const uint8_t *src, uint8_t *dest, int npix,
+                                int yodd)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int i;
+
+    for (i = 0; i + 32 <= npix; i += 32) {
+        __m256i s0 = _mm256_loadu_si256((const __m256i *)(src+i*2));
+        __m256i s1 = _mm256_loadu_si256((const __m256i *)(src+i*2+32));
+        if (yodd) {
+            s0 = _mm256_srli_epi16(s0, 8);
+            s1 = _mm256_srli_epi16(s1, 8);
+        } else {
+            s0 = _mm256_and_si256(s0, mask);
+            s1 = _mm256_and_si256(s1, mask);
+        }
+        _mm256_storeu_si256((__m256i *)(dest+i),
+                            _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16(s0, s1), 0xD8));
+    }
+    for (; i < npix; i++)
+        dest[i] = src[i*2 + yodd];
+}
+
+static AC_TARGET_AVX2 int y8_yuy2_avx2(uint8_t **src, uint8_t **dest,
+                                       int width, int height)
+{
+    y8_packed_avx2(src[0], dest[0], width*height, 0);
+    return 1;
+}
+
+static AC_TARGET_AVX2 int y8_uyvy_avx2(uint8_t **src, uint8_t **dest,
+                                       int width, int height)
+{
+    y8_packed_avx2(src[0], dest[0], width*height, 1);
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuy2_y8_avx2(uint8_t **src, uint8_t **dest,
+                                       int width, int height)
+{
+    packed_y8_avx2(src[0], dest[0], width*height, 0);
+    return 1;
+}
+
+static AC_TARGET_AVX2 int uyvy_y8_avx2(uint8_t **src, uint8_t **dest,
+                                       int width, int height)
+{
+    packed_y8_avx2(src[0], dest[0], width*height, 1);
+    return 1;
+}
+
+/*************************************************************************/
+
+#endif  /* HAVE_AC_AVX2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
 /* Initialization */
 
 int ac_imgconvert_init_yuv_mixed(int accel)
@@ -912,15 +1291,7 @@ int ac_imgconvert_init_yuv_mixed(int accel)
      || !register_conversion(IMG_YUV422P, IMG_YUY2,    yuv422p_yuy2)
      || !register_conversion(IMG_YUV444P, IMG_YUY2,    yuv444p_yuy2)
      || !register_conversion(IMG_Y8,      IMG_YUY2,    y8_yuy2)
-     || !register_conversion(IMG_YUV420P, IMG_UYVY,    yuv420p_uyvy)
-     || !register_conversion(IMG_YUV411P, IMG_UYVY,    yuv411p_uyvy)
-     || !register_conversion(IMG_YUV422P, IMG_UYVY,    yuv422p_uyvy)
-     || !register_conversion(IMG_YUV444P, IMG_UYVY,    yuv444p_uyvy)
      || !register_conversion(IMG_Y8,      IMG_UYVY,    y8_uyvy)
-     || !register_conversion(IMG_YUV420P, IMG_YVYU,    yuv420p_yvyu)
-     || !register_conversion(IMG_YUV411P, IMG_YVYU,    yuv411p_yvyu)
-     || !register_conversion(IMG_YUV422P, IMG_YVYU,    yuv422p_yvyu)
-     || !register_conversion(IMG_YUV444P, IMG_YVYU,    yuv444p_yvyu)
      || !register_conversion(IMG_Y8,      IMG_YVYU,    y8_yuy2)
 
      || !register_conversion(IMG_YUY2,    IMG_YUV420P, yuy2_yuv420p)
@@ -928,15 +1299,7 @@ int ac_imgconvert_init_yuv_mixed(int accel)
      || !register_conversion(IMG_YUY2,    IMG_YUV422P, yuy2_yuv422p)
      || !register_conversion(IMG_YUY2,    IMG_YUV444P, yuy2_yuv444p)
      || !register_conversion(IMG_YUY2,    IMG_Y8,      yuy2_y8)
-     || !register_conversion(IMG_UYVY,    IMG_YUV420P, uyvy_yuv420p)
-     || !register_conversion(IMG_UYVY,    IMG_YUV411P, uyvy_yuv411p)
-     || !register_conversion(IMG_UYVY,    IMG_YUV422P, uyvy_yuv422p)
-     || !register_conversion(IMG_UYVY,    IMG_YUV444P, uyvy_yuv444p)
      || !register_conversion(IMG_UYVY,    IMG_Y8,      uyvy_y8)
-     || !register_conversion(IMG_YVYU,    IMG_YUV420P, yvyu_yuv420p)
-     || !register_conversion(IMG_YVYU,    IMG_YUV411P, yvyu_yuv411p)
-     || !register_conversion(IMG_YVYU,    IMG_YUV422P, yvyu_yuv422p)
-     || !register_conversion(IMG_YVYU,    IMG_YUV444P, yvyu_yuv444p)
      || !register_conversion(IMG_YVYU,    IMG_Y8,      yuy2_y8)
     ) {
         return 0;
@@ -965,6 +1328,46 @@ int ac_imgconvert_init_yuv_mixed(int accel)
     }
 #endif  /* HAVE_ASM_SSE2 */
 
+#if defined(HAVE_AC_AVX2)
+    /* Registered last, so these replace the narrower versions */
+    if (HAS_ACCEL(accel, AC_AVX2)) {
+        if (!register_conversion(IMG_YUV420P, IMG_YUY2,    yuv420p_yuy2_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_YUY2,    yuv411p_yuy2_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_YUY2,    yuv422p_yuy2_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_YUY2,    yuv444p_yuy2_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_UYVY,    yuv420p_uyvy_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_UYVY,    yuv411p_uyvy_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_UYVY,    yuv422p_uyvy_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_UYVY,    yuv444p_uyvy_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_YVYU,    yuv420p_yvyu_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_YVYU,    yuv411p_yvyu_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_YVYU,    yuv422p_yvyu_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_YVYU,    yuv444p_yvyu_avx2)
+         || !register_conversion(IMG_Y8,      IMG_YUY2,    y8_yuy2_avx2)
+         || !register_conversion(IMG_Y8,      IMG_UYVY,    y8_uyvy_avx2)
+         || !register_conversion(IMG_Y8,      IMG_YVYU,    y8_yuy2_avx2)
+
+         || !register_conversion(IMG_YUY2,    IMG_YUV420P, yuy2_yuv420p_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_YUV411P, yuy2_yuv411p_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_YUV422P, yuy2_yuv422p_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_YUV444P, yuy2_yuv444p_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YUV420P, uyvy_yuv420p_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YUV411P, uyvy_yuv411p_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YUV422P, uyvy_yuv422p_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YUV444P, uyvy_yuv444p_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_YUV420P, yvyu_yuv420p_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_YUV411P, yvyu_yuv411p_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_YUV422P, yvyu_yuv422p_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_YUV444P, yvyu_yuv444p_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_Y8,      yuy2_y8_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_Y8,      uyvy_y8_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_Y8,      yuy2_y8_avx2)
+        ) {
+            return 0;
+        }
+    }
+#endif  /* HAVE_AC_AVX2 */
+
     return 1;
 }
 
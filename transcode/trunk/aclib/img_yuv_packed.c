@@ -9,6 +9,7 @@
  */
 
 #include "ac.h"
+#include "ac_internal.h"
 #include "imgconvert.h"
 #include "img_internal.h"
 
@@ -212,6 +213,93 @@ static int yvyu_uyvy_sse2(uint8_t **src, uint8_t **dest, int width, int height)
 /*************************************************************************/
 /*************************************************************************/
 
+#if defined(HAVE_AC_AVX2)
+
+/* AVX2 routines.  All four conversions just reorder the bytes of each
+ * 4-byte pixel pair, so they share one byte-shuffle loop; like the other
+ * versions, these work when src==dest. */
+
+#include <immintrin.h>
+
+/* Reorder `count' 4-byte units: dest byte n = src byte order[n] */
+static inline AC_TARGET_AVX2 void shuffle32_avx2(const uint8_t *src,
+                                                 uint8_t *dest, int count,
+                                                 const uint8_t *order)
+{
+    const __m256i mask = _mm256_setr_epi8(
+        order[0],    order[1],    order[2],    order[3],
+        order[0]+4,  order[1]+4,  order[2]+4,  order[3]+4,
+        order[0]+8,  order[1]+8,  order[2]+8,  order[3]+8,
+        order[0]+12, order[1]+12, order[2]+12, order[3]+12,
+        order[0],    order[1],    order[2],    order[3],
+        order[0]+4,  order[1]+4,  order[2]+4,  order[3]+4,
+        order[0]+8,  order[1]+8,  order[2]+8,  order[3]+8,
+        order[0]+12, order[1]+12, order[2]+12, order[3]+12);
+    int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i s0 = _mm256_loadu_si256((const __m256i *)(src + i*4));
+        __m256i s1 = _mm256_loadu_si256((const __m256i *)(src + i*4 + 32));
+        _mm256_storeu_si256((__m256i *)(dest + i*4),
+                            _mm256_shuffle_epi8(s0, mask));
+        _mm256_storeu_si256((__m256i *)(dest + i*4 + 32),
+                            _mm256_shuffle_epi8(s1, mask));
+    }
+    for (; i < count; i++) {
+        uint8_t tmp[4];
+        tmp[0] = src[i*4+order[0]];
+        tmp[1] = src[i*4+order[1]];
+        tmp[2] = src[i*4+order[2]];
+        tmp[3] = src[i*4+order[3]];
+        dest[i*4  ] = tmp[0];
+        dest[i*4+1] = tmp[1];
+        dest[i*4+2] = tmp[2];
+        dest[i*4+3] = tmp[3];
+    }
+}
+
+static AC_TARGET_AVX2 int yuv16_swap16_avx2(uint8_t **src, uint8_t **dest,
+                                            int width, int height)
+{
+    static const uint8_t order[4] = {1,0,3,2};
+    shuffle32_avx2(src[0], dest[0], width*height/2, order);
+    if (width*height & 1)
+        ((uint16_t *)(dest[0]))[width*height-1] =
+            src[0][width*height*2-2]<<8 | src[0][width*height*2-1];
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv16_swapuv_avx2(uint8_t **src, uint8_t **dest,
+                                            int width, int height)
+{
+    static const uint8_t order[4] = {0,3,2,1};
+    shuffle32_avx2(src[0], dest[0], width*height/2, order);
+    return 1;
+}
+
+static AC_TARGET_AVX2 int uyvy_yvyu_avx2(uint8_t **src, uint8_t **dest,
+                                         int width, int height)
+{
+    static const uint8_t order[4] = {1,2,3,0};
+    shuffle32_avx2(src[0], dest[0], width*height/2, order);
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yvyu_uyvy_avx2(uint8_t **src, uint8_t **dest,
+                                         int width, int height)
+{
+    static const uint8_t order[4] = {3,0,1,2};
+    shuffle32_avx2(src[0], dest[0], width*height/2, order);
+    return 1;
+}
+
+/*************************************************************************/
+
+#endif  /* HAVE_AC_AVX2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
 /* Initialization */
 
 int ac_imgconvert_init_yuv_packed(int accel)
@@ -274,6 +362,20 @@ int ac_imgconvert_init_yuv_packed(int accel)
 
 #endif  /* ARCH_X86 || ARCH_X86_64 */
 
+#if defined(HAVE_AC_AVX2)
+    if (HAS_ACCEL(accel, AC_AVX2)) {
+        if (!register_conversion(IMG_YUY2,    IMG_UYVY,    yuv16_swap16_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_YVYU,    yuv16_swapuv_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YUY2,    yuv16_swap16_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_YVYU,    uyvy_yvyu_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_YUY2,    yuv16_swapuv_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_UYVY,    yvyu_uyvy_avx2)
+        ) {
+            return 0;
+        }
+    }
+#endif
+
     return 1;
 }
 
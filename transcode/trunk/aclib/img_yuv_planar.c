@@ -9,6 +9,7 @@
  */
 
 #include "ac.h"
+#include "ac_internal.h"
 #include "imgconvert.h"
 #include "img_internal.h"
 
@@ -713,6 +714,377 @@ static int yuv444p_yuv422p_sse2(uint8_t **src, uint8_t **dest, int width, int he
 /*************************************************************************/
 /*************************************************************************/
 
+#if defined(HAVE_AC_AVX2)
+
+/* AVX2 routines.  These use the same algorithms (and rounding) as the SSE2
+ * ones, 32 output bytes at a time; the last bytes of each call are done in
+ * plain C. */
+
+#include <immintrin.h>
+
+#define AVX2_INLINE static inline AC_TARGET_AVX2
+
+/* Average 2 bytes horizontally (e.g. 422P->411P) (unit: 2 source bytes) */
+AVX2_INLINE void avg_2h_avx2(const uint8_t *src, uint8_t *dest, int count)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + i*2));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i*2 + 32));
+        a = _mm256_avg_epu16(_mm256_and_si256(a, mask),
+                             _mm256_srli_epi16(a, 8));
+        b = _mm256_avg_epu16(_mm256_and_si256(b, mask),
+                             _mm256_srli_epi16(b, 8));
+        /* packus works within 128-bit lanes: put the quadwords back in
+         * order */
+        _mm256_storeu_si256((__m256i *)(dest + i),
+                            _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16(a, b), 0xD8));
+    }
+    for (; i < count; i++)
+        dest[i] = (src[i*2] + src[i*2+1] + 1) / 2;
+}
+
+/* Average 4 bytes horizontally (e.g. 444P->411P) (unit: 4 source bytes) */
+AVX2_INLINE void avg_4h_avx2(const uint8_t *src, uint8_t *dest, int count)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256i order = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i v[4];
+        int j;
+        for (j = 0; j < 4; j++) {
+            __m256i s = _mm256_loadu_si256((const __m256i *)(src + i*4
+                                                             + j*32));
+            __m256i e = _mm256_avg_epu16(
+                _mm256_and_si256(s, mask),
+                _mm256_and_si256(_mm256_srli_epi32(s, 8), mask));
+            __m256i o = _mm256_avg_epu16(
+                _mm256_and_si256(_mm256_srli_epi32(s, 16), mask),
+                _mm256_srli_epi32(s, 24));
+            v[j] = _mm256_avg_epu16(e, o);
+        }
+        _mm256_storeu_si256((__m256i *)(dest + i),
+                            _mm256_permutevar8x32_epi32(
+                                _mm256_packus_epi16(
+                                    _mm256_packus_epi32(v[0], v[1]),
+                                    _mm256_packus_epi32(v[2], v[3])),
+                                order));
+    }
+    for (; i < count; i++) {
+        dest[i] = (src[i*4] + src[i*4+1] + src[i*4+2] + src[i*4+3] + 2) / 4;
+    }
+}
+
+/* Repeat 2 bytes horizontally (e.g. 422P->444P) (unit: 1 source byte) */
+AVX2_INLINE void rep_2h_avx2(const uint8_t *src, uint8_t *dest, int count)
+{
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i s = _mm256_permute4x64_epi64(
+            _mm256_loadu_si256((const __m256i *)(src + i)), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dest + i*2),
+                            _mm256_unpacklo_epi8(s, s));
+        _mm256_storeu_si256((__m256i *)(dest + i*2 + 32),
+                            _mm256_unpackhi_epi8(s, s));
+    }
+    for (; i < count; i++)
+        dest[i*2] = dest[i*2+1] = src[i];
+}
+
+/* Repeat 4 bytes horizontally (e.g. 411P->444P) (unit: 1 source byte) */
+AVX2_INLINE void rep_4h_avx2(const uint8_t *src, uint8_t *dest, int count)
+{
+    const __m256i rep_lo = _mm256_setr_epi8(
+        0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3,
+        4,4,4,4, 5,5,5,5, 6,6,6,6, 7,7,7,7);
+    const __m256i rep_hi = _mm256_add_epi8(rep_lo, _mm256_set1_epi8(8));
+    int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i s = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_si256((__m256i *)(dest + i*4),
+                            _mm256_shuffle_epi8(s, rep_lo));
+        _mm256_storeu_si256((__m256i *)(dest + i*4 + 32),
+                            _mm256_shuffle_epi8(s, rep_hi));
+    }
+    for (; i < count; i++)
+        dest[i*4] = dest[i*4+1] = dest[i*4+2] = dest[i*4+3] = src[i];
+}
+
+/* Average 2 bytes vertically and double horizontally (411P->420P)
+ * (unit: 1 source byte) */
+AVX2_INLINE void avg_411_420_avx2(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dest, int count)
+{
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i s = _mm256_permute4x64_epi64(
+            _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(src1 + i)),
+                            _mm256_loadu_si256((const __m256i *)(src2 + i))),
+            0xD8);
+        _mm256_storeu_si256((__m256i *)(dest + i*2),
+                            _mm256_unpacklo_epi8(s, s));
+        _mm256_storeu_si256((__m256i *)(dest + i*2 + 32),
+                            _mm256_unpackhi_epi8(s, s));
+    }
+    for (; i < count; i++)
+        dest[i*2] = dest[i*2+1] = (src1[i] + src2[i] + 1) / 2;
+}
+
+/* Average 2 bytes vertically (422P->420P) (unit: 1 source byte) */
+AVX2_INLINE void avg_422_420_avx2(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dest, int count)
+{
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        _mm256_storeu_si256((__m256i *)(dest + i),
+            _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(src1 + i)),
+                            _mm256_loadu_si256((const __m256i *)(src2 + i))));
+    }
+    for (; i < count; i++)
+        dest[i] = (src1[i] + src2[i] + 1) / 2;
+}
+
+/* Average 4 bytes, 2 horizontally and 2 vertically (444P->420P)
+ * (unit: 2 source bytes) */
+AVX2_INLINE void avg_444_420_avx2(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dest, int count)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i v[2];
+        int j;
+        for (j = 0; j < 2; j++) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(src1 + i*2
+                                                             + j*32));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(src2 + i*2
+                                                             + j*32));
+            a = _mm256_avg_epu16(_mm256_and_si256(a, mask),
+                                 _mm256_srli_epi16(a, 8));
+            b = _mm256_avg_epu16(_mm256_and_si256(b, mask),
+                                 _mm256_srli_epi16(b, 8));
+            v[j] = _mm256_avg_epu16(a, b);
+        }
+        _mm256_storeu_si256((__m256i *)(dest + i),
+                            _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16(v[0], v[1]), 0xD8));
+    }
+    for (; i < count; i++) {
+        dest[i] = (src1[i*2] + src1[i*2+1] + src2[i*2] + src2[i*2+1] + 2)
+                / 4;
+    }
+}
+
+/*************************************************************************/
+
+static AC_TARGET_AVX2 int yuv420p_yuv411p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    int y;
+    ac_memcpy(dest[0], src[0], width*height);
+    for (y = 0; y < (height & ~1); y += 2) {
+        avg_2h_avx2(src[1]+(y/2)*(width/2), dest[1]+y*(width/4), width/4);
+        ac_memcpy(dest[1]+(y+1)*(width/4), dest[1]+y*(width/4), width/4);
+        avg_2h_avx2(src[2]+(y/2)*(width/2), dest[2]+y*(width/4), width/4);
+        ac_memcpy(dest[2]+(y+1)*(width/4), dest[2]+y*(width/4), width/4);
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv420p_yuv444p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    int y;
+    ac_memcpy(dest[0], src[0], width*height);
+    for (y = 0; y < height; y += 2) {
+        rep_2h_avx2(src[1]+(y/2)*(width/2), dest[1]+y*width, width/2);
+        ac_memcpy(dest[1]+(y+1)*width, dest[1]+y*width, width);
+        rep_2h_avx2(src[2]+(y/2)*(width/2), dest[2]+y*width, width/2);
+        ac_memcpy(dest[2]+(y+1)*width, dest[2]+y*width, width);
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+static AC_TARGET_AVX2 int yuv411p_yuv420p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    int y;
+    ac_memcpy(dest[0], src[0], width*height);
+    for (y = 0; y < (height & ~1); y += 2) {
+        avg_411_420_avx2(src[1]+y*(width/4), src[1]+(y+1)*(width/4),
+                         dest[1]+(y/2)*(width/2), width/4);
+        avg_411_420_avx2(src[2]+y*(width/4), src[2]+(y+1)*(width/4),
+                         dest[2]+(y/2)*(width/2), width/4);
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv411p_yuv422p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 3)) {
+        /* Fast version, no bytes at end of row to skip */
+        rep_2h_avx2(src[1], dest[1], (width/4)*height);
+        rep_2h_avx2(src[2], dest[2], (width/4)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            rep_2h_avx2(src[1]+y*(width/4), dest[1]+y*(width/2), width/4);
+            rep_2h_avx2(src[2]+y*(width/4), dest[2]+y*(width/2), width/4);
+        }
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv411p_yuv444p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 3)) {
+        /* Fast version, no bytes at end of row to skip */
+        rep_4h_avx2(src[1], dest[1], (width/4)*height);
+        rep_4h_avx2(src[2], dest[2], (width/4)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            rep_4h_avx2(src[1]+y*(width/4), dest[1]+y*width, width/4);
+            rep_4h_avx2(src[2]+y*(width/4), dest[2]+y*width, width/4);
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+static AC_TARGET_AVX2 int yuv422p_yuv420p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    int y;
+    ac_memcpy(dest[0], src[0], width*height);
+    for (y = 0; y < (height & ~1); y += 2) {
+        avg_422_420_avx2(src[1]+y*(width/2), src[1]+(y+1)*(width/2),
+                         dest[1]+(y/2)*(width/2), width/2);
+        avg_422_420_avx2(src[2]+y*(width/2), src[2]+(y+1)*(width/2),
+                         dest[2]+(y/2)*(width/2), width/2);
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv422p_yuv411p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 3)) {
+        /* Fast version, no bytes at end of row to skip */
+        avg_2h_avx2(src[1], dest[1], (width/4)*height);
+        avg_2h_avx2(src[2], dest[2], (width/4)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            avg_2h_avx2(src[1]+y*(width/2), dest[1]+y*(width/4), width/4);
+            avg_2h_avx2(src[2]+y*(width/2), dest[2]+y*(width/4), width/4);
+        }
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv422p_yuv444p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 1)) {
+        /* Fast version, no bytes at end of row to skip */
+        rep_2h_avx2(src[1], dest[1], (width/2)*height);
+        rep_2h_avx2(src[2], dest[2], (width/2)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            rep_2h_avx2(src[1]+y*(width/2), dest[1]+y*width, width/2);
+            rep_2h_avx2(src[2]+y*(width/2), dest[2]+y*width, width/2);
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+static AC_TARGET_AVX2 int yuv444p_yuv420p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    int y;
+    ac_memcpy(dest[0], src[0], width*height);
+    for (y = 0; y < (height & ~1); y += 2) {
+        avg_444_420_avx2(src[1]+y*width, src[1]+(y+1)*width,
+                         dest[1]+(y/2)*(width/2), width/2);
+        avg_444_420_avx2(src[2]+y*width, src[2]+(y+1)*width,
+                         dest[2]+(y/2)*(width/2), width/2);
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv444p_yuv411p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 3)) {
+        /* Fast version, no bytes at end of row to skip */
+        avg_4h_avx2(src[1], dest[1], (width/4)*height);
+        avg_4h_avx2(src[2], dest[2], (width/4)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            avg_4h_avx2(src[1]+y*width, dest[1]+y*(width/4), width/4);
+            avg_4h_avx2(src[2]+y*width, dest[2]+y*(width/4), width/4);
+        }
+    }
+    return 1;
+}
+
+static AC_TARGET_AVX2 int yuv444p_yuv422p_avx2(uint8_t **src, uint8_t **dest,
+                                               int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height);
+    if (!(width & 1)) {
+        /* Fast version, no bytes at end of row to skip */
+        avg_2h_avx2(src[1], dest[1], (width/2)*height);
+        avg_2h_avx2(src[2], dest[2], (width/2)*height);
+    } else {
+        /* Slow version, loop through each row */
+        int y;
+        for (y = 0; y < height; y++) {
+            avg_2h_avx2(src[1]+y*width, dest[1]+y*(width/2), width/2);
+            avg_2h_avx2(src[2]+y*width, dest[2]+y*(width/2), width/2);
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+#endif  /* HAVE_AC_AVX2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
 /* Initialization */
 
 int ac_imgconvert_init_yuv_planar(int accel)
@@ -772,6 +1144,29 @@ int ac_imgconvert_init_yuv_planar(int accel)
     }
 #endif  /* ARCH_X86 || ARCH_X86_64 */
 
+#if defined(HAVE_AC_AVX2)
+    /* Registered last, so these replace the narrower versions */
+    if (HAS_ACCEL(accel, AC_AVX2)) {
+        if (!register_conversion(IMG_YUV420P, IMG_YUV411P, yuv420p_yuv411p_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_YUV444P, yuv420p_yuv444p_avx2)
+
+         || !register_conversion(IMG_YUV411P, IMG_YUV420P, yuv411p_yuv420p_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_YUV422P, yuv411p_yuv422p_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_YUV444P, yuv411p_yuv444p_avx2)
+
+         || !register_conversion(IMG_YUV422P, IMG_YUV420P, yuv422p_yuv420p_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_YUV411P, yuv422p_yuv411p_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_YUV444P, yuv422p_yuv444p_avx2)
+
+         || !register_conversion(IMG_YUV444P, IMG_YUV420P, yuv444p_yuv420p_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_YUV411P, yuv444p_yuv411p_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_YUV422P, yuv444p_yuv422p_avx2)
+        ) {
+            return 0;
+        }
+    }
+#endif  /* HAVE_AC_AVX2 */
+
     return 1;
 }
 
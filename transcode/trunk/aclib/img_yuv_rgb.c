@@ -2084,6 +2084,549 @@ static int y8_argb32_sse2(uint8_t **src, uint8_t **dest, int width, int height)
 /*************************************************************************/
 /*************************************************************************/
 
+#if defined(HAVE_AC_AVX2)
+
+/* AVX2 routines, 32 pixels at a time.  YUV->RGB uses the same fixed-point
+ * arithmetic as the SSE2 version; RGB->YUV computes exactly the same
+ * values as the C version (with 32-bit sums from pmaddwd), and takes
+ * chroma from the same pixels.  Leftover pixels at the end of each row
+ * are done with the C macros. */
+
+#include <immintrin.h>
+
+#define AVX2_INLINE static inline AC_TARGET_AVX2
+
+/* Two 16-bit coefficients as one 32-bit value for pmaddwd */
+#define COEF_PAIR(lo,hi)  ((int)((uint16_t)(lo) | (uint32_t)(uint16_t)(hi)<<16))
+
+/* Interleave 32 `first' and 32 `second' bytes into 64 bytes at `dest' */
+AVX2_INLINE void interleave_store_avx2(uint8_t *dest,
+                                       __m256i first, __m256i second)
+{
+    first  = _mm256_permute4x64_epi64(first,  0xD8);
+    second = _mm256_permute4x64_epi64(second, 0xD8);
+    _mm256_storeu_si256((__m256i *)dest,
+                        _mm256_unpacklo_epi8(first, second));
+    _mm256_storeu_si256((__m256i *)(dest+32),
+                        _mm256_unpackhi_epi8(first, second));
+}
+
+/* Return the even bytes of `v' in the low half, the odd ones in the high
+ * half */
+AVX2_INLINE __m256i split_even_odd_avx2(__m256i v)
+{
+    return _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x00FF)),
+                            _mm256_srli_epi16(v, 8)),
+        0xD8);
+}
+
+/*************************************************************************/
+
+/* YUV->RGB: compute the U/V terms of 16 U/V words */
+AVX2_INLINE void yuv2rgb_uv_avx2(__m256i U, __m256i V, __m256i *rV,
+                                 __m256i *gUV, __m256i *bU)
+{
+    U = _mm256_slli_epi16(_mm256_sub_epi16(U, _mm256_set1_epi16(128)), 7);
+    V = _mm256_slli_epi16(_mm256_sub_epi16(V, _mm256_set1_epi16(128)), 7);
+    *rV  = _mm256_mulhi_epi16(V, _mm256_set1_epi16(0x3313));
+    *gUV = _mm256_add_epi16(
+        _mm256_mulhi_epi16(U, _mm256_set1_epi16((int16_t)0xF377)),
+        _mm256_mulhi_epi16(V, _mm256_set1_epi16((int16_t)0xE5FC)));
+    *bU  = _mm256_mulhi_epi16(U, _mm256_set1_epi16(0x408D));
+}
+
+/* YUV->RGB: compute R/G/B words for 16 Y words */
+AVX2_INLINE void yuv2rgb_y_avx2(__m256i Y, __m256i rV, __m256i gUV,
+                                __m256i bU, __m256i *R, __m256i *G,
+                                __m256i *B)
+{
+    Y = _mm256_slli_epi16(_mm256_sub_epi16(Y, _mm256_set1_epi16(16)), 7);
+    Y = _mm256_add_epi16(_mm256_mulhi_epi16(Y, _mm256_set1_epi16(0x2543)),
+                         _mm256_set1_epi16(8));
+    *R = _mm256_srai_epi16(_mm256_add_epi16(Y, rV), 4);
+    *G = _mm256_srai_epi16(_mm256_add_epi16(Y, gUV), 4);
+    *B = _mm256_srai_epi16(_mm256_add_epi16(Y, bU), 4);
+}
+
+/* YUV->RGB for 32 pixels with horizontally subsampled chroma, given the
+ * even and odd Y values and the U/V values (16 words each) */
+AVX2_INLINE void yuv2rgb_pairs_avx2(__m256i Yeven, __m256i Yodd,
+                                    __m256i U, __m256i V,
+                                    __m256i *R, __m256i *G, __m256i *B)
+{
+    const __m256i interleave = _mm256_setr_epi8(
+        0,8,1,9,2,10,3,11,4,12,5,13,6,14,7,15,
+        0,8,1,9,2,10,3,11,4,12,5,13,6,14,7,15);
+    __m256i rV, gUV, bU, Re, Ge, Be, Ro, Go, Bo;
+
+    yuv2rgb_uv_avx2(U, V, &rV, &gUV, &bU);
+    yuv2rgb_y_avx2(Yeven, rV, gUV, bU, &Re, &Ge, &Be);
+    yuv2rgb_y_avx2(Yodd,  rV, gUV, bU, &Ro, &Go, &Bo);
+    *R = _mm256_shuffle_epi8(_mm256_packus_epi16(Re, Ro), interleave);
+    *G = _mm256_shuffle_epi8(_mm256_packus_epi16(Ge, Go), interleave);
+    *B = _mm256_shuffle_epi8(_mm256_packus_epi16(Be, Bo), interleave);
+}
+
+/* YUV->RGB for 32 pixels of 4:2:x planar data (Y bytes, U/V words) */
+AVX2_INLINE void yuv2rgb_planar_avx2(const uint8_t *srcY, __m256i U,
+                                     __m256i V, __m256i *R, __m256i *G,
+                                     __m256i *B)
+{
+    __m256i Y = _mm256_loadu_si256((const __m256i *)srcY);
+    yuv2rgb_pairs_avx2(_mm256_and_si256(Y, _mm256_set1_epi16(0x00FF)),
+                       _mm256_srli_epi16(Y, 8), U, V, R, G, B);
+}
+
+/* Extract byte `ofs' of each 4-byte unit of 64 bytes as 16 words */
+AVX2_INLINE __m256i packed_field_avx2(__m256i s0, __m256i s1, int ofs)
+{
+    if (ofs == 3) {
+        s0 = _mm256_srli_epi32(s0, 24);
+        s1 = _mm256_srli_epi32(s1, 24);
+    } else {
+        const __m256i mask = _mm256_set1_epi32(0xFF);
+        s0 = _mm256_and_si256(_mm256_srli_epi32(s0, ofs*8), mask);
+        s1 = _mm256_and_si256(_mm256_srli_epi32(s1, ofs*8), mask);
+    }
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(s0, s1), 0xD8);
+}
+
+AVX2_INLINE void yuv2rgb_packed_avx2(const uint8_t *src, int yofs, int uofs,
+                                     int vofs, __m256i *R, __m256i *G,
+                                     __m256i *B)
+{
+    __m256i s0 = _mm256_loadu_si256((const __m256i *)src);
+    __m256i s1 = _mm256_loadu_si256((const __m256i *)(src+32));
+    yuv2rgb_pairs_avx2(packed_field_avx2(s0, s1, yofs),
+                       packed_field_avx2(s0, s1, yofs+2),
+                       packed_field_avx2(s0, s1, uofs),
+                       packed_field_avx2(s0, s1, vofs), R, G, B);
+}
+
+#define LOAD_UV16(p)  _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+
+AVX2_INLINE __m256i load_uv411_avx2(const uint8_t *p)
+{
+    __m128i v = _mm_loadl_epi64((const __m128i *)p);
+    return _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v, v));
+}
+
+/* Per-format loaders: compute R/G/B bytes for pixels x..x+31 of row y */
+
+AVX2_INLINE void yuv420p_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                     __m256i *R, __m256i *G, __m256i *B)
+{
+    int uvofs = (y/2)*(width/2) + x/2;
+    yuv2rgb_planar_avx2(src[0]+y*width+x, LOAD_UV16(src[1]+uvofs),
+                        LOAD_UV16(src[2]+uvofs), R, G, B);
+}
+
+AVX2_INLINE void yuv411p_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                     __m256i *R, __m256i *G, __m256i *B)
+{
+    int uvofs = y*(width/4) + x/4;
+    yuv2rgb_planar_avx2(src[0]+y*width+x, load_uv411_avx2(src[1]+uvofs),
+                        load_uv411_avx2(src[2]+uvofs), R, G, B);
+}
+
+AVX2_INLINE void yuv422p_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                     __m256i *R, __m256i *G, __m256i *B)
+{
+    int uvofs = y*(width/2) + x/2;
+    yuv2rgb_planar_avx2(src[0]+y*width+x, LOAD_UV16(src[1]+uvofs),
+                        LOAD_UV16(src[2]+uvofs), R, G, B);
+}
+
+AVX2_INLINE void yuv444p_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                     __m256i *R, __m256i *G, __m256i *B)
+{
+    int ofs = y*width + x;
+    __m256i rV, gUV, bU, R0, G0, B0, R1, G1, B1;
+
+    yuv2rgb_uv_avx2(LOAD_UV16(src[1]+ofs), LOAD_UV16(src[2]+ofs),
+                    &rV, &gUV, &bU);
+    yuv2rgb_y_avx2(LOAD_UV16(src[0]+ofs), rV, gUV, bU, &R0, &G0, &B0);
+    yuv2rgb_uv_avx2(LOAD_UV16(src[1]+ofs+16), LOAD_UV16(src[2]+ofs+16),
+                    &rV, &gUV, &bU);
+    yuv2rgb_y_avx2(LOAD_UV16(src[0]+ofs+16), rV, gUV, bU, &R1, &G1, &B1);
+    *R = _mm256_permute4x64_epi64(_mm256_packus_epi16(R0, R1), 0xD8);
+    *G = _mm256_permute4x64_epi64(_mm256_packus_epi16(G0, G1), 0xD8);
+    *B = _mm256_permute4x64_epi64(_mm256_packus_epi16(B0, B1), 0xD8);
+}
+
+AVX2_INLINE void yuy2_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                  __m256i *R, __m256i *G, __m256i *B)
+{
+    yuv2rgb_packed_avx2(src[0]+(y*width+x)*2, 0, 1, 3, R, G, B);
+}
+
+AVX2_INLINE void uyvy_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                  __m256i *R, __m256i *G, __m256i *B)
+{
+    yuv2rgb_packed_avx2(src[0]+(y*width+x)*2, 1, 0, 2, R, G, B);
+}
+
+AVX2_INLINE void yvyu_to_rgb_avx2(uint8_t **src, int x, int y, int width,
+                                  __m256i *R, __m256i *G, __m256i *B)
+{
+    yuv2rgb_packed_avx2(src[0]+(y*width+x)*2, 0, 3, 1, R, G, B);
+}
+
+/* Store 32 pixels of R/G/B bytes; the alpha byte of 32-bit formats is set
+ * to zero, as with SSE2 */
+AVX2_INLINE void store_rgb_avx2(uint8_t *dest, __m256i R, __m256i G,
+                                __m256i B, int rgbsz, int rofs, int gofs,
+                                int bofs)
+{
+    __m256i c[4], lo01, hi01, lo23, hi23, p0, p1, p2, p3;
+
+    c[0] = c[1] = c[2] = c[3] = _mm256_setzero_si256();
+    c[rofs] = R;
+    c[gofs] = G;
+    c[bofs] = B;
+    lo01 = _mm256_unpacklo_epi8(c[0], c[1]);
+    hi01 = _mm256_unpackhi_epi8(c[0], c[1]);
+    lo23 = _mm256_unpacklo_epi8(c[2], c[3]);
+    hi23 = _mm256_unpackhi_epi8(c[2], c[3]);
+    /* low lane: pixels 0-15, high lane: pixels 16-31 */
+    p0 = _mm256_unpacklo_epi16(lo01, lo23);  /* 0-3   16-19 */
+    p1 = _mm256_unpackhi_epi16(lo01, lo23);  /* 4-7   20-23 */
+    p2 = _mm256_unpacklo_epi16(hi01, hi23);  /* 8-11  24-27 */
+    p3 = _mm256_unpackhi_epi16(hi01, hi23);  /* 12-15 28-31 */
+
+    if (rgbsz == 4) {
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest+32),
+                            _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest+64),
+                            _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256((__m256i *)(dest+96),
+                            _mm256_permute2x128_si256(p2, p3, 0x31));
+    } else {
+        /* Drop the 4th byte of each pixel, giving 12 bytes per quarter
+         * lane; each 16-byte store is partly overwritten by the next,
+         * and the last one only writes 12 bytes. */
+        const __m256i pack24 = _mm256_setr_epi8(
+            0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+            0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+        __m128i last;
+        p0 = _mm256_shuffle_epi8(p0, pack24);
+        p1 = _mm256_shuffle_epi8(p1, pack24);
+        p2 = _mm256_shuffle_epi8(p2, pack24);
+        p3 = _mm256_shuffle_epi8(p3, pack24);
+        _mm_storeu_si128((__m128i *)dest,      _mm256_castsi256_si128(p0));
+        _mm_storeu_si128((__m128i *)(dest+12), _mm256_castsi256_si128(p1));
+        _mm_storeu_si128((__m128i *)(dest+24), _mm256_castsi256_si128(p2));
+        _mm_storeu_si128((__m128i *)(dest+36), _mm256_castsi256_si128(p3));
+        _mm_storeu_si128((__m128i *)(dest+48), _mm256_extracti128_si256(p0,1));
+        _mm_storeu_si128((__m128i *)(dest+60), _mm256_extracti128_si256(p1,1));
+        _mm_storeu_si128((__m128i *)(dest+72), _mm256_extracti128_si256(p2,1));
+        last = _mm256_extracti128_si256(p3, 1);
+        _mm_storel_epi64((__m128i *)(dest+84), last);
+        *(uint32_t *)(dest+92) = _mm_cvtsi128_si32(_mm_srli_si128(last, 8));
+    }
+}
+
+#define DEFINE_YUV2RGB_AVX2(yuv,rgb,rgbsz,rofs,gofs,bofs,slowop) \
+static AC_TARGET_AVX2 int yuv##_##rgb##_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    int x, y;                                                           \
+                                                                        \
+    yuv_create_tables();                                                \
+    for (y = 0; y < height; y++) {                                      \
+        for (x = 0; x + 32 <= width; x += 32) {                         \
+            __m256i R, G, B;                                            \
+            yuv##_to_rgb_avx2(src, x, y, width, &R, &G, &B);            \
+            store_rgb_avx2(dest[0] + (y*width+x)*rgbsz, R, G, B,        \
+                           rgbsz, rofs, gofs, bofs);                    \
+        }                                                               \
+        while (x < width) {                                             \
+            slowop;                                                     \
+            x++;                                                        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}
+
+#define DEFINE_YUV2RGB_AVX2_SET(rgb,sz,r,g,b) \
+    DEFINE_YUV2RGB_AVX2(yuv420p, rgb,sz,r,g,b, YUV2RGB_420P(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(yuv411p, rgb,sz,r,g,b, YUV2RGB_411P(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(yuv422p, rgb,sz,r,g,b, YUV2RGB_422P(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(yuv444p, rgb,sz,r,g,b, YUV2RGB_444P(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(yuy2,    rgb,sz,r,g,b, YUV2RGB_YUY2(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(uyvy,    rgb,sz,r,g,b, YUV2RGB_UYVY(sz,r,g,b))  \
+    DEFINE_YUV2RGB_AVX2(yvyu,    rgb,sz,r,g,b, YUV2RGB_YVYU(sz,r,g,b))
+
+DEFINE_YUV2RGB_AVX2_SET(rgb24,  3,0,1,2)
+DEFINE_YUV2RGB_AVX2_SET(bgr24,  3,2,1,0)
+DEFINE_YUV2RGB_AVX2_SET(rgba32, 4,0,1,2)
+DEFINE_YUV2RGB_AVX2_SET(abgr32, 4,3,2,1)
+DEFINE_YUV2RGB_AVX2_SET(argb32, 4,1,2,3)
+DEFINE_YUV2RGB_AVX2_SET(bgra32, 4,2,1,0)
+
+/*************************************************************************/
+
+/* RGB->YUV: the C formulas are done as two pmaddwd's per value, on R/G
+ * word pairs and on B/2 word pairs (the latter giving the +32768 rounding
+ * term).  33039 (G->Y) does not fit in a signed word, so G->Y uses
+ * 33039-65536 and adds G<<16 separately. */
+
+#define RGB2YUV_Y_RG  COEF_PAIR( 16829, 33039-65536)
+#define RGB2YUV_Y_B   COEF_PAIR(  6416, 16384)
+#define RGB2YUV_U_RG  COEF_PAIR( -9714, -19070)
+#define RGB2YUV_U_B   COEF_PAIR( 28784, 16384)
+#define RGB2YUV_V_RG  COEF_PAIR( 28784, -24103)
+#define RGB2YUV_V_B   COEF_PAIR( -4681, 16384)
+
+/* Load 8 RGB pixels as R/G and B/2 word pairs */
+AVX2_INLINE void rgb_load8_avx2(const uint8_t *src, int rgbsz, int rofs,
+                                int gofs, int bofs, __m256i *rg,
+                                __m256i *b2)
+{
+    const int s = rgbsz;
+    /* For 24-bit pixels, the high lane is loaded from src+8, so pixel 4
+     * is at byte 4 of the lane */
+    const int h = (rgbsz == 4) ? 0 : 4;
+    const __m256i rgmask = _mm256_setr_epi8(
+        rofs,     -1, gofs,     -1, s+rofs,     -1, s+gofs,     -1,
+        2*s+rofs, -1, 2*s+gofs, -1, 3*s+rofs,   -1, 3*s+gofs,   -1,
+        h+rofs,   -1, h+gofs,   -1, h+s+rofs,   -1, h+s+gofs,   -1,
+        h+2*s+rofs,-1,h+2*s+gofs,-1,h+3*s+rofs, -1, h+3*s+gofs, -1);
+    const __m256i bmask = _mm256_setr_epi8(
+        bofs,       -1,-1,-1, s+bofs,     -1,-1,-1,
+        2*s+bofs,   -1,-1,-1, 3*s+bofs,   -1,-1,-1,
+        h+bofs,     -1,-1,-1, h+s+bofs,   -1,-1,-1,
+        h+2*s+bofs, -1,-1,-1, h+3*s+bofs, -1,-1,-1);
+    __m256i v;
+
+    if (rgbsz == 4) {
+        v = _mm256_loadu_si256((const __m256i *)src);
+    } else {
+        v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)),
+            _mm_loadu_si128((const __m128i *)(src+8)), 1);
+    }
+    *rg = _mm256_shuffle_epi8(v, rgmask);
+    *b2 = _mm256_or_si256(_mm256_shuffle_epi8(v, bmask),
+                          _mm256_set1_epi32(2<<16));
+}
+
+/* Pack 4x8 dwords (in pixel order) to 32 bytes, adding `ofs' */
+AVX2_INLINE __m256i pack_dwords_avx2(const __m256i *v, int ofs)
+{
+    const __m256i order = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+    __m256i a = _mm256_add_epi16(_mm256_packs_epi32(v[0], v[1]),
+                                 _mm256_set1_epi16(ofs));
+    __m256i b = _mm256_add_epi16(_mm256_packs_epi32(v[2], v[3]),
+                                 _mm256_set1_epi16(ofs));
+    return _mm256_permutevar8x32_epi32(_mm256_packus_epi16(a, b), order);
+}
+
+/* Compute Y (if `Y' is not NULL) and up to two chroma values for 32
+ * pixels; the chroma coefficients are given per pixel (dword) position,
+ * so that U and V can be computed for alternate pixels in one pass. */
+AVX2_INLINE void rgb2yuv_avx2(const uint8_t *src, int rgbsz, int rofs,
+                              int gofs, int bofs, __m256i *Y,
+                              __m256i crg1, __m256i cb1, __m256i *C1,
+                              __m256i crg2, __m256i cb2, __m256i *C2)
+{
+    const __m256i yrg = _mm256_set1_epi32(RGB2YUV_Y_RG);
+    const __m256i yb  = _mm256_set1_epi32(RGB2YUV_Y_B);
+    const __m256i ghi = _mm256_set1_epi32(0xFFFF0000);
+    __m256i y[4], c1[4], c2[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        __m256i rg, b2;
+        rgb_load8_avx2(src + i*8*rgbsz, rgbsz, rofs, gofs, bofs, &rg, &b2);
+        if (Y) {
+            y[i] = _mm256_add_epi32(_mm256_madd_epi16(rg, yrg),
+                                    _mm256_madd_epi16(b2, yb));
+            y[i] = _mm256_srai_epi32(
+                _mm256_add_epi32(y[i], _mm256_and_si256(rg, ghi)), 16);
+        }
+        if (C1) {
+            c1[i] = _mm256_srai_epi32(
+                _mm256_add_epi32(_mm256_madd_epi16(rg, crg1),
+                                 _mm256_madd_epi16(b2, cb1)), 16);
+        }
+        if (C2) {
+            c2[i] = _mm256_srai_epi32(
+                _mm256_add_epi32(_mm256_madd_epi16(rg, crg2),
+                                 _mm256_madd_epi16(b2, cb2)), 16);
+        }
+    }
+    if (Y)
+        *Y = pack_dwords_avx2(y, 16);
+    if (C1)
+        *C1 = pack_dwords_avx2(c1, 128);
+    if (C2)
+        *C2 = pack_dwords_avx2(c2, 128);
+}
+
+#define RGB2YUV_U  _mm256_set1_epi32(RGB2YUV_U_RG), _mm256_set1_epi32(RGB2YUV_U_B)
+#define RGB2YUV_V  _mm256_set1_epi32(RGB2YUV_V_RG), _mm256_set1_epi32(RGB2YUV_V_B)
+/* U for even pixels, V for odd pixels */
+#define RGB2YUV_UV \
+    _mm256_setr_epi32(RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_U_RG, RGB2YUV_V_RG, \
+                      RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_U_RG, RGB2YUV_V_RG), \
+    _mm256_setr_epi32(RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_U_B,  RGB2YUV_V_B,  \
+                      RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_U_B,  RGB2YUV_V_B)
+/* V for even pixels, U for odd pixels */
+#define RGB2YUV_VU \
+    _mm256_setr_epi32(RGB2YUV_V_RG, RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_U_RG, \
+                      RGB2YUV_V_RG, RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_U_RG), \
+    _mm256_setr_epi32(RGB2YUV_V_B,  RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_U_B,  \
+                      RGB2YUV_V_B,  RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_U_B)
+/* U for pixels 4n, V for pixels 4n+2 */
+#define RGB2YUV_UUVV \
+    _mm256_setr_epi32(RGB2YUV_U_RG, RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_V_RG, \
+                      RGB2YUV_U_RG, RGB2YUV_U_RG, RGB2YUV_V_RG, RGB2YUV_V_RG), \
+    _mm256_setr_epi32(RGB2YUV_U_B,  RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_V_B,  \
+                      RGB2YUV_U_B,  RGB2YUV_U_B,  RGB2YUV_V_B,  RGB2YUV_V_B)
+#define RGB2YUV_NONE  _mm256_setzero_si256(), _mm256_setzero_si256(), NULL
+
+/* Per-format storers: convert and store pixels x..x+31 of row y */
+
+#define RGB_ARGS  const uint8_t *src, int rgbsz, int rofs, int gofs, int bofs
+#define RGB_PASS  src, rgbsz, rofs, gofs, bofs
+
+AVX2_INLINE void rgb_to_yuv420p_avx2(RGB_ARGS, uint8_t **dest,
+                                     int x, int y, int width)
+{
+    __m256i Y, C;
+    if (!(y & 1)) {
+        rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_U, &C, RGB2YUV_NONE);
+        _mm_storeu_si128((__m128i *)(dest[1] + (y/2)*(width/2) + x/2),
+                         _mm256_castsi256_si128(split_even_odd_avx2(C)));
+    } else {
+        rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_V, &C, RGB2YUV_NONE);
+        _mm_storeu_si128((__m128i *)(dest[2] + (y/2)*(width/2) + x/2),
+                         _mm256_extracti128_si256(split_even_odd_avx2(C), 1));
+    }
+    _mm256_storeu_si256((__m256i *)(dest[0] + y*width + x), Y);
+}
+
+AVX2_INLINE void rgb_to_yuv411p_avx2(RGB_ARGS, uint8_t **dest,
+                                     int x, int y, int width)
+{
+    __m256i Y, C;
+    __m128i e;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_UUVV, &C, RGB2YUV_NONE);
+    /* even bytes: U0 V2 U4 V6 ...; split again for U and V */
+    e = _mm256_castsi256_si128(split_even_odd_avx2(C));
+    e = _mm_packus_epi16(_mm_and_si128(e, _mm_set1_epi16(0x00FF)),
+                         _mm_srli_epi16(e, 8));
+    _mm256_storeu_si256((__m256i *)(dest[0] + y*width + x), Y);
+    _mm_storel_epi64((__m128i *)(dest[1] + y*(width/4) + x/4), e);
+    _mm_storel_epi64((__m128i *)(dest[2] + y*(width/4) + x/4),
+                     _mm_srli_si128(e, 8));
+}
+
+AVX2_INLINE void rgb_to_yuv422p_avx2(RGB_ARGS, uint8_t **dest,
+                                     int x, int y, int width)
+{
+    __m256i Y, C;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_UV, &C, RGB2YUV_NONE);
+    C = split_even_odd_avx2(C);
+    _mm256_storeu_si256((__m256i *)(dest[0] + y*width + x), Y);
+    _mm_storeu_si128((__m128i *)(dest[1] + y*(width/2) + x/2),
+                     _mm256_castsi256_si128(C));
+    _mm_storeu_si128((__m128i *)(dest[2] + y*(width/2) + x/2),
+                     _mm256_extracti128_si256(C, 1));
+}
+
+AVX2_INLINE void rgb_to_yuv444p_avx2(RGB_ARGS, uint8_t **dest,
+                                     int x, int y, int width)
+{
+    __m256i Y, U, V;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_U, &U, RGB2YUV_V, &V);
+    _mm256_storeu_si256((__m256i *)(dest[0] + y*width + x), Y);
+    _mm256_storeu_si256((__m256i *)(dest[1] + y*width + x), U);
+    _mm256_storeu_si256((__m256i *)(dest[2] + y*width + x), V);
+}
+
+AVX2_INLINE void rgb_to_yuy2_avx2(RGB_ARGS, uint8_t **dest,
+                                  int x, int y, int width)
+{
+    __m256i Y, C;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_UV, &C, RGB2YUV_NONE);
+    interleave_store_avx2(dest[0] + (y*width+x)*2, Y, C);
+}
+
+AVX2_INLINE void rgb_to_uyvy_avx2(RGB_ARGS, uint8_t **dest,
+                                  int x, int y, int width)
+{
+    __m256i Y, C;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_UV, &C, RGB2YUV_NONE);
+    interleave_store_avx2(dest[0] + (y*width+x)*2, C, Y);
+}
+
+AVX2_INLINE void rgb_to_yvyu_avx2(RGB_ARGS, uint8_t **dest,
+                                  int x, int y, int width)
+{
+    __m256i Y, C;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_VU, &C, RGB2YUV_NONE);
+    interleave_store_avx2(dest[0] + (y*width+x)*2, Y, C);
+}
+
+AVX2_INLINE void rgb_to_y8_avx2(RGB_ARGS, uint8_t **dest,
+                                int x, int y, int width)
+{
+    __m256i Y;
+    rgb2yuv_avx2(RGB_PASS, &Y, RGB2YUV_NONE, RGB2YUV_NONE);
+    _mm256_storeu_si256((__m256i *)(dest[0] + y*width + x), Y);
+}
+
+#define DEFINE_RGB2YUV_AVX2(rgb,yuv,rgbsz,rofs,gofs,bofs,slowop) \
+static AC_TARGET_AVX2 int rgb##_##yuv##_avx2(uint8_t **src, uint8_t **dest,\
+                                             int width, int height)     \
+{                                                                       \
+    int x, y;                                                           \
+                                                                        \
+    for (y = 0; y < height; y++) {                                      \
+        for (x = 0; x + 32 <= width; x += 32) {                         \
+            rgb_to_##yuv##_avx2(src[0]+(y*width+x)*rgbsz, rgbsz,        \
+                                rofs, gofs, bofs, dest, x, y, width);   \
+        }                                                               \
+        while (x < width) {                                             \
+            int r = src[0][(y*width+x)*rgbsz+rofs];                     \
+            int g = src[0][(y*width+x)*rgbsz+gofs];                     \
+            int b = src[0][(y*width+x)*rgbsz+bofs];                     \
+            slowop;                                                     \
+            x++;                                                        \
+        }                                                               \
+    }                                                                   \
+    return 1;                                                           \
+}
+
+#define DEFINE_RGB2YUV_AVX2_SET(rgb,sz,r,g,b) \
+    DEFINE_RGB2YUV_AVX2(rgb,yuv420p, sz,r,g,b, RGB2YUV_420P) \
+    DEFINE_RGB2YUV_AVX2(rgb,yuv411p, sz,r,g,b, RGB2YUV_411P) \
+    DEFINE_RGB2YUV_AVX2(rgb,yuv422p, sz,r,g,b, RGB2YUV_422P) \
+    DEFINE_RGB2YUV_AVX2(rgb,yuv444p, sz,r,g,b, RGB2YUV_444P) \
+    DEFINE_RGB2YUV_AVX2(rgb,yuy2,    sz,r,g,b, RGB2YUV_YUY2) \
+    DEFINE_RGB2YUV_AVX2(rgb,uyvy,    sz,r,g,b, RGB2YUV_UYVY) \
+    DEFINE_RGB2YUV_AVX2(rgb,yvyu,    sz,r,g,b, RGB2YUV_YVYU) \
+    DEFINE_RGB2YUV_AVX2(rgb,y8,      sz,r,g,b, RGB2Y())
+
+DEFINE_RGB2YUV_AVX2_SET(rgb24,  3,0,1,2)
+DEFINE_RGB2YUV_AVX2_SET(bgr24,  3,2,1,0)
+DEFINE_RGB2YUV_AVX2_SET(rgba32, 4,0,1,2)
+DEFINE_RGB2YUV_AVX2_SET(abgr32, 4,3,2,1)
+DEFINE_RGB2YUV_AVX2_SET(argb32, 4,1,2,3)
+DEFINE_RGB2YUV_AVX2_SET(bgra32, 4,2,1,0)
+
+/*************************************************************************/
+
+#endif  /* HAVE_AC_AVX2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
 /* Initialization */
 
 int ac_imgconvert_init_yuv_rgb(int accel)
@@ -2394,6 +2937,118 @@ int ac_imgconvert_init_yuv_rgb(int accel)
     }
 #endif
 
+#if defined(HAVE_AC_AVX2)
+    /* Registered last, so these replace the narrower versions;
+     * grayscale conversions stay with SSE2 */
+    if (HAS_ACCEL(accel, AC_AVX2)) {
+        if (!register_conversion(IMG_YUV420P, IMG_RGB24,   yuv420p_rgb24_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_BGR24,   yuv420p_bgr24_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_RGBA32,  yuv420p_rgba32_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_ABGR32,  yuv420p_abgr32_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_ARGB32,  yuv420p_argb32_avx2)
+         || !register_conversion(IMG_YUV420P, IMG_BGRA32,  yuv420p_bgra32_avx2)
+
+         || !register_conversion(IMG_YUV411P, IMG_RGB24,   yuv411p_rgb24_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_BGR24,   yuv411p_bgr24_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_RGBA32,  yuv411p_rgba32_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_ABGR32,  yuv411p_abgr32_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_ARGB32,  yuv411p_argb32_avx2)
+         || !register_conversion(IMG_YUV411P, IMG_BGRA32,  yuv411p_bgra32_avx2)
+
+         || !register_conversion(IMG_YUV422P, IMG_RGB24,   yuv422p_rgb24_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_BGR24,   yuv422p_bgr24_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_RGBA32,  yuv422p_rgba32_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_ABGR32,  yuv422p_abgr32_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_ARGB32,  yuv422p_argb32_avx2)
+         || !register_conversion(IMG_YUV422P, IMG_BGRA32,  yuv422p_bgra32_avx2)
+
+         || !register_conversion(IMG_YUV444P, IMG_RGB24,   yuv444p_rgb24_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_BGR24,   yuv444p_bgr24_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_RGBA32,  yuv444p_rgba32_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_ABGR32,  yuv444p_abgr32_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_ARGB32,  yuv444p_argb32_avx2)
+         || !register_conversion(IMG_YUV444P, IMG_BGRA32,  yuv444p_bgra32_avx2)
+
+         || !register_conversion(IMG_YUY2,    IMG_RGB24,   yuy2_rgb24_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_BGR24,   yuy2_bgr24_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_RGBA32,  yuy2_rgba32_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_ABGR32,  yuy2_abgr32_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_ARGB32,  yuy2_argb32_avx2)
+         || !register_conversion(IMG_YUY2,    IMG_BGRA32,  yuy2_bgra32_avx2)
+
+         || !register_conversion(IMG_UYVY,    IMG_RGB24,   uyvy_rgb24_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_BGR24,   uyvy_bgr24_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_RGBA32,  uyvy_rgba32_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_ABGR32,  uyvy_abgr32_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_ARGB32,  uyvy_argb32_avx2)
+         || !register_conversion(IMG_UYVY,    IMG_BGRA32,  uyvy_bgra32_avx2)
+
+         || !register_conversion(IMG_YVYU,    IMG_RGB24,   yvyu_rgb24_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_BGR24,   yvyu_bgr24_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_RGBA32,  yvyu_rgba32_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_ABGR32,  yvyu_abgr32_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_ARGB32,  yvyu_argb32_avx2)
+         || !register_conversion(IMG_YVYU,    IMG_BGRA32,  yvyu_bgra32_avx2)
+
+         || !register_conversion(IMG_RGB24,   IMG_YUV420P, rgb24_yuv420p_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_YUV411P, rgb24_yuv411p_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_YUV422P, rgb24_yuv422p_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_YUV444P, rgb24_yuv444p_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_YUY2,    rgb24_yuy2_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_UYVY,    rgb24_uyvy_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_YVYU,    rgb24_yvyu_avx2)
+         || !register_conversion(IMG_RGB24,   IMG_Y8,      rgb24_y8_avx2)
+
+         || !register_conversion(IMG_BGR24,   IMG_YUV420P, bgr24_yuv420p_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_YUV411P, bgr24_yuv411p_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_YUV422P, bgr24_yuv422p_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_YUV444P, bgr24_yuv444p_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_YUY2,    bgr24_yuy2_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_UYVY,    bgr24_uyvy_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_YVYU,    bgr24_yvyu_avx2)
+         || !register_conversion(IMG_BGR24,   IMG_Y8,      bgr24_y8_avx2)
+
+         || !register_conversion(IMG_RGBA32,  IMG_YUV420P, rgba32_yuv420p_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_YUV411P, rgba32_yuv411p_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_YUV422P, rgba32_yuv422p_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_YUV444P, rgba32_yuv444p_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_YUY2,    rgba32_yuy2_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_UYVY,    rgba32_uyvy_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_YVYU,    rgba32_yvyu_avx2)
+         || !register_conversion(IMG_RGBA32,  IMG_Y8,      rgba32_y8_avx2)
+
+         || !register_conversion(IMG_ABGR32,  IMG_YUV420P, abgr32_yuv420p_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_YUV411P, abgr32_yuv411p_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_YUV422P, abgr32_yuv422p_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_YUV444P, abgr32_yuv444p_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_YUY2,    abgr32_yuy2_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_UYVY,    abgr32_uyvy_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_YVYU,    abgr32_yvyu_avx2)
+         || !register_conversion(IMG_ABGR32,  IMG_Y8,      abgr32_y8_avx2)
+
+         || !register_conversion(IMG_ARGB32,  IMG_YUV420P, argb32_yuv420p_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_YUV411P, argb32_yuv411p_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_YUV422P, argb32_yuv422p_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_YUV444P, argb32_yuv444p_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_YUY2,    argb32_yuy2_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_UYVY,    argb32_uyvy_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_YVYU,    argb32_yvyu_avx2)
+         || !register_conversion(IMG_ARGB32,  IMG_Y8,      argb32_y8_avx2)
+
+         || !register_conversion(IMG_BGRA32,  IMG_YUV420P, bgra32_yuv420p_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_YUV411P, bgra32_yuv411p_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_YUV422P, bgra32_yuv422p_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_YUV444P, bgra32_yuv444p_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_YUY2,    bgra32_yuy2_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_UYVY,    bgra32_uyvy_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_YVYU,    bgra32_yvyu_avx2)
+         || !register_conversion(IMG_BGRA32,  IMG_Y8,      bgra32_y8_avx2)
+        ) {
+            return 0;
+        }
+    }
+#endif  /* HAVE_AC_AVX2 */
+
     return 1;
 }
 
@@ -14,14 +14,136 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*************************************************************************/
 
-static struct {
-    ImageFormat srcfmt, destfmt;
-    ConversionFunc func;
-} *conversions;
-static int n_conversions = 0;
+/* Conversion functions, indexed by [source][destination] format (see
+ * fmt_index() below).  YV12 never appears here, since ac_imgconvert() and
+ * ac_imgconvert_get_func() map it to YUV420P. */
+
+#define N_YUV_FORMATS   (IMG_YUV_LAST - IMG_YUV_BASE - 1)
+#define N_RGB_FORMATS   (IMG_RGB_LAST - IMG_RGB_BASE - 1)
+#define N_FORMATS       (N_YUV_FORMATS + N_RGB_FORMATS)
+
+static ConversionFunc conversions[N_FORMATS][N_FORMATS];
+
+/* Intermediate format for pairs with no direct conversion, or IMG_NONE if
+ * the pair cannot be converted at all (see find_routes()). */
+static ImageFormat routes[N_FORMATS][N_FORMATS];
+
+/* Per-format data used to choose routes and to split images into bands.
+ * Sizes are in quarter-bytes per pixel, so that the subsampled planar
+ * formats come out as integers. */
+static const struct {
+    ImageFormat fmt;
+    int size;    /* Bytes per pixel * 4 */
+    int chroma;  /* Chroma samples per pixel * 4 (0 for luma only) */
+    int rgb;     /* Nonzero for RGB formats */
+} fmt_info[N_FORMATS] = {
+    { IMG_YUV420P,  6, 1, 0 },
+    { IMG_YV12,     6, 1, 0 },  /* never used (mapped to YUV420P) */
+    { IMG_YUV411P,  6, 1, 0 },
+    { IMG_YUV422P,  8, 2, 0 },
+    { IMG_YUV444P, 12, 4, 0 },
+    { IMG_YUY2,     8, 2, 0 },
+    { IMG_UYVY,     8, 2, 0 },
+    { IMG_YVYU,     8, 2, 0 },
+    { IMG_Y8,       4, 0, 0 },
+    { IMG_RGB24,   12, 4, 1 },
+    { IMG_BGR24,   12, 4, 1 },
+    { IMG_RGBA32,  16, 4, 1 },
+    { IMG_ABGR32,  16, 4, 1 },
+    { IMG_ARGB32,  16, 4, 1 },
+    { IMG_BGRA32,  16, 4, 1 },
+    { IMG_GRAY8,    4, 0, 1 },
+};
+
+/* Size in bytes of the intermediate buffer used for routed conversions;
+ * the image is converted in bands of rows which fit in this buffer, so
+ * the intermediate data stays in cache. */
+#define ROUTE_BUFSIZE   65536
+
+/* Return the table index for the given format, or -1 if it is not a valid
+ * image format. */
+
+static inline int fmt_index(ImageFormat fmt)
+{
+    if (IS_YUV_FORMAT(fmt))
+        return fmt - IMG_YUV_BASE - 1;
+    if (IS_RGB_FORMAT(fmt))
+        return N_YUV_FORMATS + (fmt - IMG_RGB_BASE - 1);
+    return -1;
+}
+
+/* Set `out' to point to row `y' of the image `in' of the given format. */
+
+static void offset_planes(uint8_t **out, uint8_t **in, ImageFormat fmt,
+                          int width, int y)
+{
+    switch (fmt) {
+      case IMG_YUV420P:
+        out[0] = in[0] + y*width;
+        out[1] = in[1] + (y/2)*(width/2);
+        out[2] = in[2] + (y/2)*(width/2);
+        break;
+      case IMG_YUV411P:
+        out[0] = in[0] + y*width;
+        out[1] = in[1] + y*(width/4);
+        out[2] = in[2] + y*(width/4);
+        break;
+      case IMG_YUV422P:
+        out[0] = in[0] + y*width;
+        out[1] = in[1] + y*(width/2);
+        out[2] = in[2] + y*(width/2);
+        break;
+      case IMG_YUV444P:
+        out[0] = in[0] + y*width;
+        out[1] = in[1] + y*width;
+        out[2] = in[2] + y*width;
+        break;
+      default:  /* packed formats */
+        out[0] = in[0] + y*width*(fmt_info[fmt_index(fmt)].size/4);
+        break;
+    }
+}
+
+/*************************************************************************/
+
+/* Convert an image through the intermediate format `via', one band of
+ * rows at a time.  Bands are an even number of rows high, so vertically
+ * subsampled formats are split cleanly. */
+
+static int convert_routed(uint8_t **src, ImageFormat srcfmt,
+                          uint8_t **dest, ImageFormat destfmt,
+                          ImageFormat via, int width, int height)
+{
+    ConversionFunc first  = conversions[fmt_index(srcfmt)][fmt_index(via)];
+    ConversionFunc second = conversions[fmt_index(via)][fmt_index(destfmt)];
+    uint8_t *buf, *bandsrc[3], *banddest[3], *bandtmp[3];
+    int rows, y, ok = 1;
+
+    rows = (ROUTE_BUFSIZE / (width*4)) & ~1;
+    if (rows < 2)
+        rows = 2;
+    buf = malloc(rows * width*4);
+    if (!buf) {
+        fprintf(stderr, "ac_imgconvert(): out of memory\n");
+        return 0;
+    }
+    YUV_INIT_PLANES(bandtmp, buf, via, width, rows);
+
+    for (y = 0; ok && y < height; y += rows) {
+        int h = (height-y < rows) ? height-y : rows;
+        offset_planes(bandsrc, src, srcfmt, width, y);
+        offset_planes(banddest, dest, destfmt, width, y);
+        ok = (*first)(bandsrc, bandtmp, width, h)
+          && (*second)(bandtmp, banddest, width, h);
+    }
+
+    free(buf);
+    return ok;
+}
 
 /*************************************************************************/
 /*************************************************************************/
@@ -35,7 +157,7 @@ int ac_imgconvert(uint8_t **src, ImageFormat srcfmt,
                   uint8_t **dest, ImageFormat destfmt,
                   int width, int height)
 {
-    int i;
+    ConversionFunc func;
 
     /* Hack to handle YV12 easily, because conversion routines don't get
      * format tags */
@@ -55,12 +177,41 @@ int ac_imgconvert(uint8_t **src, ImageFormat srcfmt,
         dest = newdest;
     }
 
-    for (i = 0; i < n_conversions; i++) {
-        if (conversions[i].srcfmt==srcfmt && conversions[i].destfmt==destfmt)
-            return (*conversions[i].func)(src, dest, width, height);
-    }
+    func = ac_imgconvert_get_func(srcfmt, destfmt);
+    if (func)
+        return (*func)(src, dest, width, height);
+    if (fmt_index(srcfmt) < 0 || fmt_index(destfmt) < 0)
+        return 0;
+    if (routes[fmt_index(srcfmt)][fmt_index(destfmt)] == IMG_NONE)
+        return 0;
+    return convert_routed(src, srcfmt, dest, destfmt,
+                          routes[fmt_index(srcfmt)][fmt_index(destfmt)],
+                          width, height);
+}
 
-    return 0;
+/*************************************************************************/
+
+/* Return the conversion function for the given pair of formats, or NULL
+ * if there is no direct conversion (ac_imgconvert() may still be able to
+ * convert through an intermediate format).  Callers converting many images
+ * of the same format can look the function up once and call it directly.
+ * As with the conversion routines themselves, no format tags are passed,
+ * so a YV12 image is converted as YUV420P: the caller must swap the U and
+ * V plane pointers (src[1]/src[2] or dest[1]/dest[2]) itself. */
+
+ConversionFunc ac_imgconvert_get_func(ImageFormat srcfmt, ImageFormat destfmt)
+{
+    int srcidx, destidx;
+
+    if (srcfmt == IMG_YV12)
+        srcfmt = IMG_YUV420P;
+    if (destfmt == IMG_YV12)
+        destfmt = IMG_YUV420P;
+    srcidx  = fmt_index(srcfmt);
+    destidx = fmt_index(destfmt);
+    if (srcidx < 0 || destidx < 0)
+        return NULL;
+    return conversions[srcidx][destidx];
 }
 
 /*************************************************************************/
@@ -68,8 +219,48 @@ int ac_imgconvert(uint8_t **src, ImageFormat srcfmt,
 
 /* Internal use only! */
 
+/* Choose an intermediate format for each pair of formats with no direct
+ * conversion.  Only intermediates in the color space of the source or
+ * destination, and with at least as much chroma data as one of them, are
+ * considered, so a route never loses data a direct conversion would keep;
+ * of those, the smallest is used. */
+
+static void find_routes(void)
+{
+    int s, d, m;
+
+    for (s = 0; s < N_FORMATS; s++) {
+        for (d = 0; d < N_FORMATS; d++) {
+            int best = -1;
+            routes[s][d] = IMG_NONE;
+            if (s == d || conversions[s][d])
+                continue;
+            for (m = 0; m < N_FORMATS; m++) {
+                if (m == s || m == d
+                 || !conversions[s][m] || !conversions[m][d]
+                 || (fmt_info[m].rgb != fmt_info[s].rgb
+                     && fmt_info[m].rgb != fmt_info[d].rgb)
+                 || (fmt_info[m].chroma < fmt_info[s].chroma
+                     && fmt_info[m].chroma < fmt_info[d].chroma)
+                ) {
+                    continue;
+                }
+                if (best < 0 || fmt_info[m].size < fmt_info[best].size)
+                    best = m;
+            }
+            if (best >= 0)
+                routes[s][d] = fmt_info[best].fmt;
+        }
+    }
+}
+
+/*************************************************************************/
+
 int ac_imgconvert_init(int accel)
 {
+    /* Forget any conversions registered by a previous call */
+    memset(conversions, 0, sizeof(conversions));
+
     if (!ac_imgconvert_init_yuv_planar(accel)
      || !ac_imgconvert_init_yuv_packed(accel)
      || !ac_imgconvert_init_yuv_mixed(accel)
@@ -79,30 +270,22 @@ int ac_imgconvert_init(int accel)
         fprintf(stderr, "ac_imgconvert_init() failed");
         return 0;
     }
+    find_routes();
     return 1;
 }
 
 int register_conversion(ImageFormat srcfmt, ImageFormat destfmt,
                         ConversionFunc function)
 {
-    int i;
-
-    for (i = 0; i < n_conversions; i++) {
-        if (conversions[i].srcfmt==srcfmt && conversions[i].destfmt==destfmt) {
-            conversions[i].func = function;
-            return 1;
-        }
-    }
+    int srcidx  = fmt_index(srcfmt);
+    int destidx = fmt_index(destfmt);
 
-    if (!(conversions = realloc(conversions,
-                                (n_conversions+1) * sizeof(*conversions)))) {
-        fprintf(stderr, "register_conversion(): out of memory\n");
+    if (srcidx < 0 || destidx < 0 || srcfmt == IMG_YV12 || destfmt == IMG_YV12) {
+        fprintf(stderr, "register_conversion(): invalid format pair"
+                " 0x%04X -> 0x%04X\n", srcfmt, destfmt);
         return 0;
     }
-    conversions[n_conversions].srcfmt  = srcfmt;
-    conversions[n_conversions].destfmt = destfmt;
-    conversions[n_conversions].func    = function;
-    n_conversions++;
+    conversions[srcidx][destidx] = function;
     return 1;
 }
 
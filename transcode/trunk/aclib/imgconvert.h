@@ -78,6 +78,11 @@ typedef struct {
 
 /*************************************************************************/
 
+/* Type of a conversion function (as returned by ac_imgconvert_get_func()).
+ * Returns 1 on success, 0 on failure. */
+typedef int (*ConversionFunc)(uint8_t **src, uint8_t **dest,
+                              int width, int height);
+
 /* Initialization routine.  Returns 1 on success, 0 on failure. */
 extern int ac_imgconvert_init(int accel);
 
@@ -90,6 +95,14 @@ extern int ac_imgconvert(uint8_t **src,         /* Array of source planes */
                          int height             /* Image height in pixels */
                         );
 
+/* Conversion function lookup.  Returns the function ac_imgconvert() would
+ * use for the given formats, or NULL if there is no direct conversion
+ * (ac_imgconvert() may still convert through an intermediate format).
+ * YV12 is handled as YUV420P, so the caller must swap the U and V plane
+ * pointers of YV12 images before calling the returned function. */
+extern ConversionFunc ac_imgconvert_get_func(ImageFormat srcfmt,
+                                             ImageFormat destfmt);
+
 /*************************************************************************/
 
 #endif  /* ACLIB_IMGCONVERT_H */
@@ -470,6 +470,60 @@ amd64.memcpy_last:                                                      \n\
 
 /*************************************************************************/
 
+/* AVX2 version: blocks up to the size of a typical L2 cache are left to
+ * the C library, which is hard to beat for them; bigger (frame-sized)
+ * blocks are copied 128 bytes at a time with non-temporal stores, so that
+ * the copy does not flush the cache of the data which will be worked on
+ * next. */
+
+#if defined(HAVE_AC_AVX2)
+
+#include <immintrin.h>
+
+/* Copies at least this large bypass the cache */
+#define AVX2_MEMCPY_NT_MIN  0x100000
+
+static AC_TARGET_AVX2 void *memcpy_avx2(void *dest, const void *src,
+                                        size_t bytes)
+{
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    size_t head;
+
+    /* ac_memcpy() has to copy ascending, and overlapping copies would
+     * not work with the streaming loop anyway */
+    if (bytes < AVX2_MEMCPY_NT_MIN || (d > s && d < s + bytes))
+        return memmove(dest, src, bytes);
+
+    head = (32 - ((uintptr_t)d & 31)) & 31;
+    if (head) {
+        memmove(d, s, head);
+        d += head;
+        s += head;
+        bytes -= head;
+    }
+    for (; bytes >= 128; bytes -= 128, d += 128, s += 128) {
+        __m256i a, b, c, e;
+        _mm_prefetch((const char *)s + 512, _MM_HINT_NTA);
+        a = _mm256_loadu_si256((const __m256i *)(s));
+        b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        c = _mm256_loadu_si256((const __m256i *)(s + 64));
+        e = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_stream_si256((__m256i *)(d),      a);
+        _mm256_stream_si256((__m256i *)(d + 32), b);
+        _mm256_stream_si256((__m256i *)(d + 64), c);
+        _mm256_stream_si256((__m256i *)(d + 96), e);
+    }
+    _mm_sfence();  /* order the streaming stores before the tail */
+    if (bytes)
+        memmove(d, s, bytes);
+    return dest;
+}
+
+#endif  /* HAVE_AC_AVX2 */
+
+/*************************************************************************/
+
 /* Initialization routine. */
 
 int ac_memcpy_init(int accel)
@@ -491,6 +545,11 @@ int ac_memcpy_init(int accel)
         memcpy_ptr = memcpy_amd64;
 #endif
 
+#if defined(HAVE_AC_AVX2)
+    if (HAS_ACCEL(accel, AC_AVX2))
+        memcpy_ptr = memcpy_avx2;
+#endif
+
     return 1;
 }
 
@@ -46,6 +46,7 @@ enum {
     MAX_INFO_STRLEN  = 64,               /* XXX: ???                   */
     FRAME_RATE_SCALE = 1000000,          /* XXX: ???                   */
     HEADERBYTES      = 2048,             /* bytes for the header       */
+    READAHEAD_GAP    = 256*1024,         /* max gap in one prefetch    */
 };
 
 /* AVI_MAX_LEN: The maximum length of an AVI file, we stay a bit below
@@ -53,6 +54,36 @@ enum {
 #define AVI_MAX_LEN (UINT_MAX-(1<<20)*16-HEADERBYTES)
 #define PAD_EVEN(x) ( ((x)+1) & ~1 )
 
+/* Index cache: suffix of the file kept next to an AVI, and its header */
+#define INDEX_CACHE_SUFFIX  ".tcidx"
+#define INDEX_CACHE_MAGIC   "TCAVIIDX"
+#define INDEX_CACHE_VERSION 2
+
+/* nanoseconds of the modification time, where struct stat has them */
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+# define ST_MTIME_NSEC(st)  ((st).st_mtim.tv_nsec)
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+# define ST_MTIME_NSEC(st)  ((st).st_mtimespec.tv_nsec)
+#else
+# define ST_MTIME_NSEC(st)  0
+#endif
+
+typedef struct {
+    char     magic[8];          /* INDEX_CACHE_MAGIC                    */
+    uint32_t version;           /* INDEX_CACHE_VERSION                  */
+    uint32_t byteorder;         /* 0x01020304 in host byte order        */
+    uint32_t entry_sizes;       /* sizeof video | audio index entry<<16 */
+    int32_t  anum;              /* number of audio tracks               */
+    int64_t  file_size;         /* size of the AVI file when cached     */
+    int64_t  file_mtime;        /* modification time of the AVI file    */
+    int64_t  file_mtime_nsec;   /* ...and its nanoseconds, 0 if unknown */
+    int64_t  video_frames;
+    int64_t  audio_chunks[AVI_MAX_TRACKS];
+    int64_t  audio_bytes[AVI_MAX_TRACKS];
+    /* followed by video_frames video index entries, then for each audio
+       track audio_chunks+1 audio index entries (the last one zeroed) */
+} index_cache_header;
+
 
 /*************************************************************************/
 /* forward declarations                                                  */
@@ -137,6 +168,99 @@ static int avi_sampsize(avi_t *AVI, int j)
    return s;
 }
 
+/* The ix## chunk currently being filled for a superindex, if any */
+
+static avistdindex_chunk *avi_cur_stdindex(avisuperindex_chunk *si)
+{
+    if (!si || si->nEntriesInUse == 0)
+        return NULL;
+    return si->stdindex[si->nEntriesInUse - 1];
+}
+
+/* Remember the writer state before chunks start to collect in the write
+   buffer, see avi_discard_write_buf().  Buffered chunks never span two
+   RIFFs (avi_add_odml_index_entry() flushes around starting a new one),
+   so the counters of the current index chunks are enough */
+
+static void avi_mark_write_buf(avi_t *AVI)
+{
+    avi_write_mark_t *m = &AVI->write_mark;
+    avistdindex_chunk *ix;
+    int j;
+
+    m->pos = AVI->pos;
+    m->n_idx = AVI->n_idx;
+    m->video_frames = AVI->video_frames;
+    m->total_frames = AVI->total_frames;
+    m->max_len = AVI->max_len;
+    m->last_pos = AVI->last_pos;
+    m->last_len = AVI->last_len;
+    ix = avi_cur_stdindex(AVI->video_superindex);
+    m->video_entries = ix ? ix->nEntriesInUse : 0;
+    for (j = 0; j < AVI->anum; j++) {
+        m->audio_bytes[j] = AVI->track[j].audio_bytes;
+        m->audio_chunks[j] = AVI->track[j].audio_chunks;
+        ix = avi_cur_stdindex(AVI->track[j].audio_superindex);
+        m->audio_entries[j] = ix ? ix->nEntriesInUse : 0;
+    }
+    m->valid = 1;
+}
+
+/* Drop the chunks waiting in the write buffer after a failed write,
+   along with their index entries and counters, so that the file can
+   still be closed consistently.  Without a mark (index chunks written
+   while starting a RIFF or closing the file) only the file position
+   is moved back */
+
+static void avi_discard_write_buf(avi_t *AVI)
+{
+    avi_write_mark_t *m = &AVI->write_mark;
+    avistdindex_chunk *ix;
+    int j;
+
+    if (m->valid) {
+        AVI->pos = m->pos;
+        AVI->n_idx = m->n_idx;
+        AVI->video_frames = m->video_frames;
+        AVI->total_frames = m->total_frames;
+        AVI->max_len = m->max_len;
+        AVI->last_pos = m->last_pos;
+        AVI->last_len = m->last_len;
+        if ((ix = avi_cur_stdindex(AVI->video_superindex)) != NULL)
+            ix->nEntriesInUse = m->video_entries;
+        for (j = 0; j < AVI->anum; j++) {
+            AVI->track[j].audio_bytes = m->audio_bytes[j];
+            AVI->track[j].audio_chunks = m->audio_chunks[j];
+            if ((ix = avi_cur_stdindex(AVI->track[j].audio_superindex)) != NULL)
+                ix->nEntriesInUse = m->audio_entries[j];
+        }
+        m->valid = 0;
+    } else {
+        AVI->pos -= AVI->write_buf_len;
+    }
+    AVI->write_buf_len = 0;
+    plat_seek(AVI->fdes,AVI->pos,SEEK_SET);
+    AVI_errno = AVI_ERR_WRITE;
+}
+
+/* Write out the chunks waiting in the write buffer; this must be done
+   before anything else is written to or seeked in the file.
+   returns -1 on write error, 0 on success */
+
+static int avi_flush_write_buf(avi_t *AVI)
+{
+   if(AVI->write_buf_len == 0) return 0;
+
+   if(plat_write(AVI->fdes,AVI->write_buf,AVI->write_buf_len) != AVI->write_buf_len)
+   {
+      avi_discard_write_buf(AVI);
+      return -1;
+   }
+   AVI->write_buf_len = 0;
+   AVI->write_mark.valid = 0;
+   return 0;
+}
+
 /* Add a chunk (=tag and data) to the AVI file,
    returns -1 on write error, 0 on success */
 
@@ -145,28 +269,54 @@ static int avi_add_chunk(avi_t *AVI, const unsigned char *tag,
 {
    unsigned char c[8];
    char p=0;
-
-   /* Copy tag and length int c, so that we need only 1 write system call
-      for these two values */
+   long total = 8 + PAD_EVEN(length);
 
    memcpy(c,tag,4);
    long2str(c+4,length);
 
-   /* Output tag, length and data, restore previous position
-      if the write fails */
+   if(AVI->write_buf && total <= AVI->write_buf_size - AVI->write_buf_len)
+   {
+      /* Small chunks are collected in the write buffer */
+
+      char *buf = AVI->write_buf + AVI->write_buf_len;
 
-   if( plat_write(AVI->fdes,(char *)c,8) != 8 ||
-       plat_write(AVI->fdes,(char *)data,length) != length ||
-       plat_write(AVI->fdes,&p,length&1) != (length&1)) // if len is uneven, write a pad byte
+      memcpy(buf,c,8);
+      memcpy(buf+8,data,length);
+      if(length&1) buf[8+length] = 0;
+      AVI->write_buf_len += total;
+   }
+   else
    {
-      plat_seek(AVI->fdes,AVI->pos,SEEK_SET);
-      AVI_errno = AVI_ERR_WRITE;
-      return -1;
+      /* Output pending chunks, tag, length, data and pad byte (if len
+         is uneven) in one go, restore previous position if the write
+         fails */
+
+      struct iovec iov[4];
+      int n = 0;
+
+      if(AVI->write_buf_len > 0) {
+         iov[n].iov_base = AVI->write_buf;
+         iov[n++].iov_len = AVI->write_buf_len;
+      }
+      iov[n].iov_base = c;
+      iov[n++].iov_len = 8;
+      iov[n].iov_base = (void *)data;
+      iov[n++].iov_len = length;
+      iov[n].iov_base = &p;
+      iov[n++].iov_len = length&1;
+
+      if(plat_writev(AVI->fdes,iov,n) != AVI->write_buf_len + total)
+      {
+         avi_discard_write_buf(AVI);
+         return -1;
+      }
+      AVI->write_buf_len = 0;
+      AVI->write_mark.valid = 0;
    }
 
    /* Update file position */
 
-   AVI->pos += 8 + PAD_EVEN(length);
+   AVI->pos += total;
 
    //fprintf(stderr, "pos=%lu %s\n", AVI->pos, tag);
 
@@ -309,7 +459,7 @@ static int avi_add_odml_index_entry_core(avi_t *AVI, long flags, off_t pos,
 
     // need to fetch more memory
     if (cur_chunk_idx >= si->dwSize) {
-	si->dwSize += 4096;
+	si->dwSize *= 2;
 	si->aIndex = plat_realloc ( si->aIndex, si->dwSize * sizeof (uint32_t) * si->wLongsPerEntry);
     }
 
@@ -404,6 +554,11 @@ static int avi_add_odml_index_entry(avi_t *AVI, const unsigned char *tag,
     plat_log_send(PLAT_LOG_INFO, __FILE__, "Adding a new RIFF chunk: %d",
                   AVI->video_superindex->nEntriesInUse);
 
+	// buffered chunks can't be taken back across RIFFs
+	if (avi_flush_write_buf(AVI) < 0)
+	    return -1;
+	AVI->write_mark.valid = 0;
+
 	// rotate ALL indices
 	AVI->video_superindex->nEntriesInUse++;
 	cur_std_idx = AVI->video_superindex->nEntriesInUse-1;
@@ -486,6 +641,9 @@ static int avi_add_odml_index_entry(avi_t *AVI, const unsigned char *tag,
 	    AVI->is_opendml++;
 	}
 
+	if (avi_flush_write_buf(AVI) < 0)
+	    return -1;
+	avi_mark_write_buf(AVI);
     }
 
 
@@ -514,13 +672,16 @@ static int avi_add_index_entry(avi_t *AVI, const unsigned char *tag, long flags,
    void *ptr;
 
    if(AVI->n_idx>=AVI->max_idx) {
-     ptr = plat_realloc((void *)AVI->idx,(AVI->max_idx+4096)*16);
+     /* grow geometrically, to keep the copying linear */
+     long max_idx = AVI->max_idx ? AVI->max_idx*2 : 4096;
+
+     ptr = plat_realloc((void *)AVI->idx,max_idx*16);
 
      if(ptr == 0) {
        AVI_errno = AVI_ERR_NO_MEM;
        return -1;
      }
-     AVI->max_idx += 4096;
+     AVI->max_idx = max_idx;
      AVI->idx = (unsigned char((*)[16]) ) ptr;
    }
 
@@ -928,7 +1089,8 @@ int avi_update_header(avi_t *AVI)
    /* Output the header, truncate the file to the number of bytes
       actually written, report an error if someting goes wrong */
 
-   if ( plat_seek(AVI->fdes,0,SEEK_SET)<0 ||
+   if ( avi_flush_write_buf(AVI)<0 ||
+        plat_seek(AVI->fdes,0,SEEK_SET)<0 ||
         plat_write(AVI->fdes,(char *)AVI_header,HEADERBYTES)!=HEADERBYTES ||
 	plat_seek(AVI->fdes,AVI->pos,SEEK_SET)<0)
      {
@@ -1609,7 +1771,8 @@ static int avi_close_output_file(avi_t *AVI)
    /* Output the header, truncate the file to the number of bytes
       actually written, report an error if someting goes wrong */
 
-   if ( plat_seek(AVI->fdes,0,SEEK_SET)<0 ||
+   if ( avi_flush_write_buf(AVI)<0 ||
+        plat_seek(AVI->fdes,0,SEEK_SET)<0 ||
         plat_write(AVI->fdes,(char *)AVI_header,HEADERBYTES)!=HEADERBYTES ||
         plat_ftruncate(AVI->fdes,AVI->pos)<0 )
    {
@@ -1681,6 +1844,9 @@ static int plat_write_data(avi_t *AVI, const char *data, unsigned long length,
    //set tag for current audio track
    snprintf((char *)astr, sizeof(astr), "0%1dwb", (int)(AVI->aptr+1));
 
+   // state to return to if this chunk can't be written
+   if(AVI->write_buf_len == 0) avi_mark_write_buf(AVI);
+
    if(audio) {
      if (!AVI->is_opendml) n = avi_add_index_entry(AVI,astr,0x10,AVI->pos,length);
      n += avi_add_odml_index_entry(AVI,astr,0x10,AVI->pos,length);
@@ -1744,6 +1910,51 @@ long AVI_bytes_written(avi_t *AVI)
    return (AVI->pos + 8 + 16*AVI->n_idx);
 }
 
+int AVI_set_write_buffer(avi_t *AVI, long bytes)
+{
+    char *buf = NULL;
+
+    if (AVI->mode == AVI_MODE_READ) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+    if (bytes < 0)
+        return -1;
+
+    if (avi_flush_write_buf(AVI) < 0)
+        return -1;
+    if (bytes > 0) {
+        buf = plat_malloc(bytes);
+        if (!buf) { AVI_errno = AVI_ERR_NO_MEM; return -1; }
+    }
+    if (AVI->write_buf)
+        plat_free(AVI->write_buf);
+    AVI->write_buf = buf;
+    AVI->write_buf_size = bytes;
+    return 0;
+}
+
+int AVI_reserve_index(avi_t *AVI, long chunks)
+{
+    void *ptr;
+
+    if (AVI->mode == AVI_MODE_READ) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+
+    if (chunks > AVI->max_idx) {
+        ptr = plat_realloc((void *)AVI->idx, chunks*16);
+        if (!ptr) { AVI_errno = AVI_ERR_NO_MEM; return -1; }
+        AVI->max_idx = chunks;
+        AVI->idx = (unsigned char((*)[16]) ) ptr;
+    }
+    return 0;
+}
+
+int AVI_reserve_space(avi_t *AVI, int64_t bytes)
+{
+    if (AVI->mode == AVI_MODE_READ) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+
+    if (bytes <= 0)
+        return 0;
+    return plat_fallocate(AVI->fdes, AVI->pos, bytes);
+}
+
 int AVI_set_audio_track(avi_t *AVI, int track)
 {
 
@@ -1803,6 +2014,21 @@ int AVI_close(avi_t *AVI)
    if (AVI->comment_fd>0)
        plat_close(AVI->comment_fd);
    AVI->comment_fd = -1;
+   if (AVI->map)
+       plat_munmap((void *)AVI->map, AVI->map_size);
+   if (AVI->read_buf)
+       plat_free(AVI->read_buf);
+   if (AVI->write_buf)
+       plat_free(AVI->write_buf);
+   if (AVI->index_map) {
+       /* the index arrays point into the mapping, nothing to free */
+       plat_munmap(AVI->index_map, AVI->index_map_size);
+       AVI->video_index = NULL;
+       for (j = 0; j < AVI->anum; j++)
+           AVI->track[j].audio_index = NULL;
+   }
+   if (AVI->index_cache)
+       plat_free(AVI->index_cache);
    plat_close(AVI->fdes);
    if(AVI->idx) plat_free(AVI->idx);
    if(AVI->video_index) plat_free(AVI->video_index);
@@ -1859,7 +2085,10 @@ int AVI_close(avi_t *AVI)
    return 0; \
 } while (0)
 
-avi_t *AVI_open_indexfd(int fd, int getIndex, const char *indexfile)
+/* `filename' is the name of the file open on `fd', or NULL if unknown;
+   if `cache' is set, the index is kept in a cache file next to it */
+static avi_t *avi_open_input(int fd, int getIndex, const char *indexfile,
+                             const char *filename, int cache)
 {
    avi_t *AVI = plat_zalloc(sizeof(avi_t));
    if (AVI == NULL) {
@@ -1874,6 +2103,11 @@ avi_t *AVI_open_indexfd(int fd, int getIndex, const char *indexfile)
 
    if (indexfile) {
        AVI->index_file = strdup(indexfile);
+   } else if (filename && getIndex && cache) {
+       AVI->index_cache = plat_malloc(strlen(filename)
+                                      + sizeof(INDEX_CACHE_SUFFIX));
+       if (AVI->index_cache)
+           sprintf(AVI->index_cache, "%s%s", filename, INDEX_CACHE_SUFFIX);
    }
    AVI_errno = 0;
    avi_parse_input_file(AVI, getIndex);
@@ -1885,6 +2119,11 @@ avi_t *AVI_open_indexfd(int fd, int getIndex, const char *indexfile)
    return (AVI_errno) ?NULL :AVI;
 }
 
+avi_t *AVI_open_indexfd(int fd, int getIndex, const char *indexfile)
+{
+   return avi_open_input(fd, getIndex, indexfile, NULL, 0);
+}
+
 avi_t *AVI_open_input_indexfile(const char *filename, int getIndex,
 				const char *indexfile)
 {
@@ -1893,7 +2132,7 @@ avi_t *AVI_open_input_indexfile(const char *filename, int getIndex,
       AVI_errno = AVI_ERR_OPEN;
       return NULL;
    }
-   return AVI_open_indexfd(fd, getIndex, indexfile);
+   return avi_open_input(fd, getIndex, indexfile, filename, 0);
 }
 
 avi_t *AVI_open_input_file(const char *filename, int getIndex)
@@ -1901,6 +2140,16 @@ avi_t *AVI_open_input_file(const char *filename, int getIndex)
     return AVI_open_input_indexfile(filename, getIndex, NULL);
 }
 
+avi_t *AVI_open_input_file_cached(const char *filename, int getIndex)
+{
+   int fd = plat_open(filename, O_RDONLY, 0);
+   if (fd < 0) {
+      AVI_errno = AVI_ERR_OPEN;
+      return NULL;
+   }
+   return avi_open_input(fd, getIndex, NULL, filename, 1);
+}
+
 avi_t *AVI_open_fd(int fd, int getIndex)
 {
    return AVI_open_indexfd(fd, getIndex, NULL);
@@ -2026,6 +2275,145 @@ int avi_parse_index_from_file(avi_t *AVI, const char *filename)
     return 0;
 }
 
+/*
+ * Index cache: once the index of an AVI file has been built, it is saved
+ * in native layout next to the file, so that the next open can simply map
+ * it instead of reading idx1 (or scanning the whole file when there is no
+ * usable index).  The cache is only trusted if the size and modification
+ * time of the AVI file still match.
+ */
+
+/* Map the cache file of AVI if it is valid; sets AVI->index_map if so */
+static void avi_map_index_cache(avi_t *AVI)
+{
+    index_cache_header hdr;
+    struct stat st;
+    int64_t size;
+    int fd, j;
+
+    if (plat_fstat(AVI->fdes, &st) != 0 || !S_ISREG(st.st_mode))
+        return;
+    fd = plat_open(AVI->index_cache, O_RDONLY, 0);
+    if (fd < 0)
+        return;
+
+    if (plat_read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+     || memcmp(hdr.magic, INDEX_CACHE_MAGIC, sizeof(hdr.magic)) != 0
+     || hdr.version != INDEX_CACHE_VERSION
+     || hdr.byteorder != 0x01020304
+     || hdr.entry_sizes != (sizeof(video_index_entry)
+                            | sizeof(audio_index_entry) << 16)
+     || hdr.file_size != st.st_size
+     || hdr.file_mtime != st.st_mtime
+     || hdr.file_mtime_nsec != ST_MTIME_NSEC(st)
+     || hdr.anum < 0 || hdr.anum > AVI_MAX_TRACKS
+     || hdr.video_frames <= 0 || hdr.video_frames > hdr.file_size
+    ) {
+        goto out;
+    }
+    size = sizeof(hdr) + hdr.video_frames * sizeof(video_index_entry);
+    for (j = 0; j < hdr.anum; j++) {
+        if (hdr.audio_chunks[j] < 0 || hdr.audio_chunks[j] > hdr.file_size)
+            goto out;
+        size += (hdr.audio_chunks[j] + 1) * sizeof(audio_index_entry);
+    }
+    if (plat_seek(fd, 0, SEEK_END) != size)
+        goto out;
+
+    AVI->index_map = plat_mmap(fd, size);
+    if (AVI->index_map)
+        AVI->index_map_size = size;
+
+  out:
+    plat_close(fd);
+}
+
+/* Take the index from the mapped cache; returns -1 if it doesn't fit */
+static int avi_use_index_cache(avi_t *AVI)
+{
+    const index_cache_header *hdr = AVI->index_map;
+    uint8_t *p = (uint8_t *)AVI->index_map + sizeof(*hdr);
+    int j;
+
+    if (hdr->anum != AVI->anum)
+        return -1;
+
+    AVI->video_frames = hdr->video_frames;
+    AVI->video_index = (video_index_entry *)p;
+    p += hdr->video_frames * sizeof(video_index_entry);
+    for (j = 0; j < AVI->anum; j++) {
+        AVI->track[j].audio_chunks = hdr->audio_chunks[j];
+        AVI->track[j].audio_bytes = hdr->audio_bytes[j];
+        AVI->track[j].audio_index =
+            hdr->audio_chunks[j] ? (audio_index_entry *)p : NULL;
+        p += (hdr->audio_chunks[j] + 1) * sizeof(audio_index_entry);
+    }
+    return 0;
+}
+
+/* Write the index of AVI to its cache file; failures are ignored */
+static void avi_save_index_cache(avi_t *AVI)
+{
+    index_cache_header hdr;
+    audio_index_entry last;
+    struct stat st;
+    char *tmpname;
+    int fd, j, ok;
+
+    if (AVI->video_frames <= 0
+     || plat_fstat(AVI->fdes, &st) != 0 || !S_ISREG(st.st_mode)
+    ) {
+        return;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, INDEX_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = INDEX_CACHE_VERSION;
+    hdr.byteorder = 0x01020304;
+    hdr.entry_sizes = sizeof(video_index_entry)
+                    | sizeof(audio_index_entry) << 16;
+    hdr.anum = AVI->anum;
+    hdr.file_size = st.st_size;
+    hdr.file_mtime = st.st_mtime;
+    hdr.file_mtime_nsec = ST_MTIME_NSEC(st);
+    hdr.video_frames = AVI->video_frames;
+    for (j = 0; j < AVI->anum; j++) {
+        hdr.audio_chunks[j] = AVI->track[j].audio_chunks;
+        hdr.audio_bytes[j] = AVI->track[j].audio_bytes;
+    }
+    memset(&last, 0, sizeof(last));
+
+    /* write to a new temporary file and rename it, so that readers never
+       see a partly written cache; the name must be unique, since the same
+       AVI can be opened several times at once, even in one process */
+    tmpname = plat_malloc(strlen(AVI->index_cache) + 8);
+    if (!tmpname)
+        return;
+    sprintf(tmpname, "%s.XXXXXX", AVI->index_cache);
+    fd = plat_mkstemp(tmpname, st.st_mode & 0666);
+    if (fd < 0) {
+        plat_free(tmpname);
+        return;
+    }
+
+    ok = plat_write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)
+      && plat_write(fd, AVI->video_index,
+                    AVI->video_frames * sizeof(video_index_entry))
+         == AVI->video_frames * sizeof(video_index_entry);
+    for (j = 0; ok && j < AVI->anum; j++) {
+        long bytes = AVI->track[j].audio_chunks * sizeof(audio_index_entry);
+        if (bytes > 0)
+            ok = plat_write(fd, AVI->track[j].audio_index, bytes) == bytes;
+        if (ok)
+            ok = plat_write(fd, &last, sizeof(last)) == sizeof(last);
+    }
+    if (plat_close(fd) != 0)
+        ok = 0;
+    if (!ok || plat_rename(tmpname, AVI->index_cache) != 0)
+        plat_unlink(tmpname);
+    plat_free(tmpname);
+}
+
 static int avi_parse_input_file(avi_t *AVI, int getIndex)
 {
   long i, rate, scale, idx_type;
@@ -2041,6 +2429,11 @@ static int avi_parse_input_file(avi_t *AVI, int getIndex)
   //  int auds_strf_seen = 0;
   char data[256];
   off_t oldpos=-1, newpos=-1, n;
+  off_t idx1_pos=0, idx1_len=0;
+
+  /* With a valid index cache, idx1 need not be read */
+
+  if(getIndex && AVI->index_cache) avi_map_index_cache(AVI);
 
   /* Read first 12 bytes and check that this is an AVI file */
 
@@ -2090,6 +2483,13 @@ static int avi_parse_input_file(avi_t *AVI, int getIndex)
          else
             if (plat_seek(AVI->fdes,n,SEEK_CUR)==(off_t)-1) break;
       }
+      else if(strncasecmp(data,"idx1",4) == 0 && AVI->index_map)
+      {
+         /* Read later, only if the cached index can't be used */
+         idx1_pos = plat_seek(AVI->fdes,0,SEEK_CUR);
+         idx1_len = n;
+         plat_seek(AVI->fdes,n,SEEK_CUR);
+      }
       else if(strncasecmp(data,"idx1",4) == 0)
       {
          /* n must be a multiple of 16, but the reading does not
@@ -2429,6 +2829,31 @@ static int avi_parse_input_file(avi_t *AVI, int getIndex)
    }
    if(!getIndex) return(0);
 
+   if(AVI->index_map)
+   {
+      if(avi_use_index_cache(AVI) == 0)
+      {
+         /* Reposition the file, as below */
+         plat_seek(AVI->fdes,AVI->movi_start,SEEK_SET);
+         AVI->video_pos = 0;
+         return 0;
+      }
+      plat_munmap(AVI->index_map, AVI->index_map_size);
+      AVI->index_map = NULL;
+      AVI->index_map_size = 0;
+
+      if(idx1_len > 0)
+      {
+         AVI->n_idx = AVI->max_idx = idx1_len/16;
+         AVI->idx = (unsigned  char((*)[16]) ) plat_malloc(idx1_len);
+         if(AVI->idx==0) ERR_EXIT(AVI_ERR_NO_MEM);
+         if(plat_pread(AVI->fdes, (char *) AVI->idx, idx1_len, idx1_pos) != idx1_len) {
+            plat_free(AVI->idx); AVI->idx=NULL;
+            AVI->n_idx = 0;
+         }
+      }
+   }
+
    /* if the file has an idx1, check if this is relative
       to the start of the file or to the start of the movi list */
 
@@ -2847,6 +3272,8 @@ multiple_riff:
 
    } // is no opendml
 
+   if(AVI->index_cache) avi_save_index_cache(AVI);
+
    /* Reposition the file */
 
    plat_seek(AVI->fdes,AVI->movi_start,SEEK_SET);
@@ -2980,6 +3407,7 @@ int AVI_seek_start(avi_t *AVI)
 
    plat_seek(AVI->fdes,AVI->movi_start,SEEK_SET);
    AVI->video_pos = 0;
+   AVI->ra_video_next = 0;
    return 0;
 }
 
@@ -2990,6 +3418,7 @@ int AVI_set_video_position(avi_t *AVI, long frame)
 
    if (frame < 0 ) frame = 0;
    AVI->video_pos = frame;
+   AVI->ra_video_next = 0;
    return 0;
 }
 
@@ -3002,6 +3431,148 @@ int AVI_set_audio_bitrate(avi_t *AVI, long bitrate)
 }
 
 
+/*
+ * Read `len' bytes at file offset `pos' into `buf' in the way selected by
+ * AVI_set_read_mode(); returns the number of bytes read.
+ */
+static long avi_read_data(avi_t *AVI, char *buf, long len, off_t pos)
+{
+    switch (AVI->read_mode) {
+      case AVI_READ_MMAP:
+        if (pos >= 0 && pos + len <= AVI->map_size) {
+            memcpy(buf, AVI->map + pos, len);
+            return len;
+        }
+        /* beyond the mapping (the file has grown): fall through */
+      case AVI_READ_PREAD:
+        return plat_pread(AVI->fdes, buf, len, pos);
+      default:
+        plat_seek(AVI->fdes, pos, SEEK_SET);
+        return plat_read(AVI->fdes, buf, len);
+    }
+}
+
+int AVI_set_read_mode(avi_t *AVI, int mode)
+{
+    if (AVI->mode == AVI_MODE_WRITE) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+    if (mode != AVI_READ_SEEK && mode != AVI_READ_PREAD
+     && mode != AVI_READ_MMAP) {
+        return -1;
+    }
+
+    if (mode == AVI_READ_MMAP && !AVI->map) {
+        off_t cur = plat_seek(AVI->fdes, 0, SEEK_CUR);
+        off_t size = plat_seek(AVI->fdes, 0, SEEK_END);
+
+        plat_seek(AVI->fdes, cur, SEEK_SET);
+        AVI->map = plat_mmap(AVI->fdes, size);
+        if (AVI->map) {
+            AVI->map_size = size;
+        } else {
+            plat_log_send(PLAT_LOG_INFO, __FILE__,
+                          "can't map file, using pread()");
+            mode = AVI_READ_PREAD;
+        }
+    } else if (mode != AVI_READ_MMAP && AVI->map) {
+        plat_munmap((void *)AVI->map, AVI->map_size);
+        AVI->map = NULL;
+        AVI->map_size = 0;
+    }
+    AVI->read_mode = mode;
+    return mode;
+}
+
+int AVI_get_read_mode(avi_t *AVI)
+{
+    return AVI->read_mode;
+}
+
+/*
+ * Prefetch the data chunks of one stream following chunk `cur' (the next
+ * one to be read), up to AVI->readahead bytes ahead of it in the file.
+ * `pos0' and `len0' point to the fields of the first index entry, which
+ * are `entry_size' bytes apart; `*next' is the first chunk not prefetched
+ * yet.  Nothing is done while at least half the distance is still
+ * covered.  Chunks less than READAHEAD_GAP apart (typically separated by
+ * chunks of the other streams) are prefetched as a single range.
+ */
+static void avi_readahead(avi_t *AVI, const off_t *pos0, const off_t *len0,
+                          size_t entry_size, long nchunks, long cur,
+                          long *next)
+{
+#define POS(i) (*(const off_t *)((const char *)pos0 + (i)*entry_size))
+#define LEN(i) (*(const off_t *)((const char *)len0 + (i)*entry_size))
+    off_t start = -1, end = -1, limit;
+    long i = cur;
+
+    if (!AVI->readahead || cur < 0 || cur >= nchunks)
+        return;
+    if (*next > cur && *next <= nchunks) {
+        if (POS(*next-1) + LEN(*next-1) - POS(cur) >= AVI->readahead / 2)
+            return;
+        i = *next;
+    }
+
+    limit = POS(cur) + AVI->readahead;
+    for (; i < nchunks && POS(i) < limit; i++) {
+        if (start >= 0 && POS(i) >= start && POS(i) <= end + READAHEAD_GAP) {
+            if (POS(i) + LEN(i) > end)
+                end = POS(i) + LEN(i);
+            continue;
+        }
+        if (start >= 0)
+            plat_prefetch(AVI->fdes, start, end - start);
+        start = POS(i);
+        end = POS(i) + LEN(i);
+    }
+    if (start >= 0)
+        plat_prefetch(AVI->fdes, start, end - start);
+    *next = i;
+#undef POS
+#undef LEN
+}
+
+static void avi_readahead_video(avi_t *AVI)
+{
+    if (AVI->video_index) {
+        avi_readahead(AVI, &AVI->video_index[0].pos,
+                      &AVI->video_index[0].len, sizeof(video_index_entry),
+                      AVI->video_frames, AVI->video_pos,
+                      &AVI->ra_video_next);
+    }
+}
+
+static void avi_readahead_audio(avi_t *AVI)
+{
+    track_t *track = &AVI->track[AVI->aptr];
+
+    if (track->audio_index) {
+        avi_readahead(AVI, &track->audio_index[0].pos,
+                      &track->audio_index[0].len, sizeof(audio_index_entry),
+                      track->audio_chunks, track->audio_posc,
+                      &track->ra_next);
+    }
+}
+
+/*
+ * Start prefetching the data to be read next in the background, `bytes'
+ * ahead of the current read position of each stream (0 to turn it off).
+ * This uses the index, so it follows the streams wherever their chunks
+ * are in the file.
+ */
+int AVI_set_readahead(avi_t *AVI, long bytes)
+{
+    int j;
+
+    if (AVI->mode == AVI_MODE_WRITE) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+
+    AVI->readahead = (bytes > 0) ? bytes : 0;
+    AVI->ra_video_next = 0;
+    for (j = 0; j < AVI_MAX_TRACKS; j++)
+        AVI->track[j].ra_next = 0;
+    return 0;
+}
+
 long AVI_read_video(avi_t *AVI, char *vidbuf, long bytes, int *keyframe)
 {
    long n;
@@ -3024,9 +3595,8 @@ long AVI_read_video(avi_t *AVI, char *vidbuf, long bytes, int *keyframe)
      return n;
    }
 
-   plat_seek(AVI->fdes, AVI->video_index[AVI->video_pos].pos, SEEK_SET);
-
-   if (plat_read(AVI->fdes,vidbuf,n) != n)
+   avi_readahead_video(AVI);
+   if (avi_read_data(AVI, vidbuf, n, AVI->video_index[AVI->video_pos].pos) != n)
    {
       AVI_errno = AVI_ERR_READ;
       return -1;
@@ -3037,6 +3607,52 @@ long AVI_read_video(avi_t *AVI, char *vidbuf, long bytes, int *keyframe)
    return n;
 }
 
+/*
+ * Like AVI_read_frame(), but returns a pointer to the frame data in
+ * *vidptr instead of copying it to a buffer.  With AVI_READ_MMAP the
+ * pointer is into the file mapping; otherwise the frame is read into an
+ * internal buffer.  Either way the data stays valid only until the next
+ * read call or AVI_close().
+ */
+long AVI_read_video_ptr(avi_t *AVI, const char **vidptr, int *keyframe)
+{
+   long n;
+   off_t pos;
+
+   if(AVI->mode==AVI_MODE_WRITE) { AVI_errno = AVI_ERR_NOT_PERM; return -1; }
+   if(!AVI->video_index)         { AVI_errno = AVI_ERR_NO_IDX;   return -1; }
+
+   if(AVI->video_pos < 0 || AVI->video_pos >= AVI->video_frames) return -1;
+   n = AVI->video_index[AVI->video_pos].len;
+   pos = AVI->video_index[AVI->video_pos].pos;
+
+   *keyframe = (AVI->video_index[AVI->video_pos].key==0x10) ? 1:0;
+
+   avi_readahead_video(AVI);
+   if (AVI->map && pos >= 0 && pos + n <= AVI->map_size) {
+      *vidptr = (const char *)AVI->map + pos;
+   } else {
+      if (AVI->read_buf_size < n) {
+         char *buf = plat_realloc(AVI->read_buf, n);
+         if (!buf) {
+            AVI_errno = AVI_ERR_NO_MEM;
+            return -1;
+         }
+         AVI->read_buf = buf;
+         AVI->read_buf_size = n;
+      }
+      if (avi_read_data(AVI, AVI->read_buf, n, pos) != n) {
+         AVI_errno = AVI_ERR_READ;
+         return -1;
+      }
+      *vidptr = AVI->read_buf;
+   }
+
+   AVI->video_pos++;
+
+   return n;
+}
+
 long AVI_read_frame(avi_t *AVI, char *vidbuf, int *keyframe)
 {
    return AVI_read_video(AVI, vidbuf, -1, keyframe);
@@ -3059,6 +3675,7 @@ int AVI_set_audio_position_index(avi_t *AVI, long indexpos)
 
    AVI->track[AVI->aptr].audio_posc = indexpos;
    AVI->track[AVI->aptr].audio_posb = 0;
+   AVI->track[AVI->aptr].ra_next = 0;
 
    return 0;
 }
@@ -3089,6 +3706,7 @@ int AVI_set_audio_position(avi_t *AVI, long byte)
 
    AVI->track[AVI->aptr].audio_posc = n0;
    AVI->track[AVI->aptr].audio_posb = byte - AVI->track[AVI->aptr].audio_index[n0].tot;
+   AVI->track[AVI->aptr].ra_next = 0;
 
    return 0;
 }
@@ -3108,6 +3726,8 @@ long AVI_read_audio(avi_t *AVI, char *audbuf, long bytes)
      AVI->track[AVI->aptr].audio_posb = 0;
       plat_seek(AVI->fdes, 0LL, SEEK_CUR);
    }
+   if (bytes > 0)
+      avi_readahead_audio(AVI);
    while(bytes>0)
    {
        off_t ret;
@@ -3124,8 +3744,7 @@ long AVI_read_audio(avi_t *AVI, char *audbuf, long bytes)
       else
          todo = left;
       pos = AVI->track[AVI->aptr].audio_index[AVI->track[AVI->aptr].audio_posc].pos + AVI->track[AVI->aptr].audio_posb;
-      plat_seek(AVI->fdes, pos, SEEK_SET);
-      if ( (ret = plat_read(AVI->fdes,audbuf+nr,todo)) != todo)
+      if ( (ret = avi_read_data(AVI, audbuf+nr, todo, pos)) != todo)
       {
 	    plat_log_send(PLAT_LOG_DEBUG, __FILE__, "XXX pos = %lld, ret = %lld, todo = %ld",
                      (long long)pos, (long long)ret, todo);
@@ -3160,9 +3779,9 @@ long AVI_read_audio_chunk(avi_t *AVI, char *audbuf)
        return 0;
    }
 
+   avi_readahead_audio(AVI);
    pos = AVI->track[AVI->aptr].audio_index[AVI->track[AVI->aptr].audio_posc].pos + AVI->track[AVI->aptr].audio_posb;
-   plat_seek(AVI->fdes, pos, SEEK_SET);
-   if (plat_read(AVI->fdes,audbuf,left) != left)
+   if (avi_read_data(AVI, audbuf, left, pos) != left)
    {
       AVI_errno = AVI_ERR_READ;
       return -1;
@@ -147,6 +147,8 @@ typedef struct track_s
     audio_index_entry *audio_index;
     avisuperindex_chunk *audio_superindex;
 
+    long   ra_next;           /* First chunk not yet prefetched */
+
 } track_t;
 
 typedef struct
@@ -200,6 +202,25 @@ typedef struct __attribute__((__packed__))
   char     sz_name[64];
 } alAVISTREAMINFO;
 
+/* Writer state from before the chunks in the write buffer, to take
+   them back if writing them out fails */
+
+typedef struct
+{
+  int      valid;           /* Set while the fields below are in use */
+  off_t    pos;
+  long     n_idx;
+  long     video_frames;
+  int      total_frames;
+  uint32_t max_len;
+  off_t    last_pos;
+  uint32_t last_len;
+  uint32_t video_entries;   /* nEntriesInUse of the current ix00 */
+  off_t    audio_bytes[AVI_MAX_TRACKS];
+  long     audio_chunks[AVI_MAX_TRACKS];
+  uint32_t audio_entries[AVI_MAX_TRACKS];
+} avi_write_mark_t;
+
 typedef struct
 {
 
@@ -250,11 +271,36 @@ typedef struct
 
   void*     extradata;
   unsigned long extradata_size;
+
+  int    read_mode;         /* How data chunks are read (AVI_READ_*) */
+  const uint8_t *map;       /* Mapping of the file (AVI_READ_MMAP) */
+  off_t  map_size;          /* Size of the mapping */
+  char  *read_buf;          /* Buffer for AVI_read_video_ptr() */
+  long   read_buf_size;     /* Size of read_buf */
+
+  long   readahead;         /* Bytes to prefetch ahead of reads, 0 = off */
+  long   ra_video_next;     /* First video chunk not yet prefetched */
+
+  char  *write_buf;         /* Chunks not yet written, see
+                               AVI_set_write_buffer() */
+  long   write_buf_size;    /* Size of write_buf, 0 = unbuffered */
+  long   write_buf_len;     /* Bytes waiting in write_buf */
+  avi_write_mark_t write_mark; /* State before them */
+
+  char  *index_cache;       /* Index cache file name, NULL if not used */
+  void  *index_map;         /* Mapping of the index cache, if in use */
+  off_t  index_map_size;    /* Size of that mapping */
 } avi_t;
 
 #define AVI_MODE_WRITE  0
 #define AVI_MODE_READ   1
 
+/* Ways of reading data chunks from an input file, see AVI_set_read_mode() */
+
+#define AVI_READ_SEEK   0   /* Seek to each chunk, then read it (default) */
+#define AVI_READ_PREAD  1   /* Read each chunk with pread(), no seeking */
+#define AVI_READ_MMAP   2   /* Map the file, copy chunks from the mapping */
+
 /* The error codes delivered by avi_open_input_file */
 
 #define AVI_ERR_SIZELIM      1     /* The write of the data would exceed
@@ -331,12 +377,19 @@ int  AVI_write_audio(avi_t *AVI, const char *data, long bytes);
 long AVI_bytes_remain(avi_t *AVI);
 int  AVI_close(avi_t *AVI);
 long AVI_bytes_written(avi_t *AVI);
+int  AVI_set_write_buffer(avi_t *AVI, long bytes);
+int  AVI_reserve_index(avi_t *AVI, long chunks);
+int  AVI_reserve_space(avi_t *AVI, int64_t bytes);
 
 avi_t *AVI_open_input_file(const char *filename, int getIndex);
 avi_t *AVI_open_input_indexfile(const char *filename, int getIndex,
                 const char *indexfile);
 avi_t *AVI_open_fd(int fd, int getIndex);
 avi_t *AVI_open_indexfd(int fd, int getIndex, const char *indexfile);
+/* Like AVI_open_input_file, but the index is saved to a cache file
+   next to the AVI on close, and reused by the next cached open of the
+   same, unchanged, file */
+avi_t *AVI_open_input_file_cached(const char *filename, int getIndex);
 
 long AVI_audio_mp3rate(avi_t *AVI);
 long AVI_audio_padrate(avi_t *AVI);
@@ -363,6 +416,11 @@ int  AVI_set_video_position(avi_t *AVI, long frame);
 long AVI_get_video_position(avi_t *AVI, long frame);
 long AVI_read_frame(avi_t *AVI, char *vidbuf, int *keyframe);
 long AVI_read_video(avi_t *AVI, char *vidbuf, long bytes, int *keyframe);
+long AVI_read_video_ptr(avi_t *AVI, const char **vidptr, int *keyframe);
+
+int  AVI_set_read_mode(avi_t *AVI, int mode);
+int  AVI_get_read_mode(avi_t *AVI);
+int  AVI_set_readahead(avi_t *AVI, long bytes);
 
 int  AVI_set_audio_position(avi_t *AVI, long byte);
 int  AVI_set_audio_bitrate(avi_t *AVI, long bitrate);
@@ -25,12 +25,9 @@
 
 #include "config.h"
 
-#ifdef OS_DARWIN
-#include <sys/uio.h>
-#endif
-
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -48,6 +45,45 @@ ssize_t plat_read(int fd, void *buf, size_t count);
 ssize_t plat_write(int fd, const void *buf, size_t count);
 int64_t plat_seek(int fd, int64_t offset, int whence);
 int plat_ftruncate(int fd, int64_t length);
+int plat_fstat(int fd, struct stat *buf);
+int plat_rename(const char *oldpath, const char *newpath);
+int plat_unlink(const char *pathname);
+
+/*
+ * create and open a new file from `template' (ending in XXXXXX, which
+ * is replaced) as mkstemp(3) does, then give it permissions `mode'
+ */
+int plat_mkstemp(char *template, int mode);
+
+/*
+ * read `count' bytes at `offset' without using or moving the file offset
+ */
+ssize_t plat_pread(int fd, void *buf, size_t count, int64_t offset);
+
+/*
+ * map the first `length' bytes of a file read-only into memory; returns
+ * NULL if that isn't possible (e.g. not supported by the I/O layer)
+ */
+void *plat_mmap(int fd, int64_t length);
+int plat_munmap(void *addr, int64_t length);
+
+/*
+ * tell the system that `length' bytes at `offset' will be read soon, so
+ * it can start reading them in the background; only a hint
+ */
+int plat_prefetch(int fd, int64_t offset, int64_t length);
+
+/*
+ * write all the buffers in `iov', in order, with as few system calls as
+ * possible; returns the number of bytes written or -1 on error
+ */
+ssize_t plat_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/*
+ * reserve disk space for `length' bytes at `offset' without changing the
+ * file size; returns -1 if that isn't supported
+ */
+int plat_fallocate(int fd, int64_t offset, int64_t length);
 
 /*************************************************************************/
 /* libc-like memory handling                                             */
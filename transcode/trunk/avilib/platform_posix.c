@@ -19,12 +19,21 @@
  * 3. This notice may not be removed or altered from any source distribution.
  */
 
+/* for fallocate() */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
 #include "platform.h"
 
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 
 /*************************************************************************/
 /* I/O is straightforward.                                               */
@@ -48,7 +57,7 @@ ssize_t plat_read(int fd, void *buf, size_t count)
     ssize_t n = 0, r = 0;
 
     while (r < count) {
-        n = read(fd, buf + r, count - r);
+        n = read(fd, (uint8_t *)buf + r, count - r);
         if (n == 0)
 	        break;
         if (n < 0) {
@@ -71,7 +80,7 @@ ssize_t plat_write(int fd, const void *buf, size_t count)
     ssize_t n = 0, r = 0;
 
     while (r < count) {
-        n = write(fd, buf + r, count - r);
+        n = write(fd, (const uint8_t *)buf + r, count - r);
         if (n < 0)
             return n;
 
@@ -91,6 +100,128 @@ int plat_ftruncate(int fd, int64_t length)
     return ftruncate(fd, length);
 }
 
+int plat_fstat(int fd, struct stat *buf)
+{
+    return fstat(fd, buf);
+}
+
+int plat_rename(const char *oldpath, const char *newpath)
+{
+    return rename(oldpath, newpath);
+}
+
+int plat_unlink(const char *pathname)
+{
+    return unlink(pathname);
+}
+
+int plat_mkstemp(char *template, int mode)
+{
+    int fd = mkstemp(template);
+
+    if (fd >= 0 && fchmod(fd, mode) != 0) {
+        close(fd);
+        unlink(template);
+        return -1;
+    }
+    return fd;
+}
+
+/* 
+ * automatically restart after a recoverable interruption
+ */
+ssize_t plat_pread(int fd, void *buf, size_t count, int64_t offset)
+{
+    ssize_t n = 0, r = 0;
+
+    while (r < count) {
+        n = pread(fd, (uint8_t *)buf + r, count - r, offset + r);
+        if (n == 0)
+            break;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            else
+                break;
+        }
+
+        r += n;
+    }
+    return r;
+}
+
+void *plat_mmap(int fd, int64_t length)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    void *addr;
+
+    if (length <= 0 || (uint64_t)length > (size_t)-1)
+        return NULL;
+    addr = mmap(NULL, (size_t)length, PROT_READ, MAP_SHARED, fd, 0);
+    return (addr == MAP_FAILED) ? NULL : addr;
+#else
+    return NULL;
+#endif
+}
+
+int plat_munmap(void *addr, int64_t length)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    return munmap(addr, (size_t)length);
+#else
+    return -1;
+#endif
+}
+
+int plat_prefetch(int fd, int64_t offset, int64_t length)
+{
+#ifdef HAVE_POSIX_FADVISE
+    return posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#else
+    return 0;
+#endif
+}
+
+ssize_t plat_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    ssize_t n = 0, r = 0;
+
+    while (iovcnt > 0) {
+        n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return n;
+        }
+        r += n;
+        while (iovcnt > 0 && n >= (ssize_t)iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0 && n > 0) {
+            /* finish the partly written buffer by hand */
+            n = plat_write(fd, (const uint8_t *)iov->iov_base + n,
+                           iov->iov_len - n);
+            if (n < 0)
+                return n;
+            r += n;
+            iov++;
+            iovcnt--;
+        }
+    }
+    return r;
+}
+
+int plat_fallocate(int fd, int64_t offset, int64_t length)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    return fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length);
+#else
+    return -1;
+#endif
+}
+
 
 
 /*************************************************************************/
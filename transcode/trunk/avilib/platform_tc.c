@@ -18,6 +18,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* for fallocate() */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
 
 #include "platform.h"
 #include "libtc/libtc.h"
@@ -29,6 +33,10 @@
 #include <stdarg.h>
 #include <errno.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 
 int plat_open(const char *pathname, int flags, int mode)
 {
@@ -60,6 +68,152 @@ int plat_ftruncate(int fd, int64_t length)
     return xio_ftruncate(fd, length);
 }
 
+int plat_fstat(int fd, struct stat *buf)
+{
+    return xio_fstat(fd, buf);
+}
+
+int plat_rename(const char *oldpath, const char *newpath)
+{
+    return xio_rename(oldpath, newpath);
+}
+
+int plat_unlink(const char *pathname)
+{
+    return unlink(pathname);
+}
+
+int plat_mkstemp(char *template, int mode)
+{
+#ifdef HAVE_IBP
+    return -1;  /* not an xio descriptor */
+#else
+    int fd = mkstemp(template);
+
+    if (fd >= 0 && fchmod(fd, mode) != 0) {
+        close(fd);
+        unlink(template);
+        return -1;
+    }
+    return fd;
+#endif
+}
+
+/*
+ * xio descriptors (with IBP support) aren't real file descriptors, so
+ * positioned reads and mappings must go through the xio layer there
+ */
+
+ssize_t plat_pread(int fd, void *buf, size_t count, int64_t offset)
+{
+#ifdef HAVE_IBP
+    if (xio_lseek(fd, offset, SEEK_SET) != offset)
+        return -1;
+    return tc_pread(fd, buf, count);
+#else
+    ssize_t n = 0, r = 0;
+
+    while (r < count) {
+        n = pread(fd, (uint8_t *)buf + r, count - r, offset + r);
+        if (n == 0)
+            break;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            else
+                break;
+        }
+        r += n;
+    }
+    return r;
+#endif
+}
+
+void *plat_mmap(int fd, int64_t length)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && !defined(HAVE_IBP)
+    void *addr;
+
+    if (length <= 0 || (uint64_t)length > (size_t)-1)
+        return NULL;
+    addr = mmap(NULL, (size_t)length, PROT_READ, MAP_SHARED, fd, 0);
+    return (addr == MAP_FAILED) ? NULL : addr;
+#else
+    return NULL;
+#endif
+}
+
+int plat_munmap(void *addr, int64_t length)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && !defined(HAVE_IBP)
+    return munmap(addr, (size_t)length);
+#else
+    return -1;
+#endif
+}
+
+int plat_prefetch(int fd, int64_t offset, int64_t length)
+{
+#if defined(HAVE_POSIX_FADVISE) && !defined(HAVE_IBP)
+    return posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#else
+    return 0;
+#endif
+}
+
+ssize_t plat_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+#ifdef HAVE_IBP
+    ssize_t n = 0, r = 0;
+
+    for (; iovcnt > 0; iov++, iovcnt--) {
+        n = plat_write(fd, iov->iov_base, iov->iov_len);
+        if (n < 0)
+            return n;
+        r += n;
+    }
+    return r;
+#else
+    ssize_t n = 0, r = 0;
+
+    while (iovcnt > 0) {
+        n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return n;
+        }
+        r += n;
+        while (iovcnt > 0 && n >= (ssize_t)iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0 && n > 0) {
+            /* finish the partly written buffer by hand */
+            n = plat_write(fd, (const uint8_t *)iov->iov_base + n,
+                           iov->iov_len - n);
+            if (n < 0)
+                return n;
+            r += n;
+            iov++;
+            iovcnt--;
+        }
+    }
+    return r;
+#endif
+}
+
+int plat_fallocate(int fd, int64_t offset, int64_t length)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE) \
+ && !defined(HAVE_IBP)
+    return fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length);
+#else
+    return -1;
+#endif
+}
+
 
 
 void *_plat_malloc(const char *file, int line, size_t size)
@@ -77,6 +77,9 @@ static int copy_inspect(TCModuleInstance *self,
     if (optstr_lookup(param, "help")) {
         *value = copy_help;
     }
+    if (optstr_lookup(param, "intra")) {
+        *value = "1"; /* only keyframes */
+    }
 
     return TC_OK;
 }
@@ -182,6 +182,9 @@ static int tc_dv_inspect(TCModuleInstance *self,
     if (optstr_lookup(param, "help")) {
         *value = tc_dv_help;
     }
+    if (optstr_lookup(param, "intra")) {
+        *value = "1"; /* only keyframes */
+    }
 
     return TC_OK;
 }
@@ -1567,6 +1567,34 @@ failure:
     return TC_ERROR;
 }
 
+/*
+ * tc_lavc_is_intra:
+ *      tell if the video stream, as configured, is made only by
+ *      independently coded frames. Multipass and PSNR logging need
+ *      a single instance seeing all the frames, so they don't qualify.
+ */
+static int tc_lavc_is_intra(TCLavcPrivateData *pd)
+{
+    int intra = TC_FALSE;
+
+    if (pd->stats_file != NULL || pd->psnr_file != NULL) {
+        return TC_FALSE;
+    }
+
+    switch (FF_VCODEC_ID(pd)) {
+      case CODEC_ID_DVVIDEO:
+      case CODEC_ID_MJPEG:
+      case CODEC_ID_LJPEG:
+        intra = TC_TRUE;
+        break;
+      default:
+        intra = (pd->ff_vcontext.gop_size == 1
+              && pd->ff_vcontext.max_b_frames == 0);
+        break;
+    }
+    return intra;
+}
+
 static int tc_lavc_inspect(TCModuleInstance *self,
                            const char *param, const char **value)
 {
@@ -1580,6 +1608,10 @@ static int tc_lavc_inspect(TCModuleInstance *self,
     if (optstr_lookup(param, "list")) {
         *value = tc_lavc_list_codecs();
     }
+
+    if (optstr_lookup(param, "intra")) {
+        *value = (tc_lavc_is_intra(self->userdata)) ?"1" :"0";
+    }
     return TC_OK;
 }
 
@@ -134,6 +134,9 @@ static int tc_lzo_inspect(TCModuleInstance *self,
     if (optstr_lookup(param, "help")) {
         *value = tc_lzo_help;
     }
+    if (optstr_lookup(param, "intra")) {
+        *value = "1"; /* only keyframes */
+    }
 
     return TC_OK;
 }
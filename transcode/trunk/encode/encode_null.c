@@ -79,6 +79,9 @@ static int null_inspect(TCModuleInstance *self,
     if (optstr_lookup(param, "help")) {
         *value = null_help;
     }
+    if (optstr_lookup(param, "intra")) {
+        *value = "1"; /* only keyframes */
+    }
 
     return TC_OK;
 }
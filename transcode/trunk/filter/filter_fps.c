@@ -31,6 +31,9 @@
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
 
+/* we only set frame attributes */
+const int tc_filter_readonly = 1;
+
 
 static int
 parse_options(char *options, int *pre, double *infps, double *outfps)
@@ -27,7 +27,7 @@
 #define MOD_AUTHOR  "Tilmann Bitterberg"
 
 #define MOD_FEATURES \
-    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO
+    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO|TC_MODULE_FEATURE_SLICE
 #define MOD_FLAGS \
     TC_MODULE_FLAG_RECONFIGURABLE
 
@@ -261,11 +261,86 @@ static int invert_process(TCModuleInstance *self,
     return TC_OK;
 }
 
+static void invert_rows(uint8_t *p, int size)
+{
+    int w;
+    for (w = 0; w < size; w++, p++)
+        *p = 255 - *p;
+}
+
+/*
+ * invert_process_slice: like invert_process, but touches only
+ * the given band of rows of the frame. May run concurrently on
+ * disjoint bands of the same frame.
+ */
+static int invert_process_slice(TCModuleInstance *self,
+                                frame_list_t *frame,
+                                int first_row, int num_rows)
+{
+    InvertPrivateData *mfd = NULL;
+    vframe_list_t *vframe = (vframe_list_t*)frame;
+    int width = 0, height = 0, crow = 0, crows = 0;
+    uint8_t *planes[3] = { NULL, NULL, NULL };
+
+    TC_MODULE_SELF_CHECK(self, "process_slice");
+
+    if (!(frame->tag & TC_VIDEO && frame->tag & TC_POST_M_PROCESS)
+     || (frame->attributes & TC_FRAME_IS_SKIPPED)) {
+        return TC_OK;
+    }
+
+    mfd    = self->userdata;
+    width  = vframe->v_width;
+    height = vframe->v_height;
+
+    if (!(mfd->start <= frame->id && frame->id <= mfd->end
+     && frame->id%mfd->step == mfd->boolstep)) {
+        return TC_OK;
+    }
+
+    switch (vframe->v_codec) {
+      case TC_CODEC_RGB24:
+        invert_rows(vframe->video_buf + first_row * width * 3,
+                    num_rows * width * 3);
+        break;
+      case TC_CODEC_YUV420P:
+        YUV_INIT_PLANES(planes, vframe->video_buf, IMG_YUV420P, width, height);
+        invert_rows(planes[0] + first_row * width, num_rows * width);
+        /*
+         * chroma row c belongs to the band holding luma row 2c,
+         * so odd band boundaries neither skip nor share a row.
+         */
+        crow  = (first_row + 1) / 2;
+        crows = TC_MIN((first_row + num_rows + 1) / 2, height / 2) - crow;
+        if (crows > 0) {
+            invert_rows(planes[1] + crow * (width / 2), crows * (width / 2));
+            invert_rows(planes[2] + crow * (width / 2), crows * (width / 2));
+        }
+        break;
+      case TC_CODEC_YUV422P:
+        YUV_INIT_PLANES(planes, vframe->video_buf, IMG_YUV422P, width, height);
+        invert_rows(planes[0] + first_row * width, num_rows * width);
+        invert_rows(planes[1] + first_row * (width / 2),
+                    num_rows * (width / 2));
+        invert_rows(planes[2] + first_row * (width / 2),
+                    num_rows * (width / 2));
+        break;
+      default:
+        /* unknown layout: the whole frame is the only safe band */
+        if (first_row == 0) {
+            invert_filter_video(self, vframe);
+        }
+        break;
+    }
+    return TC_OK;
+}
+
 /*************************************************************************/
 
 /* Old-fashioned module interface. */
 
 TC_FILTER_OLDINTERFACE(invert)
+TC_FILTER_OLDINTERFACE_SLICE(invert)
 
 /*************************************************************************/
 
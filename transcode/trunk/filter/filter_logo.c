@@ -209,27 +209,32 @@ static uint8_t **flogo_yuvbuf_alloc(size_t size, int num) {
  * flogo_convert_image: Converts a single ImageMagick RGB image into a format
  *                      usable by transcode.
  *
- * Parameters:     tcvhandle:  Opaque libtcvideo handle
+ * Parameters:     convert:    Conversion function from RGB24 to the output
+ *                             format, from ac_imgconvert_get_func()
  *                 src:        An ImageMagick handle (the source image)
+ *                 rgb:        A scratch buffer for the 24-bit RGB image
  *                 dst:        A pointer to the output buffer
  *                 ifmt:       The output format (see aclib/imgconvert.h)
  *                 do_rgbswap: zero for no swap, nonzero to swap red and blue
  *                             pixel positions
  * Return value:   1 on success, 0 on failure
- * Preconditions:  tcvhandle != null, was returned by a call to tcv_init()
+ * Preconditions:  convert != null
  *                 src is a valid ImageMagick RGB image handle
+ *                 rgb buffer holds at least columns*rows*3 bytes
  *                 dst buffer is large enough to hold the result of the
  *                   requested conversion
  * Postconditions: dst get overwritten with the result of the conversion
  */
-static int flogo_convert_image(TCVHandle    tcvhandle,
-                               Image       *src,
-                               uint8_t     *dst,
-                               ImageFormat  ifmt,
-                               int          do_rgbswap)
+static int flogo_convert_image(ConversionFunc  convert,
+                               Image          *src,
+                               uint8_t        *rgb,
+                               uint8_t        *dst,
+                               ImageFormat     ifmt,
+                               int             do_rgbswap)
 {
     PixelPacket *pixel_packet;
-    uint8_t *dst_ptr = dst;
+    uint8_t *dst_ptr = rgb;
+    uint8_t *srcplanes[3], *dstplanes[3];
 
     int row, col;
     int height = src->rows;
@@ -260,7 +265,10 @@ static int flogo_convert_image(TCVHandle    tcvhandle,
         }
     }
 
-    ret = tcv_convert(tcvhandle, dst, dst, width, height, IMG_RGB24, ifmt);
+    /* The RGB data is in its own buffer, so convert straight into dst */
+    YUV_INIT_PLANES(srcplanes, rgb, IMG_RGB24, width, height);
+    YUV_INIT_PLANES(dstplanes, dst, ifmt, width, height);
+    ret = (*convert)(srcplanes, dstplanes, width, height);
     if (ret == 0) {
         tc_log_error(MOD_NAME, "RGB->YUV conversion failed");
         return 0;
@@ -445,7 +453,9 @@ int tc_filter(frame_list_t *ptr_, char *options)
             /* convert Magick RGB image format to YUV */
             /* todo: convert the magick image if it's not rgb! (e.g. cmyk) */
             Image   *image;
-            uint8_t *yuv_hqbuf = NULL;
+            uint8_t *yuv_hqbuf = NULL, *rgbbuf = NULL;
+            ImageFormat ifmt = mfd->hqconv ? IMG_YUV444P : IMG_YUV420P;
+            ConversionFunc convert;
 
             /* Round up for odd-size images */
             unsigned long width  = mfd->image->columns;
@@ -453,10 +463,15 @@ int tc_filter(frame_list_t *ptr_, char *options)
             int do_rgbswap  = (rgbswap || mfd->rgbswap);
             int i;
 
+            /* Resolve the RGB->YUV conversion once for all images */
+            convert = ac_imgconvert_get_func(IMG_RGB24, ifmt);
+            if (convert == NULL) {
+                tc_log_error(MOD_NAME, "no RGB->YUV conversion available");
+                return -1;
+            }
+
             /* Allocate buffers for the YUV420P frames. mfd->nr_of_images
              * will be 1 unless this is an animated GIF or MNG.
-             * This buffer needs to be large enough to store a temporary
-             * 24-bit RGB image (extracted from the ImageMagick handle).
              */
             mfd->yuv = flogo_yuvbuf_alloc(width*height * 3, mfd->nr_of_images);
             if (mfd->yuv == NULL) {
@@ -473,9 +488,20 @@ int tc_filter(frame_list_t *ptr_, char *options)
                 }
             }
 
+            /* Temporary 24-bit RGB image (extracted from the ImageMagick
+             * handle), shared by all images */
+            rgbbuf = tc_malloc(width*height * 3);
+            if (rgbbuf == NULL) {
+                tc_log_error(MOD_NAME, "(%d) out of memory\n", __LINE__);
+                tc_free(yuv_hqbuf);
+                return -1;
+            }
+
             mfd->tcvhandle = tcv_init();
             if (mfd->tcvhandle == NULL) {
                 tc_log_error(MOD_NAME, "image conversion init failed");
+                tc_free(yuv_hqbuf);
+                tc_free(rgbbuf);
                 return -1;
             }
 
@@ -483,11 +509,11 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
             for (i = 0; i < mfd->nr_of_images; i++) {
                 if (!mfd->hqconv) {
-                    flogo_convert_image(mfd->tcvhandle, image, mfd->yuv[i],
-                                        IMG_YUV420P, do_rgbswap);
+                    flogo_convert_image(convert, image, rgbbuf, mfd->yuv[i],
+                                        ifmt, do_rgbswap);
                 } else {
-                    flogo_convert_image(mfd->tcvhandle, image, yuv_hqbuf,
-                                        IMG_YUV444P, do_rgbswap);
+                    flogo_convert_image(convert, image, rgbbuf, yuv_hqbuf,
+                                        ifmt, do_rgbswap);
 
                     // Copy over Y data from the 444 image
                     ac_memcpy(mfd->yuv[i], yuv_hqbuf, width * height);
@@ -522,6 +548,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
             if (mfd->hqconv)
                 tc_free(yuv_hqbuf);
+            tc_free(rgbbuf);
 
             tcv_free(mfd->tcvhandle);
         } else {
@@ -46,6 +46,9 @@
 
 #include "libtc/framecode.h"
 
+/* we only set frame attributes */
+const int tc_filter_readonly = 1;
+
 
 /**
  * Help text.
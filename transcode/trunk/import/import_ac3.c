@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(audio) AC3"
 
 #include "transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_PCM | TC_CAP_AC3;
@@ -109,7 +110,7 @@ MOD_open
     param->fd = NULL;
 
     // popen
-    if((fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	tc_log_perror(MOD_NAME, "popen pcm stream");
 	return(TC_IMPORT_ERROR);
     }
@@ -209,7 +210,7 @@ MOD_decode
 
 MOD_close
 {
-  if(param->fd != NULL) pclose(param->fd);
+  if(param->fd != NULL) tc_pipe_close(param->fd);
 
   return(TC_IMPORT_OK);
 }
@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(video) * | (audio) *"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_PCM | TC_CAP_RGB | TC_CAP_AUD |
@@ -39,6 +40,9 @@ static int capability_flag = TC_CAP_PCM | TC_CAP_RGB | TC_CAP_AUD |
 #include "libtcvideo/tcvideo.h"
 
 
+/* How far ahead of the reads avilib should prefetch each stream */
+#define READAHEAD_BYTES (8*1024*1024)
+
 static avi_t *avifile_aud = NULL;
 static avi_t *avifile_vid = NULL;
 
@@ -113,7 +117,7 @@ MOD_open
                 return TC_ERROR;
             if (verbose_flag)
                 tc_log_info(MOD_NAME, "%s", import_cmd_buf);
-            param->fd = popen(import_cmd_buf, "r");
+            param->fd = tc_pipe_open(import_cmd_buf);
             if (param->fd == NULL) {
                 return TC_ERROR;
             }
@@ -126,12 +130,17 @@ MOD_open
                 avifile_aud = AVI_open_input_indexfile(vob->audio_in_file,
                                                        0, vob->nav_seek_file);
             } else {
-                avifile_aud = AVI_open_input_file(vob->audio_in_file, 1);
+                /* reuse the index saved by a previous open of the file */
+                avifile_aud = AVI_open_input_file_cached(vob->audio_in_file,
+                                                         1);
             }
             if (avifile_aud == NULL) {
                 AVI_print_error("avi open error");
                 return TC_ERROR;
             }
+            /* chunks are read straight from their offsets */
+            AVI_set_read_mode(avifile_aud, AVI_READ_PREAD);
+            AVI_set_readahead(avifile_aud, READAHEAD_BYTES);
         }
 
         // set selected for multi-audio AVI-files
@@ -177,12 +186,15 @@ MOD_open
                 avifile_vid = AVI_open_input_indexfile(vob->video_in_file,
                                                        0, vob->nav_seek_file);
             } else {
-                avifile_vid = AVI_open_input_file(vob->video_in_file, 1);
+                avifile_vid = AVI_open_input_file_cached(vob->video_in_file,
+                                                         1);
             }
             if (avifile_vid == NULL) {
                 AVI_print_error("avi open error");
                 return TC_ERROR;
             }
+            AVI_set_read_mode(avifile_vid, AVI_READ_PREAD);
+            AVI_set_readahead(avifile_vid, READAHEAD_BYTES);
         }
 
         if (vob->vob_offset > 0)
@@ -333,7 +345,7 @@ MOD_decode
 MOD_close
 {
     if (param->fd != NULL)
-        pclose(param->fd);
+        tc_pipe_close(param->fd);
 
     if (param->flag == TC_AUDIO) {
         CLOSE_AVIFILE(avifile_aud);
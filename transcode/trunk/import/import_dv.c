@@ -27,6 +27,7 @@
 
 #include "src/transcode.h"
 #include "libtc/libtc.h"
+#include "libtc/tcpipe.h"
 #include "libtcutil/xio.h"
 #include "libtcvideo/tcvideo.h"
 
@@ -97,7 +98,7 @@ MOD_open
           return(TC_IMPORT_ERROR);
 
       // popen
-      if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+      if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	return(TC_IMPORT_ERROR);
       }
 
@@ -118,7 +119,7 @@ MOD_open
       param->fd = NULL;
 
       // popen
-      if((fd = popen(import_cmd_buf, "r"))== NULL) {
+      if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	return(TC_IMPORT_ERROR);
       }
 
@@ -156,7 +157,7 @@ MOD_open
       param->fd = NULL;
 
       // popen
-      if((fd = popen(import_cmd_buf, "r"))== NULL) {
+      if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	return(TC_IMPORT_ERROR);
       }
 
@@ -177,7 +178,7 @@ MOD_open
       param->fd = NULL;
 
       // popen
-      if((fd = popen(import_cmd_buf, "r"))== NULL) {
+      if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	return(TC_IMPORT_ERROR);
       }
 
@@ -224,7 +225,7 @@ MOD_open
     param->fd = NULL;
 
     // popen
-    if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	tc_log_perror(MOD_NAME, "popen PCM stream");
 	return(TC_IMPORT_ERROR);
     }
@@ -275,13 +276,13 @@ MOD_decode
 
 MOD_close
 {
-  if(param->fd != NULL) pclose(param->fd);
+  if(param->fd != NULL) tc_pipe_close(param->fd);
 
   if(param->flag == TC_AUDIO) return(TC_IMPORT_OK);
 
   if(param->flag == TC_VIDEO) {
 
-    if(fd) pclose(fd);
+    if(fd) tc_pipe_close(fd);
     fd=NULL;
 
     if (tcvhandle)
@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(video) DVD | (audio) MPEG/AC3/PCM"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_RGB | TC_CAP_YUV | TC_CAP_AC3 | TC_CAP_PCM;
@@ -269,7 +270,7 @@ MOD_open
     param->fd = NULL;
 
     // popen
-    if((fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
       tc_log_perror(MOD_NAME, "popen PCM stream");
       return(TC_IMPORT_ERROR);
     }
@@ -301,7 +302,7 @@ MOD_open
     if(verbose_flag) tc_log_info(MOD_NAME, "%s", import_cmd_buf);
 
     // popen
-    if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
       tc_log_perror(MOD_NAME, "popen subtitle stream");
       return(TC_IMPORT_ERROR);
     }
@@ -446,7 +447,7 @@ MOD_open
     }
 
     // popen
-    if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
       tc_log_perror(MOD_NAME, "popen RGB stream");
       return(TC_IMPORT_ERROR);
     }
@@ -743,8 +744,8 @@ MOD_decode
 
 MOD_close
 {
-    if(param->fd != NULL) pclose(param->fd); param->fd = NULL;
-    if (f) pclose (f); f=NULL;
+    if(param->fd != NULL) tc_pipe_close(param->fd); param->fd = NULL;
+    if (f) tc_pipe_close(f); f=NULL;
 
     if(param->flag == TC_VIDEO) {
 
@@ -756,7 +757,7 @@ MOD_close
 
     if(param->flag == TC_AUDIO) {
 
-      if(fd) pclose(fd);
+      if(fd) tc_pipe_close(fd);
       fd=NULL;
 
       return(TC_IMPORT_OK);
@@ -44,10 +44,7 @@ static uint32_t video_codec;
 static int audio_codec;
 static int aframe_count=0, vframe_count=0;
 
-#define BUFFER_SIZE SIZE_RGB_FRAME<<1
-
 static int r;
-static lzo_byte *out;
 static lzo_byte *wrkmem;
 static lzo_uint out_len;
 
@@ -81,13 +78,17 @@ MOD_open
 	  return(TC_IMPORT_ERROR);
 	}
       } else {
-	if(NULL == (avifile2 = AVI_open_input_file(vob->video_in_file,1))){
+	/* reuse the index saved by a previous open of the file */
+	if(NULL == (avifile2 = AVI_open_input_file_cached(vob->video_in_file,1))){
 	  AVI_print_error("avi open error");
 	  return(TC_IMPORT_ERROR);
 	}
       }
     }
 
+    /* frames are decompressed directly from the file mapping */
+    AVI_set_read_mode(avifile2, AVI_READ_MMAP);
+
     // vob->offset contains the last keyframe
     if (!done_seek && vob->vob_offset>0) {
 	AVI_set_video_position(avifile2, vob->vob_offset);
@@ -123,9 +124,8 @@ MOD_open
     }
 
     wrkmem = (lzo_bytep) lzo_malloc(LZO1X_1_MEM_COMPRESS);
-    out = (lzo_bytep) lzo_malloc(BUFFER_SIZE);
 
-    if (wrkmem == NULL || out == NULL) {
+    if (wrkmem == NULL) {
       tc_log_warn(MOD_NAME, "out of memory");
       return(TC_IMPORT_ERROR);
     }
@@ -149,6 +149,7 @@ MOD_decode
   int key;
   lzo_uint size;
   long bytes_read=0;
+  const char *frame;
 
   if(param->flag == TC_VIDEO) {
     // If we are using tccat, then do nothing here
@@ -156,27 +157,36 @@ MOD_decode
       return(TC_IMPORT_OK);
     }
 
-    out_len = AVI_read_frame(avifile2, out, &key);
+    bytes_read = AVI_read_video_ptr(avifile2, &frame, &key);
 
     if(verbose & TC_STATS && key)
       tc_log_info(MOD_NAME, "keyframe %d", vframe_count);
 
-    if(out_len<=0) {
+    if(bytes_read<=0) {
       if(verbose & TC_DEBUG) AVI_print_error("AVI read video frame");
       return(TC_IMPORT_ERROR);
     }
+    out_len = bytes_read;
 
     if (video_codec == TC_CODEC_LZO1) {
-      r = lzo1x_decompress(out, out_len, param->buffer, &size, wrkmem);
+      r = lzo1x_decompress((lzo_bytep)frame, out_len, param->buffer,
+                           &size, wrkmem);
     } else {
-      tc_lzo_header_t *h = (tc_lzo_header_t *)out;
-      uint8_t *compdata = out + sizeof(*h);
-      int compsize = out_len - sizeof(*h);
-      if (h->magic != video_codec) {
-          tc_log_warn(MOD_NAME, "frame with invalid magic 0x%08X", h->magic);
+      /* the frame data need not be aligned, so copy the header out */
+      tc_lzo_header_t h;
+      lzo_bytep compdata = (lzo_bytep)frame + sizeof(h);
+      int compsize = out_len - sizeof(h);
+      if (out_len < sizeof(h)) {
+          tc_log_warn(MOD_NAME, "frame too short (%lu bytes)",
+                      (unsigned long)out_len);
+	      return (TC_IMPORT_ERROR);
+      }
+      memcpy(&h, frame, sizeof(h));
+      if (h.magic != video_codec) {
+          tc_log_warn(MOD_NAME, "frame with invalid magic 0x%08X", h.magic);
 	      return (TC_IMPORT_ERROR);
       }
-      if (h->flags & TC_LZO_NOT_COMPRESSIBLE) {
+      if (h.flags & TC_LZO_NOT_COMPRESSIBLE) {
           ac_memcpy(param->buffer, compdata, compsize);
 	      size = compsize;
 	      r = LZO_E_OK;
@@ -261,7 +271,6 @@ MOD_close
   if(param->flag == TC_VIDEO) {
 
     lzo_free(wrkmem);
-    lzo_free(out);
 
     if(avifile2!=NULL) {
       AVI_close(avifile2);
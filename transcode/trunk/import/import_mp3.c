@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(audio) MPEG"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_PCM;
@@ -137,7 +138,7 @@ MOD_open
     param->fd = NULL;
 
     // popen
-    if((fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	tc_log_perror(MOD_NAME, "popen pcm stream");
 	return(TC_IMPORT_ERROR);
     }
@@ -212,8 +213,8 @@ MOD_close
 
   if(param->flag != TC_AUDIO) return(TC_IMPORT_ERROR);
 
-  if(fd != NULL) pclose(fd);
-  if(param->fd != NULL) pclose(param->fd);
+  if(fd != NULL) tc_pipe_close(fd);
+  if(param->fd != NULL) tc_pipe_close(param->fd);
 
   fd        = NULL;
   param->fd = NULL;
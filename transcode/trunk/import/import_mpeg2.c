@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(video) MPEG2"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_RGB | TC_CAP_YUV | TC_CAP_VID;
@@ -145,7 +146,7 @@ MOD_open
   param->fd = NULL;
 
   // popen
-  if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+  if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
     tc_log_perror(MOD_NAME, "popen RGB stream");
     return(TC_IMPORT_ERROR);
   }
@@ -335,8 +336,8 @@ MOD_decode{
 MOD_close
 {
 
-    if(param->fd != NULL) pclose(param->fd);
-    if(f != NULL) pclose(f);
+    if(param->fd != NULL) tc_pipe_close(param->fd);
+    if(f != NULL) tc_pipe_close(f);
     param->fd = f = NULL;
 
     return(TC_IMPORT_OK);
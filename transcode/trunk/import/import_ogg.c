@@ -27,6 +27,7 @@
 
 #include "src/transcode.h"
 #include "libtc/libtc.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_RGB|TC_CAP_YUV|TC_CAP_AUD|TC_CAP_PCM|TC_CAP_VID;
@@ -148,7 +149,7 @@ MOD_open
     if (verbose_flag)
         tc_log_info(MOD_NAME, "%s", import_cmd_buf);
 
-    param->fd = popen(import_cmd_buf, "r");
+    param->fd = tc_pipe_open(import_cmd_buf);
     if (param->fd == NULL) {
         tc_log_perror(MOD_NAME, "popen video stream");
         return TC_ERROR;
@@ -167,7 +168,7 @@ MOD_decode
 MOD_close
 {
     if (param->fd != NULL) {
-        pclose(param->fd);
+        tc_pipe_close(param->fd);
     }
     return TC_OK;
 }
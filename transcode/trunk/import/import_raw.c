@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(video) RGB/YUV | (audio) PCM"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_RGB|TC_CAP_YUV|TC_CAP_PCM|TC_CAP_YUV422;
@@ -69,7 +70,7 @@ MOD_open
 	    if (verbose_flag)
             tc_log_info(MOD_NAME, "%s", import_cmd_buf);
 
-        param->fd = popen(import_cmd_buf, "r");
+        param->fd = tc_pipe_open(import_cmd_buf);
         if (param->fd == NULL) {
             tc_log_perror(MOD_NAME, "popen audio stream");
             return TC_IMPORT_ERROR;
@@ -114,7 +115,7 @@ MOD_open
         if (verbose_flag)
             tc_log_info(MOD_NAME, "%s", import_cmd_buf);
 
-        param->fd = popen(import_cmd_buf, "r");
+        param->fd = tc_pipe_open(import_cmd_buf);
         if (param->fd == NULL) {
             tc_log_perror(MOD_NAME, "popen video stream");
             return TC_IMPORT_ERROR;
@@ -147,7 +148,7 @@ MOD_decode
 MOD_close
 {
     if (param->fd != NULL) {
-        pclose(param->fd);
+        tc_pipe_close(param->fd);
         param->fd = NULL;
     }
     return TC_IMPORT_OK;
@@ -28,6 +28,7 @@
 #include "src/transcode.h"
 
 #include "libtc/libtc.h"
+#include "libtc/tcpipe.h"
 #include "libtcutil/optstr.h"
 
 /*%*
@@ -235,7 +236,7 @@ MOD_open
     param->fd = NULL;
 
     // popen
-    if((fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((fd = tc_pipe_open(import_cmd_buf))== NULL) {
       tc_log_perror(MOD_NAME, "popen PCM stream");
       return(TC_IMPORT_ERROR);
     }
@@ -260,7 +261,7 @@ MOD_open
     if(verbose_flag) tc_log_info(MOD_NAME, "%s", import_cmd_buf);
 
     // popen
-    if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+    if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
       tc_log_perror(MOD_NAME, "popen subtitle stream");
       return(TC_IMPORT_ERROR);
     }
@@ -349,7 +350,7 @@ MOD_open
       param->fd = NULL;
 
       // popen
-      if((param->fd = popen(import_cmd_buf, "r"))== NULL) {
+      if((param->fd = tc_pipe_open(import_cmd_buf))== NULL) {
 	tc_log_perror(MOD_NAME, "popen RGB stream");
 	return(TC_IMPORT_ERROR);
       }
@@ -640,12 +641,12 @@ MOD_close
 {
 
     if(param->fd) {
-	pclose(param->fd);
+	tc_pipe_close(param->fd);
     }
     param->fd = NULL;
 
     if (f) {
-      pclose (f);
+      tc_pipe_close(f);
     }
     f = NULL;
 
@@ -663,7 +664,7 @@ MOD_close
 
     if(param->flag == TC_AUDIO) {
 
-      if(fd) pclose(fd);
+      if(fd) tc_pipe_close(fd);
       fd=NULL;
 
       return(0);
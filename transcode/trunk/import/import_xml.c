@@ -26,6 +26,7 @@
 #define MOD_CODEC   "(video) * | (audio) *"
 
 #include "src/transcode.h"
+#include "libtc/tcpipe.h"
 #include "src/tcinfo.h"
 #include "libtcvideo/tcvideo.h"
 
@@ -367,7 +368,7 @@ MOD_open
                        	tc_log_warn(MOD_NAME,"video magic 0x%lx not yet supported.", s_v_magic);
 			return(TC_IMPORT_ERROR);
 		}
-		if((s_fd_video = popen(import_cmd_buf, "r"))== NULL)
+		if((s_fd_video = tc_pipe_open(import_cmd_buf))== NULL)
 		{
 			tc_log_warn(MOD_NAME,"Error cannot open the pipe.");
 			return(TC_IMPORT_ERROR);
@@ -450,7 +451,7 @@ MOD_open
                         tc_log_warn(MOD_NAME,"audio magic 0x%lx not yet supported.",s_a_magic);
 			return(TC_IMPORT_ERROR);
 		}
-		if((s_fd_audio = popen(import_cmd_buf, "r"))== NULL)
+		if((s_fd_audio = tc_pipe_open(import_cmd_buf))== NULL)
 		{
 			tc_log_warn(MOD_NAME,"Error cannot open the pipe.");
 			return(TC_IMPORT_ERROR);
@@ -526,7 +527,7 @@ MOD_decode
                         		tc_log_warn(MOD_NAME,"audio magic 0x%lx not yet supported.",s_a_magic);
 					return(TC_IMPORT_ERROR);
 				}
-                                if((s_fd_audio = popen(import_cmd_buf, "r"))== NULL)
+                                if((s_fd_audio = tc_pipe_open(import_cmd_buf))== NULL)
                                 {
                                         tc_log_warn(MOD_NAME,"Error cannot open the pipe.");
                                         return(TC_IMPORT_ERROR);
@@ -683,7 +684,7 @@ MOD_decode
                         		tc_log_warn(MOD_NAME,"video magic 0x%lx not yet supported.",s_v_magic);
 					return(TC_IMPORT_ERROR);
 				}
-                       		if((s_fd_video = popen(import_cmd_buf, "r"))== NULL)
+                       		if((s_fd_video = tc_pipe_open(import_cmd_buf))== NULL)
                                	{
                                 	tc_log_warn(MOD_NAME,"Error cannot open the pipe.");
      		                 	return(TC_IMPORT_ERROR);
@@ -239,6 +239,91 @@ aframe_list_t *tc_alloc_audio_frame(size_t size)
     return aptr;
 }
 
+#define TC_FRAME_ALIGNED(size) \
+    (((size) + TC_FRAME_ALIGN - 1) & ~((size_t)TC_FRAME_ALIGN - 1))
+
+/* same sizing policy of tc_alloc_{video,audio}_frame */
+static size_t buffer_mem_size(size_t size)
+{
+#ifdef TC_FRAME_EXTRA_SIZE
+    size += TC_FRAME_EXTRA_SIZE;
+#endif
+    return TC_FRAME_ALIGNED(size);
+}
+
+size_t tc_video_frame_mem_size(int width, int height, int format,
+                               int partial)
+{
+    size_t psizes[3] = { 0, 0, 0 };
+    size_t size = TC_FRAME_ALIGNED(sizeof(vframe_list_t));
+
+    if (tc_video_planes_size(psizes, width, height, format) != 0) {
+        return 0;
+    }
+#ifdef STATBUFFER
+    size += buffer_mem_size(psizes[0] + psizes[1] + psizes[2])
+            * ((partial) ?1 :2);
+#endif
+    return size;
+}
+
+size_t tc_audio_frame_mem_size(double samples, int channels, int bits)
+{
+    int unused = 0;
+    size_t size = TC_FRAME_ALIGNED(sizeof(aframe_list_t));
+
+#ifdef STATBUFFER
+    size += buffer_mem_size(tc_audio_frame_size(samples, channels,
+                                                      bits, &unused));
+#endif
+    return size;
+}
+
+vframe_list_t *tc_new_video_frame_at(void *mem, int width, int height,
+                                     int format, int partial)
+{
+    vframe_list_t *vptr = mem;
+    size_t psizes[3] = { 0, 0, 0 };
+
+    if (mem == NULL
+     || tc_video_planes_size(psizes, width, height, format) != 0) {
+        return NULL;
+    }
+    memset(vptr, 0, sizeof(vframe_list_t));
+#ifdef STATBUFFER
+    {
+        size_t bufsize = buffer_mem_size(psizes[0] + psizes[1]
+                                               + psizes[2]);
+        uint8_t *buf = (uint8_t *)mem
+                       + TC_FRAME_ALIGNED(sizeof(vframe_list_t));
+
+        vptr->internal_video_buf_0 = buf;
+        vptr->internal_video_buf_1 = (partial) ?NULL :(buf + bufsize);
+    }
+#endif
+    tc_init_video_frame(vptr, width, height, format);
+    return vptr;
+}
+
+aframe_list_t *tc_new_audio_frame_at(void *mem, double samples,
+                                     int channels, int bits)
+{
+    aframe_list_t *aptr = mem;
+
+    if (mem == NULL) {
+        return NULL;
+    }
+    memset(aptr, 0, sizeof(aframe_list_t));
+#ifdef STATBUFFER
+    aptr->internal_audio_buf = (uint8_t *)mem
+                               + TC_FRAME_ALIGNED(sizeof(aframe_list_t));
+#endif
+    tc_init_audio_frame(aptr, samples, channels, bits);
+    return aptr;
+}
+
+#undef TC_FRAME_ALIGNED
+
 void tc_del_video_frame(vframe_list_t *vptr)
 {
     if (vptr != NULL) {
@@ -254,6 +254,12 @@ struct tcframevideo_ {
     uint8_t *video_buf_Y[2];
     uint8_t *video_buf_U[2];
     uint8_t *video_buf_V[2];
+
+    /* copy-on-write buffer sharing; managed by the framebuffer code */
+    struct tcframevideo_ *cow_owner;     /* frame whose data we borrow */
+    struct tcframevideo_ *cow_next;      /* next borrower of cow_owner */
+    struct tcframevideo_ *cow_borrowers; /* frames borrowing our data  */
+    int cow_slot;                        /* which of our buffers is lent */
 };
 typedef struct tcframevideo_ vframe_list_t;
 
@@ -490,6 +496,50 @@ TCFrameVideo *tc_new_video_frame(int width, int height, int format,
 TCFrameAudio *tc_new_audio_frame(double samples, int channels, int bits);
 
 
+/*
+ * TC_FRAME_ALIGN:
+ *     alignment, in bytes, of the buffers of frames built in place
+ *     (see below). Large enough for any SIMD kernel we have.
+ */
+#define TC_FRAME_ALIGN          64
+
+/*
+ * tc_{video,audio}_frame_mem_size:
+ *     tell how much memory is needed to build in place a frame
+ *     represented by given parameters (descriptor plus buffer(s),
+ *     including alignment padding). Always a multiple of TC_FRAME_ALIGN.
+ *
+ * Parameters:
+ *     see tc_new_{video,audio}_frame.
+ * Return Value:
+ *     size in bytes, or 0 if given parameters are wrong.
+ */
+size_t tc_video_frame_mem_size(int width, int height, int format,
+                               int partial);
+size_t tc_audio_frame_mem_size(double samples, int channels, int bits);
+
+/*
+ * tc_new_{video,audio}_frame_at:
+ *     like tc_new_{video,audio}_frame, but build the frame (descriptor
+ *     and buffers) in place, in the given memory block, instead of
+ *     allocating it. Useful to carve many frames out of one arena.
+ *     Buffers are guaranteed to be TC_FRAME_ALIGN-aligned.
+ *
+ * Parameters:
+ *        mem: TC_FRAME_ALIGN-aligned memory block, large at least
+ *             tc_{video,audio}_frame_mem_size() bytes.
+ *     others: see tc_new_{video,audio}_frame.
+ * Return Value:
+ *     pointer to the new frame (at `mem') if succesfull, NULL otherwise.
+ *     Frames built this way MUST NOT be released using
+ *     tc_del_{video,audio}_frame: just release the memory block.
+ */
+TCFrameVideo *tc_new_video_frame_at(void *mem, int width, int height,
+                                    int format, int partial);
+TCFrameAudio *tc_new_audio_frame_at(void *mem, double samples,
+                                    int channels, int bits);
+
+
 /*
  * tc_del_{video,audio}_frame:
  *     safely deallocate memory obtained with tc_new_{video,audio}_frame
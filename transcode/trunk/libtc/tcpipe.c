@@ -0,0 +1,414 @@
+/*
+ * tcpipe.c -- shell-less launcher for import helper pipelines
+ *             (tccat | tcdemux | tcextract | tcdecode ...)
+ *
+ * This file is part of transcode, a video stream processing tool.
+ *
+ * transcode is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * transcode is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for pipe2() */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "libtc.h"
+#include "tcpipe.h"
+
+extern char **environ;
+
+#ifndef O_CLOEXEC
+# define O_CLOEXEC  0
+#endif
+
+/*************************************************************************/
+
+#define TC_PIPE_MAX_STAGES  8
+#define TC_PIPE_MAX_ARGS    64
+
+/* tccat packs are DVD logical blocks */
+#define TC_PIPE_PACK_SIZE   2048
+
+/*
+ * characters which need a real shell if found outside of quotes;
+ * in such case we just give the command line to popen().
+ */
+#define TC_PIPE_SHELL_CHARS "<>;&$`\\()[]{}*?~#!"
+
+typedef struct tcpipestage_ TCPipeStage;
+struct tcpipestage_ {
+    char *argv[TC_PIPE_MAX_ARGS + 1];
+    int argc;
+};
+
+typedef struct tcpipe_ TCPipe;
+struct tcpipe_ {
+    FILE *f;
+    pid_t pids[TC_PIPE_MAX_STAGES];
+    int npids;
+    TCPipe *next;
+};
+
+static pthread_mutex_t pipes_lock = PTHREAD_MUTEX_INITIALIZER;
+static TCPipe *pipes = NULL;
+
+/*************************************************************************/
+
+/*
+ * pipe_parse:
+ *     split a command line in pipeline stages and arguments,
+ *     understanding only the (tiny) subset of the shell syntax used
+ *     by import modules: blank separated words, '...' and "..."
+ *     quoting and '|'.
+ *     Strings are copied in `buf', which must be at least as large as
+ *     `cmd'.
+ *
+ * Return Value:
+ *     number of stages found, -1 if a real shell is needed.
+ */
+static int pipe_parse(char *buf, const char *cmd, TCPipeStage *stages)
+{
+    const char *p = cmd;
+    char *out = buf;
+    TCPipeStage *stage = &stages[0];
+    int i, n = 0;
+
+    stage->argc = 0;
+    while (1) {
+        while (*p == ' ' || *p == '\t' || *p == '\n') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (*p == '|') {
+            if (stage->argc == 0 || ++n >= TC_PIPE_MAX_STAGES) {
+                return -1;
+            }
+            stage->argv[stage->argc] = NULL;
+            stage = &stages[n];
+            stage->argc = 0;
+            p++;
+            continue;
+        }
+
+        if (stage->argc >= TC_PIPE_MAX_ARGS) {
+            return -1;
+        }
+        stage->argv[stage->argc++] = out;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '|') {
+            if (*p == '"') {
+                for (p++; *p && *p != '"'; p++) {
+                    if (*p == '$' || *p == '`') {
+                        return -1; /* expansion requested */
+                    }
+                    if (*p == '\\' && p[1] != '\0'
+                     && strchr("\"\\$`", p[1]) != NULL) {
+                        p++;
+                    }
+                    *out++ = *p;
+                }
+                if (*p++ != '"') {
+                    return -1;
+                }
+            } else if (*p == '\'') {
+                for (p++; *p && *p != '\''; p++) {
+                    *out++ = *p;
+                }
+                if (*p++ != '\'') {
+                    return -1;
+                }
+            } else if (strchr(TC_PIPE_SHELL_CHARS, *p) != NULL) {
+                return -1;
+            } else {
+                *out++ = *p++;
+            }
+        }
+        *out++ = '\0';
+    }
+
+    if (stage->argc == 0) {
+        return -1; /* empty command line or dangling '|' */
+    }
+    stage->argv[stage->argc] = NULL;
+
+    for (i = 0; i <= n; i++) {
+        if (strchr(stages[i].argv[0], '=') != NULL) {
+            return -1; /* environment assignment */
+        }
+    }
+    return n + 1;
+}
+
+/*
+ * pipe_source:
+ *     if the stage is a plain `tccat -i FILE [-t TYPE] [-S PACKS] [-d N]'
+ *     on a regular file, do the same job in-process: tccat would just
+ *     seek and copy the file verbatim to its standard output.
+ *
+ * Return Value:
+ *     descriptor of the opened (and positioned) file,
+ *     -1 if the stage must be run as usual.
+ */
+static int pipe_source(const TCPipeStage *stage)
+{
+    const char *name = NULL;
+    struct stat st;
+    off_t offset = 0;
+    int i, fd;
+
+    if (strcmp(stage->argv[0], "tccat") != 0 || (stage->argc % 2) == 0) {
+        return -1;
+    }
+    for (i = 1; i < stage->argc; i += 2) {
+        const char *opt = stage->argv[i], *val = stage->argv[i + 1];
+
+        if (strcmp(opt, "-i") == 0) {
+            name = val;
+        } else if (strcmp(opt, "-S") == 0) {
+            offset = (off_t)atoi(val) * TC_PIPE_PACK_SIZE;
+        } else if (strcmp(opt, "-t") == 0) {
+            if (strcmp(val, "dvd") == 0) {
+                return -1;
+            }
+        } else if (strcmp(opt, "-d") != 0) {
+            return -1;
+        }
+    }
+    if (name == NULL || stat(name, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+
+    fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1; /* let tccat complain */
+    }
+    if (O_CLOEXEC == 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC); /* racy, see pipe_create() */
+    }
+    if (offset > 0 && lseek(fd, offset, SEEK_SET) != offset) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * pipe_create:
+ *     create a pipe whose ends are both close-on-exec: only the copies
+ *     dup'ed on the stages' stdin/stdout must survive.  Pipelines may be
+ *     opened by several import threads at once, so the flag must be set
+ *     atomically; otherwise a stage spawned by another thread in the
+ *     meantime would inherit our write end, and our reader would never
+ *     see EOF.  Setting it afterwards is only done where pipe2() is
+ *     missing.
+ */
+static int pipe_create(int fds[2])
+{
+    int ret = -1;
+
+#ifdef HAVE_PIPE2
+    ret = pipe2(fds, O_CLOEXEC);
+    if (ret < 0 && errno != ENOSYS) {
+        return TC_ERROR;
+    }
+#endif
+    if (ret < 0) {
+        if (pipe(fds) < 0) {
+            return TC_ERROR;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    }
+#ifdef F_SETPIPE_SZ
+    fcntl(fds[1], F_SETPIPE_SZ, TC_PIPE_SIZE);
+#endif
+    return TC_OK;
+}
+
+static pid_t pipe_spawn(char **argv, int fd_in, int fd_out)
+{
+    posix_spawn_file_actions_t actions;
+    pid_t pid = -1;
+    int err;
+
+    posix_spawn_file_actions_init(&actions);
+    if (fd_in != STDIN_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, fd_in, STDIN_FILENO);
+    }
+    if (fd_out != STDOUT_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, fd_out, STDOUT_FILENO);
+    }
+    err = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+/* wait for all the stages; return the status of the last one */
+static int pipe_reap(TCPipe *tp, int kill_them)
+{
+    int i, status = 0, ret = 0;
+
+    for (i = 0; i < tp->npids; i++) {
+        if (kill_them) {
+            kill(tp->pids[i], SIGTERM);
+        }
+        while (waitpid(tp->pids[i], &status, 0) < 0) {
+            if (errno != EINTR) {
+                status = -1;
+                break;
+            }
+        }
+        ret = status;
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
+FILE *tc_pipe_open(const char *cmd)
+{
+    TCPipeStage stages[TC_PIPE_MAX_STAGES];
+    TCPipe *tp = NULL;
+    char *buf = NULL;
+    int fd_in = STDIN_FILENO, fds[2];
+    int i = 0, n = 0;
+
+    if (cmd == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    buf = tc_malloc(strlen(cmd) + 1);
+    tp = tc_zalloc(sizeof(TCPipe));
+    if (buf == NULL || tp == NULL) {
+        goto fallback;
+    }
+    n = pipe_parse(buf, cmd, stages);
+    if (n <= 0) {
+        goto fallback;
+    }
+
+    fd_in = pipe_source(&stages[0]);
+    if (fd_in >= 0) {
+        i = 1;
+    } else {
+        fd_in = STDIN_FILENO;
+    }
+
+    for (; i < n; i++) {
+        pid_t pid;
+
+        if (pipe_create(fds) != TC_OK) {
+            goto failed;
+        }
+        pid = pipe_spawn(stages[i].argv, fd_in, fds[1]);
+        close(fds[1]);
+        if (fd_in != STDIN_FILENO) {
+            close(fd_in);
+        }
+        fd_in = fds[0];
+        if (pid < 0) {
+            goto failed;
+        }
+        tp->pids[tp->npids++] = pid;
+    }
+
+    tp->f = fdopen(fd_in, "r");
+    if (tp->f == NULL) {
+        goto failed;
+    }
+
+    pthread_mutex_lock(&pipes_lock);
+    tp->next = pipes;
+    pipes = tp;
+    pthread_mutex_unlock(&pipes_lock);
+
+    tc_free(buf);
+    return tp->f;
+
+  failed:
+    if (fd_in != STDIN_FILENO) {
+        close(fd_in);
+    }
+    pipe_reap(tp, 1);
+  fallback:
+    tc_free(tp);
+    tc_free(buf);
+    return popen(cmd, "r");
+}
+
+int tc_pipe_close(FILE *f)
+{
+    TCPipe *tp = NULL, **pp = NULL;
+
+    if (f == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&pipes_lock);
+    for (pp = &pipes; *pp != NULL; pp = &(*pp)->next) {
+        if ((*pp)->f == f) {
+            tp = *pp;
+            *pp = tp->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pipes_lock);
+
+    if (tp == NULL) {
+        return pclose(f); /* fallback path */
+    } else {
+        int status;
+
+        fclose(f);
+        status = pipe_reap(tp, 0);
+        tc_free(tp);
+        return status;
+    }
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,71 @@
+/*
+ * tcpipe.h -- shell-less launcher for import helper pipelines
+ *             (tccat | tcdemux | tcextract | tcdecode ...)
+ *
+ * This file is part of transcode, a video stream processing tool.
+ *
+ * transcode is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * transcode is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TCPIPE_H
+#define TCPIPE_H
+
+#include <stdio.h>
+
+/*
+ * Size requested for every pipe between two pipeline stages
+ * (Linux only, silently ignored elsewhere or if refused).
+ * A bigger pipe means much less context switches between the
+ * helpers, which otherwise hand over data in 4/64 kB bites.
+ */
+#define TC_PIPE_SIZE    (1024 * 1024)
+
+/*
+ * tc_pipe_open:
+ *     drop-in replacement for popen(cmd, "r") for the helper pipelines
+ *     built by import modules.
+ *     The command line is split into stages on '|' and every stage is
+ *     spawned directly, without an intermediate /bin/sh, connected
+ *     by enlarged pipes. A leading `tccat -i FILE' on a regular file
+ *     is handled in-process: the file is opened (and seeked, for -S)
+ *     here and given as standard input to the next stage, saving a
+ *     process and a full copy of the stream.
+ *     Command lines using any shell feature beyond plain words, quoting
+ *     and '|' (redirections, variables, globbing...) are passed to
+ *     popen() unchanged, so the shell chain remains the fallback.
+ *
+ * Parameters:
+ *     cmd: command line to run, as it would be given to popen().
+ * Return Value:
+ *     a FILE pointer to read the output of the last stage from,
+ *     NULL on error (errno set).
+ * Side effects:
+ *     spawns one process per pipeline stage.
+ */
+FILE *tc_pipe_open(const char *cmd);
+
+/*
+ * tc_pipe_close:
+ *     close a stream opened by tc_pipe_open and wait for all the
+ *     stages of the pipeline to terminate.
+ *
+ * Parameters:
+ *     f: stream returned by tc_pipe_open.
+ * Return Value:
+ *     termination status of the last stage, as pclose() would report
+ *     it; -1 on error.
+ */
+int tc_pipe_close(FILE *f);
+
+#endif  /* TCPIPE_H */
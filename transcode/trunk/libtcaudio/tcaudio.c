@@ -9,12 +9,45 @@
  */
 
 #include "libtcutil/tcutil.h"
+#include "aclib/ac.h"
 #include "tcaudio.h"
 
 #include <math.h>
 
 /*************************************************************************/
 
+/* Byte order of the CPU, in the same terms as the `msbfirst' field below */
+#ifdef WORDS_BIGENDIAN
+# define NATIVE_MSBFIRST 1
+#else
+# define NATIVE_MSBFIRST 0
+#endif
+
+/* Number of entries in tables indexed by AudioFormat */
+#define TCA_NFORMATS (TCA_U16LE + 1)
+
+/* Sample processing kernel types (the kernels themselves are defined at
+ * the bottom of the file). */
+typedef void (*ConvertFunc)(void *buf, int len, unsigned int mask);
+typedef int (*AmplifyFunc)(void *buf, int len, double scale);
+typedef void (*MixFunc)(void *buf, int len);
+
+/* A set of kernels using a particular acceleration feature. */
+typedef struct {
+    int accel;                  /* Required acceleration flags */
+    ConvertFunc xor8, xor16, swap16;
+    AmplifyFunc amplify16;
+    MixFunc mono_to_stereo8, mono_to_stereo16;
+    MixFunc stereo_to_mono8, stereo_to_mono16;
+} TCAKernels;
+
+/* A sample format conversion done by a single kernel call,
+ * func(buf, len, mask). */
+typedef struct {
+    ConvertFunc func;           /* NULL if tca_convert() must do the work */
+    unsigned int mask;
+} TCAConversion;
+
 /* Internal data structure to hold various state information.  The
  * TCAHandle returned by tca_init() and passed by the caller to other
  * functions is a pointer to this structure. */
@@ -22,6 +55,12 @@
 struct tcahandle_ {
     AudioFormat format;            /* Sample format */
     int bits, issigned, msbfirst;  /* Information about sample format */
+    /* Kernels chosen by tca_init(); NULL where there is no kernel for
+     * the sample format, and the generic code is used instead */
+    TCAConversion convert_from[TCA_NFORMATS];  /* Indexed by source format */
+    TCAConversion convert_to[TCA_NFORMATS];    /* Indexed by target format */
+    AmplifyFunc amplify;
+    MixFunc mono_to_stereo, stereo_to_mono;
 };
 
 /*************************************************************************/
@@ -32,6 +71,7 @@ static int tca_get_format_info(AudioFormat format, int *bits_ret,
                                int *issigned_ret, int *msbfirst_ret);
 static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
                        int len, AudioFormat srcfmt, AudioFormat destfmt);
+static void tca_select(TCAHandle handle);
 
 /*************************************************************************/
 /*************************************************************************/
@@ -43,7 +83,8 @@ static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
 /**
  * tca_init:  Create and return a handle for use in other tcaudio
  * functions.  The handle should be freed with tca_free() when no longer
- * needed.
+ * needed.  The processing routines for the sample format are chosen here,
+ * using the acceleration features enabled by ac_init().
  *
  * Parameters: format: Audio sample format to use with tcaudio functions.
  * Return value: A handle to be passed to other tcaudio functions, or 0 on
@@ -69,6 +110,7 @@ TCAHandle tca_init(AudioFormat format)
     handle->bits     = bits;
     handle->issigned = issigned;
     handle->msbfirst = msbfirst;
+    tca_select(handle);
     return handle;
 }
 
@@ -160,7 +202,9 @@ int tca_amplify(TCAHandle handle, void *buf, int len, double scale,
         return 0;
     }
     nclip = 0;
-    if (handle->bits == 8) {
+    if (handle->amplify) {
+        nclip = (*handle->amplify)(buf, len, scale);
+    } else if (handle->bits == 8) {
         uint8_t *ptr = buf;
         int bias = handle->issigned ? 0 : 0x80;
         int i;
@@ -226,21 +270,8 @@ int tca_mono_to_stereo(TCAHandle handle, void *buf, int len)
         tc_log_error("libtcaudio", "tca_mono_to_stereo: invalid parameters!");
         return 0;
     }
-    /* Be careful--we have to go backwards or we overwrite unconverted data */
-    if (handle->bits == 8) {
-        uint8_t *ptr = buf;
-        int i;
-        for (i = len-1; i >= 0; i--) {
-            ptr[i*2] = ptr[i];
-            ptr[i*2+1] = ptr[i];
-        }
-    } else if (handle->bits == 16) {
-        uint16_t *ptr = buf;
-        int i;
-        for (i = len-1; i >= 0; i--) {
-            ptr[i*2] = ptr[i];
-            ptr[i*2+1] = ptr[i];
-        }
+    if (handle->mono_to_stereo) {
+        (*handle->mono_to_stereo)(buf, len);
     } else {
         tc_log_error("libtcaudio", "tca_mono_to_stereo: %d-bit samples not"
                      " supported", handle->bits);
@@ -269,13 +300,10 @@ int tca_stereo_to_mono(TCAHandle handle, void *buf, int len)
         tc_log_error("libtcaudio", "tca_stereo_to_mono: invalid parameters!");
         return 0;
     }
-    if (handle->bits == 8) {
-        uint8_t *ptr = buf;
-        int i;
-        for (i = 0; i < len; i++) {
-            ptr[i] = ((int)ptr[i*2] + (int)ptr[i*2+1] + 1) / 2;
-        }
+    if (handle->stereo_to_mono) {
+        (*handle->stereo_to_mono)(buf, len);
     } else if (handle->bits == 16) {
+        /* Samples in the opposite byte order */
         int8_t *ptr1 = buf + (handle->msbfirst ? 0 : 1);
         uint8_t *ptr2 = buf + (handle->msbfirst ? 1 : 0);
         int i;
@@ -376,6 +404,7 @@ static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
 {
     int src_bits = -1, src_issigned = -1, src_msbfirst = -1,
         dest_bits = -1, dest_issigned = -1, dest_msbfirst = -1;
+    const TCAConversion *conv;
 
     /* Parameter checks */
     if (!handle || !buf || len < 0
@@ -386,6 +415,14 @@ static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
         return 0;
     }
 
+    /* Use the kernel chosen by tca_init() if there is one */
+    conv = (srcfmt == handle->format) ? &handle->convert_to[destfmt]
+                                      : &handle->convert_from[srcfmt];
+    if (conv->func) {
+        (*conv->func)(buf, len, conv->mask);
+        return 1;
+    }
+
     /* Convert sample sizes and byte orders */
     if (src_bits == 8 && dest_bits == 16) {
         /* 8 bit -> 16 bit */
@@ -425,6 +462,588 @@ static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
     return 1;
 }
 
+/*************************************************************************/
+
+/* Sample processing kernels.  Each operation has a plain C version and
+ * SSE2/AVX2 versions which give exactly the same results; tca_select()
+ * picks the best set allowed by aclib when the handle is created.  The
+ * 16-bit amplify and stereo-to-mono kernels work on signed samples in
+ * native byte order. */
+
+/************************************/
+
+/* xor8, xor16:  XOR each 8- or 16-bit sample with `mask' (flips the sign
+ * of the samples, for signed/unsigned conversion). */
+
+static void xor8_c(void *buf, int len, unsigned int mask)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = 0; i < len; i++)
+        ptr[i] ^= mask;
+}
+
+static void xor16_c(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    int i;
+
+    for (i = 0; i < len; i++)
+        ptr[i] ^= mask;
+}
+
+/* swap16:  Swap the bytes of each 16-bit sample, then XOR it with `mask'. */
+
+static void swap16_c(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    int i;
+
+    for (i = 0; i < len; i++)
+        ptr[i] = (ptr[i]<<8 | ptr[i]>>8) ^ mask;
+}
+
+/* none:  No conversion needed. */
+
+static void convert_none(void *buf, int len, unsigned int mask)
+{
+}
+
+/* amplify16:  Scale each sample, clipping to the 16-bit range; returns
+ * the number of clipped samples. */
+
+static int amplify16_c(void *buf, int len, double scale)
+{
+    int16_t *ptr = buf;
+    int i, nclip = 0;
+
+    for (i = 0; i < len; i++) {
+        int32_t v = floor((ptr[i] * scale) + 0.5);
+        if (v > 0x7FFF) {
+            v = 0x7FFF;
+            nclip++;
+        }
+        if (v < -0x8000) {
+            v = -0x8000;
+            nclip++;
+        }
+        ptr[i] = v;
+    }
+    return nclip;
+}
+
+/* mono_to_stereo8, mono_to_stereo16:  Duplicate each sample (`len' is
+ * the number of source samples); works backwards so that the buffer can
+ * be converted in place. */
+
+static void mono_to_stereo8_c(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = len-1; i >= 0; i--) {
+        ptr[i*2] = ptr[i];
+        ptr[i*2+1] = ptr[i];
+    }
+}
+
+static void mono_to_stereo16_c(void *buf, int len)
+{
+    uint16_t *ptr = buf;
+    int i;
+
+    for (i = len-1; i >= 0; i--) {
+        ptr[i*2] = ptr[i];
+        ptr[i*2+1] = ptr[i];
+    }
+}
+
+/* stereo_to_mono8, stereo_to_mono16:  Average each pair of samples (`len'
+ * is the number of result samples). */
+
+static void stereo_to_mono8_c(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = 0; i < len; i++)
+        ptr[i] = ((int)ptr[i*2] + (int)ptr[i*2+1] + 1) / 2;
+}
+
+static void stereo_to_mono16_c(void *buf, int len)
+{
+    int16_t *ptr = buf;
+    int i;
+
+    for (i = 0; i < len; i++)
+        ptr[i] = ((int32_t)ptr[i*2] + (int32_t)ptr[i*2+1] + 1) / 2;
+}
+
+/************************************/
+
+#if (defined(ARCH_X86) || defined(ARCH_X86_64)) \
+ && (defined(__clang__) || __GNUC__ > 4 \
+     || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+
+#define TCA_SIMD
+
+#include <immintrin.h>
+
+/* The kernels are compiled for their instruction set whatever the
+ * compiler flags, and only called if ac_getaccel() allows it.  Each one
+ * leaves the samples which do not fill a whole vector to the C version. */
+#define TCA_SSE2        __attribute__((target("sse2")))
+#define TCA_AVX2        __attribute__((target("avx2")))
+
+/* Bounds for amplified values before conversion to integer: anything
+ * outside is clipped anyway, and this keeps the conversion exact */
+#define AMP_MIN         (-0x8000 - 1.0)
+#define AMP_MAX         (0x7FFF + 1.0)
+
+/************************************/
+
+static TCA_SSE2 void xor8_sse2(void *buf, int len, unsigned int mask)
+{
+    uint8_t *ptr = buf;
+    __m128i m = _mm_set1_epi8(mask);
+    int i;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m128i *p = (__m128i *)(ptr+i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), m));
+    }
+    xor8_c(ptr+i, len-i, mask);
+}
+
+static TCA_SSE2 void xor16_sse2(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    __m128i m = _mm_set1_epi16(mask);
+    int i;
+
+    for (i = 0; i+8 <= len; i += 8) {
+        __m128i *p = (__m128i *)(ptr+i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), m));
+    }
+    xor16_c(ptr+i, len-i, mask);
+}
+
+static TCA_SSE2 void swap16_sse2(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    __m128i m = _mm_set1_epi16(mask);
+    int i;
+
+    for (i = 0; i+8 <= len; i += 8) {
+        __m128i *p = (__m128i *)(ptr+i);
+        __m128i x = _mm_loadu_si128(p);
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128(p, _mm_xor_si128(x, m));
+    }
+    swap16_c(ptr+i, len-i, mask);
+}
+
+/* Amplify two samples (the low two int32 lanes of `v'), returning the
+ * floor()ed results in the low two lanes.  SSE2 has no floor, so truncate
+ * and then subtract one where that rounded up. */
+static inline TCA_SSE2 __m128i amplify2_sse2(__m128i v, __m128d scale)
+{
+    __m128d d = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(v), scale),
+                           _mm_set1_pd(0.5));
+    __m128i t, up;
+
+    d = _mm_min_pd(_mm_max_pd(d, _mm_set1_pd(AMP_MIN)),
+                   _mm_set1_pd(AMP_MAX));
+    t = _mm_cvttpd_epi32(d);
+    up = _mm_castpd_si128(_mm_cmpgt_pd(_mm_cvtepi32_pd(t), d));
+    return _mm_add_epi32(t, _mm_shuffle_epi32(up, _MM_SHUFFLE(3,3,2,0)));
+}
+
+static TCA_SSE2 int amplify16_sse2(void *buf, int len, double scale)
+{
+    int16_t *ptr = buf;
+    __m128d vscale = _mm_set1_pd(scale);
+    __m128i max = _mm_set1_epi32(0x7FFF), min = _mm_set1_epi32(-0x8000);
+    __m128i nclip = _mm_setzero_si128();
+    int32_t counts[4];
+    int i;
+
+    for (i = 0; i+8 <= len; i += 8) {
+        __m128i *p = (__m128i *)(ptr+i);
+        __m128i x = _mm_loadu_si128(p), r[2];
+        int j;
+        for (j = 0; j < 2; j++) {
+            __m128i v = _mm_srai_epi32(j ? _mm_unpackhi_epi16(x, x)
+                                         : _mm_unpacklo_epi16(x, x), 16);
+            r[j] = _mm_unpacklo_epi64(
+                amplify2_sse2(v, vscale),
+                amplify2_sse2(_mm_shuffle_epi32(v, _MM_SHUFFLE(3,2,3,2)),
+                              vscale));
+            nclip = _mm_sub_epi32(nclip,
+                                  _mm_or_si128(_mm_cmpgt_epi32(r[j], max),
+                                               _mm_cmplt_epi32(r[j], min)));
+        }
+        _mm_storeu_si128(p, _mm_packs_epi32(r[0], r[1]));
+    }
+    _mm_storeu_si128((__m128i *)counts, nclip);
+    return counts[0] + counts[1] + counts[2] + counts[3]
+         + amplify16_c(ptr+i, len-i, scale);
+}
+
+static TCA_SSE2 void mono_to_stereo8_sse2(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = len-16; i >= 0; i -= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(ptr+i));
+        _mm_storeu_si128((__m128i *)(ptr+i*2), _mm_unpacklo_epi8(x, x));
+        _mm_storeu_si128((__m128i *)(ptr+i*2+16), _mm_unpackhi_epi8(x, x));
+    }
+    mono_to_stereo8_c(ptr, i+16);
+}
+
+static TCA_SSE2 void mono_to_stereo16_sse2(void *buf, int len)
+{
+    uint16_t *ptr = buf;
+    int i;
+
+    for (i = len-8; i >= 0; i -= 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(ptr+i));
+        _mm_storeu_si128((__m128i *)(ptr+i*2), _mm_unpacklo_epi16(x, x));
+        _mm_storeu_si128((__m128i *)(ptr+i*2+8), _mm_unpackhi_epi16(x, x));
+    }
+    mono_to_stereo16_c(ptr, i+8);
+}
+
+/* Average the even and odd bytes of `x' as 16-bit values */
+static inline TCA_SSE2 __m128i mix8_sse2(__m128i x)
+{
+    return _mm_avg_epu16(_mm_and_si128(x, _mm_set1_epi16(0xFF)),
+                         _mm_srli_epi16(x, 8));
+}
+
+static TCA_SSE2 void stereo_to_mono8_sse2(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(ptr+i*2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(ptr+i*2+16));
+        _mm_storeu_si128((__m128i *)(ptr+i),
+                         _mm_packus_epi16(mix8_sse2(a), mix8_sse2(b)));
+    }
+    for (; i < len; i++)
+        ptr[i] = ((int)ptr[i*2] + (int)ptr[i*2+1] + 1) / 2;
+}
+
+/* Compute (a+b+1)/2, rounding towards zero like C, for each pair of
+ * 16-bit samples in `x' */
+static inline TCA_SSE2 __m128i mix16_sse2(__m128i x)
+{
+    __m128i s = _mm_add_epi32(_mm_madd_epi16(x, _mm_set1_epi16(1)),
+                              _mm_set1_epi32(1));
+    return _mm_srai_epi32(_mm_add_epi32(s, _mm_srli_epi32(s, 31)), 1);
+}
+
+static TCA_SSE2 void stereo_to_mono16_sse2(void *buf, int len)
+{
+    int16_t *ptr = buf;
+    int i;
+
+    for (i = 0; i+8 <= len; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(ptr+i*2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(ptr+i*2+8));
+        _mm_storeu_si128((__m128i *)(ptr+i),
+                         _mm_packs_epi32(mix16_sse2(a), mix16_sse2(b)));
+    }
+    for (; i < len; i++)
+        ptr[i] = ((int32_t)ptr[i*2] + (int32_t)ptr[i*2+1] + 1) / 2;
+}
+
+/************************************/
+
+static TCA_AVX2 void xor8_avx2(void *buf, int len, unsigned int mask)
+{
+    uint8_t *ptr = buf;
+    __m256i m = _mm256_set1_epi8(mask);
+    int i;
+
+    for (i = 0; i+32 <= len; i += 32) {
+        __m256i *p = (__m256i *)(ptr+i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), m));
+    }
+    xor8_c(ptr+i, len-i, mask);
+}
+
+static TCA_AVX2 void xor16_avx2(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    __m256i m = _mm256_set1_epi16(mask);
+    int i;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m256i *p = (__m256i *)(ptr+i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), m));
+    }
+    xor16_c(ptr+i, len-i, mask);
+}
+
+static TCA_AVX2 void swap16_avx2(void *buf, int len, unsigned int mask)
+{
+    uint16_t *ptr = buf;
+    __m256i m = _mm256_set1_epi16(mask);
+    __m256i order = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+                                     9, 8, 11, 10, 13, 12, 15, 14,
+                                     1, 0, 3, 2, 5, 4, 7, 6,
+                                     9, 8, 11, 10, 13, 12, 15, 14);
+    int i;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m256i *p = (__m256i *)(ptr+i);
+        __m256i x = _mm256_shuffle_epi8(_mm256_loadu_si256(p), order);
+        _mm256_storeu_si256(p, _mm256_xor_si256(x, m));
+    }
+    swap16_c(ptr+i, len-i, mask);
+}
+
+/* Amplify four samples, returning the clamped and floor()ed results */
+static inline TCA_AVX2 __m128i amplify4_avx2(__m128i v, __m256d scale)
+{
+    __m256d d = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(v), scale),
+                              _mm256_set1_pd(0.5));
+
+    d = _mm256_floor_pd(d);
+    d = _mm256_min_pd(_mm256_max_pd(d, _mm256_set1_pd(AMP_MIN)),
+                      _mm256_set1_pd(AMP_MAX));
+    return _mm256_cvttpd_epi32(d);
+}
+
+static TCA_AVX2 int amplify16_avx2(void *buf, int len, double scale)
+{
+    int16_t *ptr = buf;
+    __m256d vscale = _mm256_set1_pd(scale);
+    __m256i max = _mm256_set1_epi32(0x7FFF);
+    __m256i min = _mm256_set1_epi32(-0x8000);
+    __m256i nclip = _mm256_setzero_si256();
+    int32_t counts[8];
+    int i, j;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m256i *p = (__m256i *)(ptr+i);
+        __m256i x = _mm256_loadu_si256(p), r[2];
+        for (j = 0; j < 2; j++) {
+            __m256i v = _mm256_cvtepi16_epi32(j ? _mm256_extracti128_si256(x, 1)
+                                                : _mm256_castsi256_si128(x));
+            r[j] = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(
+                    amplify4_avx2(_mm256_castsi256_si128(v), vscale)),
+                amplify4_avx2(_mm256_extracti128_si256(v, 1), vscale), 1);
+            nclip = _mm256_sub_epi32(
+                nclip, _mm256_or_si256(_mm256_cmpgt_epi32(r[j], max),
+                                       _mm256_cmpgt_epi32(min, r[j])));
+        }
+        _mm256_storeu_si256(p, _mm256_permute4x64_epi64(
+                                   _mm256_packs_epi32(r[0], r[1]),
+                                   _MM_SHUFFLE(3,1,2,0)));
+    }
+    _mm256_storeu_si256((__m256i *)counts, nclip);
+    return counts[0] + counts[1] + counts[2] + counts[3] + counts[4]
+         + counts[5] + counts[6] + counts[7]
+         + amplify16_c(ptr+i, len-i, scale);
+}
+
+static TCA_AVX2 void mono_to_stereo8_avx2(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = len-32; i >= 0; i -= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(ptr+i));
+        __m256i lo = _mm256_unpacklo_epi8(x, x);
+        __m256i hi = _mm256_unpackhi_epi8(x, x);
+        _mm256_storeu_si256((__m256i *)(ptr+i*2),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(ptr+i*2+32),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    mono_to_stereo8_c(ptr, i+32);
+}
+
+static TCA_AVX2 void mono_to_stereo16_avx2(void *buf, int len)
+{
+    uint16_t *ptr = buf;
+    int i;
+
+    for (i = len-16; i >= 0; i -= 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(ptr+i));
+        __m256i lo = _mm256_unpacklo_epi16(x, x);
+        __m256i hi = _mm256_unpackhi_epi16(x, x);
+        _mm256_storeu_si256((__m256i *)(ptr+i*2),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(ptr+i*2+16),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    mono_to_stereo16_c(ptr, i+16);
+}
+
+static inline TCA_AVX2 __m256i mix8_avx2(__m256i x)
+{
+    return _mm256_avg_epu16(_mm256_and_si256(x, _mm256_set1_epi16(0xFF)),
+                            _mm256_srli_epi16(x, 8));
+}
+
+static TCA_AVX2 void stereo_to_mono8_avx2(void *buf, int len)
+{
+    uint8_t *ptr = buf;
+    int i;
+
+    for (i = 0; i+32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(ptr+i*2));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(ptr+i*2+32));
+        _mm256_storeu_si256((__m256i *)(ptr+i), _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16(mix8_avx2(a),
+                                                    mix8_avx2(b)),
+                                _MM_SHUFFLE(3,1,2,0)));
+    }
+    for (; i < len; i++)
+        ptr[i] = ((int)ptr[i*2] + (int)ptr[i*2+1] + 1) / 2;
+}
+
+static inline TCA_AVX2 __m256i mix16_avx2(__m256i x)
+{
+    __m256i s = _mm256_add_epi32(_mm256_madd_epi16(x, _mm256_set1_epi16(1)),
+                                 _mm256_set1_epi32(1));
+    return _mm256_srai_epi32(_mm256_add_epi32(s, _mm256_srli_epi32(s, 31)),
+                             1);
+}
+
+static TCA_AVX2 void stereo_to_mono16_avx2(void *buf, int len)
+{
+    int16_t *ptr = buf;
+    int i;
+
+    for (i = 0; i+16 <= len; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(ptr+i*2));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(ptr+i*2+16));
+        _mm256_storeu_si256((__m256i *)(ptr+i), _mm256_permute4x64_epi64(
+                                _mm256_packs_epi32(mix16_avx2(a),
+                                                   mix16_avx2(b)),
+                                _MM_SHUFFLE(3,1,2,0)));
+    }
+    for (; i < len; i++)
+        ptr[i] = ((int32_t)ptr[i*2] + (int32_t)ptr[i*2+1] + 1) / 2;
+}
+
+#endif  /* ARCH_X86 || ARCH_X86_64 */
+
+/************************************/
+
+/* Available kernel sets, best first; the last one is always usable */
+static const TCAKernels tca_kernels[] = {
+#ifdef TCA_SIMD
+    { AC_AVX2, xor8_avx2, xor16_avx2, swap16_avx2, amplify16_avx2,
+      mono_to_stereo8_avx2, mono_to_stereo16_avx2,
+      stereo_to_mono8_avx2, stereo_to_mono16_avx2 },
+    { AC_SSE2, xor8_sse2, xor16_sse2, swap16_sse2, amplify16_sse2,
+      mono_to_stereo8_sse2, mono_to_stereo16_sse2,
+      stereo_to_mono8_sse2, stereo_to_mono16_sse2 },
+#endif
+    { AC_NONE, xor8_c, xor16_c, swap16_c, amplify16_c,
+      mono_to_stereo8_c, mono_to_stereo16_c,
+      stereo_to_mono8_c, stereo_to_mono16_c },
+};
+
+/*************************************************************************/
+
+/**
+ * tca_select_conversion:  Choose the kernel for converting between two
+ * sample formats, if there is one.
+ *
+ * Parameters:    conv: Conversion entry to fill in.
+ *             kernels: Kernel set to use.
+ *              srcfmt: Format of source audio samples.
+ *             destfmt: Format to convert audio samples into.
+ * Return value: None.
+ * Preconditions: srcfmt and destfmt are valid formats
+ * Postconditions: None.
+ */
+
+static void tca_select_conversion(TCAConversion *conv,
+                                  const TCAKernels *kernels,
+                                  AudioFormat srcfmt, AudioFormat destfmt)
+{
+    int src_bits = -1, src_issigned = -1, src_msbfirst = -1,
+        dest_bits = -1, dest_issigned = -1, dest_msbfirst = -1;
+
+    tca_get_format_info(srcfmt, &src_bits, &src_issigned, &src_msbfirst);
+    tca_get_format_info(destfmt, &dest_bits, &dest_issigned, &dest_msbfirst);
+    conv->func = NULL;
+    conv->mask = 0;
+    if (src_bits != dest_bits)
+        return;  /* resizing is left to tca_convert() */
+
+    /* The mask flips the most significant bit of each target sample,
+     * as seen in native byte order */
+    if (src_issigned != dest_issigned) {
+        if (dest_bits == 8)
+            conv->mask = 0x80;
+        else
+            conv->mask = (dest_msbfirst == NATIVE_MSBFIRST) ? 0x8000 : 0x80;
+    }
+    if (dest_bits == 8)
+        conv->func = conv->mask ? kernels->xor8 : convert_none;
+    else if (src_msbfirst != dest_msbfirst)
+        conv->func = kernels->swap16;
+    else
+        conv->func = conv->mask ? kernels->xor16 : convert_none;
+}
+
+/*************************************************************************/
+
+/**
+ * tca_select:  Choose the processing kernels for a new handle, based on
+ * its sample format and the acceleration flags enabled in aclib.
+ *
+ * Parameters: handle: tcaudio handle, with the format fields set.
+ * Return value: None.
+ * Preconditions: handle != 0
+ * Postconditions: None.
+ */
+
+static void tca_select(TCAHandle handle)
+{
+    const TCAKernels *kernels = tca_kernels;
+    int accel = ac_getaccel();
+    int fmt;
+
+    while ((accel & kernels->accel) != kernels->accel)
+        kernels++;
+
+    for (fmt = TCA_S8; fmt < TCA_NFORMATS; fmt++) {
+        tca_select_conversion(&handle->convert_from[fmt], kernels,
+                              fmt, handle->format);
+        tca_select_conversion(&handle->convert_to[fmt], kernels,
+                              handle->format, fmt);
+    }
+    handle->amplify        = NULL;
+    handle->mono_to_stereo = NULL;
+    handle->stereo_to_mono = NULL;
+    if (handle->bits == 8) {
+        handle->mono_to_stereo = kernels->mono_to_stereo8;
+        handle->stereo_to_mono = kernels->stereo_to_mono8;
+    } else if (handle->bits == 16) {
+        handle->mono_to_stereo = kernels->mono_to_stereo16;
+        if (handle->msbfirst == NATIVE_MSBFIRST) {
+            handle->stereo_to_mono = kernels->stereo_to_mono16;
+            if (handle->issigned)
+                handle->amplify = kernels->amplify16;
+        }
+    }
+}
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -242,6 +242,12 @@ struct tcmoduleclass_ {
  *             `configure' operation.
  *      'help': will return a formatted, human-readable string
  *              with module overview, tunable options and explanation.
+ *      Video encoder modules can also support the optional
+ *      'intra': will return "1" if, as configured, every encoded
+ *               frame depends only on the matching raw frame, so
+ *               the core can encode frames in parallel using many
+ *               instances of the module. Anything else (or no answer)
+ *               means "no".
  * Parameters:
  *      self: pointer to module instance to inspect.
  *      param: name of parameter to inspect
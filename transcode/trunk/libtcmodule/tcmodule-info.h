@@ -45,6 +45,10 @@
 #define TC_MODULE_FEATURE_VIDEO         0x00010000
 #define TC_MODULE_FEATURE_AUDIO         0x00020000
 #define TC_MODULE_FEATURE_EXTRA         0x00040000
+/* capabilities */
+#define TC_MODULE_FEATURE_SLICE         0x00100000
+/* (filter) module can process disjoint bands of rows of the same
+ * video frame concurrently (see TC_FILTER_OLDINTERFACE_SLICE) */
 
 #define TC_MODULE_FLAG_NONE             0x00000000
 #define TC_MODULE_FLAG_RECONFIGURABLE   0x00000001
@@ -223,6 +223,21 @@ const TCModuleClass *tc_plugin_setup(void);
 
 
 
+/*
+ * Companion of TC_FILTER_OLDINTERFACE for filters advertising
+ * TC_MODULE_FEATURE_SLICE. Exports the entry point the core uses
+ * to run the filter over a band of rows of a video frame, possibly
+ * from many threads at once on the same frame.
+ * Requires a name_process_slice(self, frame, first_row, num_rows)
+ * function which, like name_process, must check frame->tag itself.
+ */
+#define TC_FILTER_OLDINTERFACE_SLICE(name) \
+    int tc_filter_slice(frame_list_t *frame, int first_row, int num_rows) \
+    { \
+        return name ## _process_slice(&mod, frame, first_row, num_rows); \
+    }
+
+
 #define TC_FILTER_OLDINTERFACE_INSTANCES	128
 
 /* FIXME:
@@ -166,13 +166,15 @@ void tc_module_info_log(const TCModuleInfo *info, int verbose)
         if (info->features == TC_MODULE_FEATURE_NONE) {
             strlcpy(buffer, "nothing (this shouldn't happen!", sizeof(buffer));
         } else {
-            tc_snprintf(buffer, sizeof(buffer), "%s%s%s",
+            tc_snprintf(buffer, sizeof(buffer), "%s%s%s%s",
                         (info->features & TC_MODULE_FEATURE_FILTER)
                             ?"filtering " :"",
                         (info->features & TC_MODULE_FEATURE_ENCODE)
                             ?"encoding " :"",
                         (info->features & TC_MODULE_FEATURE_MULTIPLEX)
-                            ?"multiplexing" :"");
+                            ?"multiplexing " :"",
+                        (info->features & TC_MODULE_FEATURE_SLICE)
+                            ?"slicing" :"");
         }
         tc_log_info(info->name, "can do     : %s", buffer);
 
@@ -20,6 +20,18 @@
 
 /*************************************************************************/
 
+/* SIMD versions of the per-pixel loops are written with compiler
+ * intrinsics, compiled for their instruction set whatever the compiler
+ * flags, and only called if ac_getaccel() allows it. */
+#if (defined(ARCH_X86) || defined(ARCH_X86_64)) \
+ && (defined(__clang__) || __GNUC__ > 4 \
+     || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define TCV_SIMD
+# include <immintrin.h>
+# define TCV_SSE2       __attribute__((target("sse2")))
+# define TCV_AVX2       __attribute__((target("avx2")))
+#endif
+
 #ifndef PI
 # ifdef M_PI
 #  define PI M_PI
@@ -63,12 +75,20 @@ struct tcvhandle_ {
     /* ZoomInfo cache */
     struct {
         int old_w, old_h, new_w, new_h, Bpp, ilace;
+        int old_stride, new_stride;
         TCVZoomFilter filter;
         ZoomInfo *zi;
+        unsigned int last_used;  /* zoominfo_clock at last use */
     } zoominfo_cache[ZOOMINFO_CACHE_SIZE];
+    unsigned int zoominfo_clock;
+    /* Function to process images in parallel bands (NULL if none) */
+    TCVSliceRunner slice_runner;
     /* Buffer and buffer size for tcv_convert() */
     uint8_t *convert_buffer;
     uint32_t convert_buffer_size;
+    /* Line buffer and buffer size for in-place tcv_deinterlace() */
+    uint8_t *deint_buffer;
+    uint32_t deint_buffer_size;
 };
 
 /*************************************************************************/
@@ -96,7 +116,9 @@ static void init_aa_table(TCVHandle handle, double aa_weight, double aa_bias);
  * use different gamma or antialiasing values, you will get improved
  * performance by using separate handles for each set of values.  (However,
  * tcv_zoom() can cache lookup tables for multiple sets of image sizes,
- * currently 10 sets.)
+ * currently 10 sets.)  A handle must not be used by several threads at
+ * the same time, since it holds temporary buffers; see
+ * tcv_set_slice_runner() for multithreaded processing of an image.
  *
  * Parameters: None.
  * Return value: A handle to be passed to other tcvideo functions, or 0 on
@@ -136,12 +158,39 @@ void tcv_free(TCVHandle handle)
             if (handle->zoominfo_cache[i].zi)
                 zoom_free(handle->zoominfo_cache[i].zi);
         }
+        free(handle->convert_buffer);
+        free(handle->deint_buffer);
         free(handle);
     }
 }
 
 /*************************************************************************/
 
+/**
+ * tcv_set_slice_runner:  Set the function used to split the processing
+ * of an image into bands of rows run by several threads (currently by
+ * tcv_zoom(), tcv_gamma_correct() and tcv_antialias()).  The runner is
+ * called as runner(func, data, rows) and must call func(data, first,
+ * count) for disjoint bands covering rows 0..rows-1, returning only
+ * when all of them are done; it returns zero (without calling `func') if
+ * it can't split the work, in which case the calling thread processes
+ * all rows by itself.
+ *
+ * Parameters: handle: tcvideo handle.
+ *             runner: Slice runner function, or NULL for none (default).
+ * Return value: None.
+ * Preconditions: handle != 0: handle was returned by tcv_init()
+ * Postconditions: None.
+ */
+
+void tcv_set_slice_runner(TCVHandle handle, TCVSliceRunner runner)
+{
+    if (handle)
+        handle->slice_runner = runner;
+}
+
+/*************************************************************************/
+
 /**
  * tcv_clip:  Clip the given image by removing the specified number of
  * pixels from each edge.  If a clip value is negative, instead expands the
@@ -267,7 +316,8 @@ int tcv_clip(TCVHandle handle,
  *                        dest[0]..dest[width*(height/2)*Bpp-1] are writable
  *                    mode != TCV_DEINTERLACE_DROP_FIELD_{TOP,BOTTOM}:
  *                        dest[0]..dest[width*height*Bpp-1] are writable
- *                src != dest: src and dest do not overlap
+ *                src == dest || src and dest do not overlap (src == dest
+ *                    deinterlaces in place)
  * Postconditions: (on success)
  *                     mode == TCV_DEINTERLACE_DROP_FIELD_{TOP,BOTTOM}:
  *                         dest[0]..dest[width*(height/2)*Bpp-1] are set
@@ -279,8 +329,8 @@ static int deint_drop_field(uint8_t *src, uint8_t *dest, int width,
                             int height, int Bpp, int drop_top);
 static int deint_interpolate(uint8_t *src, uint8_t *dest, int width,
                              int height, int Bpp);
-static int deint_linear_blend(uint8_t *src, uint8_t *dest, int width,
-                              int height, int Bpp);
+static int deint_linear_blend(TCVHandle handle, uint8_t *src,
+                              uint8_t *dest, int width, int height, int Bpp);
 
 int tcv_deinterlace(TCVHandle handle,
                     uint8_t *src, uint8_t *dest, int width, int height,
@@ -298,7 +348,7 @@ int tcv_deinterlace(TCVHandle handle,
       case TCV_DEINTERLACE_INTERPOLATE:
         return deint_interpolate(src, dest, width, height, Bpp);
       case TCV_DEINTERLACE_LINEAR_BLEND:
-        return deint_linear_blend(src, dest, width, height, Bpp);
+        return deint_linear_blend(handle, src, dest, width, height, Bpp);
       default:
         tc_log_error("libtcvideo", "tcv_deinterlace: invalid mode %d!", mode);
         return 0;
@@ -310,18 +360,14 @@ int tcv_deinterlace(TCVHandle handle,
  * functions for tcv_deinterlace() that implement the individual
  * deinterlacing methods.
  *
- * Parameters: As for tcv_deinterlace(), less `handle'.
+ * Parameters: As for tcv_deinterlace() (deint_linear_blend() only).
  * Return value: As for tcv_deinterlace().
- * Side effects: (for deint_linear_blend())
- *                   src[0..width*height-1] are destroyed.
- * Preconditions: As for tcv_deinterlace(), less `handle', plus:
+ * Preconditions: As for tcv_deinterlace(), plus:
  *                src != NULL
  *                dest != NULL
  *                width > 0
  *                height > 0
  *                Bpp == 1 || Bpp == 3
- *                (for deint_linear_blend())
- *                    src[0..width*height-1] are writable
  * Postconditions: As for tcv_deinterlace().
  */
 
@@ -333,11 +379,99 @@ static int deint_drop_field(uint8_t *src, uint8_t *dest, int width,
 
     if (drop_top)
         src += Bpl;
-    for (y = 0; y < height/2; y++)
-        ac_memcpy(dest + y*Bpl, src + (y*2)*Bpl, Bpl);
+    for (y = 0; y < height/2; y++) {
+        /* Line y is only overwritten after line y*2 has been read */
+        if (dest + y*Bpl != src + (y*2)*Bpl)
+            ac_memcpy(dest + y*Bpl, src + (y*2)*Bpl, Bpl);
+    }
     return 1;
 }
 
+/************************************/
+
+/* Row loop for the linear blend deinterlacer: sets `dest0' and `dest1'
+ * to the vertically blended lines `cur0' and `cur1' (lines in prev, cur0,
+ * cur1, next order):
+ *     dest0 = avg(cur0, avg(prev, cur1))
+ *     dest1 = avg(cur1, avg(cur0, next))
+ * and copies the original `cur1' to `save' unless it is NULL.  avg()
+ * rounds up, as ac_average() does.  Each source line is read once, and
+ * every block of pixels is read before it is written, so the destination
+ * lines may be the same as the source ones. */
+
+typedef void (*BlendRowsFunc)(const uint8_t *prev, const uint8_t *cur0,
+                              const uint8_t *cur1, const uint8_t *next,
+                              uint8_t *dest0, uint8_t *dest1, uint8_t *save,
+                              int bytes);
+
+#define AVG(a,b)  (((a) + (b) + 1) >> 1)
+
+static void blend_rows_c(const uint8_t *prev, const uint8_t *cur0,
+                         const uint8_t *cur1, const uint8_t *next,
+                         uint8_t *dest0, uint8_t *dest1, uint8_t *save,
+                         int bytes)
+{
+    int i;
+
+    for (i = 0; i < bytes; i++) {
+        int p = prev[i], c0 = cur0[i], c1 = cur1[i], n = next[i];
+        dest0[i] = AVG(c0, AVG(p, c1));
+        dest1[i] = AVG(c1, AVG(c0, n));
+        if (save)
+            save[i] = c1;
+    }
+}
+
+#undef AVG
+
+#ifdef TCV_SIMD
+
+#define BLEND_KERNELS(name,TARGET,VEC,N,LOAD,STORE,AVG)                 \
+static TARGET void blend_rows_##name(const uint8_t *prev,               \
+                                     const uint8_t *cur0,               \
+                                     const uint8_t *cur1,               \
+                                     const uint8_t *next,               \
+                                     uint8_t *dest0, uint8_t *dest1,    \
+                                     uint8_t *save, int bytes)          \
+{                                                                       \
+    int i;                                                              \
+                                                                        \
+    for (i = 0; i+N <= bytes; i += N) {                                 \
+        VEC p  = LOAD((const VEC *)(prev+i));                           \
+        VEC c0 = LOAD((const VEC *)(cur0+i));                           \
+        VEC c1 = LOAD((const VEC *)(cur1+i));                           \
+        VEC n  = LOAD((const VEC *)(next+i));                           \
+        STORE((VEC *)(dest0+i), AVG(c0, AVG(p, c1)));                   \
+        STORE((VEC *)(dest1+i), AVG(c1, AVG(c0, n)));                   \
+        if (save)                                                       \
+            STORE((VEC *)(save+i), c1);                                 \
+    }                                                                   \
+    blend_rows_c(prev+i, cur0+i, cur1+i, next+i, dest0+i, dest1+i,      \
+                 save ? save+i : NULL, bytes-i);                        \
+}
+
+BLEND_KERNELS(sse2, TCV_SSE2, __m128i, 16, _mm_loadu_si128,
+              _mm_storeu_si128, _mm_avg_epu8)
+BLEND_KERNELS(avx2, TCV_AVX2, __m256i, 32, _mm256_loadu_si256,
+              _mm256_storeu_si256, _mm256_avg_epu8)
+
+#undef BLEND_KERNELS
+
+#endif  /* TCV_SIMD */
+
+/* Available row loops, best first; the last one is always usable */
+static const struct {
+    int accel;                  /* Required acceleration flags */
+    BlendRowsFunc blend_rows;
+} blend_kernels[] = {
+#ifdef TCV_SIMD
+    { AC_AVX2, blend_rows_avx2 },
+    { AC_SSE2, blend_rows_sse2 },
+#endif
+    { AC_NONE, blend_rows_c },
+};
+
+/************************************/
 
 static int deint_interpolate(uint8_t *src, uint8_t *dest, int width,
                              int height, int Bpp)
@@ -347,7 +481,9 @@ static int deint_interpolate(uint8_t *src, uint8_t *dest, int width,
 
     for (y = 0; y < height; y++) {
         if (y%2 == 0) {
-            ac_memcpy(dest + y*Bpl, src + y*Bpl, Bpl);
+            /* even lines are kept (nothing to do when working in place) */
+            if (src != dest)
+                ac_memcpy(dest + y*Bpl, src + y*Bpl, Bpl);
         } else if (y == height-1) {
             /* if the last line is odd, copy from the previous line */
             ac_memcpy(dest + y*Bpl, src + (y-1)*Bpl, Bpl);
@@ -359,27 +495,54 @@ static int deint_interpolate(uint8_t *src, uint8_t *dest, int width,
 }
 
 
-static int deint_linear_blend(uint8_t *src, uint8_t *dest, int width,
-                              int height, int Bpp)
+static int deint_linear_blend(TCVHandle handle, uint8_t *src,
+                              uint8_t *dest, int width, int height, int Bpp)
 {
+    BlendRowsFunc blend_rows;
     int Bpl = width * Bpp;
-    int y;
-
-    /* First interpolate odd lines into the target buffer */
-    if (!deint_interpolate(src, dest, width, height, Bpp))
-        return 0;
-
-    /* Now interpolate even lines in the source buffer; we don't use it
-     * after this so it's okay to destroy it */
-    ac_memcpy(src, src+Bpl, Bpl);
-    for (y = 2; y < height-1; y += 2)
-        ac_average(src + (y-1)*Bpl, src + (y+1)*Bpl, src + y*Bpl, Bpl);
-    if (y < height)
-        ac_memcpy(src + y*Bpl, src + (y-1)*Bpl, Bpl);
-
-    /* Finally average the two frames together */
-    ac_average(src, dest, dest, height*Bpl);
+    const uint8_t *prev;
+    uint8_t *save = NULL;
+    int accel = ac_getaccel(), i, y;
+
+    /* Each line is blended with the average of its neighbors; at the top
+     * and bottom edges the one neighbor stands in for the missing one.
+     * This gives the same result as interpolating the odd lines and the
+     * even lines separately, then averaging the two frames. */
+    if (height < 2) {
+        if (src != dest)
+            ac_memcpy(dest, src, Bpl * height);
+        return 1;
+    }
+    if (src == dest) {
+        /* The line above the current pair is overwritten by the time we
+         * need it, so keep a copy */
+        if (!handle->deint_buffer || handle->deint_buffer_size < Bpl) {
+            free(handle->deint_buffer);
+            handle->deint_buffer = tc_malloc(Bpl);
+            if (!handle->deint_buffer) {
+                handle->deint_buffer_size = 0;
+                return 0;
+            }
+            handle->deint_buffer_size = Bpl;
+        }
+        save = handle->deint_buffer;
+    }
 
+    i = 0;
+    while ((accel & blend_kernels[i].accel) != blend_kernels[i].accel)
+        i++;
+    blend_rows = blend_kernels[i].blend_rows;
+    prev = src + Bpl;
+    for (y = 0; y+1 < height; y += 2) {
+        const uint8_t *next = src + (y+2 < height ? y+2 : y) * Bpl;
+        (*blend_rows)(prev, src + y*Bpl, src + (y+1)*Bpl, next,
+                      dest + y*Bpl, dest + (y+1)*Bpl, save, Bpl);
+        prev = save ? save : src + (y+1)*Bpl;
+    }
+    if (y < height) {
+        /* Odd height: avg(cur, avg(prev, prev)) */
+        ac_average(prev, src + y*Bpl, dest + y*Bpl, Bpl);
+    }
     return 1;
 }
 
@@ -553,13 +716,52 @@ static inline void rescale_pixel(const uint8_t *src1, const uint8_t *src2,
 int tcv_zoom(TCVHandle handle,
              uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
              int new_w, int new_h, TCVZoomFilter filter)
+{
+    return tcv_zoom_stride(handle, src, dest, width, height, Bpp, width*Bpp,
+                           new_w, new_h, filter);
+}
+
+/*************************************************************************/
+
+/**
+ * tcv_zoom_stride:  Like tcv_zoom(), but reads the source image with the
+ * given line stride, so that a region of a larger image (or every n'th
+ * line of an image) can be zoomed without first being copied out.
+ *
+ * Parameters:     handle: tcvideo handle.
+ *                    src: Pointer to the first pixel of the source image.
+ *                   dest: Destination data plane.
+ *                  width: Width of source image.
+ *                 height: Height of source image.
+ *                    Bpp: Bytes (not bits!) per pixel.
+ *             src_stride: Bytes from one source line to the next.
+ *                  new_w: New frame width.
+ *                  new_h: New frame height (negative for interlaced mode,
+ *                         as for tcv_zoom()).
+ *                 filter: Filter type (TCV_ZOOM_*).
+ * Return value: Nonzero on success, zero on error (invalid parameters).
+ * Preconditions: handle != 0: handle was returned by tcv_init()
+ *                src != NULL: src[y*src_stride+x] is readable for
+ *                    0 <= y < height, 0 <= x < width*Bpp
+ *                src_stride >= width*Bpp
+ *                dest != NULL: dest[0]..dest[new_w*new_h*Bpp-1] are writable
+ *                src != dest: src and dest do not overlap
+ * Postconditions: (on success) dest[0]..dest[new_w*new_h*Bpp-1] are set
+ */
+
+int tcv_zoom_stride(TCVHandle handle,
+                    uint8_t *src, uint8_t *dest, int width, int height,
+                    int Bpp, int src_stride, int new_w, int new_h,
+                    TCVZoomFilter filter)
 {
     ZoomInfo *zi;
-    int free_zi = 0;  // Should the ZoomInfo be freed after use?
     int interlace_mode = 0;
+    int old_stride, new_stride;
     int i;
 
-    if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)) {
+    if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)
+     || src_stride < width*Bpp
+    ) {
         tc_log_error("libtcvideo", "tcv_zoom: invalid frame parameters!");
         return 0;
     }
@@ -592,29 +794,40 @@ int tcv_zoom(TCVHandle handle,
         return 0;
     }
 
+    old_stride = src_stride;
+    new_stride = new_w * Bpp;
+    if (interlace_mode) {
+        old_stride *= 2;
+        new_stride *= 2;
+    }
+
+    /* Look for a cached ZoomInfo; if there is none, replace the least
+     * recently used one, so that the lookup tables and the temporary
+     * buffer are never rebuilt for every frame */
+    handle->zoominfo_clock++;
     for (i = 0, zi = NULL; i < ZOOMINFO_CACHE_SIZE && zi == NULL; i++) {
-        if (handle->zoominfo_cache[i].zi     != NULL
-         && handle->zoominfo_cache[i].old_w  == width
-         && handle->zoominfo_cache[i].old_h  == height
-         && handle->zoominfo_cache[i].new_w  == new_w
-         && handle->zoominfo_cache[i].new_h  == new_h
-         && handle->zoominfo_cache[i].Bpp    == Bpp
-         && handle->zoominfo_cache[i].ilace  == interlace_mode
-         && handle->zoominfo_cache[i].filter == filter
+        if (handle->zoominfo_cache[i].zi         != NULL
+         && handle->zoominfo_cache[i].old_w      == width
+         && handle->zoominfo_cache[i].old_h      == height
+         && handle->zoominfo_cache[i].new_w      == new_w
+         && handle->zoominfo_cache[i].new_h      == new_h
+         && handle->zoominfo_cache[i].Bpp        == Bpp
+         && handle->zoominfo_cache[i].ilace      == interlace_mode
+         && handle->zoominfo_cache[i].old_stride == old_stride
+         && handle->zoominfo_cache[i].new_stride == new_stride
+         && handle->zoominfo_cache[i].filter     == filter
         ) {
             zi = handle->zoominfo_cache[i].zi;
+            handle->zoominfo_cache[i].last_used = handle->zoominfo_clock;
         }
     }
     if (!zi) {
         int ilace_height = height;
         int ilace_new_h = new_h;
-        int old_stride = width * Bpp;
-        int new_stride = new_w * Bpp;
+        int slot = 0;
         if (interlace_mode) {
             ilace_height /= 2;
             ilace_new_h /= 2;
-            old_stride *= 2;
-            new_stride *= 2;
         }
         zi = zoom_init(width, ilace_height, new_w, ilace_new_h, Bpp,
                        old_stride, new_stride, filter);
@@ -622,27 +835,33 @@ int tcv_zoom(TCVHandle handle,
             tc_log_error("libtcvideo", "tcv_zoom: zoom_init() failed!");
             return 0;
         }
-        free_zi = 1;
         for (i = 0; i < ZOOMINFO_CACHE_SIZE; i++) {
             if (!handle->zoominfo_cache[i].zi) {
-                handle->zoominfo_cache[i].zi     = zi;
-                handle->zoominfo_cache[i].old_w  = width;
-                handle->zoominfo_cache[i].old_h  = height;
-                handle->zoominfo_cache[i].new_w  = new_w;
-                handle->zoominfo_cache[i].new_h  = new_h;
-                handle->zoominfo_cache[i].Bpp    = Bpp;
-                handle->zoominfo_cache[i].ilace  = interlace_mode;
-                handle->zoominfo_cache[i].filter = filter;
-                free_zi = 0;
+                slot = i;
                 break;
             }
+            if (handle->zoominfo_cache[i].last_used
+                < handle->zoominfo_cache[slot].last_used)
+                slot = i;
         }
+        if (handle->zoominfo_cache[slot].zi)
+            zoom_free(handle->zoominfo_cache[slot].zi);
+        handle->zoominfo_cache[slot].zi         = zi;
+        handle->zoominfo_cache[slot].old_w      = width;
+        handle->zoominfo_cache[slot].old_h      = height;
+        handle->zoominfo_cache[slot].new_w      = new_w;
+        handle->zoominfo_cache[slot].new_h      = new_h;
+        handle->zoominfo_cache[slot].Bpp        = Bpp;
+        handle->zoominfo_cache[slot].ilace      = interlace_mode;
+        handle->zoominfo_cache[slot].old_stride = old_stride;
+        handle->zoominfo_cache[slot].new_stride = new_stride;
+        handle->zoominfo_cache[slot].filter     = filter;
+        handle->zoominfo_cache[slot].last_used  = handle->zoominfo_clock;
     }
-    zoom_process(zi, src, dest);
+    zoom_process(zi, src, dest, handle->slice_runner);
     if (interlace_mode)
-        zoom_process(zi, src + width*Bpp, dest + new_w*Bpp);
-    if (free_zi)
-        zoom_free(zi);
+        zoom_process(zi, src + src_stride, dest + new_w*Bpp,
+                     handle->slice_runner);
     return 1;
 }
 
@@ -828,15 +1047,98 @@ int tcv_flip_h(TCVHandle handle,
  * Preconditions: handle != 0: handle was returned by tcv_init()
  *                src != NULL: src[0]..src[width*height*Bpp-1] are readable
  *                dest != NULL: dest[0]..dest[width*height*Bpp-1] are writable
- *                src != dest: src and dest do not overlap
+ *                src == dest || src and dest do not overlap
  * Postconditions: (on success) dest[0]..dest[width*height*Bpp-1] are set
  */
 
+/* Function to look up `bytes' bytes from `src' in the 256-entry `table',
+ * storing the results in `dest' (which may be the same as `src'). */
+
+typedef void (*GammaBytesFunc)(const uint8_t *table, const uint8_t *src,
+                               uint8_t *dest, int bytes);
+
+static void gamma_bytes_c(const uint8_t *table, const uint8_t *src,
+                          uint8_t *dest, int bytes)
+{
+    int i;
+
+    for (i = 0; i < bytes; i++)
+        dest[i] = table[src[i]];
+}
+
+#ifdef TCV_SIMD
+
+/* The table is held in registers as 16 blocks of 16 entries, and each
+ * source byte is looked up in every block with a byte shuffle.  Before
+ * the shuffle, the byte is XORed with the block's high nibble and 0x70
+ * is added with saturation: this leaves the low nibble alone, and sets
+ * the top bit (for which the shuffle gives zero) unless the byte falls
+ * within the block, so ORing the 16 results gives the table entry. */
+
+static TCV_AVX2 void gamma_bytes_avx2(const uint8_t *table,
+                                      const uint8_t *src, uint8_t *dest,
+                                      int bytes)
+{
+    __m256i blocks[16];
+    const __m256i bias = _mm256_set1_epi8(0x70);
+    int i, k;
+
+    for (k = 0; k < 16; k++) {
+        blocks[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(table + k*16)));
+    }
+    for (i = 0; i+32 <= bytes; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(src+i));
+        __m256i out = _mm256_setzero_si256();
+        for (k = 0; k < 16; k++) {
+            __m256i index = _mm256_adds_epu8(
+                _mm256_xor_si256(in, _mm256_set1_epi8(k<<4)), bias);
+            out = _mm256_or_si256(out,
+                                  _mm256_shuffle_epi8(blocks[k], index));
+        }
+        _mm256_storeu_si256((__m256i *)(dest+i), out);
+    }
+    gamma_bytes_c(table, src+i, dest+i, bytes-i);
+}
+
+#endif  /* TCV_SIMD */
+
+/* Available lookup loops, best first; the last one is always usable.
+ * (Byte shuffles need SSSE3, which aclib doesn't detect separately, so
+ * there is no SSE2 version.) */
+static const struct {
+    int accel;                  /* Required acceleration flags */
+    GammaBytesFunc gamma_bytes;
+} gamma_kernels[] = {
+#ifdef TCV_SIMD
+    { AC_AVX2, gamma_bytes_avx2 },
+#endif
+    { AC_NONE, gamma_bytes_c },
+};
+
+/* Data for correcting a band of rows (see tcv_set_slice_runner()) */
+struct gammajob {
+    GammaBytesFunc gamma_bytes;
+    const uint8_t *table;
+    const uint8_t *src;
+    uint8_t *dest;
+    int Bpl;                    /* Bytes per line */
+};
+
+static void gamma_rows(void *data, int first, int count)
+{
+    const struct gammajob *job = data;
+
+    (*job->gamma_bytes)(job->table, job->src + first * job->Bpl,
+                        job->dest + first * job->Bpl, count * job->Bpl);
+}
+
 int tcv_gamma_correct(TCVHandle handle,
                       uint8_t *src, uint8_t *dest, int width, int height,
                       int Bpp, double gamma)
 {
-    int i;
+    struct gammajob job;
+    int accel = ac_getaccel(), i;
 
     if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)) {
         tc_log_error("libtcvideo", "tcv_gamma: invalid frame parameters!");
@@ -848,8 +1150,19 @@ int tcv_gamma_correct(TCVHandle handle,
     }
 
     init_gamma_table(handle, gamma);
-    for (i = 0; i < width*height*Bpp; i++)
-        dest[i] = handle->gamma_table[src[i]];
+    i = 0;
+    while ((accel & gamma_kernels[i].accel) != gamma_kernels[i].accel)
+        i++;
+    job.gamma_bytes = gamma_kernels[i].gamma_bytes;
+    job.table = handle->gamma_table;
+    job.src = src;
+    job.dest = dest;
+    job.Bpl = width * Bpp;
+    if (!handle->slice_runner
+     || !(*handle->slice_runner)(gamma_rows, &job, height)
+    ) {
+        gamma_rows(&job, 0, height);
+    }
 
     return 1;
 }
@@ -875,14 +1188,64 @@ int tcv_gamma_correct(TCVHandle handle,
  * Postconditions: (on success) dest[0]..dest[width*height*Bpp-1] are set
  */
 
-static void antialias_line(TCVHandle handle,
-                           uint8_t *src, uint8_t *dest, int width, int Bpp);
+/* Function to antialias one line (not the first or last) of an image */
+
+typedef void (*AntialiasLineFunc)(TCVHandle handle, const uint8_t *src,
+                                  uint8_t *dest, int width, int Bpp);
+
+static void antialias_line(TCVHandle handle, const uint8_t *src,
+                           uint8_t *dest, int width, int Bpp);
+#ifdef TCV_SIMD
+static TCV_SSE2 void antialias_line_sse2(TCVHandle handle,
+                                         const uint8_t *src, uint8_t *dest,
+                                         int width, int Bpp);
+static TCV_AVX2 void antialias_line_avx2(TCVHandle handle,
+                                         const uint8_t *src, uint8_t *dest,
+                                         int width, int Bpp);
+#endif
+
+/* Available line loops, best first; the last one is always usable.  The
+ * SIMD versions only handle single-byte pixels (see below). */
+static const struct {
+    int accel;                  /* Required acceleration flags */
+    AntialiasLineFunc antialias_line;
+} antialias_kernels[] = {
+#ifdef TCV_SIMD
+    { AC_AVX2, antialias_line_avx2 },
+    { AC_SSE2, antialias_line_sse2 },
+#endif
+    { AC_NONE, antialias_line },
+};
+
+/* Data for antialiasing a band of rows (see tcv_set_slice_runner()) */
+struct antialiasjob {
+    TCVHandle handle;
+    AntialiasLineFunc antialias_line;
+    const uint8_t *src;
+    uint8_t *dest;
+    int width, Bpp;
+};
+
+/* Row `n' of the job is image line n+1, since the first and last lines
+ * are simply copied */
+static void antialias_rows(void *data, int first, int count)
+{
+    const struct antialiasjob *job = data;
+    int Bpl = job->width * job->Bpp;
+    int y;
+
+    for (y = first+1; y <= first+count; y++) {
+        (*job->antialias_line)(job->handle, job->src + y*Bpl,
+                               job->dest + y*Bpl, job->width, job->Bpp);
+    }
+}
 
 int tcv_antialias(TCVHandle handle,
                   uint8_t *src, uint8_t *dest, int width, int height,
                   int Bpp, double weight, double bias)
 {
-    int y;
+    struct antialiasjob job;
+    int accel = ac_getaccel(), i;
 
     if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)) {
         tc_log_error("libtcvideo", "tcv_antialias: invalid frame parameters!");
@@ -895,13 +1258,34 @@ int tcv_antialias(TCVHandle handle,
     }
 
     init_aa_table(handle, weight, bias);
+    i = 0;
+    if (Bpp == 1) {
+        while ((accel & antialias_kernels[i].accel)
+               != antialias_kernels[i].accel)
+            i++;
+    } else {
+        while (antialias_kernels[i].accel != AC_NONE)
+            i++;
+    }
+    job.handle = handle;
+    job.antialias_line = antialias_kernels[i].antialias_line;
+    job.src = src;
+    job.dest = dest;
+    job.width = width;
+    job.Bpp = Bpp;
+
     ac_memcpy(dest, src, width*Bpp);
-    for (y = 1; y < height-1; y++) {
-        antialias_line(handle, src + y*width*Bpp, dest + y*width*Bpp, width,
-                       Bpp);
+    if (height > 2) {
+        if (!handle->slice_runner
+         || !(*handle->slice_runner)(antialias_rows, &job, height-2)
+        ) {
+            antialias_rows(&job, 0, height-2);
+        }
+    }
+    if (height > 1) {
+        ac_memcpy(dest + (height-1)*width*Bpp, src + (height-1)*width*Bpp,
+                  width*Bpp);
     }
-    ac_memcpy(dest + (height-1)*width*Bpp, src + (height-1)*width*Bpp,
-              width*Bpp);
 
     return 1;
 }
@@ -909,7 +1293,8 @@ int tcv_antialias(TCVHandle handle,
 
 /* Helper functions: */
 
-static inline int samecolor(uint8_t *pixel1, uint8_t *pixel2, int Bpp)
+static inline int samecolor(const uint8_t *pixel1, const uint8_t *pixel2,
+                            int Bpp)
 {
     int i;
     int maxdiff = abs(pixel2[0]-pixel1[0]);
@@ -933,8 +1318,30 @@ static inline int samecolor(uint8_t *pixel1, uint8_t *pixel2, int Bpp)
 #define SAME(pix1,pix2) samecolor((pix1),(pix2),Bpp)
 #define DIFF(pix1,pix2) !samecolor((pix1),(pix2),Bpp)
 
-static void antialias_line(TCVHandle handle,
-                           uint8_t *src, uint8_t *dest, int width, int Bpp)
+/* Store the antialiased value of pixel `x' (which is known to be on an
+ * edge) in `dest' */
+static inline void antialias_pixel(TCVHandle handle, const uint8_t *src,
+                                   uint8_t *dest, int width, int Bpp, int x)
+{
+    int i;
+
+    for (i = 0; i < Bpp; i++) {
+        uint32_t tmp = handle->aa_table_d[UL[i]]
+                     + handle->aa_table_y[U [i]]
+                     + handle->aa_table_d[UR[i]]
+                     + handle->aa_table_x[L [i]]
+                     + handle->aa_table_c[C [i]]
+                     + handle->aa_table_x[R [i]]
+                     + handle->aa_table_d[DL[i]]
+                     + handle->aa_table_y[D [i]]
+                     + handle->aa_table_d[DR[i]]
+                     + 32768;
+        dest[x*Bpp+i] = (verbose & TC_DEBUG) ? 255 : tmp>>16;
+    }
+}
+
+static void antialias_line(TCVHandle handle, const uint8_t *src,
+                           uint8_t *dest, int width, int Bpp)
 {
     int i, x;
 
@@ -946,19 +1353,7 @@ static void antialias_line(TCVHandle handle,
          || (SAME(R,U) && DIFF(R,D) && DIFF(R,L))
          || (SAME(R,D) && DIFF(R,U) && DIFF(R,L))
         ) {
-            for (i = 0; i < Bpp; i++) {
-                uint32_t tmp = handle->aa_table_d[UL[i]]
-                             + handle->aa_table_y[U [i]]
-                             + handle->aa_table_d[UR[i]]
-                             + handle->aa_table_x[L [i]]
-                             + handle->aa_table_c[C [i]]
-                             + handle->aa_table_x[R [i]]
-                             + handle->aa_table_d[DL[i]]
-                             + handle->aa_table_y[D [i]]
-                             + handle->aa_table_d[DR[i]]
-                             + 32768;
-                dest[x*Bpp+i] = (verbose & TC_DEBUG) ? 255 : tmp>>16;
-            }
+            antialias_pixel(handle, src, dest, width, Bpp, x);
         } else {
             for (i = 0; i < Bpp; i++)
                 dest[x*Bpp+i] = src[x*Bpp+i];
@@ -968,6 +1363,95 @@ static void antialias_line(TCVHandle handle,
         dest[(width-1)*Bpp+i] = src[(width-1)*Bpp+i];
 }
 
+#ifdef TCV_SIMD
+
+/* With one byte per pixel, the edge test above simplifies to
+ *     DIFF(L,R) && (SAME(L,U) != SAME(L,D) || SAME(R,U) != SAME(R,D))
+ * which is evaluated for a whole vector of pixels at once without
+ * branches.  The pixels are copied to the destination, then the few that
+ * are on an edge (if any) are overwritten with their weighted averages,
+ * which still come from the lookup tables so that the results are the
+ * same as the C version's. */
+
+#define ANTIALIAS_KERNEL(name,TARGET,VEC,N,LOAD,STORE,SET1,ZERO,SUBS,OR,   \
+                         XOR,ANDNOT,CMPEQ,MOVEMASK)                     \
+static TARGET void antialias_line_##name(TCVHandle handle,              \
+                                         const uint8_t *src,            \
+                                         uint8_t *dest, int width,      \
+                                         int Bpp)                       \
+{                                                                       \
+    const VEC limit = SET1(AA_DIFFERENT-1);                             \
+    const VEC zero = ZERO();                                            \
+    int x;                                                              \
+                                                                        \
+    if (Bpp != 1) {                                                     \
+        antialias_line(handle, src, dest, width, Bpp);                  \
+        return;                                                         \
+    }                                                                   \
+    dest[0] = src[0];                                                   \
+    for (x = 1; x+N < width; x += N) {                                  \
+        VEC c = LOAD((const VEC *)(src+x));                             \
+        VEC l = LOAD((const VEC *)(src+x-1));                           \
+        VEC r = LOAD((const VEC *)(src+x+1));                           \
+        VEC u = LOAD((const VEC *)(src+x-width));                       \
+        VEC d = LOAD((const VEC *)(src+x+width));                       \
+        VEC same_lu, same_ld, same_ru, same_rd, same_lr, edge;          \
+        unsigned int bits;                                              \
+                                                                        \
+        /* a and b are the same color if |a-b| <= limit */              \
+        same_lu = CMPEQ(SUBS(OR(SUBS(l,u), SUBS(u,l)), limit), zero);   \
+        same_ld = CMPEQ(SUBS(OR(SUBS(l,d), SUBS(d,l)), limit), zero);   \
+        same_ru = CMPEQ(SUBS(OR(SUBS(r,u), SUBS(u,r)), limit), zero);   \
+        same_rd = CMPEQ(SUBS(OR(SUBS(r,d), SUBS(d,r)), limit), zero);   \
+        same_lr = CMPEQ(SUBS(OR(SUBS(l,r), SUBS(r,l)), limit), zero);   \
+        edge = ANDNOT(same_lr, OR(XOR(same_lu, same_ld),                \
+                                  XOR(same_ru, same_rd)));              \
+        STORE((VEC *)(dest+x), c);                                      \
+        bits = (unsigned int)MOVEMASK(edge);                            \
+        while (bits) {                                                  \
+            antialias_pixel(handle, src, dest, width, 1,                \
+                            x + __builtin_ctz(bits));                   \
+            bits &= bits-1;                                             \
+        }                                                               \
+    }                                                                   \
+    for (; x < width-1; x++) {                                          \
+        if (DIFF(L,R) && (SAME(L,U) != SAME(L,D)                        \
+                          || SAME(R,U) != SAME(R,D))) {                 \
+            antialias_pixel(handle, src, dest, width, 1, x);            \
+        } else {                                                        \
+            dest[x] = src[x];                                           \
+        }                                                               \
+    }                                                                   \
+    if (width > 1)                                                      \
+        dest[width-1] = src[width-1];                                   \
+}
+
+ANTIALIAS_KERNEL(sse2, TCV_SSE2, __m128i, 16, _mm_loadu_si128,
+                 _mm_storeu_si128, _mm_set1_epi8, _mm_setzero_si128,
+                 _mm_subs_epu8, _mm_or_si128, _mm_xor_si128,
+                 _mm_andnot_si128, _mm_cmpeq_epi8, _mm_movemask_epi8)
+ANTIALIAS_KERNEL(avx2, TCV_AVX2, __m256i, 32, _mm256_loadu_si256,
+                 _mm256_storeu_si256, _mm256_set1_epi8, _mm256_setzero_si256,
+                 _mm256_subs_epu8, _mm256_or_si256, _mm256_xor_si256,
+                 _mm256_andnot_si256, _mm256_cmpeq_epi8,
+                 _mm256_movemask_epi8)
+
+#undef ANTIALIAS_KERNEL
+
+#endif  /* TCV_SIMD */
+
+#undef C
+#undef U
+#undef D
+#undef L
+#undef R
+#undef UL
+#undef UR
+#undef DL
+#undef DR
+#undef SAME
+#undef DIFF
+
 /*************************************************************************/
 
 /**
@@ -1047,6 +1531,7 @@ int tcv_convert(TCVHandle handle, uint8_t *src, uint8_t *dest, int width,
 
     YUV_INIT_PLANES(srcplanes, src, srcfmt, width, height);
     YUV_INIT_PLANES(destplanes, realdest, destfmt, width, height);
+    /* ac_imgconvert() also handles pairs with no direct conversion */
     if (!ac_imgconvert(srcplanes, srcfmt, destplanes, destfmt, width, height))
         return 0;
 
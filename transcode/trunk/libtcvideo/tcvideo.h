@@ -45,12 +45,20 @@ typedef enum {
     TCV_ZOOM_MITCHELL,
 } TCVZoomFilter;
 
+/* Function processing `count' rows of a job starting from row `first',
+ * and function running a TCVSliceFunc over `rows' rows, possibly split
+ * in bands among several threads; see tcv_set_slice_runner(). */
+typedef void (*TCVSliceFunc)(void *data, int first, int count);
+typedef int (*TCVSliceRunner)(TCVSliceFunc func, void *data, int rows);
+
 /*************************************************************************/
 
 TCVHandle tcv_init(void);
 
 void tcv_free(TCVHandle handle);
 
+void tcv_set_slice_runner(TCVHandle handle, TCVSliceRunner runner);
+
 int tcv_clip(TCVHandle handle,
              uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
              int clip_left, int clip_right, int clip_top, int clip_bottom,
@@ -68,6 +76,11 @@ int tcv_zoom(TCVHandle handle,
              uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
              int new_w, int new_h, TCVZoomFilter filter);
 
+int tcv_zoom_stride(TCVHandle handle,
+                    uint8_t *src, uint8_t *dest, int width, int height,
+                    int Bpp, int src_stride, int new_w, int new_h,
+                    TCVZoomFilter filter);
+
 int tcv_reduce(TCVHandle handle,
                uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
                int reduce_w, int reduce_h);
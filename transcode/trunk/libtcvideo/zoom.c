@@ -30,6 +30,13 @@ struct clist {
     struct contrib *list;       /* Pointer to list of contributors */
 };
 
+/* Filter loops for one row, horizontal and vertical (see zoom_process());
+ * the vertical one returns the contributor list for the next row */
+typedef void (*ZoomXFunc)(const ZoomInfo *zi, const uint8_t *from,
+                          uint8_t *to);
+typedef const int32_t *(*ZoomYFunc)(const ZoomInfo *zi, const uint8_t *from,
+                                    uint8_t *to, const int32_t *contrib);
+
 /* Data for a resize operation */
 struct zoominfo {
     int old_w, old_h;           /* Original width and height */
@@ -41,7 +48,13 @@ struct zoominfo {
     double fwidth;              /* Filter width */
     int32_t *x_contrib;         /* Contributors in the horizontal direction */
     int32_t *y_contrib;         /* Contributors in the vertical direction */
+    int *y_index;               /* Offset of each row's list in y_contrib */
     uint8_t *tmpimage;          /* Temporary buffer */
+    int simd_width;             /* Output bytes per vector (0 = plain C) */
+    int taps_x, taps_y;         /* Contributors per pixel (padded, SIMD) */
+    int32_t *x_simd;            /* x_contrib in vector order (SIMD) */
+    ZoomXFunc zoom_x;           /* Horizontal filter loop */
+    ZoomYFunc zoom_y;           /* Vertical filter loop */
 };
 
 /* Convert a double to a 16.16 fixed-point value */
@@ -261,6 +274,330 @@ static struct clist *gen_contrib(int oldsize, int newsize, int stride,
 /*************************************************************************/
 /*************************************************************************/
 
+/* Filter loops.  Each output byte is the sum of its contributors in 16.16
+ * fixed point, starting from 0.5 for rounding, clamped to 0..255.
+ *
+ * The accelerated versions compute several output bytes at once using
+ * exactly the same 32-bit integer arithmetic, so their results are
+ * bit-identical to the C loops (which remain selected with --accel C,
+ * i.e. ac_init(AC_NONE), to check for regressions).  For them every
+ * contributor list is padded with zero-weight entries to a constant,
+ * even number of taps, so that the loops can be specialized on it.
+ * The horizontal contributors are further rearranged in `x_simd' as
+ * groups of `simd_width' output bytes: for each tap, `simd_width' source
+ * offsets followed by `simd_width' weights.
+ */
+
+/* clamp the input to the specified range */
+#define CLAMP(v,l,h)    ((v)<(l) ? (l) : (v) > (h) ? (h) : (v))
+
+static inline uint8_t zoom_pixel_y(const uint8_t *from,
+                                   const int32_t *contrib, int n)
+{
+    int32_t weight = DOUBLE_TO_FIXED(0.5);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        weight += from[contrib[i*2]] * contrib[i*2+1];
+    }
+    return CLAMP(FIXED_TO_INT(weight), 0, 255);
+}
+
+static void zoom_x_c(const ZoomInfo *zi, const uint8_t *from, uint8_t *to)
+{
+    const int32_t *contrib = zi->x_contrib;
+    int x;
+
+    for (x = 0; x < zi->new_w * zi->Bpp; x++) {
+        int32_t weight = DOUBLE_TO_FIXED(0.5);
+        int n = *contrib++, i;
+        for (i = 0; i < n; i++) {
+            int pixel = *contrib++;
+            weight += from[pixel] * (*contrib++);
+        }
+        to[x] = CLAMP(FIXED_TO_INT(weight), 0, 255);
+    }
+}
+
+static const int32_t *zoom_y_c(const ZoomInfo *zi, const uint8_t *from,
+                               uint8_t *to, const int32_t *contrib)
+{
+    int n = *contrib++, x;
+
+    for (x = 0; x < zi->new_w * zi->Bpp; x++) {
+        to[x] = zoom_pixel_y(from + x, contrib, n);
+    }
+    return contrib + 2*n;
+}
+
+/*************************************************************************/
+
+#if (defined(ARCH_X86) || defined(ARCH_X86_64)) \
+ && (defined(__clang__) || __GNUC__ > 4 \
+     || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+
+#define ZOOM_SIMD
+
+#include <immintrin.h>
+
+/* The kernels are compiled for their instruction set whatever the
+ * compiler flags, and only called if ac_getaccel() allows it. */
+#define ZOOM_AVX2       __attribute__((target("avx2")))
+#define ZOOM_AVX512     __attribute__((target("avx512f")))
+#define ZOOM_INLINE     inline __attribute__((always_inline))
+
+/* Horizontal loops read 4 bytes from each source offset (gather), so
+ * they may touch up to 3 bytes past the end of the source row: they are
+ * never used for the last row of the image, see zoom_process(). */
+
+/************************************/
+
+/* Store 8 sums as clamped bytes */
+static ZOOM_INLINE ZOOM_AVX2 void store_avx2(uint8_t *to, __m256i sum)
+{
+    __m256i v = _mm256_srai_epi32(sum, 16);
+    __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v),
+                                _mm256_extracti128_si256(v, 1));
+    _mm_storel_epi64((__m128i *)to, _mm_packus_epi16(w, w));
+}
+
+static ZOOM_INLINE ZOOM_AVX2 void zoom_x_avx2(const ZoomInfo *zi,
+                                              const uint8_t *from,
+                                              uint8_t *to, int taps)
+{
+    const __m256i round = _mm256_set1_epi32(DOUBLE_TO_FIXED(0.5));
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const int32_t *contrib = zi->x_simd;
+    int nbytes = zi->new_w * zi->Bpp, x, t;
+
+    for (x = 0; x < nbytes; x += 8) {
+        __m256i sum = round;
+        for (t = 0; t < taps; t++, contrib += 16) {
+            __m256i index  = _mm256_loadu_si256((const __m256i *)contrib);
+            __m256i weight = _mm256_loadu_si256((const __m256i *)(contrib+8));
+            __m256i pixel  = _mm256_i32gather_epi32((const int *)from,
+                                                    index, 1);
+            pixel = _mm256_and_si256(pixel, mask);
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(pixel, weight));
+        }
+        if (x + 8 <= nbytes) {
+            store_avx2(to + x, sum);
+        } else {
+            uint8_t buf[8];
+            store_avx2(buf, sum);
+            memcpy(to + x, buf, nbytes - x);
+        }
+    }
+}
+
+static ZOOM_INLINE ZOOM_AVX2 const int32_t *zoom_y_avx2(const ZoomInfo *zi,
+                                                        const uint8_t *from,
+                                                        uint8_t *to,
+                                                        const int32_t *contrib,
+                                                        int taps)
+{
+    const __m256i round = _mm256_set1_epi32(DOUBLE_TO_FIXED(0.5));
+    int nbytes = zi->new_w * zi->Bpp, x = 0, t;
+
+    contrib++;  /* always `taps' contributors */
+    for (; x + 16 <= nbytes; x += 16) {
+        __m256i sum0 = round, sum1 = round;
+        for (t = 0; t < taps; t++) {
+            __m256i weight = _mm256_set1_epi32(contrib[t*2+1]);
+            __m128i pixels = _mm_loadu_si128((const __m128i *)
+                                             (from + x + contrib[t*2]));
+            __m256i p0 = _mm256_cvtepu8_epi32(pixels);
+            __m256i p1 = _mm256_cvtepu8_epi32(_mm_srli_si128(pixels, 8));
+            sum0 = _mm256_add_epi32(sum0, _mm256_mullo_epi32(p0, weight));
+            sum1 = _mm256_add_epi32(sum1, _mm256_mullo_epi32(p1, weight));
+        }
+        store_avx2(to + x, sum0);
+        store_avx2(to + x + 8, sum1);
+    }
+    for (; x < nbytes; x++) {
+        to[x] = zoom_pixel_y(from + x, contrib, taps);
+    }
+    return contrib + 2*taps;
+}
+
+/************************************/
+
+/* Store 16 sums as clamped bytes (only the first `n') */
+static ZOOM_INLINE ZOOM_AVX512 void store_avx512(uint8_t *to, __m512i sum,
+                                                 int n)
+{
+    __m512i v = _mm512_srai_epi32(sum, 16);
+    v = _mm512_max_epi32(v, _mm512_setzero_si512());
+    v = _mm512_min_epi32(v, _mm512_set1_epi32(255));
+    _mm512_mask_cvtepi32_storeu_epi8(to, (__mmask16)((1U << n) - 1), v);
+}
+
+static ZOOM_INLINE ZOOM_AVX512 void zoom_x_avx512(const ZoomInfo *zi,
+                                                  const uint8_t *from,
+                                                  uint8_t *to, int taps)
+{
+    const __m512i round = _mm512_set1_epi32(DOUBLE_TO_FIXED(0.5));
+    const __m512i mask = _mm512_set1_epi32(0xFF);
+    const int32_t *contrib = zi->x_simd;
+    int nbytes = zi->new_w * zi->Bpp, x, t;
+
+    for (x = 0; x < nbytes; x += 16) {
+        __m512i sum = round;
+        for (t = 0; t < taps; t++, contrib += 32) {
+            __m512i index  = _mm512_loadu_si512(contrib);
+            __m512i weight = _mm512_loadu_si512(contrib + 16);
+            __m512i pixel  = _mm512_i32gather_epi32(index, from, 1);
+            pixel = _mm512_and_si512(pixel, mask);
+            sum = _mm512_add_epi32(sum, _mm512_mullo_epi32(pixel, weight));
+        }
+        store_avx512(to + x, sum, (nbytes - x < 16) ? nbytes - x : 16);
+    }
+}
+
+static ZOOM_INLINE ZOOM_AVX512 const int32_t *zoom_y_avx512(const ZoomInfo *zi,
+                                                            const uint8_t *from,
+                                                            uint8_t *to,
+                                                            const int32_t *contrib,
+                                                            int taps)
+{
+    const __m512i round = _mm512_set1_epi32(DOUBLE_TO_FIXED(0.5));
+    int nbytes = zi->new_w * zi->Bpp, x = 0, t;
+
+    contrib++;  /* always `taps' contributors */
+    for (; x + 32 <= nbytes; x += 32) {
+        __m512i sum0 = round, sum1 = round;
+        for (t = 0; t < taps; t++) {
+            const uint8_t *ptr = from + x + contrib[t*2];
+            __m512i weight = _mm512_set1_epi32(contrib[t*2+1]);
+            __m512i p0 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)ptr));
+            __m512i p1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(ptr+16)));
+            sum0 = _mm512_add_epi32(sum0, _mm512_mullo_epi32(p0, weight));
+            sum1 = _mm512_add_epi32(sum1, _mm512_mullo_epi32(p1, weight));
+        }
+        store_avx512(to + x, sum0, 16);
+        store_avx512(to + x + 16, sum1, 16);
+    }
+    for (; x < nbytes; x++) {
+        to[x] = zoom_pixel_y(from + x, contrib, taps);
+    }
+    return contrib + 2*taps;
+}
+
+/************************************/
+
+/* Instances of the loops for 2, 4, 6 and 8 taps, and for any (even)
+ * number of taps. */
+
+#define ZOOM_KERNELS(isa, ISA, name, taps_x, taps_y)                    \
+static ISA void zoom_x_##isa##_##name(const ZoomInfo *zi,               \
+                                      const uint8_t *from, uint8_t *to) \
+{                                                                       \
+    zoom_x_##isa(zi, from, to, taps_x);                                 \
+}                                                                       \
+static ISA const int32_t *zoom_y_##isa##_##name(const ZoomInfo *zi,     \
+                                                const uint8_t *from,    \
+                                                uint8_t *to,            \
+                                                const int32_t *contrib) \
+{                                                                       \
+    return zoom_y_##isa(zi, from, to, contrib, taps_y);                 \
+}
+
+ZOOM_KERNELS(avx2, ZOOM_AVX2, 2, 2, 2)
+ZOOM_KERNELS(avx2, ZOOM_AVX2, 4, 4, 4)
+ZOOM_KERNELS(avx2, ZOOM_AVX2, 6, 6, 6)
+ZOOM_KERNELS(avx2, ZOOM_AVX2, 8, 8, 8)
+ZOOM_KERNELS(avx2, ZOOM_AVX2, n, zi->taps_x, zi->taps_y)
+ZOOM_KERNELS(avx512, ZOOM_AVX512, 2, 2, 2)
+ZOOM_KERNELS(avx512, ZOOM_AVX512, 4, 4, 4)
+ZOOM_KERNELS(avx512, ZOOM_AVX512, 6, 6, 6)
+ZOOM_KERNELS(avx512, ZOOM_AVX512, 8, 8, 8)
+ZOOM_KERNELS(avx512, ZOOM_AVX512, n, zi->taps_x, zi->taps_y)
+
+#undef ZOOM_KERNELS
+
+/* Available kernels, best first */
+static const struct {
+    int accel;                  /* Required acceleration flag */
+    int width;                  /* Output bytes per vector */
+    ZoomXFunc zoom_x[5];        /* For 2, 4, 6, 8, any taps */
+    ZoomYFunc zoom_y[5];
+} zoom_kernels[] = {
+    { AC_AVX512, 16,
+      { zoom_x_avx512_2, zoom_x_avx512_4, zoom_x_avx512_6,
+        zoom_x_avx512_8, zoom_x_avx512_n },
+      { zoom_y_avx512_2, zoom_y_avx512_4, zoom_y_avx512_6,
+        zoom_y_avx512_8, zoom_y_avx512_n } },
+    { AC_AVX2, 8,
+      { zoom_x_avx2_2, zoom_x_avx2_4, zoom_x_avx2_6,
+        zoom_x_avx2_8, zoom_x_avx2_n },
+      { zoom_y_avx2_2, zoom_y_avx2_4, zoom_y_avx2_6,
+        zoom_y_avx2_8, zoom_y_avx2_n } },
+};
+
+#endif  /* ARCH_X86 || ARCH_X86_64 */
+
+/*************************************************************************/
+
+/**
+ * zoom_select:  Choose the filter loops for a ZoomInfo structure, based on
+ * the acceleration flags enabled in aclib.  Sets `simd_width' (0 if the
+ * plain C loops are used) and the `zoom_x'/`zoom_y' function pointers;
+ * the taps_x and taps_y fields must be already set.
+ *
+ * Parameters:
+ *     zi: ZoomInfo structure being initialized.
+ * Return value:
+ *     None.
+ */
+
+static void zoom_select(ZoomInfo *zi)
+{
+#ifdef ZOOM_SIMD
+    int accel = ac_getaccel(), i;
+
+    for (i = 0; i < sizeof(zoom_kernels) / sizeof(*zoom_kernels); i++) {
+        if (accel & zoom_kernels[i].accel) {
+            int ix = (zi->taps_x <= 8) ? zi->taps_x/2 - 1 : 4;
+            int iy = (zi->taps_y <= 8) ? zi->taps_y/2 - 1 : 4;
+            zi->simd_width = zoom_kernels[i].width;
+            zi->zoom_x = zoom_kernels[i].zoom_x[ix];
+            zi->zoom_y = zoom_kernels[i].zoom_y[iy];
+            return;
+        }
+    }
+#endif
+    zi->simd_width = 0;
+    zi->zoom_x = zoom_x_c;
+    zi->zoom_y = zoom_y_c;
+}
+
+/*************************************************************************/
+
+/**
+ * max_taps:  Return the number of taps needed to hold every contributor
+ * list of a direction, rounded up to an even number.
+ *
+ * Parameters:
+ *     contrib: Contributor lists returned by gen_contrib().
+ *        size: Number of lists.
+ * Return value:
+ *     The number of taps (at least 2).
+ */
+
+static int max_taps(const struct clist *contrib, int size)
+{
+    int i, taps = 2;
+
+    for (i = 0; i < size; i++) {
+        if (contrib[i].n > taps)
+            taps = contrib[i].n;
+    }
+    return (taps + 1) & ~1;
+}
+
+/*************************************************************************/
+/*************************************************************************/
+
 /* External interface. */
 
 /*************************************************************************/
@@ -345,6 +682,9 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
     /* Generate contributor lists and allocate temporary image buffer */
     zi->x_contrib = NULL;
     zi->y_contrib = NULL;
+    zi->y_index = NULL;
+    zi->x_simd = NULL;
+    zi->taps_x = zi->taps_y = 2;
     zi->tmpimage = tc_malloc(new_w * old_h * Bpp);
     if (!zi->tmpimage)
         goto error_out;
@@ -363,11 +703,21 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
             goto error_out;
     }
 
+    /* Choose the filter loops: accelerated ones need the contributor
+     * lists padded to a constant number of taps */
+    if (x_contrib)
+        zi->taps_x = max_taps(x_contrib, new_w);
+    if (y_contrib)
+        zi->taps_y = max_taps(y_contrib, new_h);
+    zoom_select(zi);
+
     /* Convert contributor lists into flat arrays and fixed-point values.
      * The flat array consists of a contributor count plus two values per
      * contributor (index and fixed-point weight) for each output pixel.
      * Note that for the horizontal direction, we make `Bpp' copies of the
-     * contributors, adjusting the offset for each byte of the pixel. */
+     * contributors, adjusting the offset for each byte of the pixel.
+     * Accelerated loops also get the vector-ordered horizontal array and
+     * padded vertical lists described above zoom_x_c(). */
 
     if (x_contrib) {
         int count = 0, i;
@@ -386,6 +736,30 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
                 *ptr++ = DOUBLE_TO_FIXED(x_contrib[i/Bpp].list[j].weight);
             }
         }
+        if (zi->simd_width) {
+            int width = zi->simd_width, taps = zi->taps_x;
+            int groups = (new_w*Bpp + width-1) / width;
+            zi->x_simd = tc_malloc(sizeof(int32_t) * groups*taps*width*2);
+            if (!zi->x_simd)
+                goto error_out;
+            for (i = 0; i < groups * width; i++) {
+                /* Padding bytes at the end just use pixel 0 */
+                const struct clist *cl = &x_contrib[i/Bpp];
+                int n = (i < new_w*Bpp) ? cl->n : 0;
+                int32_t *index = zi->x_simd + (i/width)*taps*width*2
+                                            + i%width;
+                int j;
+                for (j = 0; j < taps; j++, index += width*2) {
+                    if (j < n) {
+                        index[0] = cl->list[j].pixel + i%Bpp;
+                        index[width] = DOUBLE_TO_FIXED(cl->list[j].weight);
+                    } else {
+                        index[0] = (n > 0) ? cl->list[0].pixel + i%Bpp : 0;
+                        index[width] = 0;
+                    }
+                }
+            }
+        }
         /* Free original contributor list */
         for (i = 0; i < new_w; i++)
             free(x_contrib[i].list);
@@ -399,16 +773,24 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
 
         for (i = 0; i < new_h; i++)
             count += 1 + 2 * y_contrib[i].n;
+        if (zi->simd_width)
+            count = new_h * (1 + 2 * zi->taps_y);
         zi->y_contrib = tc_malloc(sizeof(int32_t) * count);
-        if (!zi->y_contrib)
+        zi->y_index = tc_malloc(sizeof(int) * new_h);
+        if (!zi->y_contrib || !zi->y_index)
             goto error_out;
         for (ptr = zi->y_contrib, i = 0; i < new_h; i++) {
-            int j;
-            *ptr++ = y_contrib[i].n;
+            int n = zi->simd_width ? zi->taps_y : y_contrib[i].n, j;
+            zi->y_index[i] = ptr - zi->y_contrib;
+            *ptr++ = n;
             for (j = 0; j < y_contrib[i].n; j++) {
                 *ptr++ = y_contrib[i].list[j].pixel;
                 *ptr++ = DOUBLE_TO_FIXED(y_contrib[i].list[j].weight);
             }
+            for (; j < n; j++) {
+                *ptr++ = y_contrib[i].list[0].pixel;
+                *ptr++ = 0;
+            }
         }
         for (i = 0; i < new_h; i++)
             free(y_contrib[i].list);
@@ -429,9 +811,9 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
         }
         if (y_contrib) {
             int i;
-            for (i = 0; i < new_w; i++)
-                free(x_contrib[i].list);
-            free(x_contrib);
+            for (i = 0; i < new_h; i++)
+                free(y_contrib[i].list);
+            free(y_contrib);
         }
         zoom_free(zi);
         return NULL;
@@ -440,86 +822,80 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
 
 /*************************************************************************/
 
+/* Arguments of one zoom_process() call, for the row band functions */
+struct zoomjob {
+    const ZoomInfo *zi;
+    const uint8_t *src;
+    uint8_t *dest;
+};
+
 /**
- * zoom_process:  Image resizing core.
+ * zoom_rows_x, zoom_rows_y:  Apply the horizontal filter to `count' rows
+ * of the source image from `first' (into the temporary buffer), or the
+ * vertical filter to `count' rows of the destination image from `first'.
+ * These are TCVSliceFunc functions, see zoom_process().
  *
  * Parameters:
- *       zi: ZoomInfo structure allocated by zoom_init().
- *      src: Source data plane.
- *     dest: Destination data plane.
+ *      data: Pointer to the struct zoomjob of the call.
+ *     first: First row to process.
+ *     count: Number of rows to process.
  * Return value: None.
- * Preconditions:
- *     zi was allocated by zoom_init()
- *     src != NULL
- *     dest != NULL
- *     src and dest do not overlap
  */
 
-/* clamp the input to the specified range */
-#define CLAMP(v,l,h)    ((v)<(l) ? (l) : (v) > (h) ? (h) : (v))
-
-void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest)
+static void zoom_rows_x(void *data, int first, int count)
 {
-    int from_stride, to_stride;
-    const uint8_t *from;
-    uint8_t *to;
+    const struct zoomjob *job = data;
+    const ZoomInfo *zi = job->zi;
+    int to_stride = zi->new_w * zi->Bpp;
+    const uint8_t *from = job->src + first * zi->old_stride;
+    uint8_t *to = zi->tmpimage + first * to_stride;
+    int y;
+
+    for (y = first; y < first + count;
+         y++, from += zi->old_stride, to += to_stride
+    ) {
+        /* Accelerated loops may read past the end of the row */
+        if (y < zi->old_h - 1) {
+            zi->zoom_x(zi, from, to);
+        } else {
+            zoom_x_c(zi, from, to);
+        }
+    }
+}
 
-    from = src;
-    from_stride = zi->old_stride;
+static void zoom_rows_y(void *data, int first, int count)
+{
+    const struct zoomjob *job = data;
+    const ZoomInfo *zi = job->zi;
+    const uint8_t *from = job->src;
+    int from_stride = zi->old_stride;
+    int to_stride = zi->new_stride;
+    uint8_t *to = job->dest + first * to_stride;
+    int y;
 
-    /* Apply filter to zoom horizontally from src to tmp (if necessary) */
     if (zi->x_contrib) {
-        int y;
-        to = zi->tmpimage;
-        to_stride = zi->new_w * zi->Bpp;
-        for (y = 0; y < zi->old_h; y++, from += from_stride, to += to_stride) {
-            int32_t *contrib = zi->x_contrib;
-            int x;
-            for (x = 0; x < zi->new_w * zi->Bpp; x++) {
-                int32_t weight = DOUBLE_TO_FIXED(0.5);
-                int n = *contrib++, i;
-                for (i = 0; i < n; i++) {
-                    int pixel = *contrib++;
-                    weight += from[pixel] * (*contrib++);
-                }
-                to[x] = CLAMP(FIXED_TO_INT(weight), 0, 255);
-            }
-        }
         from = zi->tmpimage;
-        from_stride = to_stride;
+        from_stride = zi->new_w * zi->Bpp;
     }
 
-    /* Apply filter to zoom vertically from tmp (or src) to dest */
-    /* Use Y as the outside loop to avoid cache thrashing on output buffer */
-    to = dest;
-    to_stride = zi->new_stride;
     if (zi->y_contrib) {
-        int32_t *contrib = zi->y_contrib;
-        int y;
-        for (y = 0; y < zi->new_h; y++, to += to_stride) {
-            int n = *contrib++, x;
-            for (x = 0; x < zi->new_w * zi->Bpp; x++) {
-                int32_t weight = DOUBLE_TO_FIXED(0.5);
-                int i;
-                for (i = 0; i < n; i++) {
-                    int pixel = contrib[i*2];
-                    weight += from[x+pixel] * contrib[i*2+1];
-                }
-                to[x] = CLAMP(FIXED_TO_INT(weight), 0, 255);
-            }
-            contrib += 2*n;
+        /* Use Y as the outside loop to avoid cache thrashing on output
+         * buffer */
+        const int32_t *contrib = zi->y_contrib + zi->y_index[first];
+        for (y = 0; y < count; y++, to += to_stride) {
+            contrib = zi->zoom_y(zi, from, to, contrib);
         }
     } else {
         /* No zooming necessary, just copy */
+        from += first * from_stride;
         if (from_stride == zi->new_w*zi->Bpp
          && to_stride == zi->new_w*zi->Bpp
         ) {
-            /* We can copy the whole frame at once */
-            ac_memcpy(to, from, to_stride * zi->new_h);
+            /* We can copy the whole band at once */
+            ac_memcpy(to, from, to_stride * count);
         } else {
             /* Copy one row at a time */
-            int y;
-            for (y = 0; y < zi->new_h; y++) {
+            for (y = 0; y < count; y++) {
                 ac_memcpy(to + y*to_stride, from + y*from_stride,
                           zi->new_w * zi->Bpp);
             }
@@ -529,6 +905,50 @@ void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest)
 
 /*************************************************************************/
 
+/**
+ * zoom_process:  Image resizing core.  The horizontal filter is applied
+ * first, then the vertical one; if `runner' is given, each pass is split
+ * into bands of rows which it can hand to other threads.
+ *
+ * Parameters:
+ *         zi: ZoomInfo structure allocated by zoom_init().
+ *        src: Source data plane.
+ *       dest: Destination data plane.
+ *     runner: Function to run the passes in parallel, or NULL.
+ * Return value: None.
+ * Preconditions:
+ *     zi was allocated by zoom_init()
+ *     src != NULL
+ *     dest != NULL
+ *     src and dest do not overlap
+ *     zi is not used by another zoom_process() call at the same time
+ *         (its temporary buffer is shared)
+ */
+
+void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest,
+                  TCVSliceRunner runner)
+{
+    struct zoomjob job;
+
+    job.zi = zi;
+    job.src = src;
+    job.dest = dest;
+
+    /* Apply filter to zoom horizontally from src to tmp (if necessary) */
+    if (zi->x_contrib) {
+        if (!runner || !(*runner)(zoom_rows_x, &job, zi->old_h))
+            zoom_rows_x(&job, 0, zi->old_h);
+    }
+
+    /* Apply filter to zoom vertically from tmp (or src) to dest; the
+     * horizontal pass must be complete, since bands of output rows
+     * overlap in the input */
+    if (!runner || !(*runner)(zoom_rows_y, &job, zi->new_h))
+        zoom_rows_y(&job, 0, zi->new_h);
+}
+
+/*************************************************************************/
+
 /**
  * zoom_free():  Free a ZoomInfo structure.
  *
@@ -545,6 +965,8 @@ void zoom_free(ZoomInfo *zi)
 {
     free(zi->x_contrib);
     free(zi->y_contrib);
+    free(zi->y_index);
+    free(zi->x_simd);
     free(zi->tmpimage);
     free(zi);
 }
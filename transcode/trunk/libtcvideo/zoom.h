@@ -19,8 +19,10 @@ typedef struct zoominfo ZoomInfo;
 ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
                     int old_stride, int new_stride, TCVZoomFilter filter);
 
-/* The resizing function itself. */
-void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest);
+/* The resizing function itself; `runner' (may be NULL) is used to
+ * process bands of rows in parallel. */
+void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest,
+                  TCVSliceRunner runner);
 
 /* Free a ZoomInfo structure. */
 void zoom_free(ZoomInfo *zi);
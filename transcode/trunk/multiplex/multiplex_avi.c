@@ -27,7 +27,7 @@
 #include "avilib/avilib.h"
 
 #define MOD_NAME    "multiplex_avi.so"
-#define MOD_VERSION "v0.0.2 (2005-12-29)"
+#define MOD_VERSION "v0.0.3 (2026-10-17)"
 #define MOD_CAP     "create an AVI stream using avilib"
 
 #define MOD_FEATURES \
@@ -40,6 +40,9 @@
 /* default FourCC to use if given one isn't known or if it's just absent */
 #define DEFAULT_FOURCC "RGB"
 
+/* chunks are collected in a buffer of this size and written together */
+#define WRITE_BUFFER_SIZE   (1024*1024)
+
 static const char avi_help[] = ""
     "Overview:\n"
     "    this module create an AVI stream using avilib.\n"
@@ -47,7 +50,8 @@ static const char avi_help[] = ""
     "    maximum of one audio and video track.\n"
     "    You can add more tracks with further processing.\n"
     "Options:\n"
-    "    help    produce module overview and options explanations\n";
+    "    prealloc  reserve this many megabytes of disk space for the file\n"
+    "    help      produce module overview and options explanations\n";
 
 typedef struct {
     avi_t *avifile;
@@ -66,11 +70,33 @@ static int avi_inspect(TCModuleInstance *self,
     return TC_OK;
 }
 
+/*
+ * expected_frames:  Return the number of frames which will be encoded
+ * according to the frame ranges given with -c, or 0 if that isn't known.
+ */
+
+static long expected_frames(const vob_t *vob)
+{
+    const struct fc_time *t;
+    long frames = 0;
+
+    for (t = vob->ttime; t != NULL; t = t->next) {
+        if (t->etf == TC_FRAME_LAST)
+            return 0;
+        frames += t->etf - t->stf;
+    }
+    if (vob->frame_interval > 1)
+        frames /= vob->frame_interval;
+    return frames;
+}
+
 static int avi_configure(TCModuleInstance *self,
                           const char *options, vob_t *vob)
 {
     const char *fcc = NULL;
     AVIPrivateData *pd = NULL;
+    long frames = expected_frames(vob);
+    int prealloc = 0;
     int arate = (vob->mp3frequency != 0)
                     ?vob->mp3frequency :vob->a_rate;
     int abitrate = (vob->ex_a_codec == TC_CODEC_PCM)
@@ -111,6 +137,25 @@ static int avi_configure(TCModuleInstance *self,
                   vob->ex_a_codec, abitrate);
     AVI_set_audio_vbr(pd->avifile, vob->a_vbr);
 
+    /* write small (audio) chunks in batches, and size the index up front
+     * (one video and one audio chunk per frame) */
+    if (AVI_set_write_buffer(pd->avifile, WRITE_BUFFER_SIZE) < 0) {
+        tc_log_warn(MOD_NAME, "can't allocate write buffer");
+    }
+    if (frames > 0) {
+        AVI_reserve_index(pd->avifile, frames * 2);
+    }
+    if (options && optstr_get(options, "prealloc", "%i", &prealloc) == 1
+     && prealloc > 0) {
+        if (AVI_reserve_space(pd->avifile,
+                              (int64_t)prealloc * 1024 * 1024) < 0) {
+            tc_log_warn(MOD_NAME, "can't preallocate %i MB for the file",
+                        prealloc);
+        } else if (verbose >= TC_DEBUG) {
+            tc_log_info(MOD_NAME, "preallocated %i MB", prealloc);
+        }
+    }
+
     return TC_OK;
 }
 
@@ -1564,6 +1564,78 @@ TC_OPTION(threads,            0,   "N",
                     goto short_usage;
                 }
 )
+TC_OPTION(encoder_threads,    0,   "N",
+                "encode N video frames in parallel (intra-only codecs) [1]",
+                max_encoder_threads = strtol(optarg, &optarg, 10);
+                if (*optarg
+                 || max_encoder_threads < 1
+                 || max_encoder_threads > TC_FRAME_THREADS_MAX
+                ) {
+                    tc_error("Invalid argument for --encoder_threads");
+                    goto short_usage;
+                }
+)
+TC_OPTION(import_threads,     0,   "N[:frames]",
+                "import video in N segments at a time (seekable sources) [1]",
+                max_import_threads = strtol(optarg, &optarg, 10);
+                if (*optarg == ':') {
+                    tc_import_segment = strtol(optarg+1, &optarg, 10);
+                    if (tc_import_segment < 1) {
+                        tc_error("Invalid segment size for --import_threads");
+                        goto short_usage;
+                    }
+                }
+                if (*optarg
+                 || max_import_threads < 1
+                 || max_import_threads > TC_FRAME_THREADS_MAX
+                ) {
+                    tc_error("Invalid argument for --import_threads");
+                    goto short_usage;
+                }
+)
+TC_OPTION(mplex_queue,        0,   "N",
+                "multiplex in a separate thread, queueing up to N frames [0]",
+                max_mplex_queue = strtol(optarg, &optarg, 10);
+                if (*optarg
+                 || max_mplex_queue < 0
+                 || max_mplex_queue > TC_MPLEX_QUEUE_MAX
+                ) {
+                    tc_error("Invalid argument for --mplex_queue");
+                    goto short_usage;
+                }
+)
+TC_OPTION(lockfree_buffers,   0,   0,
+                "use lock-free FIFOs in the framebuffer [off]",
+                tc_buffer_lockfree = TC_TRUE;
+)
+TC_OPTION(buffer_stats,       0,   0,
+                "collect and report framebuffer statistics [off]",
+                tc_buffer_stats = TC_TRUE;
+)
+TC_OPTION(frame_arena,        0,   "mode[:node]",
+                "carve frames from one block per buffer (on|huge) [off]",
+                char *sep = strchr(optarg, ':');
+                if (sep != NULL) {
+                    *sep++ = '\0';
+                    tc_buffer_node = strtol(sep, &sep, 10);
+                    if (*sep || tc_buffer_node < 0) {
+                        tc_error("Invalid NUMA node for --frame_arena");
+                        goto short_usage;
+                    }
+                }
+                if (strcmp(optarg, "on") == 0) {
+                    tc_buffer_arena = TC_FRAMEBUFFER_ARENA_ON;
+                } else if (strcmp(optarg, "huge") == 0) {
+                    tc_buffer_arena = TC_FRAMEBUFFER_ARENA_HUGE;
+                } else {
+                    tc_error("Invalid mode for --frame_arena");
+                    goto short_usage;
+                }
+)
+TC_OPTION(import_stats,       0,   0,
+                "report read() calls per imported frame [off]",
+                tc_import_stats = TC_TRUE;
+)
 TC_OPTION(progress_meter,     0,   "N",
                 "select type of progress meter [1]",
                 tc_progress_meter = strtol(optarg, &optarg, 0);
@@ -1621,9 +1693,16 @@ TC_OPTION(accel,              0,   "type[,type...]",
                         tc_accel |= AC_SSE2;
                     else if (strcasecmp(accel, "sse3"    ) == 0)
                         tc_accel |= AC_SSE3;
+                    else if (strcasecmp(accel, "avx"     ) == 0)
+                        tc_accel |= AC_AVX;
+                    else if (strcasecmp(accel, "avx2"    ) == 0)
+                        tc_accel |= AC_AVX2;
+                    else if (strcasecmp(accel, "avx512"  ) == 0)
+                        tc_accel |= AC_AVX512;
                     else {
                         tc_error("bad --accel type, valid types: C asm"
-                                 " mmx mmxext 3dnow 3dnowext sse sse2 sse3");
+                                 " mmx mmxext 3dnow 3dnowext sse sse2 sse3"
+                                 " avx avx2 avx512");
                         goto short_usage;
                     }
                     accel = comma;
@@ -36,6 +36,8 @@
 #include "probe.h"
 #include "synchronizer.h"
 
+#include "libtc/tcpipe.h"
+
 
 /*************************************************************************/
 
@@ -50,10 +52,21 @@ enum {
 };
 
 
+/* read() accounting of the stream import path (see --import_stats) */
+typedef struct tcimportiostats_ TCImportIOStats;
+struct tcimportiostats_ {
+    long frames;                /* frames read from the stream      */
+    long reads;                 /* read() calls issued              */
+    long legacy;                /* estimate for the old 4 kB loop   */
+    uint64_t bytes;             /* payload read                     */
+};
+
 typedef struct tcdecoderdata_ TCDecoderData;
 struct tcdecoderdata_ {
     const char *tag;            /* audio or video? used for logging */
     FILE *fd;                   /* for stream import                */
+    TCImportIOStats io;         /* stream import counters           */
+    int (*import)(int opt, void *para1, void *para2); /* module     */
     int bytes;                  /* XXX                              */
     vob_t *vob;                 /* XXX                              */
     void *im_handle;            /* import module handle             */
@@ -68,6 +81,7 @@ struct tcdecoderdata_ {
 static TCDecoderData video_decdata = {
     .tag         = "video",
     .fd          = NULL,
+    .import      = tcv_import,
     .im_handle   = NULL,
     .active_flag = 0,
     .thread_id   = (pthread_t)0,
@@ -77,6 +91,7 @@ static TCDecoderData video_decdata = {
 static TCDecoderData audio_decdata = {
     .tag         = "audio",
     .fd          = NULL,
+    .import      = tca_import,
     .im_handle   = NULL,
     .active_flag = 0,
     .thread_id   = (pthread_t)0,
@@ -153,30 +168,81 @@ static int check_module_caps(const transfer_t *param, int codec,
 }
 
 /*************************************************************************/
-/*                  optimized block-wise fread                           */
+/*                  optimized whole-frame fread                          */
 /*************************************************************************/
 
-#ifdef PIPE_BUF
-#define BLOCKSIZE PIPE_BUF /* 4096 on linux-x86 */
-#else
-#define BLOCKSIZE 4096
-#endif
+/*
+ * Frames were once read in PIPE_BUF (4 kB) blocks; now the whole
+ * remainder of the frame is asked for on every call, so a frame takes
+ * just a few read()s as long as the pipe holds enough data (see
+ * import_setup_stream). LEGACY_BLOCKSIZE is kept for --import_stats,
+ * which compares the read()s actually issued with an estimate of the
+ * old ones: that is computed from the frame size, not measured, and is
+ * a lower bound, since the old loop could get short reads too.
+ */
+#define LEGACY_BLOCKSIZE 4096
 
-static int mfread(uint8_t *buf, int size, int nelem, FILE *f)
+static int mfread(uint8_t *buf, int size, int nelem, FILE *f,
+                  TCImportIOStats *io)
 {
     int fd = fileno(f);
-    int n = 0, r1 = 0, r2 = 0;
-    while (n < size*nelem-BLOCKSIZE) {
-        if ( !(r1 = read (fd, &buf[n], BLOCKSIZE))) return 0;
-        n += r1;
-    }
-    while (size*nelem-n) {
-        if ( !(r2 = read (fd, &buf[n], size*nelem-n)))return 0;
-        n += r2;
+    ssize_t r = 0;
+    size_t n = 0, len = (size_t)size * nelem;
+
+    while (n < len) {
+        r = read(fd, buf + n, len - n);
+        io->reads++;
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return 0;
+        }
+        n += r;
     }
+    io->frames++;
+    io->bytes  += len;
+    io->legacy += (len + LEGACY_BLOCKSIZE - 1) / LEGACY_BLOCKSIZE;
     return nelem;
 }
 
+/*
+ * import_setup_stream:  prepare a stream opened by an import module
+ * for mfread(): if it is a pipe, enlarge it to hold a whole frame, so
+ * that can be transferred with a single read(). Unprivileged processes
+ * are limited by /proc/sys/fs/pipe-max-size (1 MB by default), so for
+ * big frames we settle with TC_PIPE_SIZE.
+ *
+ * Parameters:
+ *      decdata: decoder data holding the stream.
+ *        bytes: size of the frames which will be read from the stream.
+ * Return Value:
+ *      None.
+ */
+static void import_setup_stream(TCDecoderData *decdata, int bytes)
+{
+#if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+    struct stat st;
+    int fd, size = TC_MAX(bytes, TC_PIPE_SIZE);
+
+    if (decdata->fd == NULL) {
+        return;
+    }
+    fd = fileno(decdata->fd);
+    if (fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) {
+        return;
+    }
+    if (fcntl(fd, F_GETPIPE_SZ) < size
+     && fcntl(fd, F_SETPIPE_SZ, size) < 0 && size > TC_PIPE_SIZE) {
+        fcntl(fd, F_SETPIPE_SZ, TC_PIPE_SIZE);
+    }
+    if (verbose >= TC_DEBUG) {
+        tc_log_msg(__FILE__, "%s import pipe size: %i bytes",
+                   decdata->tag, fcntl(fd, F_GETPIPE_SZ));
+    }
+#endif
+}
+
 /*************************************************************************/
 /*               some macro goodies                                      */
 /*************************************************************************/
@@ -310,6 +376,7 @@ static int tc_import_video_open(vob_t *vob)
     }
 
     video_decdata.fd = import_para.fd;
+    import_setup_stream(&video_decdata, vob->im_v_size);
 
     return TC_OK;
 }
@@ -331,6 +398,7 @@ static int tc_import_audio_open(vob_t *vob)
     }
 
     audio_decdata.fd = import_para.fd;
+    import_setup_stream(&audio_decdata, vob->im_a_size);
 
     return TC_OK;
 }
@@ -428,7 +496,8 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
     int ret = TC_OK;
 
     if (video_decdata->fd != NULL) {
-        if (video_decdata->bytes && (ret = mfread(ptr->video_buf, video_decdata->bytes, 1, video_decdata->fd)) != 1)
+        if (video_decdata->bytes && (ret = mfread(ptr->video_buf, video_decdata->bytes, 1,
+                                                     video_decdata->fd, &video_decdata->io)) != 1)
             ret = TC_ERROR;
         ptr->video_len  = video_decdata->bytes;
         ptr->video_size = video_decdata->bytes;
@@ -440,7 +509,8 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
         import_para.flag       = TC_VIDEO;
         import_para.attributes = ptr->attributes;
 
-        ret = tcv_import(TC_IMPORT_DECODE, &import_para, video_decdata->vob);
+        ret = video_decdata->import(TC_IMPORT_DECODE, &import_para,
+                                    video_decdata->vob);
 
         ptr->video_len  = import_para.size;
         ptr->video_size = import_para.size;
@@ -449,6 +519,66 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
     return ret;
 }
 
+/*
+ * video_push_frame: last stages of the video import: finalize a frame
+ * just filled (or whose filling failed, if `ret' < 0), pre-process it
+ * and push it to the next transcoding layer.
+ *
+ * Parameters:
+ *      vob: vob structure
+ *      ptr: frame to push.
+ *      ret: outcome of the frame filling.
+ *     next: status to give to the pushed frame.
+ * Return Value:
+ *      None.
+ */
+static void video_push_frame(vob_t *vob, vframe_list_t *ptr, int ret,
+                             TCFrameStatus next)
+{
+    if (ret < 0) {
+        if (verbose >= TC_DEBUG)
+            tc_log_msg(__FILE__, "(V) data read failed - end of stream");
+
+        ptr->video_len  = 0;
+        ptr->video_size = 0;
+        if (!tc_has_more_video_in_file(vob)) {
+            ptr->attributes = TC_FRAME_IS_END_OF_STREAM;
+        } else {
+            ptr->attributes = TC_FRAME_IS_SKIPPED;
+        }
+    }
+
+    ptr->v_height = vob->im_v_height;
+    ptr->v_width  = vob->im_v_width;
+    ptr->v_bpp    = BPP;
+
+    if (verbose >= TC_THREADS)
+        tc_log_msg(__FILE__, "(V) new frame is being processed");
+
+    /* stage 3: account filled frame and process it if needed */
+    if (TC_FRAME_NEED_PROCESSING(ptr)) {
+        //first stage pre-processing - (synchronous)
+        preprocess_vid_frame(vob, ptr);
+
+        //filter pre-processing - (synchronous)
+        ptr->tag = TC_VIDEO|TC_PRE_S_PROCESS;
+        tc_filter_process((frame_list_t *)ptr);
+    }
+
+    if (verbose >= TC_THREADS)
+        tc_log_msg(__FILE__, "(V) new frame ready to be pushed");
+
+    /* stage 4: push frame to next transcoding layer */
+    vframe_push_next(ptr, next);
+
+    if (verbose >= TC_THREADS)
+        tc_log_msg(__FILE__, "(V) %10s [%ld] %i bytes", "received",
+                   vframecount, ptr->video_size);
+
+    if (verbose >= TC_THREADS)
+        tc_log_msg(__FILE__, "(V) new frame pushed");
+}
+
 /*
  * {video,audio}_import_loop: data import loops. Feed frame FIFOs with
  * new data forever until are interrupted or stopped.
@@ -497,48 +627,7 @@ static int video_import_loop(vob_t *vob)
         if (verbose >= TC_THREADS)
             tc_log_msg(__FILE__, "(V) new frame filled (%s)", (ret == -1) ?"FAILED" :"OK");
 
-        if (ret < 0) {
-            if (verbose >= TC_DEBUG)
-                tc_log_msg(__FILE__, "(V) data read failed - end of stream");
-
-            ptr->video_len  = 0;
-            ptr->video_size = 0;
-            if (!tc_has_more_video_in_file(vob)) {
-                ptr->attributes = TC_FRAME_IS_END_OF_STREAM;
-            } else {
-                ptr->attributes = TC_FRAME_IS_SKIPPED;
-            }
-        }
-
-        ptr->v_height = vob->im_v_height;
-        ptr->v_width  = vob->im_v_width;
-        ptr->v_bpp    = BPP;
-
-        if (verbose >= TC_THREADS)
-            tc_log_msg(__FILE__, "(V) new frame is being processed");
-
-        /* stage 3: account filled frame and process it if needed */
-        if (TC_FRAME_NEED_PROCESSING(ptr)) {
-            //first stage pre-processing - (synchronous)
-            preprocess_vid_frame(vob, ptr);
-
-            //filter pre-processing - (synchronous)
-            ptr->tag = TC_VIDEO|TC_PRE_S_PROCESS;
-            tc_filter_process((frame_list_t *)ptr);
-        }
-
-        if (verbose >= TC_THREADS)
-            tc_log_msg(__FILE__, "(V) new frame ready to be pushed");
-
-        /* stage 4: push frame to next transcoding layer */
-        vframe_push_next(ptr, next);
-
-        if (verbose >= TC_THREADS)
-            tc_log_msg(__FILE__, "(V) %10s [%ld] %i bytes", "received",
-                       vframecount, ptr->video_size);
-
-        if (verbose >= TC_THREADS)
-            tc_log_msg(__FILE__, "(V) new frame pushed");
+        video_push_frame(vob, ptr, ret, next);
 
         if (ret < 0) {
             /* 
@@ -561,7 +650,8 @@ static int audio_get_frame(void *ctx, TCFrameAudio *ptr)
     int ret = TC_OK;
 
     if (audio_decdata->fd != NULL) {
-        if (audio_decdata->bytes && (ret = mfread(ptr->audio_buf, audio_decdata->bytes, 1, audio_decdata->fd)) != 1)
+        if (audio_decdata->bytes && (ret = mfread(ptr->audio_buf, audio_decdata->bytes, 1,
+                                                     audio_decdata->fd, &audio_decdata->io)) != 1)
             ret = TC_ERROR;
         ptr->audio_len  = audio_decdata->bytes;
         ptr->audio_size = audio_decdata->bytes;
@@ -572,7 +662,8 @@ static int audio_get_frame(void *ctx, TCFrameAudio *ptr)
         import_para.flag       = TC_AUDIO;
         import_para.attributes = ptr->attributes;
 
-        ret = tca_import(TC_IMPORT_DECODE, &import_para, audio_decdata->vob);
+        ret = audio_decdata->import(TC_IMPORT_DECODE, &import_para,
+                                    audio_decdata->vob);
 
         ptr->audio_len  = import_para.size;
         ptr->audio_size = import_para.size;
@@ -669,6 +760,528 @@ static int audio_import_loop(vob_t *vob)
 }
 
 
+/*************************************************************************/
+/*               parallel (segmented) video import                       */
+/*************************************************************************/
+
+/*
+ * With --import_threads, sources which can be entered at any frame are
+ * split into segments of consecutive frames, decoded at the same time
+ * by private instances of the video import module (see
+ * load_import_instance), each one reopened at the start of every
+ * segment it takes. The video import thread registers the frames, in
+ * frame id order, at most `window' frames ahead of the next one to be
+ * pushed, so the rest of the framebuffer never starves; the workers
+ * fill them. Registering from a single thread matters: the ring hands
+ * out the frame slots, and so the order the frames will leave the
+ * framebuffer in, in registration order.
+ * Then the video import thread collects the frames in frame id order
+ * and does exactly what the sequential loop does: pre-processing,
+ * filters, push.
+ */
+
+typedef struct tcimportnav_ TCImportNav;
+struct tcimportnav_ {
+    int offset;                 /* vob_offset to give to the module */
+    int skip;                   /* frames to drop after opening     */
+};
+
+typedef struct tcimportpool_ TCImportPool;
+
+typedef struct tcimportworker_ TCImportWorker;
+struct tcimportworker_ {
+    TCImportPool *pool;
+    TCDecoderData decdata;      /* private stream and module instance */
+    vob_t vob;                  /* private copy, for vob_offset       */
+    vframe_list_t *scratch;     /* sink for the skipped frames        */
+    pthread_t thread;
+};
+
+struct tcimportpool_ {
+    pthread_mutex_t lock;
+    pthread_cond_t filled;      /* a frame was decoded                */
+    pthread_cond_t blank;       /* a blank frame was registered       */
+    int active;
+    int stop;
+
+    vob_t *vob;
+    int workers;
+    int seglen;                 /* frames per segment                 */
+    int window;                 /* max frames ahead of the pusher     */
+    int segment;                /* next segment to hand out           */
+    TCImportNav *nav;           /* navigation log (vob), or NULL      */
+    int nav_len;
+
+    long next;                  /* next frame id to push              */
+    long registered;            /* next frame id to register          */
+    long last;                  /* end of stream frame id, once known */
+    vframe_list_t **frames;     /* [window], by frame id              */
+    int *decoded;               /* [window], frame filled by a worker */
+    int *status;                /* [window], outcome of the decoding  */
+
+    TCImportWorker worker[TC_FRAME_THREADS_MAX];
+};
+
+static TCImportPool impool = {
+    .lock   = PTHREAD_MUTEX_INITIALIZER,
+    .filled = PTHREAD_COND_INITIALIZER,
+    .blank  = PTHREAD_COND_INITIALIZER,
+    .active = TC_FALSE,
+};
+
+static const char *video_mod_name = NULL;
+
+/*
+ * video import modules which can open the stream at any frame, given
+ * as vob->vob_offset: directly (avi) or through the pack offsets of
+ * the navigation log given with --nav_seek (vob).
+ */
+static const struct {
+    const char *name;
+    int need_nav;
+} seekable_imports[] = {
+    { "avi", TC_FALSE },
+    { "vob", TC_TRUE  },
+    { NULL,  TC_FALSE },
+};
+
+/*
+ * import_pool_load_nav: load the navigation log written by
+ * `tcdemux -W' (one line per frame, holding the pack to start from
+ * and the frames to skip from there to get that frame).
+ *
+ * Return Value:
+ *      TC_OK: succesfull.
+ *      TC_ERROR: missing or unsupported (i.e. AVI index) file.
+ */
+static int import_pool_load_nav(TCImportPool *P, const char *nav_file)
+{
+    char buf[TC_BUF_MIN];
+    FILE *fp = NULL;
+    int size = 0, offset, skip;
+
+    fp = (nav_file != NULL) ?fopen(nav_file, "r") :NULL;
+    if (fp == NULL) {
+        return TC_ERROR;
+    }
+    while (fgets(buf, sizeof(buf), fp)) {
+        if (strncasecmp(buf, "AVIIDX1", 7) == 0) {
+            break;
+        }
+        if (sscanf(buf, "%*d %*d %*d %*d %d %d ", &offset, &skip) != 2) {
+            continue;
+        }
+        if (P->nav_len == size) {
+            TCImportNav *nav = NULL;
+            size = (size == 0) ?1024 :size * 2;
+            nav = realloc(P->nav, size * sizeof(TCImportNav));
+            if (nav == NULL) {
+                break;
+            }
+            P->nav = nav;
+        }
+        P->nav[P->nav_len].offset = offset;
+        P->nav[P->nav_len].skip   = skip;
+        P->nav_len++;
+    }
+    fclose(fp);
+
+    if (P->nav_len == 0) {
+        tc_free(P->nav);
+        P->nav = NULL;
+        return TC_ERROR;
+    }
+    return TC_OK;
+}
+
+static int import_worker_open(TCImportWorker *W, int offset)
+{
+    transfer_t import_para;
+
+    memset(&import_para, 0, sizeof(transfer_t));
+    import_para.flag = TC_VIDEO;
+
+    W->vob.vob_offset = offset;
+    if (W->decdata.import(TC_IMPORT_OPEN, &import_para, &W->vob) < 0) {
+        tc_log_error(__FILE__, "video import instance: OPEN failed"
+                               " (offset=%i)", offset);
+        return TC_ERROR;
+    }
+    W->decdata.fd = import_para.fd;
+    import_setup_stream(&W->decdata, W->vob.im_v_size);
+    return TC_OK;
+}
+
+static void import_worker_close(TCImportWorker *W)
+{
+    transfer_t import_para;
+
+    memset(&import_para, 0, sizeof(transfer_t));
+    import_para.flag = TC_VIDEO;
+    import_para.fd   = W->decdata.fd;
+
+    W->decdata.import(TC_IMPORT_CLOSE, &import_para, NULL);
+    W->decdata.fd = NULL;
+}
+
+/*
+ * import_pool_wait_slot: wait until frame `id' is registered.
+ *
+ * Return Value:
+ *      the frame to fill, or NULL if the worker has to quit.
+ */
+static vframe_list_t *import_pool_wait_slot(TCImportPool *P, long id)
+{
+    vframe_list_t *ptr = NULL;
+
+    pthread_mutex_lock(&P->lock);
+    while (!P->stop && id <= P->last && id >= P->registered) {
+        pthread_cond_wait(&P->blank, &P->lock);
+    }
+    if (!P->stop && id <= P->last) {
+        ptr = P->frames[id % P->window];
+    }
+    pthread_mutex_unlock(&P->lock);
+    return ptr;
+}
+
+static void *import_worker_thread(void *_W)
+{
+    TCImportWorker *W = _W;
+    TCImportPool *P = W->pool;
+    vframe_list_t *ptr = NULL;
+    long first, id;
+    int i, offset, skip, opened, ret;
+
+    while (TC_TRUE) {
+        pthread_mutex_lock(&P->lock);
+        first = (long)P->segment++ * P->seglen;
+        ret = (P->stop || first > P->last);
+        pthread_mutex_unlock(&P->lock);
+        if (ret) {
+            break;
+        }
+
+        offset = first;
+        skip   = 0;
+        if (P->nav != NULL) {
+            offset = (first < P->nav_len) ?P->nav[first].offset :-1;
+            skip   = (first < P->nav_len) ?P->nav[first].skip   :0;
+        }
+        /* failures show up as end of stream at the segment start */
+        opened = (offset >= 0 && import_worker_open(W, offset) == TC_OK);
+        ret = (opened) ?TC_OK :TC_ERROR;
+
+        for (i = 0; ret >= 0 && i < skip; i++) {
+            ret = video_get_frame(&W->decdata, W->scratch);
+        }
+
+        for (id = first; id < first + P->seglen; id++) {
+            ptr = import_pool_wait_slot(P, id);
+            if (ptr == NULL) {
+                break;
+            }
+            if (ret >= 0) {
+                ret = video_get_frame(&W->decdata, ptr);
+            }
+
+            pthread_mutex_lock(&P->lock);
+            P->decoded[id % P->window] = TC_TRUE;
+            P->status[id % P->window]  = ret;
+            if (ret < 0 && id < P->last) {
+                P->last = id;
+                pthread_cond_broadcast(&P->blank);
+            }
+            pthread_cond_broadcast(&P->filled);
+            pthread_mutex_unlock(&P->lock);
+
+            if (ret < 0) {
+                break;
+            }
+        }
+        if (opened) {
+            import_worker_close(W);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * import_pool_register: register the frames from the next one to be
+ * registered up to the end of the window (or of the stream), in
+ * frame id order. Stops the pool if the registration is interrupted.
+ */
+static void import_pool_register(TCImportPool *P)
+{
+    vframe_list_t *ptr = NULL;
+    long id;
+
+    pthread_mutex_lock(&P->lock);
+    for (id = P->registered;
+         !P->stop && id <= P->last && id < P->next + P->window; id++) {
+        /* may wait for the framebuffer to drain: not under the lock */
+        pthread_mutex_unlock(&P->lock);
+        ptr = vframe_register(id);
+        if (ptr != NULL) {
+            ptr->attributes = 0;
+            MARK_TIME_RANGE(ptr, P->vob);
+        }
+        pthread_mutex_lock(&P->lock);
+
+        if (ptr == NULL) {
+            P->stop = TC_TRUE;
+            pthread_cond_broadcast(&P->filled);
+        } else {
+            P->frames[id % P->window]  = ptr;
+            P->decoded[id % P->window] = TC_FALSE;
+            P->registered = id + 1;
+        }
+        pthread_cond_broadcast(&P->blank);
+    }
+    pthread_mutex_unlock(&P->lock);
+}
+
+static void import_pool_stop(void)
+{
+    pthread_mutex_lock(&impool.lock);
+    impool.stop = TC_TRUE;
+    pthread_cond_broadcast(&impool.filled);
+    pthread_cond_broadcast(&impool.blank);
+    pthread_mutex_unlock(&impool.lock);
+}
+
+static void import_pool_del_workers(TCImportPool *P)
+{
+    int i;
+
+    for (i = 0; i < P->workers; i++) {
+        TCImportWorker *W = &P->worker[i];
+
+        if (W->decdata.im_handle != NULL) {
+            unload_module(W->decdata.im_handle);
+            W->decdata.im_handle = NULL;
+        }
+        if (W->scratch != NULL) {
+            tc_del_video_frame(W->scratch);
+            W->scratch = NULL;
+        }
+    }
+    tc_free(P->frames);
+    tc_free(P->decoded);
+    tc_free(P->status);
+    tc_free(P->nav);
+    P->frames  = NULL;
+    P->decoded = NULL;
+    P->status  = NULL;
+    P->nav     = NULL;
+}
+
+/*
+ * import_pool_init: start the parallel video import, if asked and
+ * if the source and the video import module allow it. Otherwise,
+ * leave the import sequential (telling the user why).
+ *
+ * Parameters:
+ *      vob: vob structure.
+ * Return Value:
+ *      None.
+ */
+static void import_pool_init(vob_t *vob)
+{
+    TCImportPool *P = &impool;
+    transfer_t import_para;
+    int i, need_nav = -1;
+
+    P->active = TC_FALSE;
+    if (max_import_threads < 2) {
+        return;
+    }
+
+    for (i = 0; seekable_imports[i].name != NULL; i++) {
+        if (video_mod_name != NULL
+         && strcmp(video_mod_name, seekable_imports[i].name) == 0) {
+            need_nav = seekable_imports[i].need_nav;
+        }
+    }
+    if (need_nav < 0) {
+        tc_log_warn(__FILE__, "video import module `%s' can't seek:"
+                              " importing sequentially", video_mod_name);
+        return;
+    }
+    /*
+     * -M 2/4 sync video through clone.c, -M 5 through the synchronizer:
+     * both need to see the whole stream in order.
+     */
+    if (vob->vob_offset != 0 || (vob->pass_flag & TC_VIDEO)
+     || vob->demuxer == 2 || vob->demuxer == 4 || vob->demuxer == 5
+     || (need_nav && vob->im_v_codec != TC_CODEC_RGB24
+                  && vob->im_v_codec != TC_CODEC_YUV420P)) {
+        tc_log_warn(__FILE__, "parallel import needs decoded video from"
+                              " the stream start (no -L, -P or -M 2/4/5):"
+                              " importing sequentially");
+        return;
+    }
+
+    P->stop    = TC_FALSE;
+    P->vob     = vob;
+    P->segment = 0;
+    P->next    = 0;
+    P->registered = 0;
+    P->last    = TC_FRAME_LAST;
+    P->nav     = NULL;
+    P->nav_len = 0;
+    if (need_nav && import_pool_load_nav(P, vob->nav_seek_file) != TC_OK) {
+        tc_log_warn(__FILE__, "parallel import of `%s' streams needs the"
+                              " navigation log (--nav_seek):"
+                              " importing sequentially", video_mod_name);
+        return;
+    }
+
+    P->window  = max_frame_buffer / 2;
+    P->workers = TC_MIN(max_import_threads, P->window);
+    if (P->workers < 2) {
+        tc_log_warn(__FILE__, "framebuffer too small for parallel"
+                              " import: importing sequentially");
+        tc_free(P->nav);
+        P->nav = NULL;
+        return;
+    }
+    P->seglen = (tc_import_segment > 0)
+                    ?tc_import_segment :(P->window / P->workers);
+    if (P->seglen * P->workers > P->window) {
+        tc_log_info(__FILE__, "import segments overlap only partially"
+                              " (increase the framebuffer size with -u)");
+    }
+
+    P->frames  = tc_zalloc(P->window * sizeof(vframe_list_t *));
+    P->decoded = tc_zalloc(P->window * sizeof(int));
+    P->status  = tc_zalloc(P->window * sizeof(int));
+    if (P->frames == NULL || P->decoded == NULL || P->status == NULL) {
+        goto failed;
+    }
+
+    for (i = 0; i < P->workers; i++) {
+        TCImportWorker *W = &P->worker[i];
+
+        memset(W, 0, sizeof(TCImportWorker));
+        W->pool             = P;
+        W->vob              = *vob;
+        W->decdata.tag      = "video";
+        W->decdata.vob      = &W->vob;
+        W->decdata.bytes    = vob->im_v_size;
+        W->decdata.im_handle = load_import_instance(video_mod_name,
+                                                    &W->decdata.import);
+        W->scratch          = vframe_alloc_single();
+        if (W->decdata.im_handle == NULL || W->scratch == NULL) {
+            tc_log_error(__FILE__, "can't load video import instance #%i", i);
+            goto failed;
+        }
+        memset(&import_para, 0, sizeof(transfer_t));
+        import_para.flag = verbose;
+        W->decdata.import(TC_IMPORT_NAME, &import_para, NULL);
+    }
+
+    for (i = 0; i < P->workers; i++) {
+        if (pthread_create(&P->worker[i].thread, NULL,
+                           import_worker_thread, &P->worker[i]) != 0) {
+            tc_error("failed to start video import thread");
+        }
+    }
+
+    if (verbose >= TC_INFO) {
+        tc_log_info(__FILE__, "importing video with %i threads"
+                              " (segments of %i frames)",
+                              P->workers, P->seglen);
+    }
+    P->active = TC_TRUE;
+    return;
+
+failed:
+    import_pool_del_workers(P);
+    tc_log_warn(__FILE__, "importing sequentially");
+}
+
+static void import_pool_fini(TCImportPool *P)
+{
+    int i;
+
+    import_pool_stop();
+    for (i = 0; i < P->workers; i++) {
+        pthread_join(P->worker[i].thread, NULL);
+        video_decdata.io.frames += P->worker[i].decdata.io.frames;
+        video_decdata.io.reads  += P->worker[i].decdata.io.reads;
+        video_decdata.io.legacy += P->worker[i].decdata.io.legacy;
+        video_decdata.io.bytes  += P->worker[i].decdata.io.bytes;
+    }
+    /* registered (and maybe decoded) ahead, but never pushed */
+    for (i = 0; i < P->window; i++) {
+        if (P->frames[i] != NULL) {
+            vframe_remove(P->frames[i]);
+            P->frames[i] = NULL;
+        }
+    }
+    import_pool_del_workers(P);
+
+    pthread_mutex_lock(&P->lock);
+    P->active = TC_FALSE;
+    pthread_mutex_unlock(&P->lock);
+}
+
+/*
+ * video_import_pool_loop: the video import loop used with a pool of
+ * import workers; like video_import_loop, but frames are taken,
+ * in order, from the workers instead of being read here.
+ */
+static int video_import_pool_loop(vob_t *vob)
+{
+    TCImportPool *P = &impool;
+    TCFrameStatus next = (tc_frame_threads_have_video_workers())
+                            ?TC_FRAME_WAIT :TC_FRAME_READY;
+    int im_ret = TC_IM_THREAD_UNKNOWN, ret = 0, slot = 0;
+    vframe_list_t *ptr = NULL;
+
+    video_decdata.vob   = vob;
+    video_decdata.bytes = vob->im_v_size;
+
+    while (tc_running() && tc_import_thread_is_active(&video_decdata)) {
+        import_pool_register(P);
+        slot = P->next % P->window;
+
+        pthread_mutex_lock(&P->lock);
+        while (!P->stop && !P->decoded[slot]) {
+            pthread_cond_wait(&P->filled, &P->lock);
+        }
+        ptr = NULL;
+        if (P->decoded[slot]) {
+            ptr = P->frames[slot];
+            ret = P->status[slot];
+            P->frames[slot]  = NULL;
+            P->decoded[slot] = TC_FALSE;
+        }
+        pthread_mutex_unlock(&P->lock);
+
+        if (ptr == NULL) {
+            break; /* interrupted */
+        }
+
+        video_push_frame(vob, ptr, ret, next);
+
+        pthread_mutex_lock(&P->lock);
+        P->next++;
+        pthread_mutex_unlock(&P->lock);
+
+        if (ret < 0) {
+            tc_import_thread_stop(&audio_decdata);
+            im_ret = TC_IM_THREAD_DONE;
+            break;
+        }
+        vframecount++;
+    }
+
+    import_pool_fini(P);
+    return stop_cause(im_ret);
+}
+
 #undef MARK_TIME_RANGE
 
 /*************************************************************************/
@@ -689,7 +1302,7 @@ static void *audio_import_thread(void *_vob)
 static void *video_import_thread(void *_vob)
 {
     static int ret = 0;
-    ret = video_import_loop(_vob);
+    ret = (impool.active) ?video_import_pool_loop(_vob) :video_import_loop(_vob);
     if (verbose >= TC_CLEANUP)
         tc_log_msg(__FILE__, "video decode loop ends with code 0x%i", ret);
     pthread_exit(&ret);
@@ -723,6 +1336,7 @@ void tc_import_threads_cancel(void)
 
     tc_import_thread_stop(&video_decdata);
     tc_import_thread_stop(&audio_decdata);
+    import_pool_stop();
     tc_framebuffer_interrupt_stage(TC_FRAME_NULL);
 
     if (tc_decoder_delay)
@@ -756,6 +1370,8 @@ void tc_import_threads_create(vob_t *vob)
     if (ret != 0)
         tc_error("failed to start audio stream import thread");
 
+    import_pool_init(vob);
+
     tc_import_thread_start(&video_decdata);
     ret = pthread_create(&video_decdata.thread_id, NULL,
                          video_import_thread, vob);
@@ -776,6 +1392,7 @@ int tc_import_init(vob_t *vob, const char *a_mod, const char *v_mod)
 
     v_mod = (v_mod == NULL) ?TC_DEFAULT_IMPORT_VIDEO :v_mod;
     video_decdata.im_handle = load_module(v_mod, TC_IMPORT+TC_VIDEO);
+    video_mod_name = v_mod;
     RETURN_IF_NULL(video_decdata.im_handle, "video");
 
     memset(&import_para, 0, sizeof(transfer_t));
@@ -814,6 +1431,27 @@ int tc_import_close(void)
     return TC_OK;
 }
 
+static void report_io_stats(const TCDecoderData *decdata)
+{
+    const TCImportIOStats *io = &decdata->io;
+
+    if (io->frames == 0) {
+        return;
+    }
+    tc_log_info(PACKAGE, "%s import I/O: %li frames, %llu bytes,"
+                         " %li read() calls (%.2f/frame; estimated"
+                         " at least %.2f/frame with %i byte blocks)",
+                decdata->tag, io->frames, (unsigned long long)io->bytes,
+                io->reads, (double)io->reads / io->frames,
+                (double)io->legacy / io->frames, LEGACY_BLOCKSIZE);
+}
+
+void tc_import_report_stats(void)
+{
+    report_io_stats(&video_decdata);
+    report_io_stats(&audio_decdata);
+}
+
 void tc_import_shutdown(void)
 {
     if (verbose >= TC_DEBUG) {
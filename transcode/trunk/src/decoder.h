@@ -92,6 +92,22 @@ int tc_import_open(vob_t *vob);
  */
 int tc_import_close(void);
 
+/*
+ * tc_import_report_stats:
+ * log how many read() calls the stream import path (modules handing
+ * over a pipe, like import_vob) took per frame, for both streams,
+ * together with the count the old fixed-size (4 kB) block reads
+ * would have needed for the same frames.
+ *
+ * Parameters:
+ *      None.
+ * Return Value:
+ *      None.
+ * Preconditions:
+ *      Import threads are terminated.
+ */
+void tc_import_report_stats(void);
+
 /*
  * tc_import_threads_create (Thread safe):
  * create both audio and video import threads, and automatically,
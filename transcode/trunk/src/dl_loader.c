@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#define _GNU_SOURCE 1  /* for RTLD_DEEPBIND */
+
 #ifdef HAVE_DLFCN_H
 #include <dlfcn.h>
 #else
@@ -213,6 +215,74 @@ void *load_module(const char *mod_name, int mode)
   return(NULL);
 }
 
+/*
+ * load_import_instance: load a private instance of an (old-style)
+ * import module, with its own copy of all the module static data,
+ * so it can run alongside the one loaded by load_module().
+ * The dynamic loader shares everything loaded from the same file,
+ * so the module is copied to a temporary file first, and bound to
+ * its own symbols before the global ones (RTLD_DEEPBIND).
+ * The module entry point is returned in `import'.
+ */
+void *load_import_instance(const char *mod_name,
+                           int (**import)(int opt, void *para1, void *para2))
+{
+#ifdef RTLD_DEEPBIND
+  char path[TC_BUF_MAX], tmp[TC_BUF_MAX];
+  uint8_t buf[65536];
+  const char *tmpdir = getenv("TMPDIR");
+  void *handle = NULL;
+  ssize_t n = 0;
+  int in, out;
+
+  tc_snprintf(path, sizeof(path), "%s/import_%s.so", ((mod_path==NULL)? TC_DEFAULT_MOD_PATH:mod_path), mod_name);
+  tc_snprintf(tmp, sizeof(tmp), "%s/tcimport-XXXXXX", ((tmpdir==NULL)? "/tmp": tmpdir));
+
+  in = open(path, O_RDONLY);
+  if (in < 0) {
+    tc_log_perror(__FILE__, path);
+    return(NULL);
+  }
+  out = mkstemp(tmp);
+  if (out < 0) {
+    tc_log_perror(__FILE__, tmp);
+    close(in);
+    return(NULL);
+  }
+  while ((n = read(in, buf, sizeof(buf))) > 0) {
+    if (tc_pwrite(out, buf, n) != n) {
+      n = -1;
+      break;
+    }
+  }
+  close(in);
+  close(out);
+
+  if (n == 0) {
+    handle = dlopen(tmp, RTLD_LOCAL| RTLD_LAZY| RTLD_DEEPBIND);
+    if (!handle) {
+      tc_warn("%s", dlerror());
+    }
+  } else {
+    tc_log_warn(__FILE__, "can't copy \"%s\" to \"%s\"", path, tmp);
+  }
+  /* the mapping stays valid after the file is gone */
+  unlink(tmp);
+
+  if (handle != NULL) {
+    *import = dlsym(handle, "tc_import");
+    if (*import == NULL) {
+      tc_warn("%s", dlerror());
+      dlclose(handle);
+      handle = NULL;
+    }
+  }
+  return(handle);
+#else
+  return(NULL);
+#endif
+}
+
 void unload_module(void *handle)
 {
   if (dlclose(handle) != 0) {
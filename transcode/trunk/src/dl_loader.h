@@ -25,6 +25,8 @@
 #define _DL_LOADER_H
 
 void *load_module(const char *mod, int mode);
+void *load_import_instance(const char *mod,
+                           int (**import)(int opt, void *para1, void *para2));
 void unload_module(void *handle);
 
 // extern int (*TCV_export)(int opt, void *para1, void *para2);
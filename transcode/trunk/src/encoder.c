@@ -44,11 +44,14 @@
 #include "libtc/tcframes.h"
 
 #include <stdint.h>
+#include <pthread.h>
 
 /*************************************************************************/
 /* Our data structure forward declaration                                */
 
 typedef struct tcrotatecontext_ TCRotateContext;
+typedef struct tcencoderpool_ TCEncoderPool;
+typedef struct tcmplexqueue_ TCMplexQueue;
 typedef struct tcencoderdata_ TCEncoderData;
 
 /*************************************************************************/
@@ -78,9 +81,29 @@ static int tc_rotate_if_needed_by_bytes(TCRotateContext *rotor,
 /* new-style encoder */
 
 static int encoder_export(TCEncoderData *data, vob_t *vob);
+static int encoder_export_encoded(TCEncoderData *data, vob_t *vob,
+                                  int frame_id, vframe_list_t **venc,
+                                  aframe_list_t *aptr, int video_delayed);
 static void encoder_skip(TCEncoderData *data, int out_of_range);
 static int encoder_flush(TCEncoderData *data);
 
+/* parallel video encoding */
+
+static int encoder_pool_init(TCEncoderData *data, vob_t *vob,
+                             const char *options, int workers);
+static void encoder_pool_fini(TCEncoderData *data);
+static int encoder_pool_submit(TCEncoderData *data, vob_t *vob);
+static int encoder_pool_export(TCEncoderData *data, vob_t *vob, int wait);
+static void encoder_pool_drain(TCEncoderData *data, vob_t *vob);
+
+/* asynchronous multiplexing */
+
+static int mplex_queue_init(TCEncoderData *data, int depth);
+static void mplex_queue_fini(TCEncoderData *data);
+static int mplex_queue_submit(TCEncoderData *data, vframe_list_t **venc,
+                              aframe_list_t **aenc);
+static int mplex_queue_drain(TCEncoderData *data);
+
 /* rest of API is already public */
 
 /* old-style encoder */
@@ -113,6 +136,10 @@ static void free_buffers(TCEncoderData *data);
  * 1) keep it simple, stupid
  * 2) to have more than one encoder doesn't make sense in transcode, so
  * 3) new encoder will be monothread, like the old one
+ *    (exception: intra-only video encoders can be run in parallel, see
+ *    the encoder pool code below. Multiplexing is still monothread,
+ *    but can be moved out of the encoder loop, see the multiplexor
+ *    queue code.)
  */
 
 /*************************************************************************/
@@ -424,10 +451,14 @@ struct tcencoderdata_ {
 
     TCFactory factory;
 
+    const char *vid_mod_name;
     TCModule vid_mod;
     TCModule aud_mod;
     TCModule mplex_mod;
 
+    TCEncoderPool *pool; /* NULL if video encoding is sequential */
+    TCMplexQueue *mplex_queue; /* NULL if multiplexing is synchronous */
+
     TCRotateContext rotor_data;
 
 #ifdef SUPPORT_OLD_ENCODER
@@ -450,9 +481,12 @@ static TCEncoderData encdata = {
     .venc_ptr = NULL,
     .aenc_ptr = NULL,
     .factory = NULL,
+    .vid_mod_name = NULL,
     .vid_mod = NULL,
     .aud_mod = NULL,
     .mplex_mod = NULL,
+    .pool = NULL,
+    .mplex_queue = NULL,
     /* rotor_data explicitely initialized later */
 #ifdef SUPPORT_OLD_ENCODER
     .ex_a_handle = NULL,
@@ -581,6 +615,7 @@ int tc_export_setup(vob_t *vob,
         return TC_ERROR;
     }
     mod_name = (v_mod == NULL) ?TC_DEFAULT_EXPORT_VIDEO :v_mod;
+    encdata.vid_mod_name = mod_name;
     encdata.vid_mod = tc_new_module(encdata.factory, "encode", mod_name, TC_VIDEO);
     if (!encdata.vid_mod) {
         tc_log_error(__FILE__, "can't load video encoder");
@@ -668,6 +703,14 @@ int tc_encoder_init(vob_t *vob)
         return TC_ERROR;
     }
 
+    if (max_encoder_threads > 1 && encdata.pool == NULL) {
+        ret = encoder_pool_init(&encdata, vob, options, max_encoder_threads);
+        if (ret != TC_OK) {
+            tc_log_warn(__FILE__, "can't start the video encoder threads");
+            return TC_ERROR;
+        }
+    }
+
     options = (vob->ex_a_string) ?vob->ex_a_string :"";
     ret = tc_module_configure(encdata.aud_mod, options, vob);
     if (ret != TC_OK) {
@@ -675,6 +718,14 @@ int tc_encoder_init(vob_t *vob)
         return TC_ERROR;
     }
 
+    if (max_mplex_queue > 0 && encdata.mplex_queue == NULL) {
+        ret = mplex_queue_init(&encdata, max_mplex_queue);
+        if (ret != TC_OK) {
+            tc_log_warn(__FILE__, "can't start the multiplexor thread");
+            return TC_ERROR;
+        }
+    }
+
     return TC_OK;
 }
 
@@ -724,6 +775,14 @@ int tc_encoder_close(void)
         return OLD_tc_encoder_close();
 #endif
 
+    /* the queued frames belong to the current output chunk */
+    ret = mplex_queue_drain(&encdata);
+    if (ret != TC_OK) {
+        tc_log_warn(__FILE__, "error while closing encoder:"
+                              " multiplexing failed");
+        return TC_ERROR;
+    }
+
     /* old style code handle flushing in modules, not here */
     ret = encoder_flush(&encdata);
     if (ret != TC_OK) {
@@ -759,6 +818,9 @@ int tc_encoder_stop(void)
         return OLD_tc_encoder_stop();
 #endif
 
+    encoder_pool_fini(&encdata);
+    mplex_queue_fini(&encdata);
+
     ret = tc_module_stop(encdata.vid_mod);
     if (ret != TC_OK) {
         tc_log_warn(__FILE__, "video export module error: stop failed");
@@ -834,7 +896,6 @@ static int encoder_export(TCEncoderData *data, vob_t *vob)
 #endif
     /* remove spurious attributes */
     RESET_ATTRIBUTES(data->venc_ptr);
-    RESET_ATTRIBUTES(data->aenc_ptr);
 
     /* step 1: encode video */
     ret = tc_module_encode_video(data->vid_mod,
@@ -848,13 +909,33 @@ static int encoder_export(TCEncoderData *data, vob_t *vob)
         video_delayed = 1;
     }
 
+    return encoder_export_encoded(data, vob, data->buffer->frame_id,
+                                  &data->venc_ptr, data->buffer->aptr,
+                                  video_delayed);
+}
+
+/*
+ * encode the audio frame, multiplex it together with the already
+ * encoded video frame, and adjust frame counters.
+ * Steps 2-4 of encoder_export; also used by the encoder pool.
+ * When multiplexing is asynchronous, the encoded frames are queued and
+ * *venc (and data->aenc_ptr) are replaced by free buffers.
+ */
+static int encoder_export_encoded(TCEncoderData *data, vob_t *vob,
+                                  int frame_id, vframe_list_t **venc,
+                                  aframe_list_t *aptr, int video_delayed)
+{
+    int ret;
+
+    /* remove spurious attributes */
+    RESET_ATTRIBUTES(data->aenc_ptr);
+
     /* step 2: encode audio */
     if (video_delayed) {
-        data->buffer->aptr->attributes |= TC_FRAME_IS_CLONED;
+        aptr->attributes |= TC_FRAME_IS_CLONED;
         tc_log_info(__FILE__, "Delaying audio");
     } else {
-        ret = tc_module_encode_audio(data->aud_mod,
-                                     data->buffer->aptr, data->aenc_ptr);
+        ret = tc_module_encode_audio(data->aud_mod, aptr, data->aenc_ptr);
         if (ret != TC_OK) {
             tc_log_error(__FILE__, "error encoding audio frame");
             data->error_flag = 1;
@@ -864,8 +945,12 @@ static int encoder_export(TCEncoderData *data, vob_t *vob)
     /* step 3: multiplex and rotate */
     // FIXME: Do we really need bytes-written returned from this, or can
     //        we just return TC_OK/TC_ERROR like other functions? --AC
-    ret = tc_module_multiplex(data->mplex_mod,
-                              data->venc_ptr, data->aenc_ptr);
+    if (data->mplex_queue != NULL) {
+        /* bytes are those written since the previous call */
+        ret = mplex_queue_submit(data, venc, &data->aenc_ptr);
+    } else {
+        ret = tc_module_multiplex(data->mplex_mod, *venc, data->aenc_ptr);
+    }
     if (ret < 0) {
         tc_log_error(__FILE__, "error multiplexing encoded frames");
         data->error_flag = 1;
@@ -879,13 +964,648 @@ static int encoder_export(TCEncoderData *data, vob_t *vob)
         if (!data->fill_flag) {
             data->fill_flag = 1;
         }
-        counter_print(1, data->buffer->frame_id, data->frame_first, last);
+        counter_print(1, frame_id, data->frame_first, last);
     }
 
     tc_update_frames_encoded(1);
     return (data->error_flag) ?TC_ERROR :TC_OK;
 }
 
+/*************************************************************************/
+/* parallel video encoding                                               */
+
+/*
+ * When the video encoder declares itself intra-only (see the `intra'
+ * key of the inspect operation), the encoder loop hands the raw video
+ * frames to a pool of worker threads, each one owning a private
+ * instance of the encoder module. Pending frames live in a ring of
+ * slots, queued and completed strictly in order.
+ * Audio encoding, multiplexing, rotation and counters are still done
+ * by the encoder loop thread, taking the oldest slot once its video
+ * frame is encoded: the output is the same as the sequential one.
+ *
+ * The main video module instance is never used for encoding in this
+ * mode, so flushing it (on rotation or close) doesn't race with the
+ * workers.
+ */
+
+#define TC_ENCODER_SLOTS_PER_THREAD     2
+
+typedef enum {
+    TC_ENCODER_SLOT_FREE = 0,   /* owned by the encoder loop */
+    TC_ENCODER_SLOT_QUEUED,     /* waiting for a worker */
+    TC_ENCODER_SLOT_RUNNING,    /* being encoded */
+    TC_ENCODER_SLOT_DONE,       /* waiting to be multiplexed */
+} TCEncoderSlotState;
+
+typedef struct tcencoderslot_ TCEncoderSlot;
+struct tcencoderslot_ {
+    TCEncoderSlotState state;
+    int frame_id;
+    int error;
+
+    vframe_list_t *vptr;    /* raw video frame to encode */
+    vframe_list_t *vcopy;   /* private raw frame, used for cloned frames */
+    aframe_list_t *aptr;    /* private copy of the raw audio frame */
+    vframe_list_t *venc;    /* encoded video frame */
+};
+
+typedef struct tcencoderworker_ TCEncoderWorker;
+struct tcencoderworker_ {
+    TCEncoderPool *pool;
+    TCModule mod;
+    pthread_t thread;
+};
+
+struct tcencoderpool_ {
+    int workers;
+    int nslots;
+
+    TCEncoderWorker worker[TC_FRAME_THREADS_MAX];
+    TCEncoderSlot slots[TC_FRAME_THREADS_MAX * TC_ENCODER_SLOTS_PER_THREAD];
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      /* a slot was queued, or stop requested */
+    pthread_cond_t done;        /* a slot was encoded */
+
+    /* slot sequence numbers; slot index is seq % nslots */
+    uint32_t next_submit;
+    uint32_t next_encode;
+    uint32_t next_export;
+
+    int stop;
+};
+
+static TCEncoderPool encpool;
+
+
+static void *encoder_pool_worker(void *_worker)
+{
+    TCEncoderWorker *W = _worker;
+    TCEncoderPool *P = W->pool;
+    TCEncoderSlot *slot = NULL;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&P->lock);
+        while (!P->stop && P->next_encode == P->next_submit) {
+            pthread_cond_wait(&P->queued, &P->lock);
+        }
+        if (P->next_encode == P->next_submit) {
+            pthread_mutex_unlock(&P->lock);
+            break; /* stop requested and nothing left to encode */
+        }
+        slot = &P->slots[P->next_encode % P->nslots];
+        P->next_encode++;
+        slot->state = TC_ENCODER_SLOT_RUNNING;
+        pthread_mutex_unlock(&P->lock);
+
+        RESET_ATTRIBUTES(slot->venc);
+        ret = tc_module_encode_video(W->mod, slot->vptr, slot->venc);
+
+        pthread_mutex_lock(&P->lock);
+        slot->error = (ret != TC_OK);
+        slot->state = TC_ENCODER_SLOT_DONE;
+        pthread_cond_signal(&P->done);
+        pthread_mutex_unlock(&P->lock);
+    }
+    return NULL;
+}
+
+static void encoder_pool_free_slots(TCEncoderPool *P)
+{
+    int i;
+
+    for (i = 0; i < P->nslots; i++) {
+        if (P->slots[i].vcopy != NULL) {
+            tc_del_video_frame(P->slots[i].vcopy);
+        }
+        if (P->slots[i].venc != NULL) {
+            tc_del_video_frame(P->slots[i].venc);
+        }
+        if (P->slots[i].aptr != NULL) {
+            tc_del_audio_frame(P->slots[i].aptr);
+        }
+    }
+}
+
+static void encoder_pool_del_modules(TCEncoderData *data, TCEncoderPool *P)
+{
+    int i;
+
+    for (i = 0; i < P->workers; i++) {
+        if (P->worker[i].mod != NULL) {
+            tc_module_stop(P->worker[i].mod);
+            tc_del_module(data->factory, P->worker[i].mod);
+            P->worker[i].mod = NULL;
+        }
+    }
+}
+
+/*
+ * encoder_pool_init:
+ *      start the parallel video encoding, if the video encoder
+ *      module allows it. Otherwise, just tell the user and
+ *      leave the encoding sequential.
+ *      The slots hold framebuffer frames, so they are bound
+ *      to the framebuffer size to not starve the decoder.
+ */
+static int encoder_pool_init(TCEncoderData *data, vob_t *vob,
+                             const char *options, int workers)
+{
+    TCEncoderPool *P = &encpool;
+    const char *intra = NULL;
+    int i, ret;
+
+    tc_module_inspect(data->vid_mod, "intra", &intra);
+    if (intra == NULL || strcmp(intra, "1") != 0) {
+        tc_log_warn(__FILE__, "video encoder `%s' isn't intra-only"
+                              " (as configured): encoding sequentially",
+                              data->vid_mod_name);
+        return TC_OK;
+    }
+
+    memset(P, 0, sizeof(TCEncoderPool));
+    P->nslots = TC_MIN(workers * TC_ENCODER_SLOTS_PER_THREAD,
+                       max_frame_buffer / 2);
+    P->workers = TC_MIN(workers, P->nslots);
+    if (P->workers < 2) {
+        tc_log_warn(__FILE__, "framebuffer too small for parallel"
+                              " encoding: encoding sequentially");
+        return TC_OK;
+    }
+    if (P->workers < workers) {
+        tc_log_info(__FILE__, "using only %i encoder threads"
+                              " (increase the framebuffer size with -u)",
+                              P->workers);
+    }
+
+    for (i = 0; i < P->nslots; i++) {
+        P->slots[i].vcopy = vframe_alloc_single();
+        P->slots[i].venc  = vframe_alloc_single();
+        P->slots[i].aptr  = aframe_alloc_single();
+        if (P->slots[i].vcopy == NULL || P->slots[i].venc == NULL
+         || P->slots[i].aptr == NULL) {
+            tc_log_error(__FILE__, "can't allocate encoder pool buffers");
+            encoder_pool_free_slots(P);
+            return TC_ERROR;
+        }
+    }
+
+    for (i = 0; i < P->workers; i++) {
+        P->worker[i].pool = P;
+        P->worker[i].mod  = tc_new_module(data->factory, "encode",
+                                          data->vid_mod_name, TC_VIDEO);
+        if (P->worker[i].mod == NULL) {
+            tc_log_error(__FILE__, "can't load video encoder instance #%i", i);
+            goto failed;
+        }
+        ret = tc_module_configure(P->worker[i].mod, options, vob);
+        if (ret != TC_OK) {
+            tc_log_error(__FILE__, "can't configure video encoder"
+                                   " instance #%i", i);
+            goto failed;
+        }
+    }
+
+    pthread_mutex_init(&P->lock, NULL);
+    pthread_cond_init(&P->queued, NULL);
+    pthread_cond_init(&P->done, NULL);
+
+    for (i = 0; i < P->workers; i++) {
+        if (pthread_create(&P->worker[i].thread, NULL,
+                           encoder_pool_worker, &P->worker[i]) != 0) {
+            tc_error("failed to start video encoder thread");
+        }
+    }
+
+    if (verbose >= TC_INFO) {
+        tc_log_info(__FILE__, "encoding video with %i threads"
+                              " (%i frames in flight)",
+                              P->workers, P->nslots);
+    }
+    data->pool = P;
+    return TC_OK;
+
+failed:
+    encoder_pool_del_modules(data, P);
+    encoder_pool_free_slots(P);
+    return TC_ERROR;
+}
+
+static void encoder_pool_fini(TCEncoderData *data)
+{
+    TCEncoderPool *P = data->pool;
+    int i;
+
+    if (P == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&P->lock);
+    P->stop = TC_TRUE;
+    pthread_cond_broadcast(&P->queued);
+    pthread_mutex_unlock(&P->lock);
+
+    for (i = 0; i < P->workers; i++) {
+        pthread_join(P->worker[i].thread, NULL);
+    }
+
+    /* frames encoded but never exported (i.e. stream interrupted) */
+    for (i = 0; i < P->nslots; i++) {
+        TCEncoderSlot *slot = &P->slots[i];
+        if (slot->state != TC_ENCODER_SLOT_FREE && slot->vptr != slot->vcopy) {
+            vframe_remove(slot->vptr);
+        }
+    }
+
+    encoder_pool_del_modules(data, P);
+    encoder_pool_free_slots(P);
+
+    pthread_cond_destroy(&P->done);
+    pthread_cond_destroy(&P->queued);
+    pthread_mutex_destroy(&P->lock);
+
+    data->pool = NULL;
+}
+
+/*
+ * encoder_pool_export:
+ *      export the oldest pending frame, if its video is already
+ *      encoded. If `wait' is !0, wait for the encoding to complete.
+ *
+ * Return Value:
+ *      TC_TRUE if a frame was exported, TC_FALSE otherwise.
+ */
+static int encoder_pool_export(TCEncoderData *data, vob_t *vob, int wait)
+{
+    TCEncoderPool *P = data->pool;
+    TCEncoderSlot *slot = NULL;
+    int ready = TC_FALSE;
+
+    pthread_mutex_lock(&P->lock);
+    if (P->next_export != P->next_submit) {
+        slot = &P->slots[P->next_export % P->nslots];
+        while (wait && slot->state != TC_ENCODER_SLOT_DONE) {
+            pthread_cond_wait(&P->done, &P->lock);
+        }
+        ready = (slot->state == TC_ENCODER_SLOT_DONE);
+    }
+    pthread_mutex_unlock(&P->lock);
+
+    if (!ready) {
+        return TC_FALSE;
+    }
+
+    if (slot->error) {
+        tc_log_error(__FILE__, "error encoding video frame");
+        data->error_flag = 1;
+    }
+    if (slot->venc->attributes & TC_FRAME_IS_DELAYED) {
+        /* should never happen with intra-only encoders */
+        tc_log_warn(__FILE__, "unexpected delayed video frame (%i)",
+                    slot->frame_id);
+        slot->venc->attributes &= ~TC_FRAME_IS_DELAYED;
+    }
+    encoder_export_encoded(data, vob, slot->frame_id,
+                           &slot->venc, slot->aptr, 0);
+
+    if (slot->vptr != slot->vcopy) {
+        vframe_remove(slot->vptr);  /* release frame buffer memory */
+    }
+    slot->vptr = NULL;
+
+    pthread_mutex_lock(&P->lock);
+    slot->state = TC_ENCODER_SLOT_FREE;
+    P->next_export++;
+    pthread_mutex_unlock(&P->lock);
+
+    return TC_TRUE;
+}
+
+static void encoder_pool_drain(TCEncoderData *data, vob_t *vob)
+{
+    while (encoder_pool_export(data, vob, TC_TRUE)) {
+        /* nothing else */;
+    }
+}
+
+/*
+ * encoder_pool_submit:
+ *      queue the acquired frames for parallel encoding, exporting
+ *      the oldest pending frame first if no slot is free.
+ *      The video frame is taken away from the encoder buffer, and
+ *      released once exported; cloned frames are copied instead, since
+ *      the framebuffer will hand them again.
+ *      The audio frame is copied, so the encoder buffer can
+ *      dispose it as usual.
+ */
+static int encoder_pool_submit(TCEncoderData *data, vob_t *vob)
+{
+    TCEncoderPool *P = data->pool;
+    TCEncoderSlot *slot = &P->slots[P->next_submit % P->nslots];
+    vframe_list_t *vptr = data->buffer->vptr;
+
+    if (slot->state != TC_ENCODER_SLOT_FREE) {
+        /* ring full: this is the oldest pending slot */
+        encoder_pool_export(data, vob, TC_TRUE);
+    }
+
+    if (vptr->attributes & TC_FRAME_IS_CLONED) {
+        vframe_copy(slot->vcopy, vptr, 1);
+        slot->vptr = slot->vcopy;
+    } else {
+        if (vptr->attributes & TC_FRAME_WAS_CLONED) {
+            tc_update_frames_cloned(1);
+        }
+        slot->vptr = vptr;
+        data->buffer->vptr = NULL; /* now it's ours */
+    }
+    aframe_copy(slot->aptr, data->buffer->aptr, 1);
+    slot->frame_id = data->buffer->frame_id;
+    slot->error = 0;
+
+    pthread_mutex_lock(&P->lock);
+    slot->state = TC_ENCODER_SLOT_QUEUED;
+    P->next_submit++;
+    pthread_cond_signal(&P->queued);
+    pthread_mutex_unlock(&P->lock);
+
+    /* export what is ready, without waiting */
+    while (encoder_pool_export(data, vob, TC_FALSE)) {
+        /* nothing else */;
+    }
+    return (data->error_flag) ?TC_ERROR :TC_OK;
+}
+
+
+/*************************************************************************/
+/* asynchronous multiplexing                                             */
+
+/*
+ * With --mplex_queue, the encoded frames are handed to a dedicated
+ * thread which multiplexes them, so that a slow disk (or network
+ * storage) doesn't stall the encoder loop until the queue is full.
+ * The queue is a ring of packets, each one owning a pair of encoded
+ * frame buffers: on submit, the buffers of a free packet are swapped
+ * with the ones just encoded, so no frame data is copied.
+ *
+ * The multiplexor module is used only by the queue thread while
+ * packets are pending; the encoder loop drains the queue before
+ * touching the module itself (flush, rotation, close).
+ */
+
+typedef struct tcmplexpacket_ TCMplexPacket;
+struct tcmplexpacket_ {
+    vframe_list_t *venc;
+    aframe_list_t *aenc;
+    uint64_t queued;        /* submit time, for latency stats */
+};
+
+struct tcmplexqueue_ {
+    int npackets;
+    TCMplexPacket packets[TC_MPLEX_QUEUE_MAX];
+
+    TCModule mod;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      /* a packet was queued, or stop requested */
+    pthread_cond_t done;        /* a packet was multiplexed */
+
+    /* packet sequence numbers; packet index is seq % npackets */
+    uint32_t next_submit;
+    uint32_t next_write;
+
+    int stop;
+    int error;                  /* sticky: the multiplexor failed */
+    uint64_t new_bytes;         /* written since last collected */
+
+    /* statistics (times in microseconds) */
+    uint64_t written;
+    uint64_t bytes;
+    uint64_t latency_sum;
+    uint64_t latency_max;
+    uint64_t stalls;
+    uint64_t stall_time;
+};
+
+static TCMplexQueue mplexqueue;
+
+
+static void *mplex_queue_thread(void *_queue)
+{
+    TCMplexQueue *Q = _queue;
+    TCMplexPacket *pkt = NULL;
+    uint64_t latency;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&Q->lock);
+        while (!Q->stop && Q->next_write == Q->next_submit) {
+            pthread_cond_wait(&Q->queued, &Q->lock);
+        }
+        if (Q->next_write == Q->next_submit) {
+            pthread_mutex_unlock(&Q->lock);
+            break; /* stop requested and nothing left to write */
+        }
+        pkt = &Q->packets[Q->next_write % Q->npackets];
+        pthread_mutex_unlock(&Q->lock);
+
+        ret = tc_module_multiplex(Q->mod, pkt->venc, pkt->aenc);
+        latency = tc_gettime() - pkt->queued;
+
+        pthread_mutex_lock(&Q->lock);
+        if (ret < 0) {
+            Q->error = TC_TRUE;
+        } else {
+            Q->new_bytes += ret;
+            Q->bytes += ret;
+        }
+        Q->written++;
+        Q->latency_sum += latency;
+        if (latency > Q->latency_max) {
+            Q->latency_max = latency;
+        }
+        Q->next_write++;
+        pthread_cond_signal(&Q->done);
+        pthread_mutex_unlock(&Q->lock);
+    }
+    return NULL;
+}
+
+static void mplex_queue_free_packets(TCMplexQueue *Q)
+{
+    int i;
+
+    for (i = 0; i < Q->npackets; i++) {
+        if (Q->packets[i].venc != NULL) {
+            tc_del_video_frame(Q->packets[i].venc);
+        }
+        if (Q->packets[i].aenc != NULL) {
+            tc_del_audio_frame(Q->packets[i].aenc);
+        }
+    }
+}
+
+/*
+ * mplex_queue_init:
+ *      start the multiplexor thread, with room for `depth'
+ *      pairs of encoded frames.
+ */
+static int mplex_queue_init(TCEncoderData *data, int depth)
+{
+    TCMplexQueue *Q = &mplexqueue;
+    int i;
+
+    memset(Q, 0, sizeof(TCMplexQueue));
+    Q->npackets = TC_MIN(depth, TC_MPLEX_QUEUE_MAX);
+    Q->mod = data->mplex_mod;
+
+    for (i = 0; i < Q->npackets; i++) {
+        Q->packets[i].venc = vframe_alloc_single();
+        Q->packets[i].aenc = aframe_alloc_single();
+        if (Q->packets[i].venc == NULL || Q->packets[i].aenc == NULL) {
+            tc_log_error(__FILE__, "can't allocate multiplexor queue buffers");
+            mplex_queue_free_packets(Q);
+            return TC_ERROR;
+        }
+    }
+
+    pthread_mutex_init(&Q->lock, NULL);
+    pthread_cond_init(&Q->queued, NULL);
+    pthread_cond_init(&Q->done, NULL);
+
+    if (pthread_create(&Q->thread, NULL, mplex_queue_thread, Q) != 0) {
+        tc_error("failed to start multiplexor thread");
+    }
+
+    if (verbose >= TC_INFO) {
+        tc_log_info(__FILE__, "multiplexing in a separate thread"
+                              " (%i frames queued at most)", Q->npackets);
+    }
+    data->mplex_queue = Q;
+    return TC_OK;
+}
+
+static void mplex_queue_fini(TCEncoderData *data)
+{
+    TCMplexQueue *Q = data->mplex_queue;
+
+    if (Q == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&Q->lock);
+    Q->stop = TC_TRUE;
+    pthread_cond_broadcast(&Q->queued);
+    pthread_mutex_unlock(&Q->lock);
+
+    pthread_join(Q->thread, NULL);
+
+    if (verbose >= TC_INFO && Q->written > 0) {
+        tc_log_info(__FILE__, "multiplexor queue: %llu frames,"
+                              " %.1f MB written",
+                    (unsigned long long)Q->written,
+                    (double)Q->bytes / (1024 * 1024));
+        tc_log_info(__FILE__, "multiplexor queue: latency %.1f ms average,"
+                              " %.1f ms max",
+                    (double)Q->latency_sum / Q->written / 1000,
+                    (double)Q->latency_max / 1000);
+        tc_log_info(__FILE__, "multiplexor queue: encoder waited %llu times,"
+                              " %.1f ms total",
+                    (unsigned long long)Q->stalls,
+                    (double)Q->stall_time / 1000);
+    }
+
+    mplex_queue_free_packets(Q);
+
+    pthread_cond_destroy(&Q->done);
+    pthread_cond_destroy(&Q->queued);
+    pthread_mutex_destroy(&Q->lock);
+
+    data->mplex_queue = NULL;
+}
+
+/*
+ * mplex_queue_submit:
+ *      queue the encoded frames for multiplexing, waiting for
+ *      a free packet if the queue is full. *venc and *aenc are
+ *      replaced with the (free) buffers of the packet.
+ *
+ * Return Value:
+ *      number of bytes multiplexed since the previous call,
+ *      or -1 if the multiplexor failed meanwhile.
+ */
+static int mplex_queue_submit(TCEncoderData *data, vframe_list_t **venc,
+                              aframe_list_t **aenc)
+{
+    TCMplexQueue *Q = data->mplex_queue;
+    TCMplexPacket *pkt = NULL;
+    vframe_list_t *vtmp = NULL;
+    aframe_list_t *atmp = NULL;
+    uint64_t bytes = 0;
+    int error = 0;
+
+    pthread_mutex_lock(&Q->lock);
+    if (Q->next_submit - Q->next_write == Q->npackets) {
+        uint64_t start = tc_gettime();
+        Q->stalls++;
+        while (Q->next_submit - Q->next_write == Q->npackets) {
+            pthread_cond_wait(&Q->done, &Q->lock);
+        }
+        Q->stall_time += tc_gettime() - start;
+    }
+    pthread_mutex_unlock(&Q->lock);
+
+    pkt = &Q->packets[Q->next_submit % Q->npackets];
+    vtmp = pkt->venc;
+    pkt->venc = *venc;
+    *venc = vtmp;
+    atmp = pkt->aenc;
+    pkt->aenc = *aenc;
+    *aenc = atmp;
+    pkt->queued = tc_gettime();
+
+    pthread_mutex_lock(&Q->lock);
+    Q->next_submit++;
+    pthread_cond_signal(&Q->queued);
+    bytes = Q->new_bytes;
+    Q->new_bytes = 0;
+    error = Q->error;
+    pthread_mutex_unlock(&Q->lock);
+
+    return (error) ?-1 :(int)bytes;
+}
+
+/*
+ * mplex_queue_drain:
+ *      wait until all the queued frames are multiplexed.
+ *      Does nothing if multiplexing is synchronous.
+ *
+ * Return Value:
+ *      TC_OK if succesfull, TC_ERROR if the multiplexor ever failed.
+ *      The error is sticky: every later call reports it as well.
+ */
+static int mplex_queue_drain(TCEncoderData *data)
+{
+    TCMplexQueue *Q = data->mplex_queue;
+    int error = 0;
+
+    if (Q == NULL) {
+        return TC_OK;
+    }
+
+    pthread_mutex_lock(&Q->lock);
+    while (Q->next_write != Q->next_submit) {
+        pthread_cond_wait(&Q->done, &Q->lock);
+    }
+    error = Q->error;
+    pthread_mutex_unlock(&Q->lock);
+
+    return (error) ?TC_ERROR :TC_OK;
+}
+
 
 #define RETURN_IF_NOT_OK(RET, KIND) do { \
     if ((RET) != TC_OK) { \
@@ -1197,6 +1917,8 @@ static int OLD_encoder_export(TCEncoderData *data, vob_t *vob)
     int video_delayed = 0;
 
     /* encode and export video frame */
+    /* old export modules may convert the frame in place */
+    vframe_make_writable(data->buffer->vptr);
     data->export_para.buffer = data->buffer->vptr->video_buf;
     data->export_para.size = data->buffer->vptr->video_size;
     data->export_para.attributes = data->buffer->vptr->attributes;
@@ -1402,6 +2124,9 @@ void tc_encoder_loop(vob_t *vob, int frame_first, int frame_last)
             if (skip > 0) { /* skip frame */
                 encoder_skip(&encdata, 0);
                 skip--;
+            } else if (encdata.pool != NULL) { /* encode frame in parallel */
+                encoder_pool_submit(&encdata, vob);
+                skip = vob->frame_interval - 1;
             } else { /* encode frame */
                 encoder_export(&encdata, vob);
                 skip = vob->frame_interval - 1;
@@ -1416,6 +2141,11 @@ void tc_encoder_loop(vob_t *vob, int frame_first, int frame_last)
     }
     /* main frame decoding loop */
 
+    if (encdata.pool != NULL) {
+        /* export the frames still in flight */
+        encoder_pool_drain(&encdata, vob);
+    }
+
     if (verbose >= TC_CLEANUP) {
         if (eos) {
             tc_log_info(__FILE__, "encoder last frame finished (%i/%i)",
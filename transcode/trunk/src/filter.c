@@ -10,6 +10,10 @@
 
 #include "transcode.h"
 #include "filter.h"
+#include "frame_threads.h"
+#include "libtcmodule/tcmodule-data.h"
+
+#include <pthread.h>
 
 // temp defines during module system switchover
 //#define SUPPORT_NMS     // support NMS modules?
@@ -38,6 +42,8 @@ typedef struct FilterInstance_ {
 #ifdef SUPPORT_CLASSIC
     void *handle;               // DLL handle for old-style modules
     TCFilterOldEntryFunc entry; // Module entry point for old-style modules
+    TCFilterSliceFunc slice_entry; // Ditto, for slice-capable modules
+    int readonly;               // Nonzero if module never writes frames
 #endif
 #ifdef SUPPORT_NMS
 #error please add field(s) needed for NMS
@@ -51,6 +57,341 @@ static int initialized = 0;
 /* Filter instance table. */
 static FilterInstance filters[MAX_FILTERS];
 
+/*************************************************************************/
+
+/* The filter chain: enabled filters in processing (ID) order, as seen by
+ * tc_filter_process().  A chain is never modified once published; every
+ * change to the filter table builds and publishes a new chain, so the
+ * frame path only has to walk an array and never takes a lock.
+ *
+ * Old chains are reclaimed RCU-style: readers announce themselves on the
+ * reader counter of the current epoch; a writer publishing a new chain
+ * retires the old one, flips the epoch and waits until the readers of
+ * the previous epoch are gone, after which every retired chain can be
+ * freed.  The wait is done without holding chain_lock, since the readers
+ * it waits for may themselves be about to change the table.  A writer
+ * which is itself walking the chain (e.g. a filter disabling itself or
+ * another filter from within tc_filter_process()) must not wait for
+ * other readers at all, since they could be waiting for it in turn; it
+ * only publishes and retires, leaving the reclaiming to the next writer
+ * from outside the chain.  For the same reason, a filter removed from
+ * within the chain is not closed and unloaded right away, but queued
+ * with the retired chains and unloaded along with them.
+ *
+ * The waiting writer sleeps on a condition variable; the reader which
+ * drops the last reference of the epoch being drained wakes it up.
+ * Readers only take the lock while a writer is waiting. */
+
+typedef struct FilterLink_ {
+    int id;                     // Filter ID (frame->filter_id)
+#ifdef SUPPORT_CLASSIC
+    TCFilterOldEntryFunc entry;
+    TCFilterSliceFunc slice_entry;
+    int readonly;
+#endif
+} FilterLink;
+
+typedef struct FilterChain_ FilterChain;
+struct FilterChain_ {
+    int count;                  // Number of valid entries in link[]
+    FilterLink link[MAX_FILTERS];
+    FilterChain *next;          // Next retired chain
+};
+
+/* Currently published chain. */
+static FilterChain * volatile chain = NULL;
+/* Chains replaced but not yet freed. */
+static FilterChain *retired = NULL;
+
+/* Reader counters, indexed by epoch parity. */
+static volatile int epoch = 0;
+static volatile int readers[2] = { 0, 0 };
+/* Per-thread count of chain references held. */
+static pthread_key_t held_key;
+
+/* Serializes chain writers. */
+static pthread_mutex_t chain_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Serializes epoch flips and the waits that follow them; never taken by
+ * a thread walking the chain. */
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Lets the writer sleep until the readers of the previous epoch are
+ * gone; `draining' is nonzero while it does. */
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drained = PTHREAD_COND_INITIALIZER;
+static volatile int draining = 0;
+
+#ifdef SUPPORT_CLASSIC
+/* A filter removed while its module could still be running (see
+ * tc_filter_remove()); closed and unloaded along with the retired
+ * chains. */
+typedef struct FilterUnload_ FilterUnload;
+struct FilterUnload_ {
+    char name[MAX_FILTER_NAME_LEN+1];
+    int id;
+    void *handle;
+    TCFilterOldEntryFunc entry;
+    FilterUnload *next;
+};
+
+/* Filters waiting to be unloaded; protected by chain_lock. */
+static FilterUnload *unloading = NULL;
+#endif
+
+#ifdef HAVE_SYNC_BUILTINS
+# define READERS_ADD(p, n)  __sync_fetch_and_add(&readers[(p)], (n))
+# define READERS_GET(p)     __sync_fetch_and_add(&readers[(p)], 0)
+# define MEMORY_BARRIER()   __sync_synchronize()
+#else
+static pthread_mutex_t readers_lock = PTHREAD_MUTEX_INITIALIZER;
+static int readers_add(int p, int n)
+{
+    int old;
+    pthread_mutex_lock(&readers_lock);
+    old = readers[p];
+    readers[p] += n;
+    pthread_mutex_unlock(&readers_lock);
+    return old;
+}
+# define READERS_ADD(p, n)  readers_add((p), (n))
+# define READERS_GET(p)     readers_add((p), 0)
+# define MEMORY_BARRIER()   do {                                        \
+    pthread_mutex_lock(&readers_lock);                                  \
+    pthread_mutex_unlock(&readers_lock);                                \
+} while (0)
+#endif
+
+/* Drop a reader of the given epoch parity, waking up the writer waiting
+ * for them to drain if it was the last one. */
+static void readers_drop(int parity)
+{
+    if (READERS_ADD(parity, -1) == 1 && draining) {
+        pthread_mutex_lock(&drain_lock);
+        pthread_cond_signal(&drained);
+        pthread_mutex_unlock(&drain_lock);
+    }
+}
+
+static int held_get(void)
+{
+    return (int)(intptr_t)pthread_getspecific(held_key);
+}
+
+static void held_add(int n)
+{
+    pthread_setspecific(held_key, (void *)(intptr_t)(held_get() + n));
+}
+
+/**
+ * chain_get:  Local helper function to get a reference to the current
+ * filter chain.  Must be paired with chain_put().
+ *
+ * Parameters:
+ *     parity: Where to store the epoch parity to pass to chain_put().
+ * Return value:
+ *     The current filter chain (may be NULL if no filters are enabled).
+ */
+
+static FilterChain *chain_get(int *parity)
+{
+    FilterChain *c;
+    int e;
+
+    for (;;) {
+        e = epoch;
+        READERS_ADD(e & 1, 1);
+        if (e == epoch)
+            break;
+        readers_drop(e & 1);  // raced with a writer, try again
+    }
+    held_add(1);
+    c = chain;
+    *parity = e & 1;
+    return c;
+}
+
+/**
+ * chain_put:  Local helper function to release a reference obtained with
+ * chain_get().
+ *
+ * Parameters:
+ *     parity: Value stored by chain_get().
+ * Return value:
+ *     None.
+ */
+
+static void chain_put(int parity)
+{
+    held_add(-1);
+    readers_drop(parity);
+}
+
+#ifdef SUPPORT_CLASSIC
+/**
+ * filter_close:  Local helper function to close a filter and unload its
+ * module.  No thread may be running the filter.
+ *
+ * Parameters:
+ *       name: Filter name (for messages).
+ *         id: Filter ID.
+ *     handle: Module handle.
+ *      entry: Module entry point (may be NULL).
+ * Return value:
+ *     None.
+ */
+
+static void filter_close(const char *name, int id, void *handle,
+                         TCFilterOldEntryFunc entry)
+{
+    if (entry) {
+        frame_list_t ptr;
+        ptr.tag = TC_FILTER_CLOSE;
+        ptr.filter_id = id;
+        entry(&ptr, NULL);
+    } else {
+        tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
+                    " (bug?)", name, id);
+    }
+    dlclose(handle);
+}
+
+/**
+ * unload_list:  Local helper function to close and free a list of
+ * filters queued by tc_filter_remove().
+ *
+ * Parameters:
+ *     list: First filter of the list (may be NULL).
+ * Return value:
+ *     None.
+ */
+
+static void unload_list(FilterUnload *list)
+{
+    while (list) {
+        FilterUnload *next = list->next;
+        filter_close(list->name, list->id, list->handle, list->entry);
+        free(list);
+        list = next;
+    }
+}
+#endif
+
+/**
+ * chain_rebuild:  Local helper function to build a new filter chain from
+ * the filter table, publish it, and wait until no other thread is using
+ * the old one.  On return, no other thread is calling filters not in the
+ * new chain, unless the caller is itself walking the chain (see above).
+ *
+ * Parameters:
+ *     None.
+ * Return value:
+ *     None.
+ */
+
+static void chain_rebuild(void)
+{
+    FilterChain *new_chain, *reclaim;
+#ifdef SUPPORT_CLASSIC
+    FilterUnload *unload;
+#endif
+    int last_id = 0, parity, walking;
+
+    new_chain = tc_zalloc(sizeof(*new_chain));
+    if (!new_chain) {
+        tc_log_error(__FILE__, "chain_rebuild: out of memory!");
+        return;
+    }
+
+    walking = (held_get() > 0);
+    if (!walking)
+        pthread_mutex_lock(&sync_lock);
+    pthread_mutex_lock(&chain_lock);
+
+    /* The order of the filters is given by their ID values--however,
+     * this does not necessarily match the order in the filters[] array.
+     * Each time through the loop, search for the lowest ID greater than
+     * the last one added. */
+    for (;;) {
+        int next_filter = -1, i;
+
+        for (i = 0; i < MAX_FILTERS; i++) {
+            if (filters[i].id <= last_id || !filters[i].enabled)
+                continue;
+            if (next_filter < 0 || filters[i].id < filters[next_filter].id)
+                next_filter = i;
+        }
+        if (next_filter < 0)
+            break;
+        last_id = filters[next_filter].id;
+
+#ifdef SUPPORT_NMS
+# error please write NMS support code
+#endif
+
+#ifdef SUPPORT_CLASSIC
+        if (!filters[next_filter].entry) {
+            tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
+                        " (bug?), disabling", filters[next_filter].name,
+                        last_id);
+            filters[next_filter].enabled = 0;
+            continue;
+        }
+        new_chain->link[new_chain->count].entry =
+            filters[next_filter].entry;
+        new_chain->link[new_chain->count].slice_entry =
+            filters[next_filter].slice_entry;
+        new_chain->link[new_chain->count].readonly =
+            filters[next_filter].readonly;
+#endif
+        new_chain->link[new_chain->count].id = last_id;
+        new_chain->count++;
+    }
+
+    /* Publish and retire the old chain */
+    if (chain) {
+        chain->next = retired;
+        retired = chain;
+    }
+    MEMORY_BARRIER();
+    chain = new_chain;
+    MEMORY_BARRIER();
+    if (walking) {
+        pthread_mutex_unlock(&chain_lock);
+        return;
+    }
+
+    /* Flip the epoch; everything retired so far can only be in use by
+     * readers of the previous one.  Earlier epochs were already waited
+     * for by the previous flip (under sync_lock). */
+    reclaim = retired;
+    retired = NULL;
+#ifdef SUPPORT_CLASSIC
+    unload = unloading;
+    unloading = NULL;
+#endif
+    parity = epoch & 1;
+    epoch++;
+    MEMORY_BARRIER();
+    pthread_mutex_unlock(&chain_lock);
+
+    pthread_mutex_lock(&drain_lock);
+    draining = 1;
+    MEMORY_BARRIER();  // pairs with the decrement in readers_drop()
+    while (READERS_GET(parity) > 0)
+        pthread_cond_wait(&drained, &drain_lock);
+    draining = 0;
+    pthread_mutex_unlock(&drain_lock);
+    pthread_mutex_unlock(&sync_lock);
+
+    while (reclaim) {
+        FilterChain *next = reclaim->next;
+        free(reclaim);
+        reclaim = next;
+    }
+#ifdef SUPPORT_CLASSIC
+    unload_list(unload);
+#endif
+}
+
 
 /* Macro to check that tc_filter_init() has been called, and abort the
  * function otherwise.  Pass the appropriate return value (nothing for a
@@ -117,6 +458,11 @@ int tc_filter_init(void)
     }
     for (i = 0; i < MAX_FILTERS; i++)
         filters[i].id = 0;
+    if (pthread_key_create(&held_key, NULL) != 0) {
+        tc_log_error(__FILE__, "tc_filter_init: can't create thread key");
+        return 0;
+    }
+    chain_rebuild();  // empty chain
     initialized = 1;
     return 1;
 }
@@ -145,6 +491,18 @@ void tc_filter_fini(void)
             tc_filter_remove(filters[i].id);
     }
 
+    free(chain);
+    chain = NULL;
+    while (retired) {
+        FilterChain *next = retired->next;
+        free(retired);
+        retired = next;
+    }
+#ifdef SUPPORT_CLASSIC
+    unload_list(unloading);  // nobody walks the chain anymore
+    unloading = NULL;
+#endif
+    pthread_key_delete(held_key);
     initialized = 0;
 }
 
@@ -164,7 +522,8 @@ void tc_filter_fini(void)
 
 void tc_filter_process(frame_list_t *frame)
 {
-    int last_id;
+    FilterChain *c;
+    int parity, i;
 
     CHECK_INITIALIZED();
     if (!frame) {
@@ -172,43 +531,32 @@ void tc_filter_process(frame_list_t *frame)
         return;
     }
 
-    /* The order of the filters is given by their ID values--however, this
-     * does not necessarily match the order in the filters[] array.  We
-     * keep track of the last ID processed (starting at 0, lower than any
-     * valid ID), then each time through the loop, search for the lowest ID
-     * greater than that value, which will be the next filter to process.
-     * The loop ends when no enabled filter has an ID greater than the last
-     * ID processed. */
+    /* The chain is already sorted and holds only enabled filters;
+     * see chain_rebuild(). */
 
-    last_id = 0;
-    for (;;) {
-        int next_filter = -1, i;
-
-        for (i = 0; i < MAX_FILTERS; i++) {
-            if (filters[i].id <= last_id || !filters[i].enabled)
-                continue;
-            if (next_filter < 0 || filters[i].id < filters[next_filter].id)
-                next_filter = i;
-        }
-        if (next_filter < 0)
-            break;
-        last_id = filters[next_filter].id;
+    c = chain_get(&parity);
+    for (i = 0; c && i < c->count; i++) {
+        const FilterLink *link = &c->link[i];
 
 #ifdef SUPPORT_NMS
 # error please write NMS support code
 #endif
 
 #ifdef SUPPORT_CLASSIC
-        if (!filters[next_filter].entry) {
-            tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
-                        " (bug?), disabling", filters[i].name, last_id);
-            filters[next_filter].enabled = 0;
-            continue;
+        frame->filter_id = link->id;
+        if (!link->readonly && (frame->tag & TC_VIDEO)) {
+            /* don't let the filter scribble over a shared buffer */
+            vframe_make_writable((vframe_list_t *)frame);
         }
-        frame->filter_id = last_id;
-        filters[next_filter].entry(frame, NULL);
+        if (link->slice_entry
+         && tc_frame_threads_slice(frame, link->slice_entry) == TC_OK
+        ) {
+            continue;  // already spread across the video workers
+        }
+        link->entry(frame, NULL);
 #endif
-    }  // for (;;)
+    }
+    chain_put(parity);
 }
 
 /*************************************************************************/
@@ -241,12 +589,25 @@ int tc_filter_add(const char *name, const char *options)
         return 0;
     }
 
-    /* Find the largest ID value currently in use, and use the next value */
+    /* Find the largest ID value currently in use, and use the next value.
+     * Filters waiting to be unloaded still own their IDs: they will get
+     * a TC_FILTER_CLOSE call later. */
     id = 0;
     for (i = 0; i < MAX_FILTERS; i++) {
         if (filters[i].id > id)
             id = filters[i].id;
     }
+#ifdef SUPPORT_CLASSIC
+    {
+        const FilterUnload *u;
+        pthread_mutex_lock(&chain_lock);
+        for (u = unloading; u; u = u->next) {
+            if (u->id > id)
+                id = u->id;
+        }
+        pthread_mutex_unlock(&chain_lock);
+    }
+#endif
     id++;
     if (id <= 0) {  // wraparound check
         tc_log_warn(__FILE__, "tc_filter_add: out of filter IDs, restart %s",
@@ -301,6 +662,28 @@ int tc_filter_add(const char *name, const char *options)
             dlclose(filters[i].handle);
             return 0;
         }
+        {
+            const int *readonly = dlsym(filters[i].handle,
+                                        "tc_filter_readonly");
+            filters[i].readonly = (readonly != NULL && *readonly);
+        }
+        /* New-style modules may tell us they can work on slices */
+        filters[i].slice_entry = NULL;
+        {
+            const TCModuleClass *(*setup)(void) =
+                dlsym(filters[i].handle, "tc_plugin_setup");
+            const TCModuleClass *klass = (setup) ?setup() :NULL;
+
+            if (klass && klass->info
+             && (klass->info->features & TC_MODULE_FEATURE_SLICE)
+            ) {
+                filters[i].slice_entry = dlsym(filters[i].handle,
+                                               "tc_filter_slice");
+                if (filters[i].slice_entry && (verbose & TC_DEBUG))
+                    tc_log_msg(__FILE__, "tc_filter_add: filter %s can"
+                               " process slices", name);
+            }
+        }
         filters[i].id = id;  /* loaded, at least */
         if (verbose & TC_DEBUG)
             tc_log_msg(__FILE__, "tc_filter_add: module %s loaded", path);
@@ -323,6 +706,7 @@ int tc_filter_add(const char *name, const char *options)
 
     /* Module was successfully loaded and initialized, so enable it */
     filters[i].enabled = 1;
+    chain_rebuild();
     return 1;
 }
 
@@ -369,24 +753,45 @@ void tc_filter_remove(int id)
     if ((i = id_to_index(id, __FUNCTION__)) < 0)
         return;
 
+    /* Make sure nobody is running the filter before closing it.  The
+     * filter may also be in a retired chain (e.g. if it was disabled from
+     * within the chain), so rebuild even if it is already disabled. */
+    filters[i].enabled = 0;
+    chain_rebuild();
+
 #ifdef SUPPORT_NMS
 # error please write NMS support code
 #endif
 
 #ifdef SUPPORT_CLASSIC
     if (filters[i].handle) {
-        if (filters[i].entry) {
-            frame_list_t ptr;
-            ptr.tag = TC_FILTER_CLOSE;
-            ptr.filter_id = filters[i].id;
-            filters[i].entry(&ptr, NULL);
+        if (held_get() > 0) {
+            /* We are walking the chain: chain_rebuild() did not wait, so
+             * other threads (or this one, further up the stack) may still
+             * be running the filter.  Leave it to the next writer. */
+            FilterUnload *u = tc_zalloc(sizeof(*u));
+            if (u) {
+                strlcpy(u->name, filters[i].name, sizeof(u->name));
+                u->id = id;
+                u->handle = filters[i].handle;
+                u->entry = filters[i].entry;
+                pthread_mutex_lock(&chain_lock);
+                u->next = unloading;
+                unloading = u;
+                pthread_mutex_unlock(&chain_lock);
+            } else {
+                tc_log_warn(__FILE__, "tc_filter_remove: out of memory,"
+                            " leaving filter %s (%d) loaded",
+                            filters[i].name, id);
+            }
         } else {
-            tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
-                        " (bug?)", filters[i].name, id);
+            filter_close(filters[i].name, id, filters[i].handle,
+                         filters[i].entry);
         }
-        dlclose(filters[i].handle);
         filters[i].handle = NULL;
         filters[i].entry = NULL;
+        filters[i].slice_entry = NULL;
+        filters[i].readonly = 0;
     }
 #endif
 
@@ -414,7 +819,10 @@ int tc_filter_enable(int id)
     i = id_to_index(id, __FUNCTION__);
     if (i < 0)
         return 0;
-    filters[i].enabled = 1;
+    if (!filters[i].enabled) {
+        filters[i].enabled = 1;
+        chain_rebuild();
+    }
     return 1;
 }
 
@@ -437,7 +845,10 @@ int tc_filter_disable(int id)
     i = id_to_index(id, __FUNCTION__);
     if (i < 0)
         return 0;
-    filters[i].enabled = 0;
+    if (filters[i].enabled) {
+        filters[i].enabled = 0;
+        chain_rebuild();
+    }
     return 1;
 }
 
@@ -473,7 +884,7 @@ int tc_filter_configure(int id, const char *options)
         if (!filters[i].entry) {
             tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
                         " (bug?), disabling", filters[i].name, id);
-            filters[i].enabled = 0;
+            tc_filter_disable(id);
             return 0;
         }
         /* Old filter API does a close before reconfiguring */
@@ -487,7 +898,7 @@ int tc_filter_configure(int id, const char *options)
         if (filters[i].entry(&dummy_frame, (char *)options) < 0) {
             tc_log_warn(PACKAGE, "Reconfiguration of filter %s failed,"
                         " disabling.", filters[i].name);
-            filters[i].enabled = 0;
+            tc_filter_disable(id);
             return 0;
         }
         return 1;
@@ -537,7 +948,7 @@ const char *tc_filter_get_conf(int id, const char *option)
         } else {
             tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
                         " (bug?), disabling", filters[i].name, id);
-            filters[i].enabled = 0;
+            tc_filter_disable(id);
         }
         return NULL;
     }
@@ -565,7 +976,7 @@ const char *tc_filter_list(enum tc_filter_list_enum what)
     *buf = 0;
     CHECK_INITIALIZED(buf);
 
-    /* Use the same logic as in tc_filter_process() to retrieve the filters
+    /* Use the same logic as in chain_rebuild() to retrieve the filters
      * in ID order. */
     last_id = 0;
     for (;;) {
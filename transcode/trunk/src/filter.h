@@ -47,6 +47,17 @@ extern const char *tc_filter_list(enum tc_filter_list_enum what);
 typedef int (*TCFilterOldEntryFunc)(void *ptr, char *options);
 extern int tc_filter(frame_list_t *ptr, char *options);
 
+/* Type of the optional entry point exported by slice-capable old-style
+ * modules (see TC_FILTER_OLDINTERFACE_SLICE), and a prototype for it. */
+typedef int (*TCFilterSliceFunc)(void *ptr, int first_row, int num_rows);
+extern int tc_filter_slice(frame_list_t *ptr, int first_row, int num_rows);
+
+/* Old-style modules which never modify the video data (they just look at
+ * it or set frame attributes, like the frame rate changers) may define
+ * this to a nonzero value; the core will then pass them frames sharing
+ * their buffer with other frames as they are (see vframe_dup()). */
+extern const int tc_filter_readonly;
+
 /*************************************************************************/
 
 #endif  /* FILTER_H */
@@ -166,56 +166,451 @@ static int stop_requested(TCFrameThreadData *data)
     tc_frame_threads_stop((DATAP)); \
 } while (0)
 
-static void *process_video_frame(void *_vob)
+/*************************************************************************/
+/*         work-stealing video scheduler                                 */
+/*************************************************************************/
+
+/*
+ * The dispatcher thread reserves the video frames and queues them on
+ * the per-worker frame deques, in round-robin. Each worker takes frames
+ * from the head of its own frame deque, so they are filtered in the
+ * order they were dispatched, and slices from the tail of its own slice
+ * deque, the most recently queued bands being the ones still in cache.
+ * When its deques are empty, a worker steals from the head of the other
+ * workers' ones.
+ * A worker running a slice-capable filter queues the bands of the frame
+ * on its own slice deque, so idle workers can steal them; slices are
+ * always preferred over whole frames, to finish in-flight frames first.
+ *
+ * Deques are tiny and held for a handful of instructions, so they are
+ * just mutex-protected. The scheduler lock is used to count the queued
+ * tasks and to park idle threads.
+ */
+
+#define TC_SCHED_DEQUE_SIZE     64
+#define TC_SCHED_FRAMES_PER_WORKER  2  /* max in-flight frames per worker */
+#define TC_SLICE_MIN_ROWS       16
+
+typedef struct tcslicejob_ TCSliceJob;
+struct tcslicejob_ {
+    TCSliceFunc         func;
+    void                *data;
+
+    pthread_mutex_t     lock;
+    pthread_cond_t      done;
+    int                 pending;    /* bands not yet completed */
+};
+
+typedef struct tcframetask_ TCFrameTask;
+struct tcframetask_ {
+    vframe_list_t       *frame;     /* whole frame task... */
+    TCSliceJob          *job;       /* ...or band of a frame */
+    int                 first_row;
+    int                 num_rows;
+};
+
+typedef struct tctaskdeque_ TCTaskDeque;
+struct tctaskdeque_ {
+    pthread_mutex_t     lock;
+    TCFrameTask         tasks[TC_SCHED_DEQUE_SIZE];
+    int                 head;       /* oldest task */
+    int                 count;
+};
+
+typedef struct tcvideoworker_ TCVideoWorker;
+struct tcvideoworker_ {
+    int                 index;
+    TCTaskDeque         frames;
+    TCTaskDeque         slices;
+};
+
+typedef struct tcvideosched_ TCVideoSched;
+struct tcvideosched_ {
+    TCVideoWorker       workers[TC_FRAME_THREADS_MAX];
+    int                 count;
+    vob_t               *vob;
+
+    pthread_t           dispatcher;
+    pthread_key_t       self;       /* TCVideoWorker of calling thread */
+
+    pthread_mutex_t     lock;       /* guards the fields below */
+    pthread_cond_t      work;       /* signaled when a task is queued */
+    pthread_cond_t      room;       /* signaled when a frame completes */
+    int                 queued;     /* tasks sitting in the deques */
+    int                 in_flight;  /* frames dispatched, not completed */
+    int                 done;       /* no more frames will come */
+};
+
+static TCVideoSched video_sched;
+
+
+static void tc_task_deque_init(TCTaskDeque *D)
+{
+    pthread_mutex_init(&D->lock, NULL);
+    D->head  = 0;
+    D->count = 0;
+}
+
+static int tc_task_deque_push(TCTaskDeque *D, const TCFrameTask *task)
+{
+    int ret = TC_ERROR;
+
+    pthread_mutex_lock(&D->lock);
+    if (D->count < TC_SCHED_DEQUE_SIZE) {
+        D->tasks[(D->head + D->count) % TC_SCHED_DEQUE_SIZE] = *task;
+        D->count++;
+        ret = TC_OK;
+    }
+    pthread_mutex_unlock(&D->lock);
+    return ret;
+}
+
+/* tail side: LIFO, keeps the caches warm; owner only, for slices */
+static int tc_task_deque_pop(TCTaskDeque *D, TCFrameTask *task)
+{
+    int ret = TC_FALSE;
+
+    pthread_mutex_lock(&D->lock);
+    if (D->count > 0) {
+        D->count--;
+        *task = D->tasks[(D->head + D->count) % TC_SCHED_DEQUE_SIZE];
+        ret = TC_TRUE;
+    }
+    pthread_mutex_unlock(&D->lock);
+    return ret;
+}
+
+/*
+ * head side: FIFO, takes the oldest work; used by thieves, and by the
+ * owner for frames, which must not be reordered
+ */
+static int tc_task_deque_take(TCTaskDeque *D, TCFrameTask *task)
+{
+    int ret = TC_FALSE;
+
+    pthread_mutex_lock(&D->lock);
+    if (D->count > 0) {
+        *task   = D->tasks[D->head];
+        D->head = (D->head + 1) % TC_SCHED_DEQUE_SIZE;
+        D->count--;
+        ret = TC_TRUE;
+    }
+    pthread_mutex_unlock(&D->lock);
+    return ret;
+}
+
+static void sched_task_queued(TCVideoSched *S)
+{
+    pthread_mutex_lock(&S->lock);
+    S->queued++;
+    pthread_cond_signal(&S->work);
+    pthread_mutex_unlock(&S->lock);
+}
+
+/*
+ * sched_get_task: fetch the next task for the given worker, looking
+ * first at its own deques, then stealing from the others.
+ * If `slices_only' is !0, whole frames are left alone.
+ */
+static int sched_get_task(TCVideoSched *S, TCVideoWorker *W,
+                          TCFrameTask *task, int slices_only)
+{
+    int found = tc_task_deque_pop(&W->slices, task);
+    int i = 0;
+
+    for (i = 1; !found && i < S->count; i++) {
+        found = tc_task_deque_take(&S->workers[(W->index + i) % S->count].slices,
+                                   task);
+    }
+    if (!found && !slices_only) {
+        found = tc_task_deque_take(&W->frames, task);
+        for (i = 1; !found && i < S->count; i++) {
+            found = tc_task_deque_take(&S->workers[(W->index + i) % S->count].frames,
+                                       task);
+        }
+    }
+    if (found) {
+        pthread_mutex_lock(&S->lock);
+        S->queued--;
+        pthread_mutex_unlock(&S->lock);
+    }
+    return found;
+}
+
+static void slice_job_complete(TCSliceJob *job)
+{
+    pthread_mutex_lock(&job->lock);
+    job->pending--;
+    if (job->pending == 0) {
+        pthread_cond_signal(&job->done);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static int slice_job_pending(TCSliceJob *job)
+{
+    int pending = 0;
+    pthread_mutex_lock(&job->lock);
+    pending = job->pending;
+    pthread_mutex_unlock(&job->lock);
+    return pending;
+}
+
+static void run_slice_task(TCFrameTask *task)
+{
+    TCSliceJob *job = task->job;
+
+    job->func(job->data, task->first_row, task->num_rows);
+    slice_job_complete(job);
+}
+
+int tc_frame_threads_run_slices(TCSliceFunc func, void *data, int rows)
+{
+    TCVideoSched *S = &video_sched;
+    TCVideoWorker *W = NULL;
+    TCFrameTask task;
+    TCSliceJob job;
+    int band = 0, slices = 0, row = 0;
+
+    if (func == NULL || S->count < 2) {
+        return TC_ERROR;
+    }
+    W = pthread_getspecific(S->self);
+    if (W == NULL) {
+        return TC_ERROR; /* not called from a video worker */
+    }
+
+    slices = TC_MIN(S->count, rows / TC_SLICE_MIN_ROWS);
+    if (slices < 2) {
+        return TC_ERROR;
+    }
+    /* keep bands even-sized for the subsampled chroma planes */
+    band = ((rows + slices - 1) / slices + 1) & ~1;
+
+    job.func    = func;
+    job.data    = data;
+    job.pending = (rows + band - 1) / band;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.done, NULL);
+
+    /* queue all bands but the first, which we'll do ourselves */
+    for (row = band; row < rows; row += band) {
+        task.frame     = NULL;
+        task.job       = &job;
+        task.first_row = row;
+        task.num_rows  = TC_MIN(band, rows - row);
+
+        if (tc_task_deque_push(&W->slices, &task) == TC_OK) {
+            sched_task_queued(S);
+        } else {
+            run_slice_task(&task); /* can't happen, but be safe */
+        }
+    }
+    func(data, 0, band);
+    slice_job_complete(&job);
+
+    /* help the thieves (or take back our bands) until the frame is done */
+    while (slice_job_pending(&job) > 0) {
+        if (sched_get_task(S, W, &task, TC_TRUE)) {
+            run_slice_task(&task);
+        } else {
+            pthread_mutex_lock(&job.lock);
+            while (job.pending > 0) {
+                pthread_cond_wait(&job.done, &job.lock);
+            }
+            pthread_mutex_unlock(&job.lock);
+        }
+    }
+
+    pthread_cond_destroy(&job.done);
+    pthread_mutex_destroy(&job.lock);
+    return TC_OK;
+}
+
+/* a filter slice entry point, seen as a generic slice function */
+typedef struct tcfilterslice_ TCFilterSlice;
+struct tcfilterslice_ {
+    frame_list_t        *frame;
+    TCFilterSliceFunc   func;
+};
+
+static void run_filter_slice(void *data, int first_row, int num_rows)
+{
+    TCFilterSlice *fs = data;
+
+    fs->func(fs->frame, first_row, num_rows);
+}
+
+int tc_frame_threads_slice(frame_list_t *frame, TCFilterSliceFunc func)
+{
+    TCFilterSlice fs;
+
+    if (frame == NULL || func == NULL || !(frame->tag & TC_VIDEO)) {
+        return TC_ERROR;
+    }
+    fs.frame = frame;
+    fs.func  = func;
+    return tc_frame_threads_run_slices(run_filter_slice, &fs,
+                                       ((vframe_list_t *)frame)->v_height);
+}
+
+/*
+ * process_video_frame: apply the whole filter chain to a video frame,
+ * then pass it to the encoder.
+ */
+static void process_video_frame(vob_t *vob, vframe_list_t *ptr)
+{
+    if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
+        vframe_remove(ptr);  /* release frame buffer memory */
+        return;
+    }
+
+    if (TC_FRAME_NEED_PROCESSING(ptr)) {
+        // external plugin pre-processing
+        ptr->tag = TC_VIDEO|TC_PRE_M_PROCESS;
+        tc_filter_process((frame_list_t *)ptr);
+
+        if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
+            vframe_remove(ptr);  /* release frame buffer memory */
+            return;
+        }
+
+        // clone if the filter told us to do so.
+        DUP_vptr_if_cloned(ptr);
+
+        // internal processing of video
+        ptr->tag = TC_VIDEO;
+        process_vid_frame(vob, ptr);
+
+        // external plugin post-processing
+        ptr->tag = TC_VIDEO|TC_POST_M_PROCESS;
+        tc_filter_process((frame_list_t *)ptr);
+
+        if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
+            vframe_remove(ptr);  /* release frame buffer memory */
+            return;
+        }
+    }
+
+    vframe_push_next(ptr, TC_FRAME_READY);
+}
+
+static void sched_frame_done(TCVideoSched *S)
+{
+    pthread_mutex_lock(&S->lock);
+    S->in_flight--;
+    pthread_cond_signal(&S->room);
+    pthread_mutex_unlock(&S->lock);
+}
+
+static void sched_set_done(TCVideoSched *S)
+{
+    pthread_mutex_lock(&S->lock);
+    S->done = TC_TRUE;
+    pthread_cond_broadcast(&S->work);
+    pthread_cond_broadcast(&S->room);
+    pthread_mutex_unlock(&S->lock);
+}
+
+static void *dispatch_video_frames(void *_sched)
 {
     static int res = 0; // XXX
+    TCVideoSched *S = _sched;
     vframe_list_t *ptr = NULL;
-    vob_t *vob = _vob;
+    TCFrameTask task;
+    int next = 0, i = 0;
 
     while (!stop_requested(&video_threads)) {
+        int done = TC_FALSE, eos = TC_FALSE;
+
+        /* don't hoard frames: let the workers catch up */
+        pthread_mutex_lock(&S->lock);
+        while (!S->done
+         && S->in_flight >= S->count * TC_SCHED_FRAMES_PER_WORKER) {
+            pthread_cond_wait(&S->room, &S->lock);
+        }
+        done = S->done;
+        pthread_mutex_unlock(&S->lock);
+        if (done) {
+            break; /* shutdown requested while waiting */
+        }
+
         ptr = vframe_reserve();
         if (ptr == NULL) {
             SET_STOP_FLAG(&video_threads, "video interrupted: exiting!");
             res = 1;
             break;
         }
-        if (ptr->attributes & TC_FRAME_IS_END_OF_STREAM) {
-            SET_STOP_FLAG(&video_threads, "video stream end: marking!");
-        }
-
-        if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
-            vframe_remove(ptr);  /* release frame buffer memory */
-            continue;
-        }
 
-        if (TC_FRAME_NEED_PROCESSING(ptr)) {
-            // external plugin pre-processing
-            ptr->tag = TC_VIDEO|TC_PRE_M_PROCESS;
-            tc_filter_process((frame_list_t *)ptr);
-
-            if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
-                vframe_remove(ptr);  /* release frame buffer memory */
-                continue;
+        task.frame     = ptr;
+        task.job       = NULL;
+        task.first_row = 0;
+        task.num_rows  = 0;
+        /* ptr belongs to the workers once queued: don't look at it later */
+        eos = (ptr->attributes & TC_FRAME_IS_END_OF_STREAM);
+
+        pthread_mutex_lock(&S->lock);
+        S->in_flight++;
+        pthread_mutex_unlock(&S->lock);
+
+        for (i = 0; i < S->count; i++) {
+            TCVideoWorker *W = &S->workers[(next + i) % S->count];
+            if (tc_task_deque_push(&W->frames, &task) == TC_OK) {
+                break;
             }
+        }
+        next = (next + 1) % S->count;
+        if (i < S->count) {
+            sched_task_queued(S);
+        } else {
+            /*
+             * every deque is full: can't happen while the in-flight
+             * limit stays below TC_SCHED_DEQUE_SIZE, but never drop
+             * the frame; process it here, which also throttles us.
+             */
+            process_video_frame(S->vob, ptr);
+            sched_frame_done(S);
+        }
 
-            // clone if the filter told us to do so.
-            DUP_vptr_if_cloned(ptr);
+        if (eos) {
+            SET_STOP_FLAG(&video_threads, "video stream end: marking!");
+        }
+    }
+    sched_set_done(S);
 
-            // internal processing of video
-            ptr->tag = TC_VIDEO;
-            process_vid_frame(vob, ptr);
+    if (verbose >= TC_CLEANUP)
+        tc_log_msg(__FILE__, "video dispatcher: no more frames, exiting!");
 
-            // external plugin post-processing
-            ptr->tag = TC_VIDEO|TC_POST_M_PROCESS;
-            tc_filter_process((frame_list_t *)ptr);
+    pthread_exit(&res);
+    return NULL;
+}
 
-            if (ptr->attributes & TC_FRAME_IS_SKIPPED) {
-                vframe_remove(ptr);  /* release frame buffer memory */
-                continue;
+static void *video_worker_thread(void *_worker)
+{
+    static int res = 0; // XXX
+    TCVideoSched *S = &video_sched;
+    TCVideoWorker *W = _worker;
+    TCFrameTask task;
+    int stop = TC_FALSE;
+
+    pthread_setspecific(S->self, W);
+
+    while (!stop) {
+        if (sched_get_task(S, W, &task, TC_FALSE)) {
+            if (task.job != NULL) {
+                run_slice_task(&task);
+            } else {
+                process_video_frame(S->vob, task.frame);
+                sched_frame_done(S);
+            }
+        } else {
+            pthread_mutex_lock(&S->lock);
+            while (S->queued == 0 && !S->done) {
+                pthread_cond_wait(&S->work, &S->lock);
             }
+            stop = (S->queued == 0 && S->done);
+            pthread_mutex_unlock(&S->lock);
         }
-
-        vframe_push_next(ptr, TC_FRAME_READY);
     }
     if (verbose >= TC_CLEANUP)
         tc_log_msg(__FILE__, "video stream end: got, so exiting!");
@@ -224,6 +619,26 @@ static void *process_video_frame(void *_vob)
     return NULL;
 }
 
+static void tc_video_sched_init(TCVideoSched *S, vob_t *vob, int workers)
+{
+    int n = 0;
+
+    S->count     = workers;
+    S->vob       = vob;
+    S->queued    = 0;
+    S->in_flight = 0;
+    S->done      = TC_FALSE;
+    pthread_mutex_init(&S->lock, NULL);
+    pthread_cond_init(&S->work, NULL);
+    pthread_cond_init(&S->room, NULL);
+    pthread_key_create(&S->self, NULL);
+
+    for (n = 0; n < workers; n++) {
+        S->workers[n].index = n;
+        tc_task_deque_init(&S->workers[n].frames);
+        tc_task_deque_init(&S->workers[n].slices);
+    }
+}
 
 static void *process_audio_frame(void *_vob)
 {
@@ -308,12 +723,18 @@ void tc_frame_threads_init(vob_t *vob, int vworkers, int aworkers)
             tc_log_info(__FILE__, "starting %i video frame"
                                  " processing thread(s)", vworkers);
 
+        tc_video_sched_init(&video_sched, vob, vworkers);
+
         // start the thread pool
         for (n = 0; n < vworkers; n++) {
             if (pthread_create(&video_threads.threads[n], NULL,
-                               process_video_frame, vob) != 0)
+                               video_worker_thread,
+                               &video_sched.workers[n]) != 0)
                 tc_error("failed to start video frame processing thread");
         }
+        if (pthread_create(&video_sched.dispatcher, NULL,
+                           dispatch_video_frames, &video_sched) != 0)
+            tc_error("failed to start video frame dispatcher thread");
     }
 
     if (aworkers > 0 && !audio_threads.running) {
@@ -352,11 +773,14 @@ void tc_frame_threads_close(void)
 
     if (video_threads.count > 0) {
         tc_frame_threads_stop(&video_threads);
+        sched_set_done(&video_sched);
         if (verbose >= TC_CLEANUP)
             tc_log_msg(__FILE__, "wait for %i video frame processing threads",
                        video_threads.count);
+        pthread_join(video_sched.dispatcher, &status);
         for (n = 0; n < video_threads.count; n++)
             pthread_join(video_threads.threads[n], &status);
+        pthread_key_delete(video_sched.self);
         if (verbose >= TC_CLEANUP)
             tc_log_msg(__FILE__, "video frame processing threads canceled");
     }
@@ -26,6 +26,7 @@
 #define FRAME_THREADS_H
 
 #include "transcode.h"
+#include "filter.h"
 
 /*
  * SUMMARY:
@@ -36,6 +37,12 @@
  * It is important to note that each thread is equivalent to each
  * other, and each one will take care of one frame and applies to
  * it the whole filter chain.
+ *
+ * Video threads are driven by a work-stealing scheduler: a dispatcher
+ * thread feeds the frames to the workers' task queues, and idle workers
+ * steal work from the busy ones. Besides whole frames, the stolen work
+ * can be a band of rows of a frame being processed by a slice-capable
+ * filter (see tc_frame_threads_slice below).
  */
 
 /*
@@ -81,4 +88,46 @@ void tc_frame_threads_close(void);
 int tc_frame_threads_have_video_workers(void);
 int tc_frame_threads_have_audio_workers(void);
 
+/*
+ * tc_frame_threads_slice (thread safe):
+ *     run a slice-capable filter over the given video frame, by splitting
+ *     it into horizontal bands which are processed concurrently by the
+ *     video worker threads. The calling thread processes bands too, and
+ *     returns only when the whole frame is done.
+ *
+ * Parameters:
+ *     frame: video frame to be processed.
+ *      func: slice entry point of the filter.
+ * Return Value:
+ *      TC_OK: the frame was processed.
+ *   TC_ERROR: the frame can't be sliced here (the caller is not a
+ *             video worker, there is only one worker, the frame is
+ *             too small...). The caller must process it as a whole.
+ */
+int tc_frame_threads_slice(frame_list_t *frame, TCFilterSliceFunc func);
+
+/*
+ * TCSliceFunc: processes `num_rows' rows of some job, starting from
+ * `first_row'; `data' describes the job.
+ */
+typedef void (*TCSliceFunc)(void *data, int first_row, int num_rows);
+
+/*
+ * tc_frame_threads_run_slices (thread safe):
+ *     generic form of tc_frame_threads_slice: split the `rows' rows of
+ *     a job into bands, processed concurrently by the video worker
+ *     threads (including the calling one).
+ *     Used by internal video processing (e.g. zoom).
+ *
+ * Parameters:
+ *     func: band processing function.
+ *     data: opaque job data given to `func'.
+ *     rows: number of rows of the job.
+ * Return Value:
+ *      TC_OK: the job was done.
+ *   TC_ERROR: the job can't be sliced here (as for tc_frame_threads_slice)
+ *             and the caller must run func(data, 0, rows) itself.
+ */
+int tc_frame_threads_run_slices(TCSliceFunc func, void *data, int rows);
+
 #endif /* FRAME_THREADS_H */
@@ -22,6 +22,14 @@
 
 #include <pthread.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if defined(HAVE_NUMAIF_H)
+#include <numaif.h>
+#include <sys/syscall.h>
+#endif
+
 #include "transcode.h"
 #include "tc_defaults.h"
 #include "framebuffer.h"
@@ -159,30 +167,237 @@ void tc_framebuffer_set_specs(const TCFrameSpecs *specs)
 
 #define TCFRAMEPTR_IS_NULL(tcf)    (tcf.generic == NULL)
 
+/*
+ * Frame arena: when enabled, all the frames of a ringbuffer are carved
+ * out of a single memory block instead of being allocated one by one.
+ * The block is mmap()ed, so it can be backed by huge pages (explicit
+ * ones or transparent ones) and optionally bound to a NUMA node.
+ * When bound, it is prefaulted, so the first pass through the ring
+ * doesn't pay page faults; otherwise the pages are left to be placed
+ * on first touch, by the threads which actually fill the frames.
+ * Each frame is laid out as descriptor + buffer(s), TC_FRAME_ALIGN-aligned.
+ * Ring frames are partial: they have no second video buffer
+ * (video_buf_Y[1] and friends are NULL), so there is nothing else to
+ * carve for them.
+ */
+
+#define TC_FRAME_ARENA_ALIGN    (2 * 1024 * 1024) /* common huge page size */
+
+typedef struct tcframearena_ TCFrameArena;
+struct tcframearena_ {
+    uint8_t *base;
+    size_t  size;   /* total size of the block */
+    size_t  used;   /* carved so far */
+    int     mapped; /* !0: base comes from mmap() */
+};
+
+static TCFrameArena tc_video_arena = { NULL, 0, 0, 0 };
+static TCFrameArena tc_audio_arena = { NULL, 0, 0, 0 };
+
+static TCFrameArenaMode arena_mode = TC_FRAMEBUFFER_ARENA_OFF;
+static int arena_node = -1;
+
+int tc_framebuffer_set_arena(TCFrameArenaMode mode, int node)
+{
+    switch (mode) {
+      case TC_FRAMEBUFFER_ARENA_OFF:
+      case TC_FRAMEBUFFER_ARENA_ON:
+      case TC_FRAMEBUFFER_ARENA_HUGE:
+        break;
+      default:
+        tc_log_warn(FRBUF_NAME, "set_arena: unknown mode (%i)", mode);
+        return TC_ERROR;
+    }
+#if !defined(HAVE_NUMAIF_H) || !defined(SYS_mbind)
+    if (node >= 0) {
+        tc_log_warn(FRBUF_NAME, "NUMA binding not supported"
+                                " on this platform");
+        return TC_ERROR;
+    }
+#endif
+    arena_mode = mode;
+    arena_node = node;
+    return TC_OK;
+}
+
+/* return !0 if the arena pages are bound to a NUMA node */
+static int tc_frame_arena_bind(TCFrameArena *A)
+{
+#if defined(HAVE_NUMAIF_H) && defined(SYS_mbind)
+    unsigned long nodemask = 0;
+
+    if (arena_node < 0) {
+        return TC_FALSE; /* let the kernel place pages on first touch */
+    }
+    if (arena_node >= (int)(sizeof(nodemask) * 8)) {
+        tc_log_warn(FRBUF_NAME, "NUMA node %i out of range", arena_node);
+        return TC_FALSE;
+    }
+    nodemask = 1UL << arena_node;
+    if (syscall(SYS_mbind, A->base, A->size, MPOL_PREFERRED,
+                &nodemask, sizeof(nodemask) * 8, 0) != 0) {
+        tc_log_warn(FRBUF_NAME, "can't bind frame arena to NUMA node %i",
+                    arena_node);
+        return TC_FALSE;
+    }
+    return TC_TRUE;
+#else
+    return TC_FALSE;
+#endif
+}
+
+/*
+ * tc_frame_arena_init:
+ *      acquire a memory block large enough to hold `size' bytes of
+ *      frames. On failure, the arena is left empty, and frames will
+ *      be allocated one by one as usual.
+ */
+static int tc_frame_arena_init(TCFrameArena *A, const char *tag, size_t size)
+{
+    int huge = TC_FALSE;
+
+    A->base = NULL;
+    A->used = 0;
+    A->size = (size + TC_FRAME_ARENA_ALIGN - 1)
+              & ~((size_t)TC_FRAME_ARENA_ALIGN - 1);
+
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+    {
+        void *mem = MAP_FAILED;
+# ifdef MAP_HUGETLB
+        if (arena_mode == TC_FRAMEBUFFER_ARENA_HUGE) {
+            mem = mmap(NULL, A->size, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+            if (mem == MAP_FAILED) {
+                tc_log_info(FRBUF_NAME, "(%s) no huge pages available,"
+                                        " using normal pages", tag);
+            } else {
+                huge = TC_TRUE;
+            }
+        }
+# endif
+        if (mem == MAP_FAILED) {
+            mem = mmap(NULL, A->size, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        }
+        if (mem != MAP_FAILED) {
+            A->base   = mem;
+            A->mapped = TC_TRUE;
+# ifdef MADV_HUGEPAGE
+            if (!huge) {
+                madvise(A->base, A->size, MADV_HUGEPAGE); /* just a hint */
+            }
+# endif
+        }
+    }
+#endif
+    if (A->base == NULL) {
+        A->base   = tc_bufalloc(A->size);
+        A->mapped = TC_FALSE;
+    }
+    if (A->base == NULL) {
+        tc_log_warn(FRBUF_NAME, "(%s) can't allocate frame arena"
+                                " (%lu bytes)", tag, (unsigned long)A->size);
+        A->size = 0;
+        return TC_ERROR;
+    }
+
+    if (tc_frame_arena_bind(A)) {
+        /* placement is fixed by the policy, whoever touches first */
+        memset(A->base, 0, A->size);
+    }
+
+    if (verbose >= TC_DEBUG) {
+        tc_log_info(FRBUF_NAME, "(%s) frame arena: %lu bytes at %p%s",
+                    tag, (unsigned long)A->size, A->base,
+                    (huge) ?" (huge pages)" :"");
+    }
+    return TC_OK;
+}
+
+static void tc_frame_arena_fini(TCFrameArena *A)
+{
+    if (A->base != NULL) {
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+        if (A->mapped) {
+            munmap(A->base, A->size);
+        } else
+#endif
+        {
+            tc_buffree(A->base);
+        }
+    }
+    A->base = NULL;
+    A->size = 0;
+    A->used = 0;
+}
+
+static void *tc_frame_arena_carve(TCFrameArena *A, size_t size)
+{
+    void *ptr = NULL;
+
+    if (A->base != NULL && A->used + size <= A->size) {
+        ptr = A->base + A->used;
+        A->used += size;
+    }
+    return ptr;
+}
+
+static int tc_frame_arena_owns(const TCFrameArena *A, const void *ptr)
+{
+    return (A->base != NULL
+            && (const uint8_t *)ptr >= A->base
+            && (const uint8_t *)ptr <  A->base + A->size);
+}
+
+/*************************************************************************/
+
 static TCFramePtr tc_video_alloc(const TCFrameSpecs *specs)
 {
     TCFramePtr frame;
-    frame.video = tc_new_video_frame(specs->width, specs->height,
-                                      specs->format, TC_TRUE);
+    size_t size = tc_video_frame_mem_size(specs->width, specs->height,
+                                          specs->format, TC_TRUE);
+    void *mem = tc_frame_arena_carve(&tc_video_arena, size);
+
+    if (mem != NULL) {
+        frame.video = tc_new_video_frame_at(mem, specs->width, specs->height,
+                                            specs->format, TC_TRUE);
+    } else {
+        frame.video = tc_new_video_frame(specs->width, specs->height,
+                                         specs->format, TC_TRUE);
+    }
     return frame;
 }
 
 static TCFramePtr tc_audio_alloc(const TCFrameSpecs *specs)
 {
     TCFramePtr frame;
-    frame.audio = tc_new_audio_frame(specs->samples, specs->channels,
-                                     specs->bits);
+    size_t size = tc_audio_frame_mem_size(specs->samples, specs->channels,
+                                          specs->bits);
+    void *mem = tc_frame_arena_carve(&tc_audio_arena, size);
+
+    if (mem != NULL) {
+        frame.audio = tc_new_audio_frame_at(mem, specs->samples,
+                                            specs->channels, specs->bits);
+    } else {
+        frame.audio = tc_new_audio_frame(specs->samples, specs->channels,
+                                         specs->bits);
+    }
     return frame;
 }
 
 static void tc_video_free(TCFramePtr frame)
 {
-    tc_del_video_frame(frame.video);
+    if (!tc_frame_arena_owns(&tc_video_arena, frame.video)) {
+        tc_del_video_frame(frame.video);
+    }
 }
 
 static void tc_audio_free(TCFramePtr frame)
 {
-    tc_del_audio_frame(frame.audio);
+    if (!tc_frame_arena_owns(&tc_audio_arena, frame.audio)) {
+        tc_del_audio_frame(frame.audio);
+    }
 }
 
 vframe_list_t *vframe_alloc_single(void)
@@ -199,26 +414,45 @@ aframe_list_t *aframe_alloc_single(void)
 
 /*************************************************************************/
 
+/* TCFrameFifo flavours, to be ORed together */
+enum {
+    TC_FRAME_FIFO_PLAIN    = 0,
+    TC_FRAME_FIFO_SORTED   = 1, /* frames are delivered in bufid order */
+    TC_FRAME_FIFO_LOCKFREE = 2, /* no external locking needed          */
+};
+
 typedef struct tcframefifo_ TCFrameFifo;
 struct tcframefifo_ {
     TCFramePtr  *frames;
     int         size;
-    int         num;
-    int         first;
+    volatile int num;
+    volatile int first;
     int         last;
 
-    int         *avalaible;
+    volatile int *avalaible;
     int         (*len)(TCFrameFifo *F);
     TCFramePtr  (*get)(TCFrameFifo *F);
     int         (*put)(TCFrameFifo *F, TCFramePtr ptr);
+
+    /* lock-free plain variant only */
+    int         lockfree;
+    volatile unsigned long *seqs; /* per-slot sequence numbers */
+    unsigned long mask;           /* slots - 1; slots is a power of 2 */
+    volatile unsigned long head;  /* next slot to get */
+    volatile unsigned long tail;  /* next slot to put */
 };
 
 STATIC void tc_frame_fifo_dump_status(TCFrameFifo *F, const char *tag)
 {
     int i = 0;
-    tc_log_msg(FPOOL_NAME, "(%s|fifo|%s) size=%i num=%i first=%i last=%i",
+    tc_log_msg(FPOOL_NAME, "(%s|fifo|%s%s) size=%i num=%i first=%i last=%i",
                tag, (F->avalaible) ?"sorted" :"plain",
+               (F->lockfree) ?"|lockfree" :"",
                F->size, F->num, F->first, F->last);
+    if (F->seqs) {
+        tc_log_msg(FPOOL_NAME, "(%s|fifo) slots=%lu head=%lu tail=%lu",
+                   tag, F->mask + 1, F->head, F->tail);
+    }
 
     for (i = 0; i < F->size; i++) {
         frame_list_t *ptr = F->frames[i].generic;
@@ -320,35 +554,241 @@ static int fifo_put_sorted(TCFrameFifo *F, TCFramePtr ptr)
     return ret;
 }
 
-STATIC TCFrameFifo *tc_frame_fifo_new(int size, int sorted)
+#ifdef HAVE_SYNC_BUILTINS
+
+/*
+ * Lock-free flavours of the fifo above. Any number of threads can
+ * put and get concurrently without holding the pool lock; the lock is
+ * only needed to park a thread when the fifo is empty (see
+ * tc_frame_pool_get_frame).
+ *
+ * The plain variant is a bounded MPMC queue where each slot carries a
+ * sequence number telling if it is ready to be filled (seq == pos)
+ * or to be drained (seq == pos + 1) for the current lap.
+ * The sorted variant exploits the fact that every bufid maps to its own
+ * slot, so producers never contend; consumers race only on `first'.
+ */
+
+static int fifo_len_lockfree(TCFrameFifo *F)
+{
+    return F->num;
+}
+
+static TCFramePtr fifo_get_lockfree(TCFrameFifo *F)
+{
+    TCFramePtr ptr = { .generic = NULL };
+    unsigned long pos = F->head;
+
+    while (1) {
+        long diff = (long)(F->seqs[pos & F->mask] - (pos + 1));
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&F->head, pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return ptr; /* empty */
+        }
+        pos = F->head;
+    }
+
+    ptr = F->frames[pos & F->mask];
+    __sync_synchronize(); /* read the frame before releasing the slot */
+    F->seqs[pos & F->mask] = pos + F->mask + 1;
+    __sync_fetch_and_sub(&F->num, 1);
+    return ptr;
+}
+
+static int fifo_put_lockfree(TCFrameFifo *F, TCFramePtr ptr)
+{
+    unsigned long pos = F->tail;
+
+    while (1) {
+        long diff = (long)(F->seqs[pos & F->mask] - pos);
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&F->tail, pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* either `pos' is stale, a late consumer is still
+             * releasing this slot, or we are really full */
+            if (pos == F->tail
+             && (long)(pos - F->head) >= (long)(F->mask + 1)) {
+                return 0;
+            }
+        }
+        pos = F->tail;
+    }
+
+    F->frames[pos & F->mask] = ptr;
+    __sync_synchronize(); /* publish the frame before the slot */
+    F->seqs[pos & F->mask] = pos + 1;
+    __sync_fetch_and_add(&F->num, 1);
+    return 1;
+}
+
+static int fifo_len_sorted_lockfree(TCFrameFifo *F)
+{
+    return F->avalaible[F->first];
+}
+
+static TCFramePtr fifo_get_sorted_lockfree(TCFrameFifo *F)
+{
+    TCFramePtr ptr = { .generic = NULL };
+    int first = F->first;
+
+    while (F->avalaible[first]) {
+        if (__sync_bool_compare_and_swap(&F->first, first,
+                                         (first + 1) % F->size)) {
+            ptr = F->frames[first];
+            __sync_synchronize();
+            F->avalaible[first] = TC_FALSE;
+            __sync_fetch_and_sub(&F->num, 1);
+            break;
+        }
+        first = F->first;
+    }
+    return ptr;
+}
+
+static int fifo_put_sorted_lockfree(TCFrameFifo *F, TCFramePtr ptr)
+{
+    int bufid = ptr.generic->bufid;
+    int first;
+
+    F->frames[bufid] = ptr;
+    if (ptr.generic->attributes & TC_FRAME_WAS_CLONED) {
+        /*
+         * roll back, we want the same frame again. This is done before
+         * the slot is marked available, so consumers can't go past it
+         * meanwhile: `first' can only be ahead of `bufid' here, and the
+         * CAS only ever moves it backwards, racing with consumers
+         * moving it forward.
+         */
+        first = F->first;
+        while (first != bufid) {
+            int seen = __sync_val_compare_and_swap(&F->first, first, bufid);
+            first = (seen == first) ?bufid :seen;
+        }
+    }
+    __sync_synchronize();
+    F->avalaible[bufid] = TC_TRUE;
+    /* full barrier: callers peek the waiters count right after */
+    __sync_fetch_and_add(&F->num, 1);
+    if (!(ptr.generic->attributes & TC_FRAME_WAS_CLONED)) {
+        first = __sync_fetch_and_add(&F->first, 0);
+    }
+    return (bufid == first) ?1 :0;
+}
+
+#endif /* HAVE_SYNC_BUILTINS */
+
+static unsigned long fifo_slots(int size)
+{
+    unsigned long slots = 1;
+    while (slots < (unsigned long)size) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+/*
+ * tc_frame_fifo_new:
+ *     create a new TCFrameFifo able to hold up to `size' frames.
+ *     `flags' is a bitmask of TC_FRAME_FIFO_* values selecting the
+ *     flavour. If lock-free operations aren't supported, a
+ *     TC_FRAME_FIFO_LOCKFREE request silently yields a regular fifo;
+ *     check the `lockfree' field to know what was obtained.
+ */
+STATIC TCFrameFifo *tc_frame_fifo_new(int size, int flags)
 {
     TCFrameFifo *F = NULL;
     uint8_t *mem = NULL;
-    size_t memsize = sizeof(TCFrameFifo) + (sizeof(TCFramePtr) * size);
-    size_t xsize = (sorted) ?(sizeof(int) * size) :0;
+    int sorted = (flags & TC_FRAME_FIFO_SORTED);
+    int lockfree = TC_FALSE;
+    unsigned long slots = size;
+    size_t memsize = 0, xsize = 0, ssize = 0;
+
+#ifdef HAVE_SYNC_BUILTINS
+    lockfree = (flags & TC_FRAME_FIFO_LOCKFREE) ?TC_TRUE :TC_FALSE;
+#endif
+    if (lockfree && !sorted) {
+        slots = fifo_slots(size);
+        ssize = sizeof(unsigned long) * slots;
+    }
+    memsize = sizeof(TCFrameFifo) + (sizeof(TCFramePtr) * slots);
+    xsize   = (sorted) ?(sizeof(int) * size) :0;
 
-    mem = tc_zalloc(memsize + xsize);
+    mem = tc_zalloc(memsize + ssize + xsize);
     if (mem) {
-        F          = (TCFrameFifo *)mem;
-        F->frames  = (TCFramePtr *)(mem + sizeof(TCFrameFifo));
-        F->size    = size;
+        F           = (TCFrameFifo *)mem;
+        F->frames   = (TCFramePtr *)(mem + sizeof(TCFrameFifo));
+        F->size     = size;
+        F->lockfree = lockfree;
         if (sorted) {
             F->get       = fifo_get_sorted;
             F->put       = fifo_put_sorted;
             F->len       = fifo_len_sorted;
-            F->avalaible = (int*)(mem + memsize);
+            F->avalaible = (volatile int *)(mem + memsize);
         } else {
             F->get       = fifo_get;
             F->put       = fifo_put;
             F->len       = fifo_len;
             F->avalaible = NULL;
         }
+#ifdef HAVE_SYNC_BUILTINS
+        if (lockfree && sorted) {
+            F->get       = fifo_get_sorted_lockfree;
+            F->put       = fifo_put_sorted_lockfree;
+            F->len       = fifo_len_sorted_lockfree;
+        } else if (lockfree) {
+            unsigned long i = 0;
+
+            F->seqs = (unsigned long *)(mem + memsize);
+            F->mask = slots - 1;
+            for (i = 0; i < slots; i++) {
+                F->seqs[i] = i;
+            }
+            F->get       = fifo_get_lockfree;
+            F->put       = fifo_put_lockfree;
+            F->len       = fifo_len_lockfree;
+        }
+#endif
     }
     return F;
 }
 
 /*************************************************************************/
 
+/* flavour of the fifos used by newly initialized ringbuffers */
+static int fifo_flags = TC_FRAME_FIFO_PLAIN;
+
+int tc_framebuffer_set_fifo_mode(TCFrameFifoMode mode)
+{
+    int ret = TC_OK;
+
+    switch (mode) {
+      case TC_FRAMEBUFFER_LOCKED:
+        fifo_flags = TC_FRAME_FIFO_PLAIN;
+        break;
+      case TC_FRAMEBUFFER_LOCKFREE:
+#ifdef HAVE_SYNC_BUILTINS
+        fifo_flags = TC_FRAME_FIFO_LOCKFREE;
+#else
+        tc_log_warn(FRBUF_NAME, "lock-free frame fifos not supported"
+                                " on this platform");
+        ret = TC_ERROR;
+#endif
+        break;
+      default:
+        tc_log_warn(FRBUF_NAME, "set_fifo_mode: unknown mode (%i)", mode);
+        ret = TC_ERROR;
+        break;
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
 typedef struct tcframepool_ TCFramePool;
 struct tcframepool_ {
     const char      *ptag;      /* given from ringbuffer */
@@ -356,12 +796,18 @@ struct tcframepool_ {
 
     pthread_mutex_t lock;
     pthread_cond_t  empty;
-    int             waiting;    /* how many thread blocked here? */
+    volatile int    waiting;    /* how many thread blocked here? */
 
     TCFrameFifo     *fifo;
 };
 
-STATIC int tc_frame_pool_init(TCFramePool *P, int size, int sorted,
+/*
+ * How many times a lock-free pool retries to get a frame before
+ * parking the calling thread.
+ */
+#define TC_FRAME_POOL_SPINS     32
+
+STATIC int tc_frame_pool_init(TCFramePool *P, int size, int flags,
                               const char *tag, const char *ptag)
 {
     int ret = TC_ERROR;
@@ -372,7 +818,7 @@ STATIC int tc_frame_pool_init(TCFramePool *P, int size, int sorted,
         P->ptag     = (ptag) ?ptag :"unknown";
         P->tag      = (tag)  ?tag  :"unknown";
         P->waiting  = 0;
-        P->fifo     = tc_frame_fifo_new(size, sorted);
+        P->fifo     = tc_frame_fifo_new(size, flags);
         if (P->fifo) {
             ret = TC_OK;
         }
@@ -396,9 +842,89 @@ STATIC void tc_frame_pool_dump_status(TCFramePool *P)
     tc_frame_fifo_dump_status(P->fifo, P->tag);
 }
 
+#ifdef HAVE_SYNC_BUILTINS
+
+/*
+ * Lock-free counterparts of the two functions below. The pool lock
+ * is taken only to park/unpark threads when the fifo is truly empty.
+ * Waiters bump `waiting' *before* the last check of the fifo, and
+ * putters publish the frame *before* peeking `waiting' (both are
+ * full barriers), so a wakeup can't get lost in between.
+ */
+
+static void tc_frame_pool_put_frame_lockfree(TCFramePool *P,
+                                             TCFramePtr ptr)
+{
+    int wakeup = tc_frame_fifo_put(P->fifo, ptr);
+
+    if (verbose >= TC_FLIST)
+        tc_log_msg(FPOOL_NAME,
+                   "(put_frame|%s|%s|%li) wakeup=%i waiting=%i",
+                    P->tag, P->ptag, PTHREAD_ID, wakeup, P->waiting);
+
+    if (wakeup && P->waiting) {
+        pthread_mutex_lock(&P->lock);
+        pthread_cond_signal(&P->empty);
+        pthread_mutex_unlock(&P->lock);
+    }
+}
+
+static TCFramePtr tc_frame_pool_get_frame_lockfree(TCFramePool *P)
+{
+    int interrupted = TC_FALSE, spins = 0;
+    TCFramePtr ptr = tc_frame_fifo_get(P->fifo);
+
+    for (spins = 0; TCFRAMEPTR_IS_NULL(ptr) && spins < TC_FRAME_POOL_SPINS;
+         spins++) {
+        ptr = tc_frame_fifo_get(P->fifo);
+    }
+
+    if (TCFRAMEPTR_IS_NULL(ptr)) {
+        pthread_mutex_lock(&P->lock);
+        __sync_fetch_and_add(&P->waiting, 1);
+
+        ptr = tc_frame_fifo_get(P->fifo);
+        while (!interrupted && TCFRAMEPTR_IS_NULL(ptr)) {
+            if (verbose >= TC_FLIST)
+                tc_log_msg(FPOOL_NAME,
+                           "(get_frame|%s|%s|%li) parking (no frames in pool)",
+                           P->tag, P->ptag, PTHREAD_ID);
+
+            pthread_cond_wait(&P->empty, &P->lock);
+
+            interrupted = !tc_running();
+            if (!interrupted) {
+                ptr = tc_frame_fifo_get(P->fifo);
+            }
+        }
+
+        __sync_fetch_and_sub(&P->waiting, 1);
+        pthread_mutex_unlock(&P->lock);
+    }
+
+    if (verbose >= TC_FLIST)
+        tc_log_msg(FPOOL_NAME,
+                   "(got_frame|%s|%s|%li) frame=%p #%i",
+                   P->tag, P->ptag, PTHREAD_ID,
+                   ptr.generic,
+                   (ptr.generic) ?ptr.generic->bufid :(-1));
+
+    return ptr;
+}
+
+#endif /* HAVE_SYNC_BUILTINS */
+
 STATIC void tc_frame_pool_put_frame(TCFramePool *P, TCFramePtr ptr)
 {
     int wakeup = 0;
+
+#ifdef HAVE_SYNC_BUILTINS
+    if (P->fifo->lockfree) {
+        tc_frame_pool_put_frame_lockfree(P, ptr);
+        return;
+    }
+#endif
+
     pthread_mutex_lock(&P->lock);
     wakeup = tc_frame_fifo_put(P->fifo, ptr);
 
@@ -419,6 +945,13 @@ STATIC TCFramePtr tc_frame_pool_get_frame(TCFramePool *P)
     int interrupted = TC_FALSE;
 
     TCFramePtr ptr = { .generic = NULL };
+
+#ifdef HAVE_SYNC_BUILTINS
+    if (P->fifo->lockfree) {
+        return tc_frame_pool_get_frame_lockfree(P);
+    }
+#endif
+
     pthread_mutex_lock(&P->lock);
 
     if (verbose >= TC_FLIST)
@@ -494,6 +1027,73 @@ typedef void       (*TCFrameFreeFn)(TCFramePtr);
 
 /*************************************************************************/
 
+/*
+ * Ringbuffer statistics.
+ *
+ * Every sample (a duration in microseconds, or a number of frames)
+ * goes in a log2 histogram: bucket 0 holds zero, bucket `b' holds
+ * values in the (2^(b-1), 2^b] range; the last one holds everything
+ * larger. That is precise enough to tell a stage which takes
+ * microseconds from one which takes milliseconds, and cheap enough
+ * to be updated on every frame transition.
+ */
+
+#define TC_FRAME_STAT_BUCKETS   28  /* 2^26 usecs ~= 67 seconds */
+
+/*
+ * Occupancy timeline: every `period' usecs (checked on frame
+ * transitions) the number of frames in each stage is sampled.
+ * When the timeline is full, every other sample is dropped and
+ * the period doubles, so it always spans the whole run.
+ */
+#define TC_FRAME_STAT_SAMPLES   64
+#define TC_FRAME_STAT_PERIOD    250000  /* initial period, usecs */
+
+typedef struct tcframestat_ TCFrameStat;
+struct tcframestat_ {
+    unsigned long   count;
+    uint64_t        sum;
+    uint64_t        max;
+    unsigned long   hist[TC_FRAME_STAT_BUCKETS];
+};
+
+typedef struct tcframesample_ TCFrameSample;
+struct tcframesample_ {
+    uint64_t        when;     /* usecs since the ring was set up */
+    int             queued[TC_FRAME_STAGE_NUM];
+};
+
+/*
+ * clones share the bufid of their source (see fifo_put_sorted),
+ * so the last status change is looked up by frame address instead.
+ */
+typedef struct tcframestamp_ TCFrameStamp;
+struct tcframestamp_ {
+    const void      *frame;
+    uint64_t        when;     /* last status change */
+};
+
+typedef struct tcframeringstats_ TCFrameRingStats;
+struct tcframeringstats_ {
+    pthread_mutex_t lock;
+    TCFrameStamp    *stamps;  /* [size], sorted by frame address */
+
+    TCFrameStat     stay[TC_FRAME_STAGE_NUM];  /* usecs spent in stage */
+    TCFrameStat     wait[TC_FRAME_STAGE_NUM];  /* usecs to get a frame */
+    TCFrameStat     depth[TC_FRAME_STAGE_NUM]; /* frames queued on put */
+
+    uint64_t        start;
+    uint64_t        period;
+    uint64_t        next_sample;
+    int             nsamples;
+    TCFrameSample   samples[TC_FRAME_STAT_SAMPLES];
+};
+
+/* collection is off by default; it costs a lock per frame transition */
+static int stats_enabled = TC_FALSE;
+
+/*************************************************************************/
+
 typedef struct tcframering_ TCFrameRing;
 struct tcframering_ {
     const char          *tag;
@@ -507,6 +1107,8 @@ struct tcframering_ {
     /* (de)allocation helpers */
     TCFrameAllocFn      alloc;
     TCFrameFreeFn       free;
+
+    TCFrameRingStats    stats;
 };
 
 static TCFrameRing tc_audio_ringbuffer;
@@ -538,11 +1140,154 @@ static int tc_frame_ring_get_pool_size(TCFrameRing *rfb,
 }
 
 
+/*************************************************************************/
+
+static uint64_t stats_now(void)
+{
+    struct timeval tv;
+
+    if (gettimeofday(&tv, NULL) != 0) {
+        return 0;
+    }
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* stats lock must be held */
+static void stats_add(TCFrameStat *st, uint64_t value)
+{
+    int b = 0;
+
+    while (b < TC_FRAME_STAT_BUCKETS - 1 && ((uint64_t)1 << b) < value) {
+        b++;
+    }
+    if (value > 0 && b == 0) {
+        b = 1; /* 1 usec/frame goes with 2: bucket 0 is for zero only */
+    }
+    st->hist[b]++;
+    st->count++;
+    st->sum += value;
+    if (value > st->max) {
+        st->max = value;
+    }
+}
+
+/* value below which the given fraction of the samples lies (approx.) */
+static uint64_t stats_percentile(const TCFrameStat *st, double frac)
+{
+    unsigned long seen = 0, need = (unsigned long)(st->count * frac);
+    int b = 0;
+
+    for (b = 0; b < TC_FRAME_STAT_BUCKETS; b++) {
+        seen += st->hist[b];
+        if (seen > need) {
+            break;
+        }
+    }
+    if (b >= TC_FRAME_STAT_BUCKETS - 1) {
+        return st->max;
+    }
+    return TC_MIN(((uint64_t)1 << b), st->max);
+}
+
+static int stats_stamp_cmp(const void *a, const void *b)
+{
+    const void *fa = ((const TCFrameStamp *)a)->frame;
+    const void *fb = ((const TCFrameStamp *)b)->frame;
+
+    return (fa < fb) ?-1 :((fa > fb) ?1 :0);
+}
+
+static void tc_frame_ring_stats_init(TCFrameRing *rfb)
+{
+    uint64_t now = stats_now();
+    int i = 0;
+
+    memset(&rfb->stats, 0, sizeof(rfb->stats));
+    pthread_mutex_init(&rfb->stats.lock, NULL);
+    rfb->stats.start       = now;
+    rfb->stats.period      = TC_FRAME_STAT_PERIOD;
+    rfb->stats.next_sample = now;
+    rfb->stats.stamps = tc_malloc(rfb->size * sizeof(TCFrameStamp));
+    if (rfb->stats.stamps != NULL) {
+        for (i = 0; i < rfb->size; i++) {
+            rfb->stats.stamps[i].frame = rfb->frames[i].generic;
+            rfb->stats.stamps[i].when  = now;
+        }
+        qsort(rfb->stats.stamps, rfb->size, sizeof(TCFrameStamp),
+              stats_stamp_cmp);
+    }
+}
+
+static void tc_frame_ring_stats_fini(TCFrameRing *rfb)
+{
+    tc_free(rfb->stats.stamps);
+    rfb->stats.stamps = NULL;
+}
+
+/* stats lock must be held */
+static void tc_frame_ring_stats_sample(TCFrameRing *rfb, uint64_t now)
+{
+    TCFrameRingStats *RS = &rfb->stats;
+    TCFrameSample *sample = NULL;
+    int i = 0;
+
+    if (RS->nsamples == TC_FRAME_STAT_SAMPLES) {
+        for (i = 0; i < TC_FRAME_STAT_SAMPLES / 2; i++) {
+            RS->samples[i] = RS->samples[i * 2];
+        }
+        RS->nsamples = TC_FRAME_STAT_SAMPLES / 2;
+        RS->period  *= 2;
+    }
+    sample = &RS->samples[RS->nsamples++];
+    sample->when = (now >= RS->start) ?(now - RS->start) :0;
+    for (i = 0; i < TC_FRAME_STAGE_NUM; i++) {
+        /* unlocked: a snapshot may be off by a frame in flight */
+        sample->queued[i] = tc_frame_ring_get_pool_size(rfb,
+                                                        TC_FRAME_STAGE_ST(i),
+                                                        TC_FALSE);
+    }
+    RS->next_sample = now + RS->period;
+}
+
+/*
+ * account the end of the stay of a frame into its current status,
+ * right before it enters the `S' one.
+ */
+static void tc_frame_ring_stats_move(TCFrameRing *rfb, TCFramePtr ptr,
+                                     TCFrameStatus S)
+{
+    TCFrameRingStats *RS = &rfb->stats;
+    TCFrameStamp key, *stamp = NULL;
+
+    if (stats_enabled && RS->stamps != NULL) {
+        key.frame = ptr.generic;
+        stamp = bsearch(&key, RS->stamps, rfb->size, sizeof(TCFrameStamp),
+                        stats_stamp_cmp);
+    }
+    if (stamp != NULL) {
+        uint64_t now = stats_now();
+        int queued = tc_frame_ring_get_pool_size(rfb, S, TC_FALSE);
+
+        pthread_mutex_lock(&RS->lock);
+        if (now >= stamp->when) {
+            stats_add(&RS->stay[TC_FRAME_STAGE_ID(ptr.generic->status)],
+                      now - stamp->when);
+        }
+        stamp->when = now;
+        stats_add(&RS->depth[TC_FRAME_STAGE_ID(S)], queued);
+        if (now >= RS->next_sample) {
+            tc_frame_ring_stats_sample(rfb, now);
+        }
+        pthread_mutex_unlock(&RS->lock);
+    }
+}
+
 static void tc_frame_ring_put_frame(TCFrameRing *rfb,
                                     TCFrameStatus S,
                                     TCFramePtr ptr)
 {
     TCFramePool *P = tc_frame_ring_get_pool(rfb, S);
+    tc_frame_ring_stats_move(rfb, ptr, S);
     ptr.generic->status = S;
     tc_frame_pool_put_frame(P, ptr);
 }
@@ -551,7 +1296,22 @@ static TCFramePtr tc_frame_ring_get_frame(TCFrameRing *rfb,
                                           TCFrameStatus S)
 {
     TCFramePool *P = tc_frame_ring_get_pool(rfb, S);
-    return tc_frame_pool_get_frame(P);
+    TCFramePtr ptr;
+
+    if (stats_enabled) {
+        uint64_t start = stats_now(), now = 0;
+
+        ptr = tc_frame_pool_get_frame(P);
+        now = stats_now();
+
+        pthread_mutex_lock(&rfb->stats.lock);
+        stats_add(&rfb->stats.wait[TC_FRAME_STAGE_ID(S)],
+                  (now >= start) ?(now - start) :0);
+        pthread_mutex_unlock(&rfb->stats.lock);
+    } else {
+        ptr = tc_frame_pool_get_frame(P);
+    }
+    return ptr;
 }
 
 static void tc_frame_ring_dump_status(TCFrameRing *rfb,
@@ -620,9 +1380,13 @@ static int tc_frame_ring_init(TCFrameRing *rfb,
         TCFrameStatus S = TC_FRAME_STAGE_ST(i);
         const char *name = frame_status_name(S);
 
-        int err = tc_frame_pool_init(&(rfb->pools[i]), size,
-                                     (S == TC_FRAME_READY),
-                                     name, tag);
+        int flags = fifo_flags;
+        int err = 0;
+
+        if (S == TC_FRAME_READY) {
+            flags |= TC_FRAME_FIFO_SORTED;
+        }
+        err = tc_frame_pool_init(&(rfb->pools[i]), size, flags, name, tag);
         
         if (err) {
             tc_log_error(FRING_NAME,
@@ -654,6 +1418,8 @@ static int tc_frame_ring_init(TCFrameRing *rfb,
         }
  
     }
+    /* last, so the initial filling isn't accounted */
+    tc_frame_ring_stats_init(rfb);
     return 0;
 }
 
@@ -694,6 +1460,7 @@ static void tc_frame_ring_fini(TCFrameRing *rfb)
             rfb->free(rfb->frames[i]);
         }
         tc_free(rfb->frames);
+        tc_frame_ring_stats_fini(rfb);
     }
 }
 
@@ -743,6 +1510,7 @@ static TCFramePtr tc_frame_ring_register_frame(TCFrameRing *rfb,
             ptr.generic->prev       = NULL;
         }
 
+        tc_frame_ring_stats_move(rfb, ptr, status);
         ptr.generic->status = status;
 
         if (verbose >= TC_FLIST) {
@@ -895,6 +1663,14 @@ static void tc_frame_ring_get_counters(TCFrameRing *rfb,
 
 int aframe_alloc(int num)
 {
+    if (arena_mode != TC_FRAMEBUFFER_ARENA_OFF) {
+        size_t size = tc_audio_frame_mem_size(tc_specs.samples,
+                                              tc_specs.channels,
+                                              tc_specs.bits);
+        /* on failure, just fall back to per-frame allocation */
+        tc_frame_arena_init(&tc_audio_arena, "audio",
+                            TC_MAX(num, 1) * size);
+    }
     return tc_frame_ring_init(&tc_audio_ringbuffer,
                               "audio", &tc_specs,
                               tc_audio_alloc, tc_audio_free, num);
@@ -902,6 +1678,14 @@ int aframe_alloc(int num)
 
 int vframe_alloc(int num)
 {
+    if (arena_mode != TC_FRAMEBUFFER_ARENA_OFF) {
+        size_t size = tc_video_frame_mem_size(tc_specs.width,
+                                              tc_specs.height,
+                                              tc_specs.format, TC_TRUE);
+        /* on failure, just fall back to per-frame allocation */
+        tc_frame_arena_init(&tc_video_arena, "video",
+                            TC_MAX(num, 1) * size);
+    }
     return tc_frame_ring_init(&tc_video_ringbuffer,
                               "video", &tc_specs,
                               tc_video_alloc, tc_video_free, num);
@@ -910,11 +1694,13 @@ int vframe_alloc(int num)
 void aframe_free(void)
 {
     tc_frame_ring_fini(&tc_audio_ringbuffer);
+    tc_frame_arena_fini(&tc_audio_arena);
 }
 
 void vframe_free(void)
 {
     tc_frame_ring_fini(&tc_video_ringbuffer);
+    tc_frame_arena_fini(&tc_video_arena);
 }
 
 
@@ -931,12 +1717,191 @@ aframe_list_t *aframe_dup(aframe_list_t *f)
                                          0, TC_FRAME_WAIT);
     if (!TCFRAMEPTR_IS_NULL(frame)) {
         aframe_copy(frame.audio, f, 1);
+        /* the clone keeps the source bufid, but not its status */
+        frame.audio->status = TC_FRAME_WAIT;
         tc_frame_ring_put_frame(&tc_audio_ringbuffer,
                                 TC_FRAME_WAIT, frame);
     }
     return frame.audio;
 }
 
+/*************************************************************************/
+
+/*
+ * Copy-on-write video frames.
+ *
+ * vframe_dup() doesn't copy video data: the new frame (the borrower)
+ * points to the buffer of the original one (the owner). Every owner
+ * keeps the list of its borrowers; duplicating a borrower yields
+ * another borrower of the same owner.
+ *
+ * Sharing ends when a frame is removed, or when someone is going to
+ * write into it; in the latter case vframe_make_writable() must be
+ * called first. An owner giving up sharing never copies data: it just
+ * swaps the lent buffer with the matching (unused) one of a borrower,
+ * which becomes the new owner. A frame gets a private copy of the data
+ * only if it still needs the shared content when giving up sharing.
+ *
+ * All sharing data is protected by a single lock, which is taken a
+ * few times per frame at most.
+ */
+
+static pthread_mutex_t cow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef STATBUFFER
+
+/* index of the frame buffer holding the current data, or -1 */
+static int cow_data_slot(const vframe_list_t *ptr)
+{
+    if (ptr->video_buf != NULL) {
+        if (ptr->video_buf == ptr->video_buf_Y[0]) {
+            return 0;
+        }
+        if (ptr->video_buf == ptr->video_buf_Y[1]) {
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/* exchange buffer `slot' (with all the plane pointers) of two frames */
+static void cow_swap_slot(vframe_list_t *a, vframe_list_t *b, int slot)
+{
+    uint8_t *tmp = NULL;
+
+#define SWAP_BUF(FIELD) do { \
+    tmp = a->FIELD; \
+    a->FIELD = b->FIELD; \
+    b->FIELD = tmp; \
+} while (0)
+
+    SWAP_BUF(video_buf_RGB[slot]);
+    SWAP_BUF(video_buf_Y[slot]);
+    SWAP_BUF(video_buf_U[slot]);
+    SWAP_BUF(video_buf_V[slot]);
+    if (slot == 0) {
+        SWAP_BUF(internal_video_buf_0);
+    } else {
+        SWAP_BUF(internal_video_buf_1);
+    }
+
+#undef SWAP_BUF
+
+    a->video_buf2 = a->internal_video_buf_1;
+    b->video_buf2 = b->internal_video_buf_1;
+}
+
+/* cow_lock must be held */
+static int cow_share(vframe_list_t *dst, vframe_list_t *src)
+{
+    vframe_list_t *owner = src;
+    int slot = -1;
+
+    if (src->cow_owner != NULL) {
+        owner = src->cow_owner;
+        slot  = owner->cow_slot;
+        if (src->video_buf != owner->video_buf_Y[slot]) {
+            slot = -1;
+        }
+    } else {
+        slot = cow_data_slot(src);
+        if (src->cow_borrowers != NULL && slot != src->cow_slot) {
+            slot = -1;
+        }
+    }
+    if (slot < 0) {
+        return TC_ERROR; /* data not in a frame buffer, can't share it */
+    }
+
+    vframe_copy(dst, src, 0);   /* metadata, video_buf points to src data */
+    dst->video_buf2 = dst->internal_video_buf_1;
+    dst->free       = !slot;
+
+    dst->cow_owner        = owner;
+    dst->cow_next         = owner->cow_borrowers;
+    owner->cow_borrowers  = dst;
+    owner->cow_slot       = slot;
+    return TC_OK;
+}
+
+/*
+ * cow_release:
+ *      stop sharing the data of given frame (either as owner
+ *      or as borrower); cow_lock must be held.
+ *      If `keep_data' is !0 and the frame still uses the shared
+ *      data, this is copied into a buffer owned by the frame;
+ *      otherwise the frame is just pointed back to its own buffer.
+ */
+static void cow_release(vframe_list_t *ptr, int keep_data)
+{
+    vframe_list_t *owner = ptr->cow_owner;
+    uint8_t *shared = NULL;
+    int slot = 0;
+
+    if (owner != NULL) {
+        vframe_list_t **pp = &owner->cow_borrowers;
+
+        slot   = owner->cow_slot;
+        shared = owner->video_buf_Y[slot];
+
+        while (*pp != NULL && *pp != ptr) {
+            pp = &(*pp)->cow_next;
+        }
+        if (*pp == ptr) {
+            *pp = ptr->cow_next;
+        }
+        ptr->cow_owner = NULL;
+        ptr->cow_next  = NULL;
+    } else if (ptr->cow_borrowers != NULL) {
+        vframe_list_t *heir = ptr->cow_borrowers, *b = NULL;
+
+        slot   = ptr->cow_slot;
+        shared = ptr->video_buf_Y[slot];
+
+        /*
+         * zero-copy handover: the heir takes the lent buffer. The heir
+         * may be in use by another thread right now; that's fine, since
+         * its current data (video_buf) doesn't move, and its buffer
+         * pointers are only read after taking cow_lock (see
+         * vframe_get_buffers and vframe_make_writable), which orders
+         * those reads after this update.
+         */
+        cow_swap_slot(ptr, heir, slot);
+        heir->cow_borrowers = heir->cow_next;
+        heir->cow_owner     = NULL;
+        heir->cow_next      = NULL;
+        heir->cow_slot      = slot;
+        for (b = heir->cow_borrowers; b != NULL; b = b->cow_next) {
+            b->cow_owner = heir;
+        }
+        ptr->cow_borrowers = NULL;
+    } else {
+        return; /* nothing shared */
+    }
+
+    if (ptr->video_buf == shared) {
+        if (keep_data) {
+            ac_memcpy(ptr->video_buf_Y[slot], shared, ptr->video_size);
+        }
+        ptr->video_buf = ptr->video_buf_Y[slot];
+        ptr->free      = !slot;
+    }
+}
+
+#else  /* ! STATBUFFER */
+
+static int cow_share(vframe_list_t *dst, vframe_list_t *src)
+{
+    return TC_ERROR;
+}
+
+static void cow_release(vframe_list_t *ptr, int keep_data)
+{
+    return;
+}
+
+#endif /* STATBUFFER */
+
 vframe_list_t *vframe_dup(vframe_list_t *f)
 {
     TCFramePtr frame;
@@ -949,15 +1914,52 @@ vframe_list_t *vframe_dup(vframe_list_t *f)
     frame = tc_frame_ring_register_frame(&tc_video_ringbuffer,
                                          0, TC_FRAME_WAIT);
     if (!TCFRAMEPTR_IS_NULL(frame)) {
-        vframe_copy(frame.video, f, 1);
-        /* currently noone seems to care about this */
-        frame.video->clone_flag = f->clone_flag + 1;
+        int ret;
+
+        pthread_mutex_lock(&cow_lock);
+        ret = cow_share(frame.video, f);
+        pthread_mutex_unlock(&cow_lock);
+
+        if (ret != TC_OK) {
+            vframe_copy(frame.video, f, 1);
+        }
+        /* the clone keeps the source bufid, but not its status */
+        frame.video->status = TC_FRAME_WAIT;
         tc_frame_ring_put_frame(&tc_video_ringbuffer,
                                 TC_FRAME_WAIT, frame);
     }
     return frame.video;
 }
 
+void vframe_make_writable(vframe_list_t *ptr)
+{
+    if (ptr != NULL) {
+        pthread_mutex_lock(&cow_lock);
+        cow_release(ptr, TC_TRUE);
+        pthread_mutex_unlock(&cow_lock);
+    }
+}
+
+void vframe_get_buffers(vframe_list_t *ptr, uint8_t **buf0, uint8_t **buf1)
+{
+    pthread_mutex_lock(&cow_lock);
+    *buf0 = ptr->video_buf_Y[0];
+    *buf1 = ptr->video_buf_Y[1];
+    pthread_mutex_unlock(&cow_lock);
+}
+
+/* drop any sharing before the ring frames are recycled all at once */
+static void vframe_unshare_all(void)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&cow_lock);
+    for (i = 0; i < tc_video_ringbuffer.size; i++) {
+        cow_release(tc_video_ringbuffer.frames[i].video, TC_FALSE);
+    }
+    pthread_mutex_unlock(&cow_lock);
+}
+
 /*************************************************************************/
 
 aframe_list_t *aframe_register(int id)
@@ -990,6 +1992,11 @@ void vframe_remove(vframe_list_t *ptr)
         tc_log_warn(FRBUF_NAME, "vframe_remove: given NULL frame pointer");
     } else {
         TCFramePtr frame = { .video = ptr };
+
+        pthread_mutex_lock(&cow_lock);
+        cow_release(ptr, TC_FALSE);
+        pthread_mutex_unlock(&cow_lock);
+
         tc_frame_ring_remove_frame(&tc_video_ringbuffer, frame);
     }
 }
@@ -1071,12 +2078,14 @@ void aframe_flush(void)
 
 void vframe_flush(void)
 {
+    vframe_unshare_all();
     tc_frame_ring_flush(&tc_video_ringbuffer);
 }
 
 void tc_framebuffer_flush(void)
 {
     tc_frame_ring_flush(&tc_audio_ringbuffer);
+    vframe_unshare_all();
     tc_frame_ring_flush(&tc_video_ringbuffer);
 }
 
@@ -1162,7 +2171,6 @@ void vframe_copy(vframe_list_t *dst, const vframe_list_t *src,
     /* copy all common fields with just one move */
     ac_memcpy(dst, src, sizeof(frame_list_t));
     
-    dst->clone_flag   = src->clone_flag;
     dst->deinter_flag = src->deinter_flag;
     dst->free         = src->free;
     /* 
@@ -1205,6 +2213,125 @@ void tc_framebuffer_get_counters(int *im, int *fl, int *ex)
     *ex = v_ex + a_ex;
 }
 
+/*************************************************************************/
+
+void tc_framebuffer_set_stats(int enable)
+{
+    stats_enabled = enable;
+}
+
+#define USECS_TO_MSECS(US)  ((double)(US) / 1000.0)
+
+static void tc_frame_ring_report_stats(TCFrameRing *rfb,
+                                       TCFrameStatsFn emit, void *userdata)
+{
+    /* frames queued in those stages are waiting for the next layer */
+    static const struct {
+        TCFrameStatus   status;
+        const char      *layer;
+    } queues[] = {
+        { TC_FRAME_NULL,    "import" },
+        { TC_FRAME_WAIT,    "filter" },
+        { TC_FRAME_READY,   "export" },
+    };
+    TCFrameStat stays[TC_FRAME_STAGE_NUM];
+    TCFrameStat waits[TC_FRAME_STAGE_NUM];
+    TCFrameStat depths[TC_FRAME_STAGE_NUM];
+    TCFrameSample samples[TC_FRAME_STAT_SAMPLES];
+    char buf[TC_BUF_LINE];
+    uint64_t total = 0, worst = 0, period = 0;
+    int i = 0, j = 0, n = 0, len = 0, nsamples = 0, bound = -1;
+
+    if (rfb->stats.stamps == NULL) {
+        return; /* ring not in use */
+    }
+
+    /* work on a snapshot, to not hold the lock while emitting */
+    pthread_mutex_lock(&rfb->stats.lock);
+    ac_memcpy(stays,  rfb->stats.stay,  sizeof(stays));
+    ac_memcpy(waits,  rfb->stats.wait,  sizeof(waits));
+    ac_memcpy(depths, rfb->stats.depth, sizeof(depths));
+    nsamples = rfb->stats.nsamples;
+    period   = rfb->stats.period;
+    ac_memcpy(samples, rfb->stats.samples, nsamples * sizeof(samples[0]));
+    pthread_mutex_unlock(&rfb->stats.lock);
+
+    for (i = 0; i < TC_FRAME_STAGE_NUM; i++) {
+        const TCFrameStat *stay  = &stays[i];
+        const TCFrameStat *wait  = &waits[i];
+        const TCFrameStat *depth = &depths[i];
+
+        if (!stay->count && !wait->count && !depth->count) {
+            continue;
+        }
+        tc_snprintf(buf, sizeof(buf),
+                    "%s %-6s stay: n=%lu mean=%.2fms p50=%.2fms"
+                    " p90=%.2fms p99=%.2fms max=%.2fms |"
+                    " get: n=%lu mean=%.2fms max=%.2fms |"
+                    " queued: mean=%.1f max=%lu",
+                    rfb->tag, frame_stages[i].name,
+                    stay->count,
+                    USECS_TO_MSECS(stay->count ?stay->sum / stay->count :0),
+                    USECS_TO_MSECS(stats_percentile(stay, 0.50)),
+                    USECS_TO_MSECS(stats_percentile(stay, 0.90)),
+                    USECS_TO_MSECS(stats_percentile(stay, 0.99)),
+                    USECS_TO_MSECS(stay->max),
+                    wait->count,
+                    USECS_TO_MSECS(wait->count ?wait->sum / wait->count :0),
+                    USECS_TO_MSECS(wait->max),
+                    (depth->count) ?(double)depth->sum / depth->count :0.0,
+                    (unsigned long)depth->max);
+        emit(userdata, buf);
+    }
+
+    /* the layer frames wait most for is the bottleneck */
+    for (i = 0; i < sizeof(queues)/sizeof(queues[0]); i++) {
+        uint64_t sum = stays[TC_FRAME_STAGE_ID(queues[i].status)].sum;
+        total += sum;
+        if (sum > worst) {
+            worst = sum;
+            bound = i;
+        }
+    }
+    if (bound >= 0 && total > 0) {
+        tc_snprintf(buf, sizeof(buf),
+                    "%s frames spent %.0f%% of their queueing time"
+                    " waiting for the %s layer (likely %s-bound)",
+                    rfb->tag, 100.0 * worst / total,
+                    queues[bound].layer, queues[bound].layer);
+        emit(userdata, buf);
+    }
+
+    /* how the occupancy changed over time */
+    if (nsamples > 0) {
+        tc_snprintf(buf, sizeof(buf),
+                    "%s occupancy: %i samples, at least %.2fs apart",
+                    rfb->tag, nsamples, USECS_TO_MSECS(period) / 1000.0);
+        emit(userdata, buf);
+    }
+    for (i = 0; i < nsamples; i++) {
+        len = tc_snprintf(buf, sizeof(buf), "%s occupancy t=%.2fs",
+                          rfb->tag,
+                          USECS_TO_MSECS(samples[i].when) / 1000.0);
+        for (j = 0; j < TC_FRAME_STAGE_NUM && len >= 0; j++) {
+            n = tc_snprintf(buf + len, sizeof(buf) - len, " %s=%i",
+                            frame_stages[j].name, samples[i].queued[j]);
+            len = (n < 0) ?-1 :(len + n);
+        }
+        emit(userdata, buf);
+    }
+}
+
+void tc_framebuffer_report_stats(TCFrameStatsFn emit, void *userdata)
+{
+    if (emit != NULL) {
+        tc_frame_ring_report_stats(&tc_video_ringbuffer, emit, userdata);
+        tc_frame_ring_report_stats(&tc_audio_ringbuffer, emit, userdata);
+    }
+}
+
+#undef USECS_TO_MSECS
+
 /*************************************************************************/
 /*
  * Local variables:
@@ -145,6 +145,60 @@ const TCFrameSpecs *tc_framebuffer_get_specs(void);
  */
 void tc_framebuffer_set_specs(const TCFrameSpecs *specs);
 
+typedef enum tcframefifomode_ TCFrameFifoMode;
+enum tcframefifomode_ {
+    TC_FRAMEBUFFER_LOCKED = 0,  /* mutex-protected FIFOs (default) */
+    TC_FRAMEBUFFER_LOCKFREE,    /* lock-free bounded MPMC FIFOs    */
+};
+
+/*
+ * tc_framebuffer_set_fifo_mode: (NOT thread safe)
+ *     Select the frame FIFO implementation to be used by the frame pools.
+ *     Lock-free FIFOs let the processing threads exchange frames without
+ *     taking the per-pool lock, which is used only to park a thread
+ *     when a pool is empty.
+ *     PLEASE NOTE that only ringbuffers allocated AFTER calling this
+ *     function will use the given mode.
+ *
+ * Parameters:
+ *     mode: FIFO implementation to use (see TCFrameFifoMode above).
+ * Return Value:
+ *     TC_OK if succesfull,
+ *     TC_ERROR if given mode isn't supported on this platform.
+ *     The current mode is left untouched on error.
+ */
+int tc_framebuffer_set_fifo_mode(TCFrameFifoMode mode);
+
+typedef enum tcframearenamode_ TCFrameArenaMode;
+enum tcframearenamode_ {
+    TC_FRAMEBUFFER_ARENA_OFF = 0, /* one allocation per frame (default)  */
+    TC_FRAMEBUFFER_ARENA_ON,      /* one block per ring, THP if possible */
+    TC_FRAMEBUFFER_ARENA_HUGE,    /* as above, explicit huge pages first */
+};
+
+/*
+ * tc_framebuffer_set_arena: (NOT thread safe)
+ *     Make {v,a}frame_alloc carve all the frames of a ringbuffer out
+ *     of a single memory block, optionally backed by huge pages and
+ *     bound to a NUMA node. The block is prefaulted only if bound to
+ *     a node; otherwise pages are placed on first touch. Frame buffers
+ *     are always TC_FRAME_ALIGN-aligned. Ring video frames have only
+ *     the first buffer (video_buf_Y[1] is NULL), so that is the only
+ *     one carved.
+ *     PLEASE NOTE that only ringbuffers allocated AFTER calling this
+ *     function will use the given mode.
+ *
+ * Parameters:
+ *     mode: allocation mode (see TCFrameArenaMode above).
+ *     node: NUMA node to bind the arena to, or -1 to let the kernel
+ *           place the pages on first touch.
+ * Return Value:
+ *     TC_OK if succesfull,
+ *     TC_ERROR if given mode/node isn't supported on this platform.
+ *     Current settings are left untouched on error.
+ */
+int tc_framebuffer_set_arena(TCFrameArenaMode mode, int node);
+
 /*
  * tc_framebuffer_interrupt: (thread safe)
  *     Interrupt the framebuffer immediately (see below for specific meaning
@@ -421,9 +475,13 @@ void aframe_push_next(aframe_list_t *ptr, TCFrameStatus status);
  * vframe_dup, aframe_dup: (thread safe)
  *     Frame claiming functions.
  *     Duplicate given respectively video or audio framebuffer.
- *     New framebuffer will be a full (deep) copy of old one
+ *     New audio framebuffer will be a full (deep) copy of old one
  *     (see aframe_copy/vframe_copy documentation to learn about
  *     deep copy).
+ *     New video framebuffer will share the video data with the old
+ *     one until either of them is modified (copy-on-write); see
+ *     vframe_make_writable below. Falls back to a deep copy if
+ *     the data of the old framebuffer can't be shared.
  *
  * Parameters:
  *     f: framebuffer to be copied.
@@ -438,6 +496,39 @@ void aframe_push_next(aframe_list_t *ptr, TCFrameStatus status);
 vframe_list_t *vframe_dup(vframe_list_t *f);
 aframe_list_t *aframe_dup(aframe_list_t *f);
 
+/*
+ * vframe_make_writable: (thread safe)
+ *     ensure that the video data of given framebuffer isn't shared
+ *     with any other framebuffer (see vframe_dup), so it can be
+ *     modified in place. Any code writing into ptr->video_buf MUST
+ *     call this function first. The framebuffer keeps its content,
+ *     but ptr->video_buf (and ptr->free) may change.
+ *     A no-op for framebuffers not sharing anything.
+ *
+ * Parameters:
+ *     ptr: framebuffer to be made writable.
+ * Return Value:
+ *     None.
+ */
+void vframe_make_writable(vframe_list_t *ptr);
+
+/*
+ * vframe_get_buffers: (thread safe)
+ *     get the two frame buffers of given framebuffer. While the video
+ *     data is shared (see vframe_dup), the buffer pointers of a
+ *     framebuffer may be changed by other threads: they must be read
+ *     either through this function or after vframe_make_writable.
+ *     ptr->video_buf is never changed by other threads.
+ *
+ * Parameters:
+ *      ptr: framebuffer to inspect.
+ *     buf0: where to store ptr->video_buf_Y[0].
+ *     buf1: where to store ptr->video_buf_Y[1].
+ * Return Value:
+ *     None.
+ */
+void vframe_get_buffers(vframe_list_t *ptr, uint8_t **buf0, uint8_t **buf1);
+
 /*
  * vframe_copy, aframe_copy (thread safe)
  *     perform a soft or optionally deep copy respectively of a 
@@ -529,4 +620,40 @@ void aframe_get_counters(int *im, int *fl, int *ex);
  */
 void tc_framebuffer_get_counters(int *im, int *fl, int *ex);
 
+/*
+ * tc_framebuffer_set_stats (thread safe):
+ *     enable or disable the collection of framebuffer statistics:
+ *     how long frames stay in each status, how long threads wait to
+ *     get a frame from each stage, and how many frames are queued in
+ *     each stage, both on each transition and sampled over time.
+ *     Collection is disabled by default, since it takes a lock at
+ *     each frame transition.
+ *
+ * Parameters:
+ *     enable: if !0, enable collection; otherwise disable it.
+ *             Statistics already collected are kept in both cases.
+ * Return Value:
+ *     None.
+ */
+void tc_framebuffer_set_stats(int enable);
+
+/* receives one line of the report; `line' has no trailing newline */
+typedef void (*TCFrameStatsFn)(void *userdata, const char *line);
+
+/*
+ * tc_framebuffer_report_stats (thread safe):
+ *     produce a human-readable report of the statistics collected
+ *     so far (see tc_framebuffer_set_stats), line by line, including
+ *     a guess about which layer (import, filter or export) is the
+ *     bottleneck of the pipeline and a timeline of the number of
+ *     frames held by each stage over the run.
+ *
+ * Parameters:
+ *         emit: function to be called for each line of the report.
+ *     userdata: opaque pointer passed to `emit'.
+ * Return Value:
+ *     None.
+ */
+void tc_framebuffer_report_stats(TCFrameStatsFn emit, void *userdata);
+
 #endif /* FRAMEBUFFER_H */
@@ -117,6 +117,45 @@ static void dump_processing(int sock)
 
 /*************************************************************************/
 
+/**
+ * send_stats_line:  Callback for tc_framebuffer_report_stats(), sending
+ * each line of the report over the socket.
+ *
+ * Parameters:
+ *     userdata: Pointer to the socket descriptor.
+ *         line: Line of the report.
+ * Return value:
+ *     None.
+ */
+
+static void send_stats_line(void *userdata, const char *line)
+{
+    int sock = *(int *)userdata;
+
+    sendstr(sock, line);
+    sendstr(sock, "\n");
+}
+
+/**
+ * dump_stats:  Send the framebuffer statistics over the socket, if they
+ * are being collected (see the --buffer_stats option).
+ *
+ * Parameters:
+ *     sock: Socket descriptor to send data to.
+ * Return value:
+ *     Nonzero if statistics were sent, zero if they are not collected.
+ */
+
+static int dump_stats(int sock)
+{
+    if (!tc_buffer_stats)
+        return 0;
+    tc_framebuffer_report_stats(send_stats_line, &sock);
+    return 1;
+}
+
+/*************************************************************************/
+
 /**
  * dump_vob:  Send the contents of the global `vob' structure over the
  * socket in a "parameter=value" format, one field per line.
@@ -413,6 +452,8 @@ static int handle_help(char *params)
             "list [ load | enable | disable ]\n"
             "dump\n"
             "progress\n"
+            "processing\n"
+            "stats\n"
             "pause\n"
             "preview <command>\n"
             "  [ draw | undo | pause | fastfw |\n"
@@ -640,6 +681,8 @@ static int handle(char *buf)
     } else if (strncasecmp(cmd, "processing", 10) == 0) {
         dump_processing(client_sock);
         retval = 1;
+    } else if (strncasecmp(cmd, "stats", 5) == 0) {
+        retval = dump_stats(client_sock);
     } else if (strncasecmp(cmd, "quit", 2) == 0
             || strncasecmp(cmd, "exit", 2) == 0) {
         return 0;  // tell caller to close socket
@@ -102,6 +102,10 @@
 #define TC_FRAME_BUFFER        10
 #define TC_FRAME_THREADS        1
 #define TC_FRAME_THREADS_MAX   32
+#define TC_ENCODER_THREADS      1
+#define TC_IMPORT_THREADS       1
+#define TC_MPLEX_QUEUE          0
+#define TC_MPLEX_QUEUE_MAX     32
 
 #define TC_FRAME_FIRST          0
 #define TC_FRAME_LAST     INT_MAX
@@ -78,8 +78,13 @@ int verbose = TC_INFO;
 
 int tc_buffer_delay_dec  = -1;
 int tc_buffer_delay_enc  = -1;
+int tc_buffer_lockfree   = TC_FALSE;
+int tc_buffer_arena      =  0;  // TC_FRAMEBUFFER_ARENA_OFF
+int tc_buffer_node       = -1;
+int tc_buffer_stats      = TC_FALSE;
 int tc_cluster_mode      =  0;
 int tc_decoder_delay     =  0;
+int tc_import_stats      = TC_FALSE;
 int tc_progress_meter    =  -1;  // so we know whether it's set by the user
 int tc_progress_rate     =  1;
 int tc_accel             = AC_ALL;    //acceleration code
@@ -89,6 +94,10 @@ int tc_niceness          = 0;
 
 int max_frame_buffer  = TC_FRAME_BUFFER;
 int max_frame_threads = TC_FRAME_THREADS;
+int max_encoder_threads = TC_ENCODER_THREADS;
+int max_import_threads  = TC_IMPORT_THREADS;
+int max_mplex_queue     = TC_MPLEX_QUEUE;
+int tc_import_segment   = 0;  // frames per segment, 0: automatic
 
 //-------------------------------------------------------------
 
@@ -310,6 +319,24 @@ static void stop_event_thread(void)
     }
 }
 
+/*************************************************************************/
+
+/**
+ * log_buffer_stats:  Callback for tc_framebuffer_report_stats(), logging
+ * each line of the end-of-run framebuffer statistics.
+ *
+ * Parameters:
+ *     userdata: Unused.
+ *         line: Line of the report.
+ * Return value:
+ *     None.
+ */
+
+static void log_buffer_stats(void *userdata, const char *line)
+{
+    tc_log_info(PACKAGE, "%s", line);
+}
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -2695,6 +2722,15 @@ int main(int argc, char *argv[])
     specs.bits = TC_MAX(vob->a_bits, vob->dm_bits);
 
     tc_framebuffer_set_specs(&specs);
+    if (tc_buffer_lockfree
+     && tc_framebuffer_set_fifo_mode(TC_FRAMEBUFFER_LOCKFREE) != TC_OK) {
+        tc_warn("lock-free framebuffer unavailable, using the default one");
+    }
+    if (tc_buffer_arena
+     && tc_framebuffer_set_arena(tc_buffer_arena, tc_buffer_node) != TC_OK) {
+        tc_warn("frame arena unavailable, allocating frames one by one");
+    }
+    tc_framebuffer_set_stats(tc_buffer_stats);
 
     if (verbose & TC_INFO) {
         tc_log_info(PACKAGE, "V: video buffer     | %i @ %ix%i [0x%x]",
@@ -2830,6 +2866,11 @@ int main(int argc, char *argv[])
                     tc_get_frames_encoded()/vob->ex_fps);
     }
 
+    if (tc_buffer_stats)
+        tc_framebuffer_report_stats(log_buffer_stats, NULL);
+    if (tc_import_stats)
+        tc_import_report_stats();
+
 #ifdef STATBUFFER
     // free buffers
     vframe_free();
@@ -420,8 +420,13 @@ extern int fast_resize;
 
 extern int tc_buffer_delay_dec;
 extern int tc_buffer_delay_enc;
+extern int tc_buffer_lockfree;
+extern int tc_buffer_arena;
+extern int tc_buffer_node;
+extern int tc_buffer_stats;
 extern int tc_cluster_mode;
 extern int tc_decoder_delay;
+extern int tc_import_stats;
 extern int tc_progress_meter;
 extern int tc_progress_rate;
 extern int tc_accel;
@@ -431,6 +436,10 @@ extern int tc_niceness;
 
 extern int max_frame_buffer;
 extern int max_frame_threads;
+extern int max_encoder_threads;
+extern int max_import_threads;
+extern int max_mplex_queue;
+extern int tc_import_segment;
 
 // Various constants
 
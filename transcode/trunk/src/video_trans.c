@@ -12,6 +12,7 @@
 #include "transcode.h"
 #include "framebuffer.h"
 #include "video_trans.h"
+#include "frame_threads.h"
 #include "libtcvideo/tcvideo.h"
 
 /*************************************************************************/
@@ -30,6 +31,12 @@ typedef struct {
     int width_div[3];        // width divisors for each plane
     int height_div[3];       // height divisors for each plane
     uint8_t black_pixel[3];  // "black" value for each plane (e.g. 128 for U/V)
+    /* Pending pixel selection, see view_start() and friends */
+    int view_w, view_h;      // frame size seen through the view (0 if none)
+    uint8_t *view_planes[3]; // first pixel of the view in each plane
+    int view_xstep[3];       // bytes from one view pixel to the next
+    int view_ystep[3];       // bytes from one view line to the next
+    int uvswap;              // U/V swap (-k) not yet done
 } video_trans_data_t;
 
 /* Macro to perform a transformation on a frame.  `vtd' is a pointer to a
@@ -51,13 +58,66 @@ typedef struct {
     swap_buffers(vtd);                                          \
 } while (0)
 
-/* Handle for calling tcvideo functions. */
-static TCVHandle handle = 0;
+/* Handles for calling tcvideo functions.  A handle holds lookup tables
+ * and temporary buffers, so each frame processing thread gets its own
+ * (and keeps it, with its cached tables, for the whole run). */
+static pthread_key_t handle_key;
+static pthread_once_t handle_key_once = PTHREAD_ONCE_INIT;
 
 /*************************************************************************/
 /*************************** Internal routines ***************************/
 /*************************************************************************/
 
+/**
+ * slice_runner:  TCVSliceRunner function for the tcvideo handles: lets
+ * the other video worker threads process bands of a frame.
+ */
+
+static int slice_runner(TCVSliceFunc func, void *data, int rows)
+{
+    return tc_frame_threads_run_slices(func, data, rows) == TC_OK;
+}
+
+static void free_handle(void *handle)
+{
+    tcv_free(handle);
+}
+
+static void create_handle_key(void)
+{
+    pthread_key_create(&handle_key, free_handle);
+}
+
+/**
+ * get_handle:  Return the tcvideo handle of the calling thread,
+ * allocating it if necessary.
+ *
+ * Parameters:
+ *     None.
+ * Return value:
+ *     The handle, or 0 on error.
+ */
+
+static TCVHandle get_handle(void)
+{
+    TCVHandle handle;
+
+    pthread_once(&handle_key_once, create_handle_key);
+    handle = pthread_getspecific(handle_key);
+    if (!handle) {
+        handle = tcv_init();
+        if (!handle) {
+            tc_log_error(PACKAGE, "video_trans.c: tcv_init() failed!");
+            return 0;
+        }
+        tcv_set_slice_runner(handle, slice_runner);
+        pthread_setspecific(handle_key, handle);
+    }
+    return handle;
+}
+
+/*************************************************************************/
+
 /**
  * set_vtd:  Initialize the given vtd structure from the given
  * vframe_list_t, and update ptr->video_size.
@@ -76,6 +136,8 @@ static void set_vtd(video_trans_data_t *vtd, vframe_list_t *ptr)
     vtd->ptr = ptr;
     vtd->preadj_w = 0;
     vtd->preadj_h = 0;
+    vtd->view_w = 0;
+    vtd->view_h = 0;
     /* Set some defaults */
     vtd->Bpp = 1;
     vtd->nplanes = 1;
@@ -164,6 +226,10 @@ static void swap_buffers(video_trans_data_t *vtd)
 {
     vtd->ptr->video_buf = vtd->ptr->video_buf_Y[vtd->ptr->free];
     vtd->ptr->free = (vtd->ptr->free==0) ? 1 : 0;
+    /* The old buffer becomes the new temporary one; if it was shared
+     * with other frames, let them keep it (no copy is needed, since
+     * the current data is now in the other buffer). */
+    vframe_make_writable(vtd->ptr);
     /* Install new width/height if preadjust_frame_size() was called */
     if (vtd->preadj_w && vtd->preadj_h) {
         vtd->ptr->v_width = vtd->preadj_w;
@@ -175,6 +241,281 @@ static void swap_buffers(video_trans_data_t *vtd)
     set_vtd(vtd, vtd->ptr);
 }
 
+/*************************************************************************/
+
+/**
+ * make_writable:  Prepare for an operation modifying the current frame
+ * buffer in place, which may be shared with other frames (see
+ * vframe_dup()).
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ * Return value:
+ *     None.
+ */
+
+static void make_writable(video_trans_data_t *vtd)
+{
+    uint8_t *buf = vtd->ptr->video_buf;
+
+    vframe_make_writable(vtd->ptr);
+    if (vtd->ptr->video_buf != buf)
+        set_vtd(vtd, vtd->ptr);
+}
+
+/*************************************************************************/
+
+/* Operations which only select or reorder pixels (clipping without
+ * borders, -r reduction, dropping a field, and flipping) are not performed
+ * right away; instead they are accumulated in a "view" of the current
+ * buffer, given by a starting pointer and signed pixel and line steps for
+ * each plane.  The view is then read directly by the next zoom (if its
+ * pixels and lines are in order), or copied out in a single pass by
+ * flush_view() before any other operation.  Thus, for example, -j, -Z,
+ * -Y, -r and -z together cost one zoom and one copy instead of five full
+ * passes over the frame.
+ *
+ * In the same way, the U/V swap done by -k for YUV frames is merged into
+ * the first such pass, since it commutes with all the preceding steps. */
+
+/**
+ * view_start:  Set up a view of the current buffer if none is active.
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ * Return value:
+ *     None.
+ */
+
+static void view_start(video_trans_data_t *vtd)
+{
+    int i;
+
+    if (vtd->view_w)
+        return;
+    vtd->view_w = vtd->ptr->v_width;
+    vtd->view_h = vtd->ptr->v_height;
+    for (i = 0; i < vtd->nplanes; i++) {
+        vtd->view_planes[i] = vtd->planes[i];
+        vtd->view_xstep[i] = vtd->Bpp;
+        vtd->view_ystep[i] = (vtd->ptr->v_width / vtd->width_div[i])
+                           * vtd->Bpp;
+    }
+}
+
+/*************************************************************************/
+
+/**
+ * view_clip:  Clip the view.  Only clipping is possible (not expansion),
+ * so if any of the parameters is negative, or the result would be empty,
+ * nothing is done and the caller must use tcv_clip() instead.
+ *
+ * Parameters:
+ *             vtd: Pointer to video frame data.
+ *       clip_left: Number of pixels to clip from left edge.
+ *      clip_right: Number of pixels to clip from right edge.
+ *        clip_top: Number of pixels to clip from top edge.
+ *     clip_bottom: Number of pixels to clip from bottom edge.
+ * Return value:
+ *     Nonzero if the view was clipped, zero otherwise.
+ */
+
+static int view_clip(video_trans_data_t *vtd, int clip_left, int clip_right,
+                     int clip_top, int clip_bottom)
+{
+    int width  = vtd->view_w ? vtd->view_w : vtd->ptr->v_width;
+    int height = vtd->view_h ? vtd->view_h : vtd->ptr->v_height;
+    int i;
+
+    if (clip_left < 0 || clip_right < 0 || clip_top < 0 || clip_bottom < 0
+     || clip_left + clip_right >= width || clip_top + clip_bottom >= height
+    ) {
+        return 0;
+    }
+    view_start(vtd);
+    for (i = 0; i < vtd->nplanes; i++) {
+        vtd->view_planes[i] +=
+            (clip_top  / vtd->height_div[i]) * vtd->view_ystep[i]
+          + (clip_left / vtd->width_div[i])  * vtd->view_xstep[i];
+    }
+    vtd->view_w -= clip_left + clip_right;
+    vtd->view_h -= clip_top + clip_bottom;
+    return 1;
+}
+
+/*************************************************************************/
+
+/**
+ * view_reduce:  Keep only every `reduce_w'th pixel and `reduce_h'th line
+ * of the view (as tcv_reduce()).
+ *
+ * Parameters:
+ *          vtd: Pointer to video frame data.
+ *     reduce_w: Ratio to reduce width by.
+ *     reduce_h: Ratio to reduce height by.
+ * Return value:
+ *     None.
+ */
+
+static void view_reduce(video_trans_data_t *vtd, int reduce_w, int reduce_h)
+{
+    int i;
+
+    view_start(vtd);
+    for (i = 0; i < vtd->nplanes; i++) {
+        vtd->view_xstep[i] *= reduce_w;
+        vtd->view_ystep[i] *= reduce_h;
+    }
+    vtd->view_w /= reduce_w;
+    vtd->view_h /= reduce_h;
+}
+
+/*************************************************************************/
+
+/**
+ * view_flip_v, view_flip_h:  Flip the view vertically or horizontally.
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ * Return value:
+ *     None.
+ */
+
+static void view_flip_v(video_trans_data_t *vtd)
+{
+    int i;
+
+    view_start(vtd);
+    for (i = 0; i < vtd->nplanes; i++) {
+        vtd->view_planes[i] += (vtd->view_h / vtd->height_div[i] - 1)
+                             * vtd->view_ystep[i];
+        vtd->view_ystep[i] = -vtd->view_ystep[i];
+    }
+}
+
+static void view_flip_h(video_trans_data_t *vtd)
+{
+    int i;
+
+    view_start(vtd);
+    for (i = 0; i < vtd->nplanes; i++) {
+        vtd->view_planes[i] += (vtd->view_w / vtd->width_div[i] - 1)
+                             * vtd->view_xstep[i];
+        vtd->view_xstep[i] = -vtd->view_xstep[i];
+    }
+}
+
+/*************************************************************************/
+
+/**
+ * dest_plane:  Return the index of the secondary buffer plane to which
+ * plane `i' should be written, taking a pending U/V swap into account.
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ *       i: Plane index.
+ * Return value:
+ *     Destination plane index.
+ */
+
+static inline int dest_plane(const video_trans_data_t *vtd, int i)
+{
+    return (vtd->uvswap && i > 0) ? 3-i : i;
+}
+
+/*************************************************************************/
+
+/**
+ * flush_view:  Copy the pixels selected by the current view (if any) to
+ * the secondary buffer and make that the current buffer.
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ * Return value:
+ *     None.
+ */
+
+static void flush_view(video_trans_data_t *vtd)
+{
+    int i, x, y;
+
+    if (!vtd->view_w)
+        return;
+    preadjust_frame_size(vtd, vtd->view_w, vtd->view_h);
+    for (i = 0; i < vtd->nplanes; i++) {
+        int w = vtd->view_w / vtd->width_div[i];
+        int h = vtd->view_h / vtd->height_div[i];
+        int Bpp = vtd->Bpp, xstep = vtd->view_xstep[i];
+        const uint8_t *src = vtd->view_planes[i];
+        uint8_t *dest = vtd->tmpplanes[dest_plane(vtd, i)];
+
+        for (y = 0; y < h; y++, src += vtd->view_ystep[i], dest += w*Bpp) {
+            if (xstep == Bpp) {
+                ac_memcpy(dest, src, w*Bpp);
+            } else if (Bpp == 1) {
+                for (x = 0; x < w; x++)
+                    dest[x] = src[x*xstep];
+            } else {
+                for (x = 0; x < w; x++) {
+                    dest[x*3  ] = src[x*xstep  ];
+                    dest[x*3+1] = src[x*xstep+1];
+                    dest[x*3+2] = src[x*xstep+2];
+                }
+            }
+        }
+    }
+    if (vtd->nplanes == 3)
+        vtd->uvswap = 0;
+    swap_buffers(vtd);
+}
+
+/*************************************************************************/
+
+/**
+ * zoom_view:  Zoom the current view (or the whole frame, if no view is
+ * active) into the secondary buffer and make that the current buffer.
+ * If the view has any flipped or skipped pixels within a line, it is
+ * flushed first, since the zoom code can only skip whole lines.
+ *
+ * Parameters:
+ *        handle: tcvideo handle.
+ *           vtd: Pointer to video frame data.
+ *         new_w: New frame width.
+ *         new_h: New frame height.
+ *     interlace: Nonzero to zoom the fields of the Y (or RGB) plane
+ *                separately; see tcv_zoom().
+ *        filter: Zoom filter.
+ * Return value:
+ *     None.
+ */
+
+static void zoom_view(TCVHandle handle, video_trans_data_t *vtd,
+                      int new_w, int new_h, int interlace,
+                      TCVZoomFilter filter)
+{
+    int i;
+
+    for (i = 0; vtd->view_w && i < vtd->nplanes; i++) {
+        if (vtd->view_xstep[i] != vtd->Bpp || vtd->view_ystep[i] < 0)
+            flush_view(vtd);
+    }
+    view_start(vtd);
+    preadjust_frame_size(vtd, new_w, new_h);
+    for (i = 0; i < vtd->nplanes; i++) {
+        int plane_h = new_h / vtd->height_div[i];
+        tcv_zoom_stride(handle, vtd->view_planes[i],
+                        vtd->tmpplanes[dest_plane(vtd, i)],
+                        vtd->view_w / vtd->width_div[i],
+                        vtd->view_h / vtd->height_div[i],
+                        vtd->Bpp, vtd->view_ystep[i],
+                        new_w / vtd->width_div[i],
+                        (interlace && i == 0) ? -plane_h : plane_h, filter);
+    }
+    if (vtd->nplanes == 3)
+        vtd->uvswap = 0;
+    swap_buffers(vtd);
+}
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -192,15 +533,20 @@ static void swap_buffers(video_trans_data_t *vtd)
 static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
 {
     video_trans_data_t vtd;  /* for passing to subroutines */
+    TCVHandle handle = get_handle();
+    uint8_t *bufs[2];
 
 
     /**** Sanity check and initialization ****/
 
-    if (ptr->video_buf_Y[0] == ptr->video_buf_Y[1]) {
+    if (!handle)
+        return -1;
+    vframe_get_buffers(ptr, &bufs[0], &bufs[1]);
+    if (bufs[0] == bufs[1]) {
         tc_log_error(__FILE__, "video frame has no temporary buffer!");
         return -1;
     }
-    if (ptr->video_buf == ptr->video_buf_Y[ptr->free]) {
+    if (ptr->video_buf == bufs[ptr->free]) {
         static int warned = 0;
         if (!warned) {
             tc_log_warn(__FILE__, "ptr->free points to wrong buffer"
@@ -210,10 +556,15 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
         ptr->free = !ptr->free;
     }
     set_vtd(&vtd, ptr);
+    vtd.uvswap = (rgbswap && ptr->v_codec != TC_CODEC_RGB24);
 
     /**** -j: clip frame (import) ****/
 
-    if (im_clip) {
+    if (im_clip
+     && !view_clip(&vtd, vob->im_clip_left, vob->im_clip_right,
+                   vob->im_clip_top, vob->im_clip_bottom)
+    ) {
+        flush_view(&vtd);
         preadjust_frame_size(&vtd,
                 ptr->v_width - vob->im_clip_left - vob->im_clip_right,
                 ptr->v_height - vob->im_clip_top - vob->im_clip_bottom);
@@ -231,46 +582,27 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
      || ((ptr->attributes & TC_FRAME_IS_INTERLACED) && ptr->deinter_flag > 0)
     ) {
         int mode = (vob->deinterlace>0 ? vob->deinterlace : ptr->deinter_flag);
-        if (mode == 1) {
-            /* Simple linear interpolation */
-            /* Note that for YUV, we can just leave U and V alone, since
-             * they already cover pairs of lines; thus instead of using
-             * PROCESS_FRAME, we just call tcv_deinterlace() on the Y/RGB
-             * plane, then copy the other two planes and swap_buffers(). */
-            int i;
-            tcv_deinterlace(handle, vtd.planes[0], vtd.tmpplanes[0],
+        if (mode == 1 || mode == 5) {
+            /* Simple linear interpolation (1) or linear blend (5), done
+             * in place.  Note that for YUV, we can just leave U and V
+             * alone, since they already cover pairs of lines; thus
+             * instead of using PROCESS_FRAME, we just call
+             * tcv_deinterlace() on the Y/RGB plane. */
+            flush_view(&vtd);
+            make_writable(&vtd);
+            tcv_deinterlace(handle, vtd.planes[0], vtd.planes[0],
                             ptr->v_width, ptr->v_height, vtd.Bpp,
-                            TCV_DEINTERLACE_INTERPOLATE);
-            for (i = 1; i < vtd.nplanes; i++) {
-                ac_memcpy(vtd.tmpplanes[i], vtd.planes[i],
-                          (ptr->v_width/vtd.width_div[i])
-                          * (ptr->v_height/vtd.height_div[i]));
-            }
-            swap_buffers(&vtd);
+                            mode == 1 ? TCV_DEINTERLACE_INTERPOLATE
+                                      : TCV_DEINTERLACE_LINEAR_BLEND);
         } else if (mode == 3 || mode == 4) {
-            /* Drop every other line (and zoom back out in mode 3) */
-            preadjust_frame_size(&vtd, ptr->v_width, ptr->v_height/2);
-            /* Drop the top or the bottom field?  (Does it matter?) */
-            PROCESS_FRAME(tcv_deinterlace, &vtd,
-                          TCV_DEINTERLACE_DROP_FIELD_BOTTOM);
+            /* Drop every other line (and zoom back out in mode 3); this
+             * keeps the top field, like TCV_DEINTERLACE_DROP_FIELD_BOTTOM.
+             * (Drop the top or the bottom field?  Does it matter?) */
+            view_reduce(&vtd, 1, 2);
             if (mode == 3) {
-                int w = ptr->v_width, h = ptr->v_height*2;
-                preadjust_frame_size(&vtd, w, h);
-                PROCESS_FRAME(tcv_zoom, &vtd, w / vtd.width_div[i],
-                              h / vtd.height_div[i], vob->zoom_filter);
-            }
-        } else if (mode == 5) {
-            /* Linear blend; as for -I 1, only Y is processed in YUV mode */
-            int i;
-            tcv_deinterlace(handle, vtd.planes[0], vtd.tmpplanes[0],
-                            ptr->v_width, ptr->v_height, vtd.Bpp,
-                            TCV_DEINTERLACE_LINEAR_BLEND);
-            for (i = 1; i < vtd.nplanes; i++) {
-                ac_memcpy(vtd.tmpplanes[i], vtd.planes[i],
-                          (ptr->v_width/vtd.width_div[i])
-                          * (ptr->v_height/vtd.height_div[i]));
+                zoom_view(handle, &vtd, vtd.view_w, vtd.view_h*2, 0,
+                          vob->zoom_filter);
             }
-            swap_buffers(&vtd);
         }
         /* else mode 2 (handled by encoder) or unknown: do nothing */
         ptr->attributes &= ~TC_FRAME_IS_INTERLACED;
@@ -280,9 +612,12 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -B: fast resize (down) ****/
 
     if (resize1 || resize2) {
-        int width = ptr->v_width, height = ptr->v_height;
+        int width, height;
         int resize_w = vob->hori_resize2 - vob->hori_resize1;
         int resize_h = vob->vert_resize2 - vob->vert_resize1;
+        flush_view(&vtd);
+        width = ptr->v_width;
+        height = ptr->v_height;
         if (resize_h) {
             preadjust_frame_size(&vtd, width, height+resize_h*8);
             PROCESS_FRAME(tcv_resize, &vtd, 0, resize_h, 8/vtd.width_div[i],
@@ -299,33 +634,19 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -Z: zoom frame (slow resize) ****/
 
     if (zoom) {
-        preadjust_frame_size(&vtd, vob->zoom_width, vob->zoom_height);
-        if (vob->zoom_interlaced) {
-            /* In YUV mode, only handle the first place as interlaced;
-             * the U and V planes are shared between both fields */
-            int i;
-            tcv_zoom(handle, vtd.planes[0], vtd.tmpplanes[0],
-                     ptr->v_width, ptr->v_height, vtd.Bpp,
-                     vob->zoom_width, -vob->zoom_height, vob->zoom_filter);
-            for (i = 1; i < vtd.nplanes; i++) {
-                tcv_zoom(handle, vtd.planes[i], vtd.tmpplanes[i],
-                         ptr->v_width / vtd.width_div[i],
-                         ptr->v_height / vtd.height_div[i], vtd.Bpp,
-                         vob->zoom_width / vtd.width_div[i],
-                         vob->zoom_height / vtd.height_div[i],
-                         vob->zoom_filter);
-            }
-            swap_buffers(&vtd);
-        } else {
-            PROCESS_FRAME(tcv_zoom, &vtd, vob->zoom_width / vtd.width_div[i],
-                          vob->zoom_height / vtd.height_div[i],
-                          vob->zoom_filter);
-        }
+        /* In YUV mode, only the first plane is handled as interlaced;
+         * the U and V planes are shared between both fields */
+        zoom_view(handle, &vtd, vob->zoom_width, vob->zoom_height,
+                  vob->zoom_interlaced, vob->zoom_filter);
     }
 
     /**** -Y: clip frame (export) ****/
 
-    if (ex_clip) {
+    if (ex_clip
+     && !view_clip(&vtd, vob->ex_clip_left, vob->ex_clip_right,
+                   vob->ex_clip_top, vob->ex_clip_bottom)
+    ) {
+        flush_view(&vtd);
         preadjust_frame_size(&vtd,
                 ptr->v_width - vob->ex_clip_left-vob->ex_clip_right,
                 ptr->v_height - vob->ex_clip_top - vob->ex_clip_bottom);
@@ -340,36 +661,41 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -r: rescale video frame ****/
 
     if (rescale) {
-        preadjust_frame_size(&vtd, ptr->v_width / vob->reduce_w,
-                             ptr->v_height / vob->reduce_h);
-        PROCESS_FRAME(tcv_reduce, &vtd, vob->reduce_w, vob->reduce_h);
+        view_reduce(&vtd, vob->reduce_w, vob->reduce_h);
     }
 
     /**** -z: flip frame vertically ****/
 
     if (flip) {
-        PROCESS_FRAME(tcv_flip_v, &vtd);
+        view_flip_v(&vtd);
     }
 
     /**** -l: flip flame horizontally (mirror) ****/
 
     if (mirror) {
-        PROCESS_FRAME(tcv_flip_h, &vtd);
+        view_flip_h(&vtd);
     }
 
+    /* Everything from here on works on whole planes, so copy out any
+     * pending view (this also does the U/V swap for -k if needed) */
+    flush_view(&vtd);
+
     /**** -k: red/blue swap ****/
 
     if (rgbswap) {
         if (ptr->v_codec == TC_CODEC_RGB24) {
             int i;
+            make_writable(&vtd);
             for (i = 0; i < ptr->v_width * ptr->v_height; i++) {
                 uint8_t tmp = vtd.planes[0][i*3];
                 vtd.planes[0][i*3] = vtd.planes[0][i*3+2];
                 vtd.planes[0][i*3+2] = tmp;
             }
-        } else {
+        } else if (vtd.uvswap) {
+            /* Not already done by one of the passes above */
             int UVsize = (ptr->v_width  / vtd.width_div[1])
                        * (ptr->v_height / vtd.height_div[1]) * vtd.Bpp;
+            make_writable(&vtd);
             ac_memcpy(vtd.tmpplanes[1], vtd.planes[1], UVsize);  /* tmp<-U   */
             ac_memcpy(vtd.planes[1], vtd.planes[2], UVsize);     /*   U<-V   */
             ac_memcpy(vtd.planes[2], vtd.tmpplanes[1], UVsize);  /*   V<-tmp */
@@ -379,6 +705,7 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -K: grayscale ****/
 
     if (decolor) {
+        make_writable(&vtd);
         if (ptr->v_codec == TC_CODEC_RGB24) {
             /* Convert to 8-bit grayscale, then back to RGB24.  Just
              * averaging the values won't give us the right intensity. */
@@ -398,6 +725,7 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -G: gamma correction ****/
 
     if (dgamma) {
+        make_writable(&vtd);
         /* Only process the first plane (Y) for YUV; for RGB it's all in
          * one plane anyway */
         tcv_gamma_correct(handle, ptr->video_buf, ptr->video_buf,
@@ -482,18 +810,16 @@ int process_vid_frame(vob_t *vob, vframe_list_t *ptr)
 
 int preprocess_vid_frame(vob_t *vob, vframe_list_t *ptr)
 {
+    TCVHandle handle;
+
     /* Check parameter validity */
     if (!vob || !ptr)
         return -1;
 
     /* Allocate tcvideo handle if necessary */
-    if (!handle) {
-        handle = tcv_init();
-        if (!handle) {
-            tc_log_error(PACKAGE, "video_trans.c: tcv_init() failed!");
-            return -1;
-        }
-    }
+    handle = get_handle();
+    if (!handle)
+        return -1;
 
     /* Check for pass-through mode */
     if (vob->pass_flag & TC_VIDEO)
@@ -547,6 +873,8 @@ int preprocess_vid_frame(vob_t *vob, vframe_list_t *ptr)
 
 int postprocess_vid_frame(vob_t *vob, vframe_list_t *ptr)
 {
+    TCVHandle handle;
+
     /* Check parameter validity */
     if (!vob || !ptr)
         return -1;
@@ -556,6 +884,9 @@ int postprocess_vid_frame(vob_t *vob, vframe_list_t *ptr)
         return 0;
     if (ptr->attributes & TC_FRAME_IS_SKIPPED)
         return 0;
+    handle = get_handle();
+    if (!handle)
+        return -1;
 
     /* Check frame colorspace */
     if (vob->im_v_codec != TC_CODEC_RGB24
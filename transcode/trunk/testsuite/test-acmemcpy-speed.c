@@ -5,7 +5,8 @@ exit $?
 */
 
 /*
- * test-acmemcpy-speed.c - time all accelerated memcpy() implementations
+ * test-acmemcpy-speed.c - time all accelerated memcpy(), average and
+ *                         rescale implementations
  * Written by Andrew Church <achurch@achurch.org>
  *
  * This file is part of transcode, a video stream processing tool.
@@ -27,27 +28,58 @@ exit $?
 #include <signal.h>
 #include <sys/time.h>
 
-#define ac_memcpy local_ac_memcpy  /* to avoid clash with libac.a */
-#define ac_memcpy_init local_ac_memcpy_init  /* to avoid clash with libac.a */
+/* to avoid clashes with libac.a */
+#define ac_memcpy local_ac_memcpy
+#define ac_memcpy_init local_ac_memcpy_init
+#define ac_average local_ac_average
+#define ac_average_init local_ac_average_init
+#define ac_rescale local_ac_rescale
+#define ac_rescale_init local_ac_rescale_init
 #include "aclib/ac.h"
 
-/* Include memcpy.c directly to get access to the particular implementations */
+/* Include the sources directly to get access to the particular
+ * implementations */
 #include "../aclib/memcpy.c"
+#include "../aclib/average.c"
+#include "../aclib/rescale.c"
 #undef ac_memcpy
-/* Make sure all names are available, to simplify function table */
+#undef ac_average
+#undef ac_rescale
+/* Make sure all names are available, to simplify function tables */
 #if !defined(ARCH_X86) || !defined(HAVE_ASM_MMX)
 # define memcpy_mmx memcpy
+# define average_mmx average
+# define rescale_mmx rescale
 #endif
 #if !defined(ARCH_X86) || !defined(HAVE_ASM_SSE)
 # define memcpy_sse memcpy
+# define average_sse average
+#endif
+#if !defined(ARCH_X86) \
+ || (!defined(HAVE_ASM_MMXEXT) && !defined(HAVE_ASM_SSE))
+# define rescale_mmxext rescale
 #endif
 #if !defined(ARCH_X86_64) || !defined(HAVE_ASM_SSE2)
 # define memcpy_amd64 memcpy
 #endif
+#if !defined(HAVE_ASM_SSE2)
+# define average_sse2 average
+# define rescale_sse2 rescale
+#endif
+#if !defined(HAVE_AC_AVX2)
+# define memcpy_avx2 memcpy
+# define average_avx2 average
+# define rescale_avx2 rescale
+#endif
 
-/* Default copy size and test length */
-#define DEF_BLOCKSIZE    0x10000
-#define DEF_TESTTIME  2000  /* milliseconds */
+/* Default test length */
+#define DEF_TESTTIME  1000  /* milliseconds */
+
+/* Default copy sizes: small and medium blocks, then PAL YUV420 and RGB
+ * frames, which is what transcode spends its time on */
+static const int def_sizes[] = {
+    0x1000, 0x10000, 720*576*3/2, 720*576*3, 0
+};
 
 /*************************************************************************/
 
@@ -78,52 +110,6 @@ static void clear_signals(void)
 
 /*************************************************************************/
 
-/* align1 and align2 are 0..63 */
-static void testit(void *(*func)(void *, const void *, size_t), int size,
-                   int align1, int align2, int msec, uint64_t *iterations)
-{
-    char *chunk1, *chunk1_base;
-    char *chunk2, *chunk2_base;
-    int sig;
-    volatile uint64_t iter = 0;
-
-    chunk1_base = malloc(size+128);
-    chunk2_base = malloc(size+128);
-    chunk1 = (char *)(((long)chunk1_base+63) & -64) + align1;
-    chunk2 = (char *)(((long)chunk2_base+63) & -64) + align2;
-    memset(chunk1, 0x11, size);
-    memset(chunk2, 0x22, size);
-
-    set_signals();
-    if ((sig = sigsetjmp(env, 1)) != 0) {
-        if (sig == SIGVTALRM)
-            *iterations = iter;
-        else
-            *iterations = 0;
-    } else {
-        struct itimerval timer;
-
-        timer.it_interval.tv_sec = 0;
-        timer.it_interval.tv_usec = 0;
-        timer.it_value.tv_sec = msec/1000;
-        timer.it_value.tv_usec = msec%1000;
-        if (setitimer(ITIMER_VIRTUAL, &timer, NULL) < 0) {
-            perror("setitimer");
-            exit(1);
-        }
-        for (;;) {
-            (*func)(chunk2, chunk1, size);
-            iter++;
-        }
-    }
-    clear_signals();
-
-    free(chunk1_base);
-    free(chunk2_base);
-}
-
-/*************************************************************************/
-
 /* Turn presence/absence of #define into a number */
 #if defined(ARCH_X86)
 # define defined_ARCH_X86 1
@@ -140,6 +126,11 @@ static void testit(void *(*func)(void *, const void *, size_t), int size,
 #else
 # define defined_HAVE_ASM_MMX 0
 #endif
+#if defined(HAVE_ASM_MMXEXT)
+# define defined_HAVE_ASM_MMXEXT 1
+#else
+# define defined_HAVE_ASM_MMXEXT 0
+#endif
 #if defined(HAVE_ASM_SSE)
 # define defined_HAVE_ASM_SSE 1
 #else
@@ -150,15 +141,26 @@ static void testit(void *(*func)(void *, const void *, size_t), int size,
 #else
 # define defined_HAVE_ASM_SSE2 0
 #endif
+#if defined(HAVE_AC_AVX2)
+# define defined_HAVE_AC_AVX2 1
+#else
+# define defined_HAVE_AC_AVX2 0
+#endif
 
-/* List of routines to test, NULL-terminated */
-static struct {
+/* Routines to test; only the pointer matching the table is set */
+typedef struct {
     const char *name;  /* centered in 5 chars */
     int arch_ok;       /* defined(ARCH_xxx) */
     int acflags;       /* required ac_cpuinfo() flags */
-    void *(*func)(void *, const void *, size_t);
-} testfuncs[] = {
-    { "libc ", 1,                   
+    void *(*memcpy)(void *, const void *, size_t);
+    void (*average)(const uint8_t *, const uint8_t *, uint8_t *, int);
+    void (*rescale)(const uint8_t *, const uint8_t *, uint8_t *, int,
+                    uint32_t, uint32_t);
+} TestFunc;
+
+/* Lists of routines to test, NULL-terminated */
+static TestFunc memcpy_funcs[] = {
+    { "libc ", 1,
                0,                memcpy },
     { " mmx ", defined_ARCH_X86 && defined_HAVE_ASM_MMX,
                AC_MMX,           memcpy_mmx },
@@ -166,10 +168,50 @@ static struct {
                AC_CMOVE|AC_SSE,  memcpy_sse },
     { "amd64", defined_ARCH_X86_64 && defined_HAVE_ASM_SSE2,
                AC_CMOVE|AC_SSE2, memcpy_amd64 },
+    { "avx2 ", defined_HAVE_AC_AVX2,
+               AC_AVX2,          memcpy_avx2 },
+    { NULL }
+};
+
+static TestFunc average_funcs[] = {
+    { "  C  ", 1,
+               0,       NULL, average },
+    { " mmx ", defined_ARCH_X86 && defined_HAVE_ASM_MMX,
+               AC_MMX,  NULL, average_mmx },
+    { " sse ", defined_ARCH_X86 && defined_HAVE_ASM_SSE,
+               AC_SSE,  NULL, average_sse },
+    { "sse2 ", defined_HAVE_ASM_SSE2,
+               AC_SSE2, NULL, average_sse2 },
+    { "avx2 ", defined_HAVE_AC_AVX2,
+               AC_AVX2, NULL, average_avx2 },
     { NULL }
 };
 
-/* Alignments/sizes to test */
+static TestFunc rescale_funcs[] = {
+    { "  C  ", 1,
+               0,         NULL, NULL, rescale },
+    { " mmx ", defined_ARCH_X86 && defined_HAVE_ASM_MMX,
+               AC_MMX,    NULL, NULL, rescale_mmx },
+    { "mmxex", defined_ARCH_X86 && defined_HAVE_ASM_MMXEXT,
+               AC_MMXEXT, NULL, NULL, rescale_mmxext },
+    { "sse2 ", defined_HAVE_ASM_SSE2,
+               AC_SSE2,   NULL, NULL, rescale_sse2 },
+    { "avx2 ", defined_HAVE_AC_AVX2,
+               AC_AVX2,   NULL, NULL, rescale_avx2 },
+    { NULL }
+};
+
+static const struct {
+    const char *name;
+    TestFunc *funcs;
+} testsets[] = {
+    { "memcpy",  memcpy_funcs },
+    { "average", average_funcs },
+    { "rescale", rescale_funcs },
+    { NULL }
+};
+
+/* Alignments to test (source(s), destination) */
 static struct {
     int align1, align2;
 } tests[] = {
@@ -189,79 +231,177 @@ static struct {
     {  8,  1 },
     { 63,  0 },
     { 63,  1 },
-    {  0,  0 },
-    {  0,  1 },
-    {  0,  4 },
-    {  0,  8 },
-    {  0, 63 },
-    {  1,  0 },
-    {  1,  1 },
-    {  1,  4 },
-    {  1,  8 },
-    {  1, 63 },
     { -1, -1 }
 };
 
+/* Number of leading entries of tests[] used without -a */
+#define SHORT_TESTS  2
+
+/*************************************************************************/
+
+/* align1 and align2 are 0..63 */
+static void testit(const TestFunc *func, int size,
+                   int align1, int align2, int msec, uint64_t *iterations)
+{
+    uint8_t *chunk1, *chunk1_base;
+    uint8_t *chunk2, *chunk2_base;
+    uint8_t *chunk3, *chunk3_base;
+    int sig;
+    volatile uint64_t iter = 0;
+
+    chunk1_base = malloc(size+128);
+    chunk2_base = malloc(size+128);
+    chunk3_base = malloc(size+128);
+    chunk1 = (uint8_t *)(((long)chunk1_base+63) & -64) + align1;
+    chunk2 = (uint8_t *)(((long)chunk2_base+63) & -64) + align2;
+    chunk3 = (uint8_t *)(((long)chunk3_base+63) & -64) + align1;
+    memset(chunk1, 0x11, size);
+    memset(chunk2, 0x22, size);
+    memset(chunk3, 0x33, size);
+
+    set_signals();
+    if ((sig = sigsetjmp(env, 1)) != 0) {
+        if (sig == SIGVTALRM)
+            *iterations = iter;
+        else
+            *iterations = 0;
+    } else {
+        struct itimerval timer;
+
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = 0;
+        timer.it_value.tv_sec = msec/1000;
+        timer.it_value.tv_usec = (msec%1000) * 1000;
+        if (setitimer(ITIMER_VIRTUAL, &timer, NULL) < 0) {
+            perror("setitimer");
+            exit(1);
+        }
+        if (func->memcpy) {
+            for (;;) {
+                (*func->memcpy)(chunk2, chunk1, size);
+                iter++;
+            }
+        } else if (func->average) {
+            for (;;) {
+                (*func->average)(chunk1, chunk3, chunk2, size);
+                iter++;
+            }
+        } else {
+            for (;;) {
+                (*func->rescale)(chunk1, chunk3, chunk2, size,
+                                 0x5555, 0xAAAB);
+                iter++;
+            }
+        }
+    }
+    clear_signals();
+
+    free(chunk1_base);
+    free(chunk2_base);
+    free(chunk3_base);
+}
+
+/*************************************************************************/
+
+static void run_set(const char *name, TestFunc *funcs, const int *sizes,
+                    int all_aligns, int testtime)
+{
+    int i, j, s;
+
+    for (i = 0; funcs[i].name; i++) {
+        if ((ac_cpuinfo() & funcs[i].acflags) != funcs[i].acflags)
+            funcs[i].arch_ok = 0;
+    }
+
+    printf("%s: msec/test: %d    Table entries in MB/s (destination)\n",
+           name, testtime);
+    printf("    Size Align ");
+    for (i = 0; funcs[i].name; i++) {
+        if (funcs[i].arch_ok)
+            printf("|%s", funcs[i].name);
+    }
+    printf("\n--------------");
+    for (i = 0; funcs[i].name; i++) {
+        if (funcs[i].arch_ok)
+            printf("+-----");
+    }
+    printf("\n");
+
+    for (s = 0; sizes[s] > 0; s++) {
+        for (i = 0; tests[i].align1 >= 0; i++) {
+            if (!all_aligns && i >= SHORT_TESTS)
+                break;
+            printf("%8d %2d/%2d ", sizes[s],
+                   tests[i].align1, tests[i].align2);
+            fflush(stdout);
+            for (j = 0; funcs[j].name; j++) {
+                if (funcs[j].arch_ok) {
+                    uint64_t iterations;
+                    testit(&funcs[j], sizes[s],
+                           tests[i].align1, tests[i].align2, testtime,
+                           &iterations);
+                    if (iterations == 0)
+                        printf("|-ERR-");
+                    else
+                        printf("|%5d", (int)(iterations*sizes[s]*1000
+                                             / testtime / (1<<20)));
+                    fflush(stdout);
+                }
+            }
+            printf("\n");
+        }
+    }
+    printf("\n");
+}
+
+/*************************************************************************/
+
 int main(int argc, char *argv[])
 {
-    int size = DEF_BLOCKSIZE, testtime = DEF_TESTTIME;
+    int size = 0, testtime = DEF_TESTTIME, all_aligns = 0;
+    const char *only = NULL;
+    int one_size[2];
+    const int *sizes = def_sizes;
     int ch, i;
 
-    while ((ch = getopt(argc, argv, "hs:t:")) != EOF) {
-        if (ch == 's') {
+    while ((ch = getopt(argc, argv, "af:hs:t:")) != EOF) {
+        if (ch == 'a') {
+            all_aligns = 1;
+        } else if (ch == 'f') {
+            only = optarg;
+        } else if (ch == 's') {
             size = atoi(optarg);
+            if (size <= 0)
+                goto usage;
         } else if (ch == 't') {
             testtime = atoi(optarg);
         } else {
           usage:
             fprintf(stderr,
-                    "Usage: %s [-s blocksize] [-t msec-per-test]\n"
-                    "Defaults: -s %d -t %d\n",
-                    argv[0], DEF_BLOCKSIZE, DEF_TESTTIME);
+                    "Usage: %s [-a] [-f routine] [-s blocksize]"
+                    " [-t msec-per-test]\n"
+                    "-a: test all source/destination alignments\n"
+                    "-f: only test the given routine (memcpy, average,"
+                    " rescale)\n"
+                    "-s: only test the given block size (default: 4k, 64k,"
+                    " PAL YUV420 and RGB frames)\n"
+                    "Defaults: -t %d\n",
+                    argv[0], DEF_TESTTIME);
             return 1;
         }
     }
-    if (size <= 0 || testtime <= 0)
+    if (testtime <= 0)
         goto usage;
-
-    for (i = 0; testfuncs[i].name; i++) {
-        if ((ac_cpuinfo() & testfuncs[i].acflags) != testfuncs[i].acflags)
-            testfuncs[i].arch_ok = 0;
-    }
-
-    printf("Size: %d  msec/test: %d    Table entries in MB/s\n",
-           size, testtime);
-    printf("Align ");
-    for (i = 0; testfuncs[i].name; i++) {
-        if (testfuncs[i].arch_ok)
-            printf("|%s", testfuncs[i].name);
-    }
-    printf("\n------");
-    for (i = 0; testfuncs[i].name; i++) {
-        if (testfuncs[i].arch_ok)
-            printf("+-----");
+    if (size > 0) {
+        one_size[0] = size;
+        one_size[1] = 0;
+        sizes = one_size;
     }
-    printf("\n");
 
-    for (i = 0; tests[i].align1 >= 0; i++) {
-        int j;
-        printf("%2d/%2d ", tests[i].align1, tests[i].align2);
-        fflush(stdout);
-        for (j = 0; testfuncs[j].name; j++) {
-            if (testfuncs[j].arch_ok) {
-                uint64_t iterations;
-                testit(testfuncs[j].func, size,
-                       tests[i].align1, tests[i].align2, testtime,
-                       &iterations);
-                if (iterations == 0)
-                    printf("|-ERR-");
-                else
-                    printf("|%5d",
-                           (int)(iterations*size*1000 / testtime / (1<<20)));
-                fflush(stdout);
-            }
-        }
-        printf("\n");
+    for (i = 0; testsets[i].name; i++) {
+        if (!only || strcmp(only, testsets[i].name) == 0)
+            run_set(testsets[i].name, testsets[i].funcs, sizes,
+                    all_aligns, testtime);
     }
     return 0;
 }
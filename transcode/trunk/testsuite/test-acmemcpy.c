@@ -45,6 +45,9 @@ exit $?
 #if !defined(ARCH_X86_64) || !defined(HAVE_ASM_SSE2)
 # define memcpy_amd64 memcpy
 #endif
+#if !defined(HAVE_AC_AVX2)
+# define memcpy_avx2 memcpy
+#endif
 
 /* Constant `spill' value for tests */
 static const int SPILL = 8;
@@ -158,6 +161,11 @@ static int testit(void *(*func)(void *, const void *, size_t),
 #else
 # define defined_HAVE_ASM_SSE2 0
 #endif
+#if defined(HAVE_AC_AVX2)
+# define defined_HAVE_AC_AVX2 1
+#else
+# define defined_HAVE_AC_AVX2 0
+#endif
 
 /* List of routines to test, NULL-terminated */
 static struct {
@@ -172,6 +180,8 @@ static struct {
                AC_CMOVE|AC_SSE,  memcpy_sse },
     { "amd64", defined_ARCH_X86_64 && defined_HAVE_ASM_SSE2,
                AC_CMOVE|AC_SSE2, memcpy_amd64 },
+    { "avx2",  defined_HAVE_AC_AVX2,
+               AC_AVX2,          memcpy_avx2 },
     { NULL }
 };
 
@@ -190,6 +200,9 @@ static struct {
     /* Test large block size plus up to 2 cache lines minus 1 */
     {"sse",   0x10040, 0x100BF, 64},
     {"amd64", 0x38000, 0x3807F, 64},
+    /* Streaming copy (every destination alignment gives a different
+     * head and tail length, so a few sizes are enough) */
+    {"avx2",  0x100000, 0x100001, 32},
     /* End of list */
     {NULL,0,0}
 };
@@ -38,6 +38,9 @@
 #if !defined(HAVE_ASM_SSE2)
 # define average_sse2 average
 #endif
+#if !defined(HAVE_AC_AVX2)
+# define average_avx2 average
+#endif
 
 /* Constant `spill' value for tests */
 static const int SPILL = 8;
@@ -153,6 +156,11 @@ static int testit(void (*func)(const uint8_t *, const uint8_t *, uint8_t *, int)
 #else
 # define defined_HAVE_ASM_SSE2 0
 #endif
+#if defined(HAVE_AC_AVX2)
+# define defined_HAVE_AC_AVX2 1
+#else
+# define defined_HAVE_AC_AVX2 0
+#endif
 
 /* List of routines to test, NULL-terminated */
 static struct {
@@ -167,6 +175,8 @@ static struct {
               AC_SSE,  average_sse },
     { "sse2", defined_HAVE_ASM_SSE2,
               AC_SSE2, average_sse2 },
+    { "avx2", defined_HAVE_AC_AVX2,
+              AC_AVX2, average_avx2 },
     { NULL }
 };
 
@@ -228,7 +228,7 @@ static int checkall(uint8_t *srcimage, int accel, const char *name)
 static const char *accel_flags(int accel)
 {
     static char buf[1000];
-    snprintf(buf, sizeof(buf), "%s%s%s%s%s%s%s%s%s%s",
+    snprintf(buf, sizeof(buf), "%s%s%s%s%s%s%s%s%s%s%s",
            !accel                ? " none"     : "",
            (accel & AC_IA32ASM ) ? " ia32asm"  : "",
            (accel & AC_AMD64ASM) ? " amd64asm" : "",
@@ -238,7 +238,8 @@ static const char *accel_flags(int accel)
            (accel & AC_3DNOW   ) ? " 3dnow"    : "",
            (accel & AC_SSE     ) ? " sse"      : "",
            (accel & AC_SSE2    ) ? " sse2"     : "",
-           (accel & AC_SSE3    ) ? " sse3"     : "");
+           (accel & AC_SSE3    ) ? " sse3"     : "",
+           (accel & AC_AVX2    ) ? " avx2"     : "");
     return buf;
 }
 
@@ -301,6 +302,8 @@ int main(int argc, char **argv)
             accel |= AC_SSE2;
         else if (strcmp(argv[argc],"sse3") == 0)
             accel |= AC_SSE3;
+        else if (strcmp(argv[argc],"avx2") == 0)
+            accel |= AC_AVX2;
         else if (argv[argc][0] == '=') {
             char *s = argv[argc]+1;
             for (i = 0; fmtlist[i].fmt != IMG_NONE; i++) {
@@ -363,23 +366,32 @@ int main(int argc, char **argv)
         srcbuf[i] = random();
 
     if (check) {
+        /* Go through all the sets, so that a failure in one of them does
+         * not hide the results of the others */
+        int failed = 0;
         if (ac_cpuinfo() & (AC_IA32ASM | AC_AMD64ASM)) {
             if (!checkall(srcbuf, AC_IA32ASM | AC_AMD64ASM,
                           verbose ? "asm" : NULL))
-                return 1;
+                failed = 1;
         }
         if (ac_cpuinfo() & AC_MMX) {
             if (!checkall(srcbuf, AC_IA32ASM | AC_AMD64ASM | AC_MMX,
                           verbose ? "mmx" : NULL))
-                return 1;
+                failed = 1;
         }
         if (ac_cpuinfo() & AC_SSE2) {
             if (!checkall(srcbuf, AC_IA32ASM | AC_AMD64ASM | AC_CMOVE
                                 | AC_MMX | AC_SSE | AC_SSE2,
                           verbose ? "sse2" : NULL))
-                return 1;
+                failed = 1;
         }
-        return 0;
+        if (ac_cpuinfo() & AC_AVX2) {
+            if (!checkall(srcbuf, AC_IA32ASM | AC_AMD64ASM | AC_CMOVE
+                                | AC_MMX | AC_SSE | AC_SSE2 | AC_AVX2,
+                          verbose ? "avx2" : NULL))
+                failed = 1;
+        }
+        return failed;
     }
 
     printf("Acceleration flags:%s\n", accel_flags(accel));
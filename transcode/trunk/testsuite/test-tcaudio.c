@@ -0,0 +1,185 @@
+/*
+ * test-tcaudio.c - check that the accelerated libtcaudio routines give
+ *                  the same results as the plain C ones
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "aclib/ac.h"
+#include "libtcaudio/tcaudio.h"
+
+/* Constant `spill' value for tests */
+#define SPILL   16
+
+/* Longest buffer tested, in samples, and the buffer size needed for it
+ * (16-bit stereo, plus the spill areas) */
+#define MAXLEN  1000
+#define BUFSIZE (MAXLEN*4 + SPILL*2)
+
+/*************************************************************************/
+
+/* Acceleration sets to compare against AC_NONE */
+static struct {
+    const char *name;
+    int acflags;
+} testaccel[] = {
+    { "sse2",   AC_SSE2 },
+    { "avx2",   AC_AVX2 },
+    { NULL }
+};
+
+static const char *format_names[] = {
+    NULL, "s8", "u8", "s16be", "s16le", "u16be", "u16le",
+};
+
+enum { OP_FROM, OP_TO, OP_AMPLIFY, OP_MONO_TO_STEREO, OP_STEREO_TO_MONO };
+
+static const char *op_names[] = {
+    "convert_from", "convert_to", "amplify", "mono_to_stereo",
+    "stereo_to_mono",
+};
+
+/* Buffer lengths to test, in samples (vector tails, tiny buffers) */
+static const int testlens[] = { 0, 1, 7, 15, 17, 33, 100, 999, MAXLEN, -1 };
+
+/* Scale factors for amplify tests (the larger ones cause clipping) */
+static const double testscales[] = { 0.3, 1.0, 1.7, 4.0, 65537.0, 0 };
+
+/*************************************************************************/
+
+/* Run one operation on a copy of `src' with the given acceleration flags;
+ * the buffer has `SPILL' guard bytes on each side.  Returns the number of
+ * clipped samples for amplify, else 0, or -1 on error. */
+
+static int runop(int accel, uint8_t *buf, const uint8_t *src,
+                 AudioFormat format, int op, AudioFormat other, int len,
+                 double scale)
+{
+    TCAHandle handle;
+    int ok = 0, nclip = 0;
+
+    memcpy(buf, src, BUFSIZE);
+    ac_init(accel);
+    handle = tca_init(format);
+    if (!handle)
+        return -1;
+    switch (op) {
+      case OP_FROM:
+        ok = tca_convert_from(handle, buf + SPILL, len, other);
+        break;
+      case OP_TO:
+        ok = tca_convert_to(handle, buf + SPILL, len, other);
+        break;
+      case OP_AMPLIFY:
+        ok = tca_amplify(handle, buf + SPILL, len, scale, &nclip);
+        break;
+      case OP_MONO_TO_STEREO:
+        ok = tca_mono_to_stereo(handle, buf + SPILL, len);
+        break;
+      case OP_STEREO_TO_MONO:
+        ok = tca_stereo_to_mono(handle, buf + SPILL, len);
+        break;
+    }
+    tca_free(handle);
+    return ok ? nclip : -1;
+}
+
+static int testit(int accel, const uint8_t *src, AudioFormat format, int op,
+                  AudioFormat other, int len, double scale)
+{
+    static uint8_t ref[BUFSIZE], res[BUFSIZE];
+    int refclip, resclip, i;
+
+    refclip = runop(AC_NONE, ref, src, format, op, other, len, scale);
+    resclip = runop(accel, res, src, format, op, other, len, scale);
+    if (refclip < 0 || resclip < 0) {
+        fprintf(stderr, "%s %s len=%d: call failed\n",
+                format_names[format], op_names[op], len);
+        return 0;
+    }
+    if (refclip != resclip) {
+        fprintf(stderr, "%s %s len=%d scale=%g: %d samples clipped"
+                " (expected %d)\n", format_names[format], op_names[op], len,
+                scale, resclip, refclip);
+        return 0;
+    }
+    for (i = 0; i < BUFSIZE; i++) {
+        if (res[i] != ref[i]) {
+            fprintf(stderr, "%s %s %s len=%d: byte %d differs"
+                    " (expected 0x%02X, got 0x%02X)\n",
+                    format_names[format], op_names[op],
+                    (op == OP_FROM || op == OP_TO) ? format_names[other] : "",
+                    len, i - SPILL, ref[i], res[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+int main(int argc, char **argv)
+{
+    static uint8_t src[BUFSIZE];
+    int i, failed = 0;
+
+    srand(0);
+    for (i = 0; i < BUFSIZE; i++)
+        src[i] = rand();
+    for (i = 0; testaccel[i].name; i++) {
+        int format, op, other, len, scale, count = 0, passed = 0;
+
+        if (!(ac_cpuinfo() & testaccel[i].acflags)) {
+            printf("%-8s skipped (not supported by CPU)\n",
+                   testaccel[i].name);
+            continue;
+        }
+        for (format = TCA_S8; format <= TCA_U16LE; format++) {
+            for (len = 0; testlens[len] >= 0; len++) {
+                for (other = TCA_S8; other <= TCA_U16LE; other++) {
+                    count += 2;
+                    passed += testit(testaccel[i].acflags, src, format,
+                                     OP_FROM, other, testlens[len], 0);
+                    passed += testit(testaccel[i].acflags, src, format,
+                                     OP_TO, other, testlens[len], 0);
+                }
+                for (scale = 0; testscales[scale]; scale++) {
+                    count++;
+                    passed += testit(testaccel[i].acflags, src, format,
+                                     OP_AMPLIFY, 0, testlens[len],
+                                     testscales[scale]);
+                }
+                for (op = OP_MONO_TO_STEREO; op <= OP_STEREO_TO_MONO; op++) {
+                    count++;
+                    passed += testit(testaccel[i].acflags, src, format, op,
+                                     0, testlens[len], 0);
+                }
+            }
+        }
+        printf("%-8s %d/%d passed\n", testaccel[i].name, passed, count);
+        if (passed != count)
+            failed = 1;
+    }
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -23,6 +23,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "config.h"
 #include "libtc/libtc.h"
@@ -46,12 +48,12 @@ TCFramePtr tc_frame_fifo_get(TCFrameFifo *F);
 int tc_frame_fifo_put(TCFrameFifo *F, TCFramePtr ptr);
 
 void tc_frame_fifo_del(TCFrameFifo *F);
-TCFrameFifo *tc_frame_fifo_new(int size, int sorted);
+TCFrameFifo *tc_frame_fifo_new(int size, int flags);
 
 
 /*************************************************************************/
 
-#define TC_TEST_BEGIN(NAME, SIZE, SORTED) \
+#define TC_TEST_BEGIN(NAME, SIZE, FLAGS) \
 static int tcframefifo_ ## NAME ## _test(void) \
 { \
     const char *TC_TEST_name = # NAME ; \
@@ -61,7 +63,7 @@ static int tcframefifo_ ## NAME ## _test(void) \
     TCFrameFifo *F = NULL; \
     \
     tc_log_info(__FILE__, "running test: [%s]", # NAME); \
-    F = tc_frame_fifo_new((SIZE), (SORTED)); \
+    F = tc_frame_fifo_new((SIZE), (FLAGS)); \
     if (F) {
 
 
@@ -102,9 +104,11 @@ TC_TEST_failure: \
 /*************************************************************************/
 
 enum {
-    UNSORTED = 0,
-    SORTED   = 1,
-    FIFOSIZE = 10
+    UNSORTED    = 0,
+    SORTED      = 1,
+    LF_UNSORTED = 2, /* lock-free flavours; see framebuffer.c */
+    LF_SORTED   = 3,
+    FIFOSIZE    = 10
 };
 
 static void init_frames(int num, frame_list_t *frames, TCFramePtr *ptrs)
@@ -215,6 +219,167 @@ TC_TEST_BEGIN(S_put1_get1, FIFOSIZE, SORTED)
 TC_TEST_END
 
 
+/*************************************************************************/
+
+TC_TEST_BEGIN(LU_init_empty, FIFOSIZE, LF_UNSORTED)
+    TC_TEST_IS_TRUE(tc_frame_fifo_empty(F));
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 0);
+TC_TEST_END
+
+TC_TEST_BEGIN(LU_put1_get1, FIFOSIZE, LF_UNSORTED)
+    frame_list_t frame[1];
+    TCFramePtr ptr[1];
+    TCFramePtr fp = { .generic = NULL };
+
+    int wakeup = 0;
+    init_frames(1, frame, ptr);
+    
+    wakeup = tc_frame_fifo_put(F, ptr[0]);
+    TC_TEST_IS_TRUE(wakeup);
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 1);
+
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[0].generic);
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 0);
+
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(TCFRAMEPTR_IS_NULL(fp));
+TC_TEST_END
+
+TC_TEST_BEGIN(LU_fill_drain, FIFOSIZE, LF_UNSORTED)
+    frame_list_t frame[FIFOSIZE];
+    TCFramePtr ptr[FIFOSIZE];
+    TCFramePtr fp = { .generic = NULL };
+    int i = 0, lap = 0;
+
+    init_frames(FIFOSIZE, frame, ptr);
+
+    /* more than one lap, to exercise the slot sequence numbers */
+    for (lap = 0; lap < 3; lap++) {
+        for (i = 0; i < FIFOSIZE; i++) {
+            TC_TEST_SET_STEP(i);
+            TC_TEST_IS_TRUE(tc_frame_fifo_put(F, ptr[i]));
+        }
+        TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == FIFOSIZE);
+        for (i = 0; i < FIFOSIZE; i++) {
+            TC_TEST_SET_STEP(i);
+            fp = tc_frame_fifo_get(F);
+            TC_TEST_IS_TRUE(fp.generic == ptr[i].generic);
+        }
+        TC_TEST_UNSET_STEP;
+        TC_TEST_IS_TRUE(tc_frame_fifo_empty(F));
+    }
+TC_TEST_END
+
+TC_TEST_BEGIN(LS_init_empty, FIFOSIZE, LF_SORTED)
+    TC_TEST_IS_TRUE(tc_frame_fifo_empty(F));
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 0);
+TC_TEST_END
+
+TC_TEST_BEGIN(LS_put3_get_ordered, FIFOSIZE, LF_SORTED)
+    frame_list_t frame[3];
+    TCFramePtr ptr[3];
+    TCFramePtr fp = { .generic = NULL };
+
+    init_frames(3, frame, ptr);
+
+    TC_TEST_IS_TRUE(!tc_frame_fifo_put(F, ptr[2]));
+    TC_TEST_IS_TRUE(tc_frame_fifo_empty(F)); /* #0 still missing */
+    TC_TEST_IS_TRUE(!tc_frame_fifo_put(F, ptr[1]));
+    TC_TEST_IS_TRUE(tc_frame_fifo_put(F, ptr[0]));
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 3);
+
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[0].generic);
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[1].generic);
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[2].generic);
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 0);
+TC_TEST_END
+
+/* a cloned frame put back rolls the fifo back to it */
+TC_TEST_BEGIN(LS_clone_rollback, FIFOSIZE, LF_SORTED)
+    frame_list_t frame[3];
+    TCFramePtr ptr[3];
+    TCFramePtr fp = { .generic = NULL };
+
+    init_frames(3, frame, ptr);
+
+    tc_frame_fifo_put(F, ptr[0]);
+    tc_frame_fifo_put(F, ptr[1]);
+    tc_frame_fifo_put(F, ptr[2]);
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[0].generic);
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[1].generic);
+
+    frame[1].attributes |= TC_FRAME_WAS_CLONED;
+    TC_TEST_IS_TRUE(tc_frame_fifo_put(F, ptr[1]));
+    frame[1].attributes &= ~TC_FRAME_WAS_CLONED;
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[1].generic);
+    fp = tc_frame_fifo_get(F);
+    TC_TEST_IS_TRUE(fp.generic == ptr[2].generic);
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == 0);
+TC_TEST_END
+
+/*************************************************************************/
+
+enum {
+    MT_THREADS    = 8,
+    MT_ITERATIONS = 100000,
+};
+
+static void *bounce_frames(void *arg)
+{
+    TCFrameFifo *F = arg;
+    int i = 0;
+
+    for (i = 0; i < MT_ITERATIONS; i++) {
+        TCFramePtr fp = tc_frame_fifo_get(F);
+        while (TCFRAMEPTR_IS_NULL(fp)) {
+            sched_yield();
+            fp = tc_frame_fifo_get(F);
+        }
+        fp.generic->tag++;
+        tc_frame_fifo_put(F, fp);
+    }
+    return NULL;
+}
+
+/* many threads get and put back frames concurrently: none must be lost */
+TC_TEST_BEGIN(LU_threads_bounce, FIFOSIZE, LF_UNSORTED)
+    frame_list_t frame[FIFOSIZE];
+    TCFramePtr ptr[FIFOSIZE];
+    pthread_t tids[MT_THREADS];
+    int seen[FIFOSIZE] = { 0 };
+    int i = 0, bounces = 0;
+
+    init_frames(FIFOSIZE, frame, ptr);
+    for (i = 0; i < FIFOSIZE; i++) {
+        tc_frame_fifo_put(F, ptr[i]);
+    }
+    for (i = 0; i < MT_THREADS; i++) {
+        pthread_create(&tids[i], NULL, bounce_frames, F);
+    }
+    for (i = 0; i < MT_THREADS; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    TC_TEST_IS_TRUE(tc_frame_fifo_size(F) == FIFOSIZE);
+    for (i = 0; i < FIFOSIZE; i++) {
+        TCFramePtr fp = tc_frame_fifo_get(F);
+        TC_TEST_SET_STEP(i);
+        TC_TEST_IS_TRUE(!TCFRAMEPTR_IS_NULL(fp));
+        TC_TEST_IS_TRUE(seen[fp.generic->bufid] == 0);
+        seen[fp.generic->bufid] = 1;
+        bounces += fp.generic->tag;
+    }
+    TC_TEST_UNSET_STEP;
+    TC_TEST_IS_TRUE(bounces == MT_THREADS * MT_ITERATIONS);
+TC_TEST_END
+
 /*************************************************************************/
 
 static int test_frame_fifo_all(void)
@@ -231,6 +396,14 @@ static int test_frame_fifo_all(void)
     TC_RUN_TEST(S_put1);
     TC_RUN_TEST(S_put1_get1);
 
+    TC_RUN_TEST(LU_init_empty);
+    TC_RUN_TEST(LU_put1_get1);
+    TC_RUN_TEST(LU_fill_drain);
+    TC_RUN_TEST(LS_init_empty);
+    TC_RUN_TEST(LS_put3_get_ordered);
+    TC_RUN_TEST(LS_clone_rollback);
+    TC_RUN_TEST(LU_threads_bounce);
+
     return errors;
 }
 
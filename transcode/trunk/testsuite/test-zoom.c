@@ -0,0 +1,166 @@
+/*
+ * test-zoom.c - check that the accelerated zoom_process() filter loops
+ *               give the same results as the plain C ones
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "aclib/ac.h"
+#include "libtcvideo/tcvideo.h"
+#include "libtcvideo/zoom.h"
+
+/* Needed by libtcvideo */
+int verbose = 0;
+
+/* Constant `spill' value for tests */
+static const int SPILL = 16;
+
+/*************************************************************************/
+
+/* Acceleration sets to compare against AC_NONE */
+static struct {
+    const char *name;
+    int acflags;
+} testaccel[] = {
+    { "avx2",   AC_AVX2 },
+    { "avx512", AC_AVX512 },
+    { NULL }
+};
+
+static const char *filter_names[] = {
+    NULL, "hermite", "box", "triangle", "bell", "b_spline", "lanczos3",
+    "mitchell",
+};
+
+/* Image sizes to test: old_w, old_h, new_w, new_h */
+static const int testsizes[][4] = {
+    {  16,  16,  32,  32 },
+    {  17,   9,  31,   7 },     /* odd sizes, vector tails */
+    { 100,  50,  33,  20 },     /* downscaling, many taps */
+    { 720, 576, 640, 480 },
+    { 352, 288, 704, 576 },
+    { 640, 480, 640, 360 },     /* vertical only */
+    { 640, 480, 480, 480 },     /* horizontal only */
+    {   8,   6,  40,  40 },     /* few source pixels */
+    { 0 }
+};
+
+/*************************************************************************/
+
+/* Resize a random image with the given acceleration flags; returns the
+ * destination buffer (with `SPILL' guard bytes on each side), or NULL
+ * on error. */
+
+static uint8_t *zoomit(int accel, const uint8_t *src, const int *size,
+                       int Bpp, TCVZoomFilter filter)
+{
+    int destsize = size[2] * size[3] * Bpp;
+    uint8_t *dest;
+    ZoomInfo *zi;
+
+    dest = malloc(destsize + SPILL*2);
+    if (!dest)
+        return NULL;
+    memset(dest, 0x11, destsize + SPILL*2);
+    ac_init(accel);
+    zi = zoom_init(size[0], size[1], size[2], size[3], Bpp,
+                   size[0] * Bpp, size[2] * Bpp, filter);
+    if (!zi) {
+        free(dest);
+        return NULL;
+    }
+    zoom_process(zi, src, dest + SPILL, NULL);
+    zoom_free(zi);
+    return dest;
+}
+
+static int testit(int accel, const int *size, int Bpp, TCVZoomFilter filter)
+{
+    int srcsize = size[0] * size[1] * Bpp;
+    int destsize = size[2] * size[3] * Bpp;
+    uint8_t *src, *ref = NULL, *res = NULL;
+    int i, ok = 0;
+
+    /* exact size, so that memory checkers can catch overruns */
+    src = malloc(srcsize);
+    if (!src)
+        return 0;
+    for (i = 0; i < srcsize; i++)
+        src[i] = rand();
+
+    ref = zoomit(AC_NONE, src, size, Bpp, filter);
+    res = zoomit(accel, src, size, Bpp, filter);
+    if (ref && res) {
+        ok = 1;
+        for (i = 0; i < destsize + SPILL*2; i++) {
+            if (res[i] != ref[i]) {
+                fprintf(stderr, "%dx%d->%dx%d Bpp=%d %s: byte %d differs"
+                        " (expected 0x%02X, got 0x%02X)\n",
+                        size[0], size[1], size[2], size[3], Bpp,
+                        filter_names[filter], i - SPILL, ref[i], res[i]);
+                ok = 0;
+                break;
+            }
+        }
+    }
+    free(src);
+    free(ref);
+    free(res);
+    return ok;
+}
+
+/*************************************************************************/
+
+int main(int argc, char **argv)
+{
+    static const int Bpps[] = { 1, 3, 4 };
+    int i, failed = 0;
+
+    srand(0);
+    for (i = 0; testaccel[i].name; i++) {
+        int size, b, filter, count = 0, passed = 0;
+
+        if (!(ac_cpuinfo() & testaccel[i].acflags)) {
+            printf("%-8s skipped (not supported by CPU)\n",
+                   testaccel[i].name);
+            continue;
+        }
+        for (size = 0; testsizes[size][0]; size++) {
+            for (b = 0; b < sizeof(Bpps) / sizeof(*Bpps); b++) {
+                for (filter = TCV_ZOOM_HERMITE;
+                     filter <= TCV_ZOOM_MITCHELL;
+                     filter++
+                ) {
+                    count++;
+                    passed += testit(testaccel[i].acflags, testsizes[size],
+                                     Bpps[b], filter);
+                }
+            }
+        }
+        printf("%-8s %d/%d passed\n", testaccel[i].name, passed, count);
+        if (passed != count)
+            failed = 1;
+    }
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */